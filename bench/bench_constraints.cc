@@ -0,0 +1,167 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * v2RDM-CASSCF, a plugin to:
+ *
+ * Psi4: an open-source quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (c) 2014, The Florida State University. All rights reserved.
+ * 
+ *@END LICENSE
+ *
+ */
+
+/*================================================================
+
+   bench_constraints: standalone benchmark of the constraint maps
+
+   builds the v2RDM index machinery for a synthetic active space
+   (no molecule, SCF, or integrals) and calls
+   v2RDMSolver::BenchmarkConstraints(), which times every A.u and 
+   A^T.u kernel and checks <A.u,v> = <u,A^T.v> for each family.
+
+   usage: bench_constraints [flags] ACTIVE NALPHA NBETA
+
+     ACTIVE   active orbitals per irrep, e.g., 4,1,2,1 (C2v) or 10 (C1)
+     NALPHA   number of active alpha electrons
+     NBETA    number of active beta electrons
+
+     --positivity P   POSITIVITY (D, DQ, DG, DQG, DQGT1, DQGT2, DQGT1T2)
+     --d3             CONSTRAIN_D3 true
+     --spin-adapt     SPIN_ADAPT_Q2 and SPIN_ADAPT_G2 true
+     --no-spin        CONSTRAIN_SPIN false
+     --slow-t2        SLOW_T2_CONSTRAINTS true (affects only the total)
+     --tasks          CONSTRAINT_TASKS true (affects only the total)
+     --repeat N       number of calls averaged per kernel (default 10)
+
+   the exit status is 1 if any adjoint check fails.
+
+================================================================*/
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+
+#include<string>
+#include<vector>
+
+#include <psi4/psi4-dec.h>
+#include <psi4/liboptions/liboptions.h>
+#include <psi4/libpsi4util/PsiOutStream.h>
+#include <psi4/libpsi4util/exception.h>
+
+#include"../v2rdm_solver.h"
+
+using namespace psi;
+
+namespace psi{ namespace v2rdm_casscf{
+    extern "C" int read_options(std::string name, Options& options);
+}}
+
+static void usage(const char * name) {
+    printf("\n");
+    printf("    usage: %s [flags] ACTIVE NALPHA NBETA\n",name);
+    printf("\n");
+    printf("        ACTIVE   active orbitals per irrep, e.g., 4,1,2,1 (C2v) or 10 (C1)\n");
+    printf("        NALPHA   number of active alpha electrons\n");
+    printf("        NBETA    number of active beta electrons\n");
+    printf("\n");
+    printf("        --positivity P   D, DQ, DG, DQG, DQGT1, DQGT2, or DQGT1T2 (default DQG)\n");
+    printf("        --d3             constrain D3\n");
+    printf("        --spin-adapt     spin adapt Q2 and G2\n");
+    printf("        --no-spin        do not constrain spin\n");
+    printf("        --slow-t2        reference T2 kernels in the total A.u and A^T.u\n");
+    printf("        --tasks          constraint families as OpenMP tasks in the total A.u and A^T.u\n");
+    printf("        --repeat N       number of calls averaged per kernel (default 10)\n");
+    printf("\n");
+}
+
+int main(int argc, char * argv[]) {
+
+    std::string positivity = "DQG";
+    bool d3         = false;
+    bool spin_adapt = false;
+    bool spin       = true;
+    bool slow_t2    = false;
+    bool tasks      = false;
+    int  nrepeat    = 10;
+
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++) {
+        if ( strcmp(argv[i],"--positivity") == 0 && i + 1 < argc ) {
+            positivity = argv[++i];
+        }else if ( strcmp(argv[i],"--repeat") == 0 && i + 1 < argc ) {
+            nrepeat = atoi(argv[++i]);
+        }else if ( strcmp(argv[i],"--d3") == 0 ) {
+            d3 = true;
+        }else if ( strcmp(argv[i],"--spin-adapt") == 0 ) {
+            spin_adapt = true;
+        }else if ( strcmp(argv[i],"--no-spin") == 0 ) {
+            spin = false;
+        }else if ( strcmp(argv[i],"--slow-t2") == 0 ) {
+            slow_t2 = true;
+        }else if ( strcmp(argv[i],"--tasks") == 0 ) {
+            tasks = true;
+        }else if ( argv[i][0] == '-' && argv[i][1] == '-' ) {
+            usage(argv[0]);
+            return 2;
+        }else {
+            args.push_back(argv[i]);
+        }
+    }
+    if ( args.size() != 3 ) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // active orbitals per irrep
+    std::vector<int> amopi;
+    std::string active = args[0];
+    size_t pos = 0;
+    while ( pos <= active.size() ) {
+        size_t next = active.find(',',pos);
+        if ( next == std::string::npos ) next = active.size();
+        amopi.push_back(atoi(active.substr(pos,next-pos).c_str()));
+        pos = next + 1;
+    }
+    int nalpha = atoi(args[1].c_str());
+    int nbeta  = atoi(args[2].c_str());
+
+    outfile = std::shared_ptr<PsiOutStream>(new PsiOutStream());
+
+    Options options;
+    options.set_current_module("V2RDM_CASSCF");
+    v2rdm_casscf::read_options("V2RDM_CASSCF",options);
+    options.set_str("V2RDM_CASSCF","POSITIVITY",positivity);
+    options.set_bool("V2RDM_CASSCF","CONSTRAIN_D3",d3);
+    options.set_bool("V2RDM_CASSCF","SPIN_ADAPT_Q2",spin_adapt);
+    options.set_bool("V2RDM_CASSCF","SPIN_ADAPT_G2",spin_adapt);
+    options.set_bool("V2RDM_CASSCF","CONSTRAIN_SPIN",spin);
+    options.set_bool("V2RDM_CASSCF","SLOW_T2_CONSTRAINTS",slow_t2);
+    options.set_bool("V2RDM_CASSCF","CONSTRAINT_TASKS",tasks);
+
+    bool pass = false;
+    try {
+        std::shared_ptr<v2rdm_casscf::v2RDMSolver> v2rdm (new v2rdm_casscf::v2RDMSolver(options,(int)amopi.size(),amopi.data(),nalpha,nbeta));
+        pass = v2rdm->BenchmarkConstraints(nrepeat);
+    }catch (PsiException & e) {
+        printf("\n    error: %s\n\n",e.what());
+        return 2;
+    }
+
+    return pass ? 0 : 1;
+}
@@ -28,6 +28,7 @@
 #include<stdio.h>
 #include<stdlib.h>
 #include<math.h>
+#include<time.h>
 
 #include <psi4/libplugin/plugin.h>
 #include <psi4/psi4-dec.h>
@@ -38,6 +39,12 @@
 #include <psi4/libqt/qt.h>
 #include "cg_solver.h"
 
+#ifdef _OPENMP
+    #include<omp.h>
+#else
+    #define omp_get_wtime() ( (double)clock() / CLOCKS_PER_SEC )
+#endif
+
 
 namespace psi{ 
 
@@ -46,9 +53,10 @@ CGSolver::CGSolver(long int n) {
     iter_           = 0;
     cg_max_iter_    = 10000;
     cg_convergence_ = 1e-9;
+    timers_         = NULL;
     p = SharedVector(new Vector(n));
     r = SharedVector(new Vector(n));
-    //z = SharedVector(new Vector(n));
+    z = SharedVector(new Vector(n));
 }
 CGSolver::~CGSolver(){
 }
@@ -58,6 +66,32 @@ void CGSolver::set_max_iter(int iter) {
 void CGSolver::set_convergence(double conv) {
     cg_convergence_ = conv;
 }
+void CGSolver::set_timers(v2rdm_casscf::Timers * timers) {
+    timers_ = timers;
+}
+
+// timed wrappers for the callbacks and the vector operations
+void CGSolver::evaluate(CallbackType function, long int n, SharedVector out, SharedVector in, void * data, int timer) {
+    double start = omp_get_wtime();
+    function(n,out,in,data);
+    if ( timers_ ) timers_->accumulate(timer,omp_get_wtime() - start);
+}
+double CGSolver::dot(double * x, double * y) {
+    double start = omp_get_wtime();
+    double val = C_DDOT(n_,x,1,y,1);
+    if ( timers_ ) timers_->accumulate(v2rdm_casscf::TIMER_CG_DOT,omp_get_wtime() - start);
+    return val;
+}
+void CGSolver::axpy(double alpha, double * x, double * y) {
+    double start = omp_get_wtime();
+    C_DAXPY(n_,alpha,x,1,y,1);
+    if ( timers_ ) timers_->accumulate(v2rdm_casscf::TIMER_CG_AXPY,omp_get_wtime() - start);
+}
+void CGSolver::scal(double alpha, double * x) {
+    double start = omp_get_wtime();
+    C_DSCAL(n_,alpha,x,1);
+    if ( timers_ ) timers_->accumulate(v2rdm_casscf::TIMER_CG_AXPY,omp_get_wtime() - start);
+}
 
 void CGSolver::preconditioned_solve(long int n,
                     SharedVector Ap, 
@@ -78,7 +112,7 @@ void CGSolver::preconditioned_solve(long int n,
     double beta  = 0.0;
 
     // call some function to evaluate A.x.  Result in Ap
-    function(n,Ap,x,data);
+    evaluate(function,n,Ap,x,data,v2rdm_casscf::TIMER_CG_AX);
 
     double * b_p      = b->pointer();
     double * x_p      = x->pointer();
@@ -95,27 +129,92 @@ void CGSolver::preconditioned_solve(long int n,
     do {
 
         // call some function to evaluate A.p.  Result in Ap
-        function(n,Ap,p,data);
+        evaluate(function,n,Ap,p,data,v2rdm_casscf::TIMER_CG_AX);
 
-        double rz  = C_DDOT(n_,r_p,1,z_p,1);
-        double pap = C_DDOT(n_,p_p,1,Ap_p,1);
+        double rz  = dot(r_p,z_p);
+        double pap = dot(p_p,Ap_p);
         double alpha = rz / pap;
-        C_DAXPY(n_,alpha,p_p,1,x_p,1);
-        C_DAXPY(n_,-alpha,Ap_p,1,r_p,1);
+        axpy(alpha,p_p,x_p);
+        axpy(-alpha,Ap_p,r_p);
 
         // if r is sufficiently small, then exit loop
-        double rrnew = C_DDOT(n_,r_p,1,r_p,1);
+        double rrnew = dot(r_p,r_p);
         double nrm = sqrt(rrnew);// / sqrt(n_);
         if ( nrm < cg_convergence_ ) break;
 
+        double start = omp_get_wtime();
         for (int i = 0; i < n; i++) {
             z_p[i] = precon_p[i] * r_p[i];
         }
-        double rznew  = C_DDOT(n_,r_p,1,z_p,1);
+        if ( timers_ ) timers_->accumulate(v2rdm_casscf::TIMER_CG_PRECONDITION,omp_get_wtime() - start);
+        double rznew  = dot(r_p,z_p);
+        double beta = rznew/rz;
+
+        scal(beta,p_p);
+        axpy(1.0,z_p,p_p);
+
+        iter_++;
+
+    }while(iter_ < cg_max_iter_ );
+}
+
+// preconditioner applied by callback: precon_function(n,z,r,data) evaluates z = M^-1.r
+void CGSolver::preconditioned_solve(long int n,
+                    SharedVector Ap, 
+                    SharedVector  x, 
+                    SharedVector  b, 
+                    CallbackType function, 
+                    CallbackType precon_function, void * data) {
+
+    if ( n != n_ ) {
+        throw PsiException("Warning: dimension does not match dimension from initialization",__FILE__,__LINE__);
+    }
+
+    double * p_p = p->pointer();
+    double * r_p = r->pointer();
+    double * z_p = z->pointer();
+
+    // call some function to evaluate A.x.  Result in Ap
+    evaluate(function,n,Ap,x,data,v2rdm_casscf::TIMER_CG_AX);
+
+    double * b_p      = b->pointer();
+    double * x_p      = x->pointer();
+    double * Ap_p     = Ap->pointer();
+
+    for (int i = 0; i < n; i++) {
+        r_p[i] = b_p[i] - Ap_p[i];
+    }
+
+    iter_ = 0;
+
+    // initial guess may already be converged
+    if ( sqrt(dot(r_p,r_p)) < cg_convergence_ ) return;
+
+    evaluate(precon_function,n,z,r,data,v2rdm_casscf::TIMER_CG_PRECONDITION);
+    C_DCOPY(n,z_p,1,p_p,1);
+
+    do {
+
+        // call some function to evaluate A.p.  Result in Ap
+        evaluate(function,n,Ap,p,data,v2rdm_casscf::TIMER_CG_AX);
+
+        double rz  = dot(r_p,z_p);
+        double pap = dot(p_p,Ap_p);
+        double alpha = rz / pap;
+        axpy(alpha,p_p,x_p);
+        axpy(-alpha,Ap_p,r_p);
+
+        // if r is sufficiently small, then exit loop
+        double rrnew = dot(r_p,r_p);
+        double nrm = sqrt(rrnew);
+        if ( nrm < cg_convergence_ ) break;
+
+        evaluate(precon_function,n,z,r,data,v2rdm_casscf::TIMER_CG_PRECONDITION);
+        double rznew  = dot(r_p,z_p);
         double beta = rznew/rz;
 
-        C_DSCAL(n_,beta,p_p,1);
-        C_DAXPY(n_,1.0,z_p,1,p_p,1);
+        scal(beta,p_p);
+        axpy(1.0,z_p,p_p);
 
         iter_++;
 
@@ -139,7 +238,7 @@ void CGSolver::solve(long int n,
     double beta  = 0.0;
 
     // call some function to evaluate A.x.  Result in Ap
-    function(n,Ap,x,data);
+    evaluate(function,n,Ap,x,data,v2rdm_casscf::TIMER_CG_AX);
 
     double * b_p  = b->pointer();
     double * x_p  = x->pointer();
@@ -154,22 +253,22 @@ void CGSolver::solve(long int n,
     do {
 
         // call some function to evaluate A.p.  Result in Ap
-        function(n,Ap,p,data);
+        evaluate(function,n,Ap,p,data,v2rdm_casscf::TIMER_CG_AX);
 
-        double rr  = C_DDOT(n_,r_p,1,r_p,1);
-        double pap = C_DDOT(n_,p_p,1,Ap_p,1);
+        double rr  = dot(r_p,r_p);
+        double pap = dot(p_p,Ap_p);
         double alpha = rr / pap;
-        C_DAXPY(n_,alpha,p_p,1,x_p,1);
-        C_DAXPY(n_,-alpha,Ap_p,1,r_p,1);
+        axpy(alpha,p_p,x_p);
+        axpy(-alpha,Ap_p,r_p);
 
         // if r is sufficiently small, then exit loop
-        double rrnew = C_DDOT(n_,r_p,1,r_p,1);
+        double rrnew = dot(r_p,r_p);
         double nrm = sqrt(rrnew);// / sqrt(n_);
         double beta = rrnew/rr;
         if ( nrm < cg_convergence_ ) break;
 
-        C_DSCAL(n_,beta,p_p,1);
-        C_DAXPY(n_,1.0,r_p,1,p_p,1);
+        scal(beta,p_p);
+        axpy(1.0,r_p,p_p);
 
         iter_++;
 
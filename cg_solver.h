@@ -30,6 +30,8 @@
 
 #include<psi4/libmints/vector.h>
 
+#include"timers.h"
+
 
 namespace psi{ 
 
@@ -46,6 +48,12 @@ public:
                SharedVector  b,
                SharedVector  precon,
                CallbackType function, void * data);
+    void preconditioned_solve(long int n,
+               SharedVector Ap,
+               SharedVector  x,
+               SharedVector  b,
+               CallbackType function,
+               CallbackType precon_function, void * data);
     void solve(long int n,
                SharedVector Ap,
                SharedVector  x,
@@ -56,8 +64,19 @@ public:
     void set_max_iter(int iter);
     void set_convergence(double conv);
 
+    /// accumulate the time spent in the callbacks, dot products, and axpys
+    void set_timers(v2rdm_casscf::Timers * timers);
+
 private:
 
+    /// timed callback, dot product, axpy, and scaling
+    void evaluate(CallbackType function, long int n, SharedVector out, SharedVector in, void * data, int timer);
+    double dot(double * x, double * y);
+    void axpy(double alpha, double * x, double * y);
+    void scal(double alpha, double * x);
+
+    v2rdm_casscf::Timers * timers_;
+
     int    n_;
     int    iter_;
     int    cg_max_iter_;
@@ -71,8 +71,20 @@ void v2RDMSolver::WriteCheckpointFile() {
     // y
     psio->write_entry(PSIF_V2RDM_CHECKPOINT,"DUAL 1",(char*)y->pointer(),nconstraints_*sizeof(double));
 
-    // z
-    psio->write_entry(PSIF_V2RDM_CHECKPOINT,"DUAL 2",(char*)z->pointer(),dimx_*sizeof(double));
+    // z (always written as full squares of the blocks in dimensions_)
+    if ( !packed_storage_ ) {
+        psio->write_entry(PSIF_V2RDM_CHECKPOINT,"DUAL 2",(char*)z->pointer(),primal_dim_*sizeof(double));
+    }else {
+        psio_address zaddr = PSIO_ZERO;
+        for (int i = 0; i < dimensions_.size(); i++) {
+            long int dim = dimensions_[i];
+            if ( dim == 0 ) continue;
+            double * block = (double*)malloc(dim*dim*sizeof(double));
+            UnpackBlock(dim,z->pointer() + dimensions_packed_offset_[i],block);
+            psio->write(PSIF_V2RDM_CHECKPOINT,"DUAL 2",(char*)block,dim*dim*sizeof(double),zaddr,&zaddr);
+            free(block);
+        }
+    }
 
     // mo/mo' transformation matrix
     psio_address addr = PSIO_ZERO;
@@ -114,8 +126,20 @@ void v2RDMSolver::ReadFromCheckpointFile() {
     // y
     psio->read_entry(PSIF_V2RDM_CHECKPOINT,"DUAL 1",(char*)y->pointer(),nconstraints_*sizeof(double));
 
-    // z
-    psio->read_entry(PSIF_V2RDM_CHECKPOINT,"DUAL 2",(char*)z->pointer(),dimx_*sizeof(double));
+    // z (always written as full squares of the blocks in dimensions_)
+    if ( !packed_storage_ ) {
+        psio->read_entry(PSIF_V2RDM_CHECKPOINT,"DUAL 2",(char*)z->pointer(),primal_dim_*sizeof(double));
+    }else {
+        psio_address zaddr = PSIO_ZERO;
+        for (int i = 0; i < dimensions_.size(); i++) {
+            long int dim = dimensions_[i];
+            if ( dim == 0 ) continue;
+            double * block = (double*)malloc(dim*dim*sizeof(double));
+            psio->read(PSIF_V2RDM_CHECKPOINT,"DUAL 2",(char*)block,dim*dim*sizeof(double),zaddr,&zaddr);
+            PackBlock(dim,block,z->pointer() + dimensions_packed_offset_[i]);
+            free(block);
+        }
+    }
 
     psio->close(PSIF_V2RDM_CHECKPOINT,1);
 }
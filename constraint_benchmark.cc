@@ -0,0 +1,257 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * v2RDM-CASSCF, a plugin to:
+ *
+ * Psi4: an open-source quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (c) 2014, The Florida State University. All rights reserved.
+ * 
+ *@END LICENSE
+ *
+ */
+
+#include <psi4/psi4-dec.h>
+#include <psi4/liboptions/liboptions.h>
+#include <psi4/libqt/qt.h>
+
+#include<psi4/libmints/wavefunction.h>
+#include<psi4/libmints/vector.h>
+#include<psi4/libmints/matrix.h>
+
+#include<time.h>
+#include<string>
+#include<vector>
+
+#include"v2rdm_solver.h"
+
+#ifdef _OPENMP
+    #include<omp.h>
+#else
+    #define omp_get_wtime() ( (double)clock() / CLOCKS_PER_SEC )
+    #define omp_get_max_threads() 1
+#endif
+
+using namespace psi;
+
+namespace psi{ namespace v2rdm_casscf{
+
+/// A.u and A^T.u kernels for one constraint family, and the rows of A they own
+struct ConstraintFamily {
+    std::string label;
+    void (v2RDMSolver::*Au)(SharedVector,SharedVector);
+    void (v2RDMSolver::*ATu)(SharedVector,SharedVector);
+    long int (v2RDMSolver::*Record)(SparseTarget,SparseSource);
+    long int row_begin;
+    long int row_end;
+};
+
+// deterministic pseudorandom numbers in [-1,1)
+static void fill_random(double * v, long int n, unsigned long int & seed) {
+    for (long int i = 0; i < n; i++) {
+        seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+        v[i] = (double)(seed >> 11) / 4503599627370496.0 - 1.0;
+    }
+}
+
+// time the A.u and A^T.u kernels for each constraint family and check that
+// each family's A^T.u is the adjoint of its A.u, i.e., <A.u,v> = <u,A^T.v> 
+// for random u and v.
+//
+// the kernels are matrix free, so throughput is reported in terms of the
+// elements of A they apply (counted once with SparseRecorder, duplicates
+// included): each element is one multiply-add (2 flops).  the traffic is
+// the compulsory one: A.u loads each primal element the family references
+// and stores each of its constraints; A^T.u loads each of its multipliers
+// and loads and stores each primal element it references.
+bool v2RDMSolver::BenchmarkConstraints(int nrepeat) {
+
+    if ( nrepeat < 1 ) nrepeat = 1;
+
+    std::vector<ConstraintFamily> families;
+
+    ConstraintFamily d2 = { "D2", &v2RDMSolver::D2_constraints_Au, &v2RDMSolver::D2_constraints_ATu,
+        &v2RDMSolver::D2_constraints_ATu<SparseTarget,SparseSource>, d2_constraints_offset_, q2_constraints_offset_ };
+    families.push_back(d2);
+
+    if ( constrain_q2_ ) {
+        if ( !spin_adapt_q2_ ) {
+            ConstraintFamily q2 = { "Q2", &v2RDMSolver::Q2_constraints_Au, &v2RDMSolver::Q2_constraints_ATu,
+                &v2RDMSolver::Q2_constraints_ATu<SparseTarget,SparseSource>, q2_constraints_offset_, g2_constraints_offset_ };
+            families.push_back(q2);
+        }else {
+            ConstraintFamily q2 = { "Q2 (SA)", &v2RDMSolver::Q2_constraints_Au_spin_adapted, &v2RDMSolver::Q2_constraints_ATu_spin_adapted,
+                &v2RDMSolver::Q2_constraints_ATu_spin_adapted<SparseTarget,SparseSource>, q2_constraints_offset_, g2_constraints_offset_ };
+            families.push_back(q2);
+        }
+    }
+    if ( constrain_g2_ ) {
+        if ( !spin_adapt_g2_ ) {
+            ConstraintFamily g2 = { "G2", &v2RDMSolver::G2_constraints_Au, &v2RDMSolver::G2_constraints_ATu,
+                &v2RDMSolver::G2_constraints_ATu<SparseTarget,SparseSource>, g2_constraints_offset_, t1_constraints_offset_ };
+            families.push_back(g2);
+        }else {
+            ConstraintFamily g2 = { "G2 (SA)", &v2RDMSolver::G2_constraints_Au_spin_adapted, &v2RDMSolver::G2_constraints_ATu_spin_adapted,
+                &v2RDMSolver::G2_constraints_ATu_spin_adapted<SparseTarget,SparseSource>, g2_constraints_offset_, t1_constraints_offset_ };
+            families.push_back(g2);
+        }
+    }
+    if ( constrain_t1_ ) {
+        ConstraintFamily t1 = { "T1", &v2RDMSolver::T1_constraints_Au, &v2RDMSolver::T1_constraints_ATu,
+            &v2RDMSolver::T1_constraints_ATu<SparseTarget,SparseSource>, t1_constraints_offset_, t2_constraints_offset_ };
+        families.push_back(t1);
+    }
+    if ( constrain_t2_ ) {
+        ConstraintFamily t2 = { "T2", &v2RDMSolver::T2_constraints_Au, &v2RDMSolver::T2_constraints_ATu,
+            &v2RDMSolver::T2_constraints_ATu<SparseTarget,SparseSource>, t2_constraints_offset_, d3_constraints_offset_ };
+        families.push_back(t2);
+        ConstraintFamily t2_slow = { "T2 (slow)", &v2RDMSolver::T2_constraints_Au_slow, &v2RDMSolver::T2_constraints_ATu_slow,
+            &v2RDMSolver::T2_constraints_ATu_slow<SparseTarget,SparseSource>, t2_constraints_offset_, d3_constraints_offset_ };
+        families.push_back(t2_slow);
+    }
+    if ( constrain_d3_ ) {
+        ConstraintFamily d3 = { "D3", &v2RDMSolver::D3_constraints_Au, &v2RDMSolver::D3_constraints_ATu,
+            &v2RDMSolver::D3_constraints_ATu<SparseTarget,SparseSource>, d3_constraints_offset_, nconstraints_ };
+        families.push_back(d3);
+    }
+
+    SharedVector u   (new Vector("u",dimx_));
+    SharedVector v   (new Vector("v",nconstraints_));
+    SharedVector Au  (new Vector("A . u",nconstraints_));
+    SharedVector ATv (new Vector("A^T . v",dimx_));
+
+    unsigned long int seed = 1;
+    fill_random(u->pointer(),dimx_,seed);
+    fill_random(v->pointer(),nconstraints_,seed);
+
+    double * u_p   = u->pointer();
+    double * v_p   = v->pointer();
+    double * Au_p  = Au->pointer();
+    double * ATv_p = ATv->pointer();
+
+    const double tolerance = 1e-10;
+    bool pass = true;
+
+    outfile->Printf("\n");
+    outfile->Printf("  ==> Constraint map benchmark <==\n");
+    outfile->Printf("\n");
+    outfile->Printf("        Positivity conditions:         %10s\n",options_.get_str("POSITIVITY").c_str());
+    outfile->Printf("        Total number of variables:     %10li\n",dimx_);
+    outfile->Printf("        Total number of constraints:   %10li\n",nconstraints_);
+    outfile->Printf("        Repetitions:                   %10i\n",nrepeat);
+    outfile->Printf("        Threads:                       %10i\n",omp_get_max_threads());
+    outfile->Printf("\n");
+    outfile->Printf("        %-9s %10s %12s   %10s %7s %7s   %10s %7s %7s   %9s\n",
+        "family","rows","elements","A.u (s)","GB/s","GFLOP/s","A^T.u (s)","GB/s","GFLOP/s","adjoint");
+    outfile->Printf("        ");
+    for (int i = 0; i < 110; i++) outfile->Printf("-");
+    outfile->Printf("\n");
+
+    for (size_t f = 0; f < families.size(); f++) {
+
+        ConstraintFamily & fam = families[f];
+        long int nrow = fam.row_end - fam.row_begin;
+
+        // elements of A applied by this family
+        long int nel = 0;
+        {
+            SparseRecorder counter(true);
+            (this->*fam.Record)(SparseTarget(&counter),SparseSource());
+            nel = counter.size();
+        }
+
+        // A.u
+        double tAu = 0.0;
+        for (int rep = 0; rep < nrepeat; rep++) {
+            Au->zero();
+            double start = omp_get_wtime();
+            (this->*fam.Au)(Au,u);
+            tAu += omp_get_wtime() - start;
+        }
+        tAu /= nrepeat;
+        double uAv = C_DDOT(nconstraints_,Au_p,1,v_p,1);
+
+        // A^T.v
+        double tATu = 0.0;
+        for (int rep = 0; rep < nrepeat; rep++) {
+            ATv->zero();
+            double start = omp_get_wtime();
+            (this->*fam.ATu)(ATv,v);
+            tATu += omp_get_wtime() - start;
+        }
+        tATu /= nrepeat;
+        double vATu = C_DDOT(dimx_,ATv_p,1,u_p,1);
+
+        // primal elements referenced by this family (A^T.v is nonzero there)
+        long int ncol = 0;
+        for (long int i = 0; i < dimx_; i++) {
+            if ( ATv_p[i] != 0.0 ) ncol++;
+        }
+
+        double scale = fabs(uAv) > fabs(vATu) ? fabs(uAv) : fabs(vATu);
+        double error = scale > 0.0 ? fabs(uAv - vATu) / scale : fabs(uAv - vATu);
+        if ( error > tolerance ) pass = false;
+
+        double flops    = 2.0 * nel;
+        double bytesAu  = 8.0 * ( ncol + nrow );
+        double bytesATu = 8.0 * ( nrow + 2.0 * ncol );
+
+        outfile->Printf("        %-9s %10li %12li   %10.3le %7.2lf %7.2lf   %10.3le %7.2lf %7.2lf   %9.2le%s\n",
+            fam.label.c_str(),nrow,nel,
+            tAu, tAu > 0.0 ? bytesAu / tAu / 1.0e9 : 0.0, tAu > 0.0 ? flops / tAu / 1.0e9 : 0.0,
+            tATu, tATu > 0.0 ? bytesATu / tATu / 1.0e9 : 0.0, tATu > 0.0 ? flops / tATu / 1.0e9 : 0.0,
+            error, error > tolerance ? " *" : "");
+    }
+
+    // complete maps, as used by the solver
+    double tAu = 0.0;
+    for (int rep = 0; rep < nrepeat; rep++) {
+        double start = omp_get_wtime();
+        bpsdp_Au(Au,u);
+        tAu += omp_get_wtime() - start;
+    }
+    tAu /= nrepeat;
+    double uAv = C_DDOT(nconstraints_,Au_p,1,v_p,1);
+
+    double tATu = 0.0;
+    for (int rep = 0; rep < nrepeat; rep++) {
+        double start = omp_get_wtime();
+        bpsdp_ATu(ATv,v);
+        tATu += omp_get_wtime() - start;
+    }
+    tATu /= nrepeat;
+    double vATu = C_DDOT(dimx_,ATv_p,1,u_p,1);
+
+    double scale = fabs(uAv) > fabs(vATu) ? fabs(uAv) : fabs(vATu);
+    double error = scale > 0.0 ? fabs(uAv - vATu) / scale : fabs(uAv - vATu);
+    if ( error > tolerance ) pass = false;
+
+    outfile->Printf("        ");
+    for (int i = 0; i < 110; i++) outfile->Printf("-");
+    outfile->Printf("\n");
+    outfile->Printf("        %-9s %10li %12s   %10.3le %7s %7s   %10.3le %7s %7s   %9.2le%s\n",
+        "total",nconstraints_,"",tAu,"","",tATu,"","",error, error > tolerance ? " *" : "");
+    outfile->Printf("\n");
+    if ( !pass ) {
+        outfile->Printf("        * |<A.u,v> - <u,A^T.v>| / |<A.u,v>| > %5.1le\n",tolerance);
+        outfile->Printf("\n");
+    }
+
+    return pass;
+}
+
+}} // end namespaces
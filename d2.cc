@@ -56,8 +56,12 @@ namespace psi{ namespace v2rdm_casscf{
 
 // D2 portion of A^T.y ( and D1 / Q1 )
 void v2RDMSolver::D2_constraints_ATu(SharedVector A,SharedVector u){
-    double* A_p = A->pointer();
-    double* u_p = u->pointer();
+    D2_constraints_ATu(A->pointer(),u->pointer());
+}
+
+template <typename TargetType, typename SourceType>
+long int v2RDMSolver::D2_constraints_ATu(TargetType A_p,SourceType u_p){
+    long int offset = d2_constraints_offset_;
 
     if ( constrain_spin_ ) {
         // spin
@@ -97,22 +101,24 @@ void v2RDMSolver::D2_constraints_ATu(SharedVector A,SharedVector u){
     }
     offset++;
     // Tr(D2bb)
-    for (int i = 0; i < amo_; i++){
-        for (int j = 0; j < amo_; j++){
-            if ( i==j ) continue;
-            int h = SymmetryPair(symmetry[i],symmetry[j]);
-            if ( gems_aa[h] == 0 ) continue;
-            int ij = ibas_aa_sym[h][i][j];
-            A_p[d2bboff[h]+ij*gems_aa[h]+ij] += u_p[offset];
+    if ( !closed_shell_ ) {
+        for (int i = 0; i < amo_; i++){
+            for (int j = 0; j < amo_; j++){
+                if ( i==j ) continue;
+                int h = SymmetryPair(symmetry[i],symmetry[j]);
+                if ( gems_aa[h] == 0 ) continue;
+                int ij = ibas_aa_sym[h][i][j];
+                A_p[d2bboff[h]+ij*gems_aa[h]+ij] += u_p[offset];
+            }
         }
+        offset++;
     }
-    offset++;
 
     // d1 / q1 a
     for (int h = 0; h < nirrep_; h++) {
         for(int i = 0; i < amopi_[h]; i++){
             for(int j = 0; j < amopi_[h]; j++){
-                double dum = u_p[offset + i*amopi_[h]+j];
+                auto dum = u_p[offset + i*amopi_[h]+j];
                 A_p[d1aoff[h] + j*amopi_[h]+i] += dum;
                 A_p[q1aoff[h] + i*amopi_[h]+j] += dum;
             }
@@ -121,15 +127,17 @@ void v2RDMSolver::D2_constraints_ATu(SharedVector A,SharedVector u){
     }
 
     // d1 / q1 b
-    for (int h = 0; h < nirrep_; h++) {
-        for(int i = 0; i < amopi_[h]; i++){
-            for(int j = 0; j < amopi_[h]; j++){
-                double dum = u_p[offset + i*amopi_[h]+j];
-                A_p[d1boff[h] + j*amopi_[h]+i] += dum;
-                A_p[q1boff[h] + i*amopi_[h]+j] += dum;
+    if ( !closed_shell_ ) {
+        for (int h = 0; h < nirrep_; h++) {
+            for(int i = 0; i < amopi_[h]; i++){
+                for(int j = 0; j < amopi_[h]; j++){
+                    auto dum = u_p[offset + i*amopi_[h]+j];
+                    A_p[d1boff[h] + j*amopi_[h]+i] += dum;
+                    A_p[q1boff[h] + i*amopi_[h]+j] += dum;
+                }
             }
+            offset += amopi_[h]*amopi_[h];
         }
-        offset += amopi_[h]*amopi_[h];
     }
 
     int na = nalpha_ - nrstc_ - nfrzc_;
@@ -201,105 +209,116 @@ void v2RDMSolver::D2_constraints_ATu(SharedVector A,SharedVector u){
     }
 
     //contract D2bb -> D1 b
-    poff = 0;
-    for (int h = 0; h < nirrep_; h++) {
-        for(int i = 0; i < amopi_[h]; i++){
-            for(int j = 0; j < amopi_[h]; j++){
-                A_p[d1boff[h] + i*amopi_[h]+j] += (nb - 1.0) * u_p[offset + i*amopi_[h]+j];
-                int ii = i + poff;
-                int jj = j + poff;
-                for(int k =0; k < amo_; k++){
-                    if( ii==k || jj==k )continue;
-                    int h2  = SymmetryPair(symmetry[ii],symmetry[k]);
-                    int ik = ibas_aa_sym[h2][ii][k];
-                    int jk = ibas_aa_sym[h2][jj][k];
-                    int sik = ( ii < k ? 1 : -1);
-                    int sjk = ( jj < k ? 1 : -1);
-                    A_p[d2bboff[h2] + ik*gems_aa[h2]+jk] -= sik*sjk*u_p[offset + i*amopi_[h]+j];
+    if ( !closed_shell_ ) {
+        poff = 0;
+        for (int h = 0; h < nirrep_; h++) {
+            for(int i = 0; i < amopi_[h]; i++){
+                for(int j = 0; j < amopi_[h]; j++){
+                    A_p[d1boff[h] + i*amopi_[h]+j] += (nb - 1.0) * u_p[offset + i*amopi_[h]+j];
+                    int ii = i + poff;
+                    int jj = j + poff;
+                    for(int k =0; k < amo_; k++){
+                        if( ii==k || jj==k )continue;
+                        int h2  = SymmetryPair(symmetry[ii],symmetry[k]);
+                        int ik = ibas_aa_sym[h2][ii][k];
+                        int jk = ibas_aa_sym[h2][jj][k];
+                        int sik = ( ii < k ? 1 : -1);
+                        int sjk = ( jj < k ? 1 : -1);
+                        A_p[d2bboff[h2] + ik*gems_aa[h2]+jk] -= sik*sjk*u_p[offset + i*amopi_[h]+j];
+                    }
                 }
             }
+            offset += amopi_[h]*amopi_[h];
+            poff   += nmopi_[h] - rstcpi_[h] - frzcpi_[h] - rstvpi_[h] - frzvpi_[h];
         }
-        offset += amopi_[h]*amopi_[h];
-        poff   += nmopi_[h] - rstcpi_[h] - frzcpi_[h] - rstvpi_[h] - frzvpi_[h];
     }
 
 
     // additional spin constraints for singlets:
     if ( constrain_spin_ && nalpha_ == nbeta_ ) {
         // D1a = D1b
-        for ( int h = 0; h < nirrep_; h++) {
-            C_DAXPY(amopi_[h]*amopi_[h], 1.0, u_p + offset, 1, A_p + d1aoff[h],1);
-            C_DAXPY(amopi_[h]*amopi_[h],-1.0, u_p + offset, 1, A_p + d1boff[h],1);
-            offset += amopi_[h]*amopi_[h];
-        }
-        // D2aa = D2bb
-        for ( int h = 0; h < nirrep_; h++) {
-            C_DAXPY(gems_aa[h]*gems_aa[h], 1.0, u_p + offset, 1, A_p + d2aaoff[h],1);
-            C_DAXPY(gems_aa[h]*gems_aa[h],-1.0, u_p + offset, 1, A_p + d2bboff[h],1);
-            offset += gems_aa[h]*gems_aa[h];
+        if ( !closed_shell_ ) {
+            for ( int h = 0; h < nirrep_; h++) {
+                C_DAXPY(amopi_[h]*amopi_[h], 1.0, u_p + offset, 1, A_p + d1aoff[h],1);
+                C_DAXPY(amopi_[h]*amopi_[h],-1.0, u_p + offset, 1, A_p + d1boff[h],1);
+                offset += amopi_[h]*amopi_[h];
+            }
         }
-        // D2aa[pq][rs] = 1/2(D2ab[pq][rs] - D2ab[pq][sr] - D2ab[qp][rs] + D2ab[qp][sr])
-        for ( int h = 0; h < nirrep_; h++) {
-            C_DAXPY(gems_aa[h]*gems_aa[h],1.0,u_p + offset,1,A_p + d2aaoff[h],1);
-            for (int ij = 0; ij < gems_aa[h]; ij++) {
-                int i = bas_aa_sym[h][ij][0]; 
-                int j = bas_aa_sym[h][ij][1];
-                int ijb = ibas_ab_sym[h][i][j];
-                int jib = ibas_ab_sym[h][j][i];
-                for (int kl = 0; kl < gems_aa[h]; kl++) {
-                    int k = bas_aa_sym[h][kl][0]; 
-                    int l = bas_aa_sym[h][kl][1];
-                    int klb = ibas_ab_sym[h][k][l];
-                    int lkb = ibas_ab_sym[h][l][k];
-                    A_p[d2aboff[h] + ijb*gems_ab[h] + klb] -= 0.5 * u_p[offset + ij*gems_aa[h] + kl];
-                    A_p[d2aboff[h] + jib*gems_ab[h] + klb] += 0.5 * u_p[offset + ij*gems_aa[h] + kl];
-                    A_p[d2aboff[h] + ijb*gems_ab[h] + lkb] += 0.5 * u_p[offset + ij*gems_aa[h] + kl];
-                    A_p[d2aboff[h] + jib*gems_ab[h] + lkb] -= 0.5 * u_p[offset + ij*gems_aa[h] + kl];
+        // D2aa = D2bb and D2aa, D2bb, D200 <- D2ab hold by construction with SPIN_ADAPT_D2
+        if ( !spin_adapt_d2_ ) {
+            // D2aa = D2bb
+            if ( !closed_shell_ ) {
+                for ( int h = 0; h < nirrep_; h++) {
+                    C_DAXPY(gems_aa[h]*gems_aa[h], 1.0, u_p + offset, 1, A_p + d2aaoff[h],1);
+                    C_DAXPY(gems_aa[h]*gems_aa[h],-1.0, u_p + offset, 1, A_p + d2bboff[h],1);
+                    offset += gems_aa[h]*gems_aa[h];
+                }
+            }
+            // D2aa[pq][rs] = 1/2(D2ab[pq][rs] - D2ab[pq][sr] - D2ab[qp][rs] + D2ab[qp][sr])
+            for ( int h = 0; h < nirrep_; h++) {
+                C_DAXPY(gems_aa[h]*gems_aa[h],1.0,u_p + offset,1,A_p + d2aaoff[h],1);
+                for (int ij = 0; ij < gems_aa[h]; ij++) {
+                    int i = bas_aa_sym[h][ij][0]; 
+                    int j = bas_aa_sym[h][ij][1];
+                    int ijb = ibas_ab_sym[h][i][j];
+                    int jib = ibas_ab_sym[h][j][i];
+                    for (int kl = 0; kl < gems_aa[h]; kl++) {
+                        int k = bas_aa_sym[h][kl][0]; 
+                        int l = bas_aa_sym[h][kl][1];
+                        int klb = ibas_ab_sym[h][k][l];
+                        int lkb = ibas_ab_sym[h][l][k];
+                        A_p[d2aboff[h] + ijb*gems_ab[h] + klb] -= 0.5 * u_p[offset + ij*gems_aa[h] + kl];
+                        A_p[d2aboff[h] + jib*gems_ab[h] + klb] += 0.5 * u_p[offset + ij*gems_aa[h] + kl];
+                        A_p[d2aboff[h] + ijb*gems_ab[h] + lkb] += 0.5 * u_p[offset + ij*gems_aa[h] + kl];
+                        A_p[d2aboff[h] + jib*gems_ab[h] + lkb] -= 0.5 * u_p[offset + ij*gems_aa[h] + kl];
+                    }   
                 }   
+                offset += gems_aa[h]*gems_aa[h];
             }   
-            offset += gems_aa[h]*gems_aa[h];
-        }   
-        // D2bb[pq][rs] = 1/2(D2ab[pq][rs] - D2ab[pq][sr] - D2ab[qp][rs] + D2ab[qp][sr])
-        for ( int h = 0; h < nirrep_; h++) {
-            C_DAXPY(gems_aa[h]*gems_aa[h],1.0,u_p + offset,1,A_p + d2bboff[h],1);
-            for (int ij = 0; ij < gems_aa[h]; ij++) {
-                int i = bas_aa_sym[h][ij][0];
-                int j = bas_aa_sym[h][ij][1];
-                int ijb = ibas_ab_sym[h][i][j];
-                int jib = ibas_ab_sym[h][j][i];
-                for (int kl = 0; kl < gems_aa[h]; kl++) {
-                    int k = bas_aa_sym[h][kl][0];
-                    int l = bas_aa_sym[h][kl][1];
-                    int klb = ibas_ab_sym[h][k][l];
-                    int lkb = ibas_ab_sym[h][l][k];
-                    A_p[d2aboff[h] + ijb*gems_ab[h] + klb] -= 0.5 * u_p[offset + ij*gems_aa[h] + kl];
-                    A_p[d2aboff[h] + jib*gems_ab[h] + klb] += 0.5 * u_p[offset + ij*gems_aa[h] + kl];
-                    A_p[d2aboff[h] + ijb*gems_ab[h] + lkb] += 0.5 * u_p[offset + ij*gems_aa[h] + kl];
-                    A_p[d2aboff[h] + jib*gems_ab[h] + lkb] -= 0.5 * u_p[offset + ij*gems_aa[h] + kl];
+            // D2bb[pq][rs] = 1/2(D2ab[pq][rs] - D2ab[pq][sr] - D2ab[qp][rs] + D2ab[qp][sr])
+            if ( !closed_shell_ ) {
+                for ( int h = 0; h < nirrep_; h++) {
+                    C_DAXPY(gems_aa[h]*gems_aa[h],1.0,u_p + offset,1,A_p + d2bboff[h],1);
+                    for (int ij = 0; ij < gems_aa[h]; ij++) {
+                        int i = bas_aa_sym[h][ij][0];
+                        int j = bas_aa_sym[h][ij][1];
+                        int ijb = ibas_ab_sym[h][i][j];
+                        int jib = ibas_ab_sym[h][j][i];
+                        for (int kl = 0; kl < gems_aa[h]; kl++) {
+                            int k = bas_aa_sym[h][kl][0];
+                            int l = bas_aa_sym[h][kl][1];
+                            int klb = ibas_ab_sym[h][k][l];
+                            int lkb = ibas_ab_sym[h][l][k];
+                            A_p[d2aboff[h] + ijb*gems_ab[h] + klb] -= 0.5 * u_p[offset + ij*gems_aa[h] + kl];
+                            A_p[d2aboff[h] + jib*gems_ab[h] + klb] += 0.5 * u_p[offset + ij*gems_aa[h] + kl];
+                            A_p[d2aboff[h] + ijb*gems_ab[h] + lkb] += 0.5 * u_p[offset + ij*gems_aa[h] + kl];
+                            A_p[d2aboff[h] + jib*gems_ab[h] + lkb] -= 0.5 * u_p[offset + ij*gems_aa[h] + kl];
+                        }
+                    }
+                    offset += gems_aa[h]*gems_aa[h];
                 }
             }
-            offset += gems_aa[h]*gems_aa[h];
-        }
-        // D200 = 1/(2 sqrt(1+dpq)sqrt(1+drs)) ( D2ab[pq][rs] + D2ab[pq][sr] + D2ab[qp][rs] + D2ab[qp][sr] )
-        for ( int h = 0; h < nirrep_; h++) {
-            C_DAXPY(gems_ab[h]*gems_ab[h],1.0,u_p + offset,1,A_p + d200off[h],1);
-            for (int ij = 0; ij < gems_ab[h]; ij++) {
-                int i = bas_ab_sym[h][ij][0];
-                int j = bas_ab_sym[h][ij][1];
-                int ji = ibas_ab_sym[h][j][i];
-                double dij = ( i == j ) ? sqrt(2.0) : 1.0;
-                for (int kl = 0; kl < gems_ab[h]; kl++) {
-                    int k = bas_ab_sym[h][kl][0];
-                    int l = bas_ab_sym[h][kl][1];
-                    int lk = ibas_ab_sym[h][l][k];
-                    double dkl = ( k == l ) ? sqrt(2.0) : 1.0;
-                    A_p[d2aboff[h] + ij*gems_ab[h] + kl] -= 0.5 / ( dij * dkl ) * u_p[offset + ij*gems_ab[h] + kl];
-                    A_p[d2aboff[h] + ji*gems_ab[h] + kl] -= 0.5 / ( dij * dkl ) * u_p[offset + ij*gems_ab[h] + kl];
-                    A_p[d2aboff[h] + ij*gems_ab[h] + lk] -= 0.5 / ( dij * dkl ) * u_p[offset + ij*gems_ab[h] + kl];
-                    A_p[d2aboff[h] + ji*gems_ab[h] + lk] -= 0.5 / ( dij * dkl ) * u_p[offset + ij*gems_ab[h] + kl];
+            // D200 = 1/(2 sqrt(1+dpq)sqrt(1+drs)) ( D2ab[pq][rs] + D2ab[pq][sr] + D2ab[qp][rs] + D2ab[qp][sr] )
+            for ( int h = 0; h < nirrep_; h++) {
+                C_DAXPY(gems_ab[h]*gems_ab[h],1.0,u_p + offset,1,A_p + d200off[h],1);
+                for (int ij = 0; ij < gems_ab[h]; ij++) {
+                    int i = bas_ab_sym[h][ij][0];
+                    int j = bas_ab_sym[h][ij][1];
+                    int ji = ibas_ab_sym[h][j][i];
+                    double dij = ( i == j ) ? sqrt(2.0) : 1.0;
+                    for (int kl = 0; kl < gems_ab[h]; kl++) {
+                        int k = bas_ab_sym[h][kl][0];
+                        int l = bas_ab_sym[h][kl][1];
+                        int lk = ibas_ab_sym[h][l][k];
+                        double dkl = ( k == l ) ? sqrt(2.0) : 1.0;
+                        A_p[d2aboff[h] + ij*gems_ab[h] + kl] -= 0.5 / ( dij * dkl ) * u_p[offset + ij*gems_ab[h] + kl];
+                        A_p[d2aboff[h] + ji*gems_ab[h] + kl] -= 0.5 / ( dij * dkl ) * u_p[offset + ij*gems_ab[h] + kl];
+                        A_p[d2aboff[h] + ij*gems_ab[h] + lk] -= 0.5 / ( dij * dkl ) * u_p[offset + ij*gems_ab[h] + kl];
+                        A_p[d2aboff[h] + ji*gems_ab[h] + lk] -= 0.5 / ( dij * dkl ) * u_p[offset + ij*gems_ab[h] + kl];
+                    }
                 }
+                offset += gems_ab[h]*gems_ab[h];
             }
-            offset += gems_ab[h]*gems_ab[h];
         }
     }else if ( constrain_spin_ ) { // nonsinglets ... big block
 
@@ -376,10 +395,12 @@ void v2RDMSolver::D2_constraints_ATu(SharedVector A,SharedVector u){
         }
     }
 
+    return offset;
 }
 
 // D2 portion of A.x (and D1/Q1)
 void v2RDMSolver::D2_constraints_Au(SharedVector A,SharedVector u){
+    long int offset = d2_constraints_offset_;
 
     double* A_p = A->pointer();
     double* u_p = u->pointer();
@@ -430,19 +451,21 @@ void v2RDMSolver::D2_constraints_Au(SharedVector A,SharedVector u){
     offset++;
 
     // Tr(D2bb)
-    double sumbb =0.0;
-    for (int i = 0; i < amo_; i++){
-        for (int j = 0; j < amo_; j++){
-            if ( i==j ) continue;
-            int h = SymmetryPair(symmetry[i],symmetry[j]);
-            if ( gems_aa[h] == 0 ) continue;
-            int ij = ibas_aa_sym[h][i][j];
-            sumbb += u_p[d2bboff[h] + ij*gems_aa[h]+ij];
-        }
+    if ( !closed_shell_ ) {
+        double sumbb =0.0;
+        for (int i = 0; i < amo_; i++){
+            for (int j = 0; j < amo_; j++){
+                if ( i==j ) continue;
+                int h = SymmetryPair(symmetry[i],symmetry[j]);
+                if ( gems_aa[h] == 0 ) continue;
+                int ij = ibas_aa_sym[h][i][j];
+                sumbb += u_p[d2bboff[h] + ij*gems_aa[h]+ij];
+            }
 
+        }
+        A_p[offset] = sumbb;
+        offset++;
     }
-    A_p[offset] = sumbb;
-    offset++;
 
     // d1 / q1 a
     for (int h = 0; h < nirrep_; h++) {
@@ -455,13 +478,15 @@ void v2RDMSolver::D2_constraints_Au(SharedVector A,SharedVector u){
     }
 
     // d1 / q1 b
-    for (int h = 0; h < nirrep_; h++) {
-        for(int i = 0; i < amopi_[h]; i++){
-            for(int j = 0; j < amopi_[h]; j++){
-                A_p[offset+i*amopi_[h]+j] = u_p[d1boff[h]+j*amopi_[h]+i] + u_p[q1boff[h]+i*amopi_[h]+j];
+    if ( !closed_shell_ ) {
+        for (int h = 0; h < nirrep_; h++) {
+            for(int i = 0; i < amopi_[h]; i++){
+                for(int j = 0; j < amopi_[h]; j++){
+                    A_p[offset+i*amopi_[h]+j] = u_p[d1boff[h]+j*amopi_[h]+i] + u_p[q1boff[h]+i*amopi_[h]+j];
+                }
             }
+            offset += amopi_[h]*amopi_[h];
         }
-        offset += amopi_[h]*amopi_[h];
     }
 
     int na = nalpha_ - nrstc_ - nfrzc_;
@@ -538,105 +563,116 @@ void v2RDMSolver::D2_constraints_Au(SharedVector A,SharedVector u){
     }
 
     //contract D2bb -> D1 b
-    poff = 0;
-    for (int h = 0; h < nirrep_; h++) {
-        for (int i = 0; i < amopi_[h]; i++){
-            for (int j = 0; j < amopi_[h]; j++){
-                double sum = (nb - 1.0) * u_p[d1boff[h] + i*amopi_[h]+j];
-                int ii  = i + poff;
-                int jj  = j + poff;
-                for(int k = 0; k < amo_; k++){
-                    if( ii==k || jj==k ) continue;
-                    int h2   = SymmetryPair(symmetry[ii],symmetry[k]);
-                    int ik  = ibas_aa_sym[h2][ii][k];
-                    int jk  = ibas_aa_sym[h2][jj][k];
-                    int sik = ( ii < k ) ? 1 : -1;
-                    int sjk = ( jj < k ) ? 1 : -1;
-                    sum -= sik*sjk*u_p[d2bboff[h2] + ik*gems_aa[h2]+jk];
+    if ( !closed_shell_ ) {
+        poff = 0;
+        for (int h = 0; h < nirrep_; h++) {
+            for (int i = 0; i < amopi_[h]; i++){
+                for (int j = 0; j < amopi_[h]; j++){
+                    double sum = (nb - 1.0) * u_p[d1boff[h] + i*amopi_[h]+j];
+                    int ii  = i + poff;
+                    int jj  = j + poff;
+                    for(int k = 0; k < amo_; k++){
+                        if( ii==k || jj==k ) continue;
+                        int h2   = SymmetryPair(symmetry[ii],symmetry[k]);
+                        int ik  = ibas_aa_sym[h2][ii][k];
+                        int jk  = ibas_aa_sym[h2][jj][k];
+                        int sik = ( ii < k ) ? 1 : -1;
+                        int sjk = ( jj < k ) ? 1 : -1;
+                        sum -= sik*sjk*u_p[d2bboff[h2] + ik*gems_aa[h2]+jk];
+                    }
+                    A_p[offset+i*amopi_[h]+j] = sum;
                 }
-                A_p[offset+i*amopi_[h]+j] = sum;
             }
+            offset += amopi_[h]*amopi_[h];
+            poff   += nmopi_[h] - rstcpi_[h] - frzcpi_[h] - rstvpi_[h] - frzvpi_[h];
         }
-        offset += amopi_[h]*amopi_[h];
-        poff   += nmopi_[h] - rstcpi_[h] - frzcpi_[h] - rstvpi_[h] - frzvpi_[h];
     }
 
     // additional spin constraints for singlets:
     if ( constrain_spin_ && nalpha_ == nbeta_ ) {
         // D1a = D1b
-        for ( int h = 0; h < nirrep_; h++) {
-            C_DCOPY(amopi_[h]*amopi_[h],     u_p + d1aoff[h],1,A_p + offset,1);
-            C_DAXPY(amopi_[h]*amopi_[h],-1.0,u_p + d1boff[h],1,A_p + offset,1);
-            offset += amopi_[h]*amopi_[h]; 
-        }
-        // D2aa = D2bb
-        for ( int h = 0; h < nirrep_; h++) {
-            C_DCOPY(gems_aa[h]*gems_aa[h],     u_p + d2aaoff[h],1,A_p + offset,1);
-            C_DAXPY(gems_aa[h]*gems_aa[h],-1.0,u_p + d2bboff[h],1,A_p + offset,1);
-            offset += gems_aa[h]*gems_aa[h];
+        if ( !closed_shell_ ) {
+            for ( int h = 0; h < nirrep_; h++) {
+                C_DCOPY(amopi_[h]*amopi_[h],     u_p + d1aoff[h],1,A_p + offset,1);
+                C_DAXPY(amopi_[h]*amopi_[h],-1.0,u_p + d1boff[h],1,A_p + offset,1);
+                offset += amopi_[h]*amopi_[h]; 
+            }
         }
-        // D2aa[pq][rs] = 1/2(D2ab[pq][rs] - D2ab[pq][sr] - D2ab[qp][rs] + D2ab[qp][sr])
-        for ( int h = 0; h < nirrep_; h++) {
-            C_DCOPY(gems_aa[h]*gems_aa[h],u_p + d2aaoff[h],1,A_p + offset,1);
-            for (int ij = 0; ij < gems_aa[h]; ij++) {
-                int i = bas_aa_sym[h][ij][0];
-                int j = bas_aa_sym[h][ij][1];
-                int ijb = ibas_ab_sym[h][i][j];
-                int jib = ibas_ab_sym[h][j][i];
-                for (int kl = 0; kl < gems_aa[h]; kl++) {
-                    int k = bas_aa_sym[h][kl][0];
-                    int l = bas_aa_sym[h][kl][1];
-                    int klb = ibas_ab_sym[h][k][l];
-                    int lkb = ibas_ab_sym[h][l][k];
-                    A_p[offset + ij*gems_aa[h] + kl] -= 0.5 * u_p[d2aboff[h] + ijb*gems_ab[h] + klb];
-                    A_p[offset + ij*gems_aa[h] + kl] += 0.5 * u_p[d2aboff[h] + jib*gems_ab[h] + klb];
-                    A_p[offset + ij*gems_aa[h] + kl] += 0.5 * u_p[d2aboff[h] + ijb*gems_ab[h] + lkb];
-                    A_p[offset + ij*gems_aa[h] + kl] -= 0.5 * u_p[d2aboff[h] + jib*gems_ab[h] + lkb];
+        // D2aa = D2bb and D2aa, D2bb, D200 <- D2ab hold by construction with SPIN_ADAPT_D2
+        if ( !spin_adapt_d2_ ) {
+            // D2aa = D2bb
+            if ( !closed_shell_ ) {
+                for ( int h = 0; h < nirrep_; h++) {
+                    C_DCOPY(gems_aa[h]*gems_aa[h],     u_p + d2aaoff[h],1,A_p + offset,1);
+                    C_DAXPY(gems_aa[h]*gems_aa[h],-1.0,u_p + d2bboff[h],1,A_p + offset,1);
+                    offset += gems_aa[h]*gems_aa[h];
                 }
             }
-            offset += gems_aa[h]*gems_aa[h];
-        }
-        // D2bb[pq][rs] = 1/2(D2ab[pq][rs] - D2ab[pq][sr] - D2ab[qp][rs] + D2ab[qp][sr])
-        for ( int h = 0; h < nirrep_; h++) {
-            C_DCOPY(gems_aa[h]*gems_aa[h],u_p + d2bboff[h],1,A_p + offset,1);
-            for (int ij = 0; ij < gems_aa[h]; ij++) {
-                int i = bas_aa_sym[h][ij][0];
-                int j = bas_aa_sym[h][ij][1];
-                int ijb = ibas_ab_sym[h][i][j];
-                int jib = ibas_ab_sym[h][j][i];
-                for (int kl = 0; kl < gems_aa[h]; kl++) {
-                    int k = bas_aa_sym[h][kl][0];
-                    int l = bas_aa_sym[h][kl][1];
-                    int klb = ibas_ab_sym[h][k][l];
-                    int lkb = ibas_ab_sym[h][l][k];
-                    A_p[offset + ij*gems_aa[h] + kl] -= 0.5 * u_p[d2aboff[h] + ijb*gems_ab[h] + klb];
-                    A_p[offset + ij*gems_aa[h] + kl] += 0.5 * u_p[d2aboff[h] + jib*gems_ab[h] + klb];
-                    A_p[offset + ij*gems_aa[h] + kl] += 0.5 * u_p[d2aboff[h] + ijb*gems_ab[h] + lkb];
-                    A_p[offset + ij*gems_aa[h] + kl] -= 0.5 * u_p[d2aboff[h] + jib*gems_ab[h] + lkb];
+            // D2aa[pq][rs] = 1/2(D2ab[pq][rs] - D2ab[pq][sr] - D2ab[qp][rs] + D2ab[qp][sr])
+            for ( int h = 0; h < nirrep_; h++) {
+                C_DCOPY(gems_aa[h]*gems_aa[h],u_p + d2aaoff[h],1,A_p + offset,1);
+                for (int ij = 0; ij < gems_aa[h]; ij++) {
+                    int i = bas_aa_sym[h][ij][0];
+                    int j = bas_aa_sym[h][ij][1];
+                    int ijb = ibas_ab_sym[h][i][j];
+                    int jib = ibas_ab_sym[h][j][i];
+                    for (int kl = 0; kl < gems_aa[h]; kl++) {
+                        int k = bas_aa_sym[h][kl][0];
+                        int l = bas_aa_sym[h][kl][1];
+                        int klb = ibas_ab_sym[h][k][l];
+                        int lkb = ibas_ab_sym[h][l][k];
+                        A_p[offset + ij*gems_aa[h] + kl] -= 0.5 * u_p[d2aboff[h] + ijb*gems_ab[h] + klb];
+                        A_p[offset + ij*gems_aa[h] + kl] += 0.5 * u_p[d2aboff[h] + jib*gems_ab[h] + klb];
+                        A_p[offset + ij*gems_aa[h] + kl] += 0.5 * u_p[d2aboff[h] + ijb*gems_ab[h] + lkb];
+                        A_p[offset + ij*gems_aa[h] + kl] -= 0.5 * u_p[d2aboff[h] + jib*gems_ab[h] + lkb];
+                    }
                 }
+                offset += gems_aa[h]*gems_aa[h];
             }
-            offset += gems_aa[h]*gems_aa[h];
-        }
-        // D200 = 1/(2 sqrt(1+dpq)sqrt(1+drs)) ( D2ab[pq][rs] + D2ab[pq][sr] + D2ab[qp][rs] + D2ab[qp][sr] )
-        for ( int h = 0; h < nirrep_; h++) {
-            C_DCOPY(gems_ab[h]*gems_ab[h],u_p + d200off[h],1,A_p + offset,1);
-            for (int ij = 0; ij < gems_ab[h]; ij++) {
-                int i = bas_ab_sym[h][ij][0];
-                int j = bas_ab_sym[h][ij][1];
-                int ji = ibas_ab_sym[h][j][i];
-                double dij = ( i == j ) ? sqrt(2.0) : 1.0;
-                for (int kl = 0; kl < gems_ab[h]; kl++) {
-                    int k = bas_ab_sym[h][kl][0];
-                    int l = bas_ab_sym[h][kl][1];
-                    int lk = ibas_ab_sym[h][l][k];
-                    double dkl = ( k == l ) ? sqrt(2.0) : 1.0;
-                    A_p[offset + ij*gems_ab[h] + kl] -= 0.5 / ( dij * dkl ) * u_p[d2aboff[h] + ij*gems_ab[h] + kl];
-                    A_p[offset + ij*gems_ab[h] + kl] -= 0.5 / ( dij * dkl ) * u_p[d2aboff[h] + ji*gems_ab[h] + kl];
-                    A_p[offset + ij*gems_ab[h] + kl] -= 0.5 / ( dij * dkl ) * u_p[d2aboff[h] + ij*gems_ab[h] + lk];
-                    A_p[offset + ij*gems_ab[h] + kl] -= 0.5 / ( dij * dkl ) * u_p[d2aboff[h] + ji*gems_ab[h] + lk];
+            // D2bb[pq][rs] = 1/2(D2ab[pq][rs] - D2ab[pq][sr] - D2ab[qp][rs] + D2ab[qp][sr])
+            if ( !closed_shell_ ) {
+                for ( int h = 0; h < nirrep_; h++) {
+                    C_DCOPY(gems_aa[h]*gems_aa[h],u_p + d2bboff[h],1,A_p + offset,1);
+                    for (int ij = 0; ij < gems_aa[h]; ij++) {
+                        int i = bas_aa_sym[h][ij][0];
+                        int j = bas_aa_sym[h][ij][1];
+                        int ijb = ibas_ab_sym[h][i][j];
+                        int jib = ibas_ab_sym[h][j][i];
+                        for (int kl = 0; kl < gems_aa[h]; kl++) {
+                            int k = bas_aa_sym[h][kl][0];
+                            int l = bas_aa_sym[h][kl][1];
+                            int klb = ibas_ab_sym[h][k][l];
+                            int lkb = ibas_ab_sym[h][l][k];
+                            A_p[offset + ij*gems_aa[h] + kl] -= 0.5 * u_p[d2aboff[h] + ijb*gems_ab[h] + klb];
+                            A_p[offset + ij*gems_aa[h] + kl] += 0.5 * u_p[d2aboff[h] + jib*gems_ab[h] + klb];
+                            A_p[offset + ij*gems_aa[h] + kl] += 0.5 * u_p[d2aboff[h] + ijb*gems_ab[h] + lkb];
+                            A_p[offset + ij*gems_aa[h] + kl] -= 0.5 * u_p[d2aboff[h] + jib*gems_ab[h] + lkb];
+                        }
+                    }
+                    offset += gems_aa[h]*gems_aa[h];
                 }
             }
-            offset += gems_ab[h]*gems_ab[h];
+            // D200 = 1/(2 sqrt(1+dpq)sqrt(1+drs)) ( D2ab[pq][rs] + D2ab[pq][sr] + D2ab[qp][rs] + D2ab[qp][sr] )
+            for ( int h = 0; h < nirrep_; h++) {
+                C_DCOPY(gems_ab[h]*gems_ab[h],u_p + d200off[h],1,A_p + offset,1);
+                for (int ij = 0; ij < gems_ab[h]; ij++) {
+                    int i = bas_ab_sym[h][ij][0];
+                    int j = bas_ab_sym[h][ij][1];
+                    int ji = ibas_ab_sym[h][j][i];
+                    double dij = ( i == j ) ? sqrt(2.0) : 1.0;
+                    for (int kl = 0; kl < gems_ab[h]; kl++) {
+                        int k = bas_ab_sym[h][kl][0];
+                        int l = bas_ab_sym[h][kl][1];
+                        int lk = ibas_ab_sym[h][l][k];
+                        double dkl = ( k == l ) ? sqrt(2.0) : 1.0;
+                        A_p[offset + ij*gems_ab[h] + kl] -= 0.5 / ( dij * dkl ) * u_p[d2aboff[h] + ij*gems_ab[h] + kl];
+                        A_p[offset + ij*gems_ab[h] + kl] -= 0.5 / ( dij * dkl ) * u_p[d2aboff[h] + ji*gems_ab[h] + kl];
+                        A_p[offset + ij*gems_ab[h] + kl] -= 0.5 / ( dij * dkl ) * u_p[d2aboff[h] + ij*gems_ab[h] + lk];
+                        A_p[offset + ij*gems_ab[h] + kl] -= 0.5 / ( dij * dkl ) * u_p[d2aboff[h] + ji*gems_ab[h] + lk];
+                    }
+                }
+                offset += gems_ab[h]*gems_ab[h];
+            }
         }
     }else if ( constrain_spin_ ) { // nonsinglets ... big block
 
@@ -715,4 +751,8 @@ void v2RDMSolver::D2_constraints_Au(SharedVector A,SharedVector u){
 
 }
 
+// instantiations used by RecordConstraints and bpsdp_ATu_tasks
+template long int v2RDMSolver::D2_constraints_ATu<SparseTarget,SparseSource>(SparseTarget A_p,SparseSource u_p);
+template long int v2RDMSolver::D2_constraints_ATu<double*,double*>(double* A_p,double* u_p);
+
 }}
@@ -55,6 +55,7 @@ namespace psi{ namespace v2rdm_casscf{
 
 // D3 portion of A.u 
 void v2RDMSolver::D3_constraints_Au(SharedVector A,SharedVector u){
+    long int offset = d3_constraints_offset_;
 
     double * A_p = A->pointer();
     double * u_p = u->pointer();
@@ -92,7 +93,7 @@ void v2RDMSolver::D3_constraints_Au(SharedVector A,SharedVector u){
             offset += gems_aa[h] * gems_aa[h];
         }
     }
-    if ( nb > 2 ) {
+    if ( !closed_shell_ && nb > 2 ) {
         // D3bbb -> D2bb
         for ( int h = 0; h < nirrep_; h++) {
             #pragma omp parallel for schedule (static)
@@ -144,25 +145,27 @@ void v2RDMSolver::D3_constraints_Au(SharedVector A,SharedVector u){
         offset += gems_aa[h] * gems_aa[h];
     }
     // D3bba -> D2bb
-    for ( int h = 0; h < nirrep_; h++) {
-        #pragma omp parallel for schedule (static)
-        for ( int ij = 0; ij < gems_aa[h]; ij++) {
-            int i = bas_aa_sym[h][ij][0];
-            int j = bas_aa_sym[h][ij][1];
-            for ( int kl = 0; kl < gems_aa[h]; kl++) {
-                int k = bas_aa_sym[h][kl][0];
-                int l = bas_aa_sym[h][kl][1];
-                double dum = na * u_p[d2bboff[h] + ij*gems_aa[h] + kl];
-                for ( int p = 0; p < amo_; p++) {
-                    int h2 = SymmetryPair(h,symmetry[p]);
-                    int ijp = ibas_aab_sym[h2][i][j][p];
-                    int klp = ibas_aab_sym[h2][k][l][p];
-                    dum -= u_p[d3bbaoff[h2] + ijp*trip_aab[h2]+klp];
+    if ( !closed_shell_ ) {
+        for ( int h = 0; h < nirrep_; h++) {
+            #pragma omp parallel for schedule (static)
+            for ( int ij = 0; ij < gems_aa[h]; ij++) {
+                int i = bas_aa_sym[h][ij][0];
+                int j = bas_aa_sym[h][ij][1];
+                for ( int kl = 0; kl < gems_aa[h]; kl++) {
+                    int k = bas_aa_sym[h][kl][0];
+                    int l = bas_aa_sym[h][kl][1];
+                    double dum = na * u_p[d2bboff[h] + ij*gems_aa[h] + kl];
+                    for ( int p = 0; p < amo_; p++) {
+                        int h2 = SymmetryPair(h,symmetry[p]);
+                        int ijp = ibas_aab_sym[h2][i][j][p];
+                        int klp = ibas_aab_sym[h2][k][l][p];
+                        dum -= u_p[d3bbaoff[h2] + ijp*trip_aab[h2]+klp];
+                    }
+                    A_p[offset + ij*gems_aa[h]+kl] = dum;
                 }
-                A_p[offset + ij*gems_aa[h]+kl] = dum;
             }
+            offset += gems_aa[h] * gems_aa[h];
         }
-        offset += gems_aa[h] * gems_aa[h];
     }
     if ( na > 1 ) {
         // D3aab -> D2ab
@@ -224,10 +227,12 @@ void v2RDMSolver::D3_constraints_Au(SharedVector A,SharedVector u){
     // additional spin constraints for singlets:
     if ( constrain_spin_ && nalpha_ == nbeta_ ) {
         // D3aab = D3bba
-        for ( int h = 0; h < nirrep_; h++) {
-            C_DCOPY(trip_aab[h]*trip_aab[h],u_p + d3aaboff[h],1,A_p + offset,1);
-            C_DAXPY(trip_aab[h]*trip_aab[h],-1.0,u_p + d3bbaoff[h],1,A_p + offset,1);
-            offset += trip_aab[h]*trip_aab[h];
+        if ( !closed_shell_ ) {
+            for ( int h = 0; h < nirrep_; h++) {
+                C_DCOPY(trip_aab[h]*trip_aab[h],u_p + d3aaboff[h],1,A_p + offset,1);
+                C_DAXPY(trip_aab[h]*trip_aab[h],-1.0,u_p + d3bbaoff[h],1,A_p + offset,1);
+                offset += trip_aab[h]*trip_aab[h];
+            }
         }
         // D3aaa <- D3aab
         for ( int h = 0; h < nirrep_; h++) {
@@ -262,36 +267,38 @@ void v2RDMSolver::D3_constraints_Au(SharedVector A,SharedVector u){
             offset += trip_aaa[h]*trip_aaa[h];
         }
         // D3bbb <- D3bba
-        for ( int h = 0; h < nirrep_; h++) {
-            C_DCOPY(trip_aaa[h]*trip_aaa[h],u_p + d3bbboff[h],1,A_p + offset,1);
-            for (int pqr = 0; pqr < trip_aaa[h]; pqr++) {
-                int p = bas_aaa_sym[h][pqr][0];
-                int q = bas_aaa_sym[h][pqr][1];
-                int r = bas_aaa_sym[h][pqr][2];
-                int pqr_b = ibas_aab_sym[h][p][q][r];
-                int prq_b = ibas_aab_sym[h][p][r][q];
-                int qrp_b = ibas_aab_sym[h][q][r][p];
-                for (int stu = 0; stu < trip_aaa[h]; stu++) {
-                    int s = bas_aaa_sym[h][stu][0];
-                    int t = bas_aaa_sym[h][stu][1];
-                    int u = bas_aaa_sym[h][stu][2];
-                    int stu_b = ibas_aab_sym[h][s][t][u];
-                    int sut_b = ibas_aab_sym[h][s][u][t];
-                    int tus_b = ibas_aab_sym[h][t][u][s];
-                    A_p[offset + pqr*trip_aaa[h] + stu] -= 1.0/3.0 * u_p[d3bbaoff[h] + pqr_b * trip_aab[h] + stu_b];
-                    A_p[offset + pqr*trip_aaa[h] + stu] += 1.0/3.0 * u_p[d3bbaoff[h] + pqr_b * trip_aab[h] + sut_b];
-                    A_p[offset + pqr*trip_aaa[h] + stu] -= 1.0/3.0 * u_p[d3bbaoff[h] + pqr_b * trip_aab[h] + tus_b];
+        if ( !closed_shell_ ) {
+            for ( int h = 0; h < nirrep_; h++) {
+                C_DCOPY(trip_aaa[h]*trip_aaa[h],u_p + d3bbboff[h],1,A_p + offset,1);
+                for (int pqr = 0; pqr < trip_aaa[h]; pqr++) {
+                    int p = bas_aaa_sym[h][pqr][0];
+                    int q = bas_aaa_sym[h][pqr][1];
+                    int r = bas_aaa_sym[h][pqr][2];
+                    int pqr_b = ibas_aab_sym[h][p][q][r];
+                    int prq_b = ibas_aab_sym[h][p][r][q];
+                    int qrp_b = ibas_aab_sym[h][q][r][p];
+                    for (int stu = 0; stu < trip_aaa[h]; stu++) {
+                        int s = bas_aaa_sym[h][stu][0];
+                        int t = bas_aaa_sym[h][stu][1];
+                        int u = bas_aaa_sym[h][stu][2];
+                        int stu_b = ibas_aab_sym[h][s][t][u];
+                        int sut_b = ibas_aab_sym[h][s][u][t];
+                        int tus_b = ibas_aab_sym[h][t][u][s];
+                        A_p[offset + pqr*trip_aaa[h] + stu] -= 1.0/3.0 * u_p[d3bbaoff[h] + pqr_b * trip_aab[h] + stu_b];
+                        A_p[offset + pqr*trip_aaa[h] + stu] += 1.0/3.0 * u_p[d3bbaoff[h] + pqr_b * trip_aab[h] + sut_b];
+                        A_p[offset + pqr*trip_aaa[h] + stu] -= 1.0/3.0 * u_p[d3bbaoff[h] + pqr_b * trip_aab[h] + tus_b];
 
-                    A_p[offset + pqr*trip_aaa[h] + stu] += 1.0/3.0 * u_p[d3bbaoff[h] + prq_b * trip_aab[h] + stu_b];
-                    A_p[offset + pqr*trip_aaa[h] + stu] -= 1.0/3.0 * u_p[d3bbaoff[h] + prq_b * trip_aab[h] + sut_b];
-                    A_p[offset + pqr*trip_aaa[h] + stu] += 1.0/3.0 * u_p[d3bbaoff[h] + prq_b * trip_aab[h] + tus_b];
+                        A_p[offset + pqr*trip_aaa[h] + stu] += 1.0/3.0 * u_p[d3bbaoff[h] + prq_b * trip_aab[h] + stu_b];
+                        A_p[offset + pqr*trip_aaa[h] + stu] -= 1.0/3.0 * u_p[d3bbaoff[h] + prq_b * trip_aab[h] + sut_b];
+                        A_p[offset + pqr*trip_aaa[h] + stu] += 1.0/3.0 * u_p[d3bbaoff[h] + prq_b * trip_aab[h] + tus_b];
 
-                    A_p[offset + pqr*trip_aaa[h] + stu] -= 1.0/3.0 * u_p[d3bbaoff[h] + qrp_b * trip_aab[h] + stu_b];
-                    A_p[offset + pqr*trip_aaa[h] + stu] += 1.0/3.0 * u_p[d3bbaoff[h] + qrp_b * trip_aab[h] + sut_b];
-                    A_p[offset + pqr*trip_aaa[h] + stu] -= 1.0/3.0 * u_p[d3bbaoff[h] + qrp_b * trip_aab[h] + tus_b];
+                        A_p[offset + pqr*trip_aaa[h] + stu] -= 1.0/3.0 * u_p[d3bbaoff[h] + qrp_b * trip_aab[h] + stu_b];
+                        A_p[offset + pqr*trip_aaa[h] + stu] += 1.0/3.0 * u_p[d3bbaoff[h] + qrp_b * trip_aab[h] + sut_b];
+                        A_p[offset + pqr*trip_aaa[h] + stu] -= 1.0/3.0 * u_p[d3bbaoff[h] + qrp_b * trip_aab[h] + tus_b];
+                    }
                 }
+                offset += trip_aaa[h]*trip_aaa[h];
             }
-            offset += trip_aaa[h]*trip_aaa[h];
         }
     }
 
@@ -299,9 +306,12 @@ void v2RDMSolver::D3_constraints_Au(SharedVector A,SharedVector u){
 
 // D3 portion of A^T.y 
 void v2RDMSolver::D3_constraints_ATu(SharedVector A,SharedVector u){
+    D3_constraints_ATu(A->pointer(),u->pointer());
+}
 
-    double * A_p = A->pointer();
-    double * u_p = u->pointer();
+template <typename TargetType, typename SourceType>
+long int v2RDMSolver::D3_constraints_ATu(TargetType A_p,SourceType u_p){
+    long int offset = d3_constraints_offset_;
 
     int na = nalpha_ - nrstc_ - nfrzc_;
     int nb = nbeta_ - nrstc_ - nfrzc_;
@@ -315,7 +325,7 @@ void v2RDMSolver::D3_constraints_ATu(SharedVector A,SharedVector u){
                 for ( int kl = 0; kl < gems_aa[h]; kl++) {
                     int k = bas_aa_sym[h][kl][0];
                     int l = bas_aa_sym[h][kl][1];
-                    double dum = u_p[offset + ij*gems_aa[h] + kl];
+                    auto dum = u_p[offset + ij*gems_aa[h] + kl];
                     A_p[d2aaoff[h] + ij*gems_aa[h] + kl] += (na - 2.0) * dum;
                     for ( int p = 0; p < amo_; p++) {
                         if ( i == p || j == p ) continue;
@@ -335,7 +345,7 @@ void v2RDMSolver::D3_constraints_ATu(SharedVector A,SharedVector u){
             offset += gems_aa[h] * gems_aa[h];
         }
     }
-    if ( nb > 2 ) {
+    if ( !closed_shell_ && nb > 2 ) {
         // D3bbb -> D2bb
         for ( int h = 0; h < nirrep_; h++) {
             for ( int ij = 0; ij < gems_aa[h]; ij++) {
@@ -344,7 +354,7 @@ void v2RDMSolver::D3_constraints_ATu(SharedVector A,SharedVector u){
                 for ( int kl = 0; kl < gems_aa[h]; kl++) {
                     int k = bas_aa_sym[h][kl][0];
                     int l = bas_aa_sym[h][kl][1];
-                    double dum = u_p[offset + ij*gems_aa[h] + kl];
+                    auto dum = u_p[offset + ij*gems_aa[h] + kl];
                     A_p[d2bboff[h] + ij*gems_aa[h] + kl] += (nb - 2.0) * dum;
                     for ( int p = 0; p < amo_; p++) {
                         if ( i == p || j == p ) continue;
@@ -372,7 +382,7 @@ void v2RDMSolver::D3_constraints_ATu(SharedVector A,SharedVector u){
             for ( int kl = 0; kl < gems_aa[h]; kl++) {
                 int k = bas_aa_sym[h][kl][0];
                 int l = bas_aa_sym[h][kl][1];
-                double dum = u_p[offset + ij*gems_aa[h] + kl];
+                auto dum = u_p[offset + ij*gems_aa[h] + kl];
                 A_p[d2aaoff[h] + ij*gems_aa[h] + kl] += nb * dum;
                 for ( int p = 0; p < amo_; p++) {
                     int h2 = SymmetryPair(h,symmetry[p]);
@@ -385,24 +395,26 @@ void v2RDMSolver::D3_constraints_ATu(SharedVector A,SharedVector u){
         offset += gems_aa[h] * gems_aa[h];
     }
     // D3bba -> D2bb
-    for ( int h = 0; h < nirrep_; h++) {
-        for ( int ij = 0; ij < gems_aa[h]; ij++) {
-            int i = bas_aa_sym[h][ij][0];
-            int j = bas_aa_sym[h][ij][1];
-            for ( int kl = 0; kl < gems_aa[h]; kl++) {
-                int k = bas_aa_sym[h][kl][0];
-                int l = bas_aa_sym[h][kl][1];
-                double dum = u_p[offset + ij*gems_aa[h] + kl];
-                A_p[d2bboff[h] + ij*gems_aa[h] + kl] += na * dum;
-                for ( int p = 0; p < amo_; p++) {
-                    int h2 = SymmetryPair(h,symmetry[p]);
-                    int ijp = ibas_aab_sym[h2][i][j][p];
-                    int klp = ibas_aab_sym[h2][k][l][p];
-                    A_p[d3bbaoff[h2] + ijp*trip_aab[h2]+klp] -= dum;
+    if ( !closed_shell_ ) {
+        for ( int h = 0; h < nirrep_; h++) {
+            for ( int ij = 0; ij < gems_aa[h]; ij++) {
+                int i = bas_aa_sym[h][ij][0];
+                int j = bas_aa_sym[h][ij][1];
+                for ( int kl = 0; kl < gems_aa[h]; kl++) {
+                    int k = bas_aa_sym[h][kl][0];
+                    int l = bas_aa_sym[h][kl][1];
+                    auto dum = u_p[offset + ij*gems_aa[h] + kl];
+                    A_p[d2bboff[h] + ij*gems_aa[h] + kl] += na * dum;
+                    for ( int p = 0; p < amo_; p++) {
+                        int h2 = SymmetryPair(h,symmetry[p]);
+                        int ijp = ibas_aab_sym[h2][i][j][p];
+                        int klp = ibas_aab_sym[h2][k][l][p];
+                        A_p[d3bbaoff[h2] + ijp*trip_aab[h2]+klp] -= dum;
+                    }
                 }
             }
+            offset += gems_aa[h] * gems_aa[h];
         }
-        offset += gems_aa[h] * gems_aa[h];
     }
     if ( na > 1 ) {
         // D3aab -> D2ab
@@ -413,7 +425,7 @@ void v2RDMSolver::D3_constraints_ATu(SharedVector A,SharedVector u){
                 for ( int kl = 0; kl < gems_ab[h]; kl++) {
                     int k = bas_ab_sym[h][kl][0];
                     int l = bas_ab_sym[h][kl][1];
-                    double dum = u_p[offset + ij*gems_ab[h] + kl];
+                    auto dum = u_p[offset + ij*gems_ab[h] + kl];
                     A_p[d2aboff[h] + ij*gems_ab[h] + kl] += (na - 1.0) * dum;
                     for ( int p = 0; p < amo_; p++) {
                         if ( i == p) continue;
@@ -440,7 +452,7 @@ void v2RDMSolver::D3_constraints_ATu(SharedVector A,SharedVector u){
                 for ( int kl = 0; kl < gems_ab[h]; kl++) {
                     int k = bas_ab_sym[h][kl][0];
                     int l = bas_ab_sym[h][kl][1];
-                    double dum = u_p[offset + ij*gems_ab[h] + kl];
+                    auto dum = u_p[offset + ij*gems_ab[h] + kl];
                     A_p[d2aboff[h] + ij*gems_ab[h] + kl] += (nb - 1.0) * dum;
                     for ( int p = 0; p < amo_; p++) {
                         if ( j == p) continue;
@@ -462,10 +474,12 @@ void v2RDMSolver::D3_constraints_ATu(SharedVector A,SharedVector u){
     // additional spin constraints for singlets:
     if ( constrain_spin_ && nalpha_ == nbeta_ ) {
         // D3aab = D3bba
-        for ( int h = 0; h < nirrep_; h++) {
-            C_DAXPY(trip_aab[h]*trip_aab[h], 1.0,u_p + offset,1,A_p + d3aaboff[h],1);
-            C_DAXPY(trip_aab[h]*trip_aab[h],-1.0,u_p + offset,1,A_p + d3bbaoff[h],1);
-            offset += trip_aab[h]*trip_aab[h];
+        if ( !closed_shell_ ) {
+            for ( int h = 0; h < nirrep_; h++) {
+                C_DAXPY(trip_aab[h]*trip_aab[h], 1.0,u_p + offset,1,A_p + d3aaboff[h],1);
+                C_DAXPY(trip_aab[h]*trip_aab[h],-1.0,u_p + offset,1,A_p + d3bbaoff[h],1);
+                offset += trip_aab[h]*trip_aab[h];
+            }
         }
         // D3aaa <- D3aab
         for ( int h = 0; h < nirrep_; h++) {
@@ -500,39 +514,46 @@ void v2RDMSolver::D3_constraints_ATu(SharedVector A,SharedVector u){
             offset += trip_aaa[h]*trip_aaa[h];
         }
         // D3bbb <- D3bba
-        for ( int h = 0; h < nirrep_; h++) {
-            C_DAXPY(trip_aaa[h]*trip_aaa[h],1.0,u_p + offset,1,A_p+d3bbboff[h],1);
-            for (int pqr = 0; pqr < trip_aaa[h]; pqr++) {
-                int p = bas_aaa_sym[h][pqr][0];
-                int q = bas_aaa_sym[h][pqr][1];
-                int r = bas_aaa_sym[h][pqr][2];
-                int pqr_b = ibas_aab_sym[h][p][q][r];
-                int prq_b = ibas_aab_sym[h][p][r][q];
-                int qrp_b = ibas_aab_sym[h][q][r][p];
-                for (int stu = 0; stu < trip_aaa[h]; stu++) {
-                    int s = bas_aaa_sym[h][stu][0];
-                    int t = bas_aaa_sym[h][stu][1];
-                    int u = bas_aaa_sym[h][stu][2];
-                    int stu_b = ibas_aab_sym[h][s][t][u];
-                    int sut_b = ibas_aab_sym[h][s][u][t];
-                    int tus_b = ibas_aab_sym[h][t][u][s];
-                    A_p[d3bbaoff[h] + pqr_b * trip_aab[h] + stu_b] -= 1.0/3.0 * u_p[offset + pqr*trip_aaa[h] + stu];
-                    A_p[d3bbaoff[h] + pqr_b * trip_aab[h] + sut_b] += 1.0/3.0 * u_p[offset + pqr*trip_aaa[h] + stu];
-                    A_p[d3bbaoff[h] + pqr_b * trip_aab[h] + tus_b] -= 1.0/3.0 * u_p[offset + pqr*trip_aaa[h] + stu];
+        if ( !closed_shell_ ) {
+            for ( int h = 0; h < nirrep_; h++) {
+                C_DAXPY(trip_aaa[h]*trip_aaa[h],1.0,u_p + offset,1,A_p+d3bbboff[h],1);
+                for (int pqr = 0; pqr < trip_aaa[h]; pqr++) {
+                    int p = bas_aaa_sym[h][pqr][0];
+                    int q = bas_aaa_sym[h][pqr][1];
+                    int r = bas_aaa_sym[h][pqr][2];
+                    int pqr_b = ibas_aab_sym[h][p][q][r];
+                    int prq_b = ibas_aab_sym[h][p][r][q];
+                    int qrp_b = ibas_aab_sym[h][q][r][p];
+                    for (int stu = 0; stu < trip_aaa[h]; stu++) {
+                        int s = bas_aaa_sym[h][stu][0];
+                        int t = bas_aaa_sym[h][stu][1];
+                        int u = bas_aaa_sym[h][stu][2];
+                        int stu_b = ibas_aab_sym[h][s][t][u];
+                        int sut_b = ibas_aab_sym[h][s][u][t];
+                        int tus_b = ibas_aab_sym[h][t][u][s];
+                        A_p[d3bbaoff[h] + pqr_b * trip_aab[h] + stu_b] -= 1.0/3.0 * u_p[offset + pqr*trip_aaa[h] + stu];
+                        A_p[d3bbaoff[h] + pqr_b * trip_aab[h] + sut_b] += 1.0/3.0 * u_p[offset + pqr*trip_aaa[h] + stu];
+                        A_p[d3bbaoff[h] + pqr_b * trip_aab[h] + tus_b] -= 1.0/3.0 * u_p[offset + pqr*trip_aaa[h] + stu];
                                                                                                                    
-                    A_p[d3bbaoff[h] + prq_b * trip_aab[h] + stu_b] += 1.0/3.0 * u_p[offset + pqr*trip_aaa[h] + stu];
-                    A_p[d3bbaoff[h] + prq_b * trip_aab[h] + sut_b] -= 1.0/3.0 * u_p[offset + pqr*trip_aaa[h] + stu];
-                    A_p[d3bbaoff[h] + prq_b * trip_aab[h] + tus_b] += 1.0/3.0 * u_p[offset + pqr*trip_aaa[h] + stu];
+                        A_p[d3bbaoff[h] + prq_b * trip_aab[h] + stu_b] += 1.0/3.0 * u_p[offset + pqr*trip_aaa[h] + stu];
+                        A_p[d3bbaoff[h] + prq_b * trip_aab[h] + sut_b] -= 1.0/3.0 * u_p[offset + pqr*trip_aaa[h] + stu];
+                        A_p[d3bbaoff[h] + prq_b * trip_aab[h] + tus_b] += 1.0/3.0 * u_p[offset + pqr*trip_aaa[h] + stu];
                                                                                                                    
-                    A_p[d3bbaoff[h] + qrp_b * trip_aab[h] + stu_b] -= 1.0/3.0 * u_p[offset + pqr*trip_aaa[h] + stu];
-                    A_p[d3bbaoff[h] + qrp_b * trip_aab[h] + sut_b] += 1.0/3.0 * u_p[offset + pqr*trip_aaa[h] + stu];
-                    A_p[d3bbaoff[h] + qrp_b * trip_aab[h] + tus_b] -= 1.0/3.0 * u_p[offset + pqr*trip_aaa[h] + stu];
+                        A_p[d3bbaoff[h] + qrp_b * trip_aab[h] + stu_b] -= 1.0/3.0 * u_p[offset + pqr*trip_aaa[h] + stu];
+                        A_p[d3bbaoff[h] + qrp_b * trip_aab[h] + sut_b] += 1.0/3.0 * u_p[offset + pqr*trip_aaa[h] + stu];
+                        A_p[d3bbaoff[h] + qrp_b * trip_aab[h] + tus_b] -= 1.0/3.0 * u_p[offset + pqr*trip_aaa[h] + stu];
+                    }
                 }
+                offset += trip_aaa[h]*trip_aaa[h];
             }
-            offset += trip_aaa[h]*trip_aaa[h];
         }
     }
 
+    return offset;
 }
 
+// instantiations used by RecordConstraints and bpsdp_ATu_tasks
+template long int v2RDMSolver::D3_constraints_ATu<SparseTarget,SparseSource>(SparseTarget A_p,SparseSource u_p);
+template long int v2RDMSolver::D3_constraints_ATu<double*,double*>(double* A_p,double* u_p);
+
 }} // end namespaces
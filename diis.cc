@@ -31,8 +31,6 @@
 #include "blas.h"
 #include<psi4/libqt/qt.h>
 
-#include<psi4/psifiles.h>
-
 using namespace psi;
 
 using namespace fnocc;
@@ -41,191 +39,139 @@ using namespace fnocc;
 
    diis functions
 
+   DIIS extrapolation of (rx, rz), the square roots of x and z, so 
+   the extrapolated x = rx^2 and z = rz^2 stay positive semidefinite.
+   the last maxdiis_ vectors and errors are kept in memory in a ring 
+   buffer, and the error matrix gains one row per stored vector.
+
 ================================================================*/
 
 namespace psi{ namespace v2rdm_casscf{
 
-// TODO: replace junk1/junk2
-void v2RDMSolver::DIIS(double*c,long int nvec,int replace_diis_iter){
-    long int nvar      = nvec+1;
-    long int * ipiv    = (long int*)malloc(nvar*sizeof(long int));
-    double * temp      = (double*)malloc(sizeof(double)*maxdiis_*maxdiis_);
-    double * A         = (double*)malloc(sizeof(double)*nvar*nvar);
-    double * B         = (double*)malloc(sizeof(double)*nvar);
-    memset((void*)A,'\0',nvar*nvar*sizeof(double));
-    memset((void*)B,'\0',nvar*sizeof(double));
-    B[nvec] = -1.;
-
-    char*evector=(char*)malloc(1000*sizeof(char));
-
-    std::shared_ptr<PSIO> psio(new PSIO());
-    psio->open(PSIF_DCC_EVEC,PSIO_OPEN_OLD);
-
-    // add row to matrix, don't build the whole thing.
-    psio->read_entry(PSIF_DCC_EVEC,"error matrix",(char*)&temp[0],maxdiis_*maxdiis_*sizeof(double));
-    for (long int i = 0; i < nvec; i++){
-        for (long int j = 0; j < nvec; j++){
-            A[i*nvar+j] = temp[i*maxdiis_+j];
-        }
-    }
+void v2RDMSolver::DIIS_Initialize() {
 
-    if (nvec <= 3) {
-        for (long int i = 0; i < nvec; i++) {
-            sprintf(evector,"evector%li",i+1);
-            psio->read_entry(PSIF_DCC_EVEC,evector,(char*)&junk1[0],dimdiis_*sizeof(double));
-            for (long int j = i; j < nvec; j++){
-                sprintf(evector,"evector%li",j+1);
-                psio->read_entry(PSIF_DCC_EVEC,evector,(char*)&junk2[0],dimdiis_*sizeof(double));
-                double sum  = C_DDOT(dimdiis_,junk1,1,junk2,1);
-                A[i*nvar+j] = sum;
-                A[j*nvar+i] = sum;
-            }
-        }
-    }else {
-        long int i;
-        if (nvec<=maxdiis_ && diis_oiter_<=maxdiis_){
-            i = nvec - 1;
-        }
-        else{
-            i = replace_diis_iter - 1;
-        }
-        sprintf(evector,"evector%li",i+1);
-        psio->read_entry(PSIF_DCC_EVEC,evector,(char*)&junk1[0],dimdiis_*sizeof(double));
-        for (long int j = 0; j < nvec; j++){
-            sprintf(evector,"evector%li",j+1);
-            psio->read_entry(PSIF_DCC_EVEC,evector,(char*)&junk2[0],dimdiis_*sizeof(double));
-            double sum  = C_DDOT(dimdiis_,junk1,1,junk2,1);
-            A[i*nvar+j] = sum;
-            A[j*nvar+i] = sum;
-        }
-    }
+    dimdiis_ = 2 * primal_dim_;
 
-    long int j = nvec;
-    for (long int i = 0; i < nvar; i++){
-        A[j*nvar+i] = -1.0;
-        A[i*nvar+j] = -1.0;
-    }
-    A[nvar*nvar-1] = 0.;
+    rx = SharedVector(new Vector("diis x",primal_dim_));
+    rz = SharedVector(new Vector("diis z",primal_dim_));
 
-    // save matrix for next iteration
-    for (long int i = 0; i < nvec; i++){
-        for (long int j = 0; j < nvec; j++){
-            temp[i*maxdiis_+j] = A[i*nvar+j];
-        }
-    }
-    psio->write_entry(PSIF_DCC_EVEC,"error matrix",(char*)&temp[0],maxdiis_*maxdiis_*sizeof(double));
-    free(temp);
-    psio->close(PSIF_DCC_EVEC,1);
-    free(evector);
+    diis_vectors_  = (double*)malloc(maxdiis_ * dimdiis_ * sizeof(double));
+    diis_errors_   = (double*)malloc(maxdiis_ * dimdiis_ * sizeof(double));
+    diis_previous_ = (double*)malloc(dimdiis_ * sizeof(double));
+    diis_gram_     = (double*)malloc(maxdiis_ * maxdiis_ * sizeof(double));
 
-    long int nrhs,lda,ldb,info;
-    nrhs = 1;
-    lda = ldb = nvar;
-    info = 0;
-    DGESV(nvar,nrhs,A,lda,ipiv,B,ldb,info);
-    C_DCOPY(nvec,B,1,c,1);
-
-    free(A);
-    free(B);
-    free(ipiv);
-    psio.reset();
+    DIIS_Reset();
 }
 
-void v2RDMSolver::DIIS_WriteOldVector(long int iter,int diis_iter,int replace_diis_iter){
-
-    char*oldvector=(char*)malloc(1000*sizeof(char));
-
-    if (diis_iter<=maxdiis_ && iter<=maxdiis_){
-       sprintf(oldvector,"oldvector%i",diis_iter);
-    }
-    else{
-       sprintf(oldvector,"oldvector%i",replace_diis_iter);
-    }
+void v2RDMSolver::DIIS_Finalize() {
+    free(diis_vectors_);
+    free(diis_errors_);
+    free(diis_previous_);
+    free(diis_gram_);
+}
 
-    std::shared_ptr<PSIO> psio(new PSIO());
-    if (diis_iter==0) {
-       psio->open(PSIF_DCC_OVEC,PSIO_OPEN_NEW);
-    }else {
-       psio->open(PSIF_DCC_OVEC,PSIO_OPEN_OLD);
-    }
+void v2RDMSolver::DIIS_Reset() {
+    diis_oiter_         = 0;
+    diis_nvec_          = 0;
+    diis_head_          = 0;
+    diis_have_previous_ = false;
+}
 
-    psio_address addr;
-    addr = PSIO_ZERO;
+// vectors are collected over the last maxdiis_ + 1 iterations before 
+// each extrapolation (the first one only provides an error reference)
+bool v2RDMSolver::DIIS_Collecting() {
+    if ( maxdiis_ < 2 || diis_update_frequency_ < 1 ) return false;
+    long int phase = diis_oiter_ % diis_update_frequency_;
+    return ( phase >= diis_update_frequency_ - maxdiis_ - 1 );
+}
 
-    psio->write(PSIF_DCC_OVEC,oldvector,(char*)&rx->pointer()[0],dimdiis_*sizeof(double),addr,&addr);
-    psio->write(PSIF_DCC_OVEC,oldvector,(char*)&rz->pointer()[0],dimdiis_*sizeof(double),addr,&addr);
-    psio->close(PSIF_DCC_OVEC,1);
-    psio.reset();
+// store (rx, rz) from the last Update_xz.  the error is the change 
+// relative to the previous vector
+void v2RDMSolver::DIIS_StoreVectors() {
 
-    free(oldvector);
-}
-void v2RDMSolver::DIIS_WriteErrorVector(int diis_iter,int replace_diis_iter,int iter){
+    double * rx_p = rx->pointer();
+    double * rz_p = rz->pointer();
 
-    char*evector   = (char*)malloc(1000*sizeof(char));
-    if (diis_iter<=maxdiis_ && iter<=maxdiis_){
-       sprintf(evector,"evector%i",diis_iter);
-    }
-    else{
-       sprintf(evector,"evector%i",replace_diis_iter);
+    if ( !diis_have_previous_ ) {
+        C_DCOPY(primal_dim_,rx_p,1,diis_previous_,1);
+        C_DCOPY(primal_dim_,rz_p,1,diis_previous_ + primal_dim_,1);
+        diis_have_previous_ = true;
+        return;
     }
 
-    std::shared_ptr<PSIO> psio(new PSIO());
-    if (diis_iter==0) {
-       psio->open(PSIF_DCC_EVEC,PSIO_OPEN_NEW);
-       double * temp = (double*)malloc(maxdiis_*maxdiis_*sizeof(double));
-       memset((void*)temp,'\0',maxdiis_*maxdiis_*sizeof(double));
-       psio->write_entry(PSIF_DCC_EVEC,"error matrix",(char*)&temp[0],maxdiis_*maxdiis_*sizeof(double));
-       free(temp);
-    }
-    else {
-       psio->open(PSIF_DCC_EVEC,PSIO_OPEN_OLD);
-    }
+    long int slot = diis_head_;
+    double * vec = diis_vectors_ + slot * dimdiis_;
+    double * err = diis_errors_  + slot * dimdiis_;
 
-    psio_address addr;
-    addr = PSIO_ZERO;
+    C_DCOPY(primal_dim_,rx_p,1,vec,1);
+    C_DCOPY(primal_dim_,rz_p,1,vec + primal_dim_,1);
 
-    psio->write(PSIF_DCC_EVEC,evector,(char*)&rx_error->pointer()[0],dimdiis_*sizeof(double),addr,&addr);
-    psio->write(PSIF_DCC_EVEC,evector,(char*)&rz_error->pointer()[0],dimdiis_*sizeof(double),addr,&addr);
+    C_DCOPY(dimdiis_,vec,1,err,1);
+    C_DAXPY(dimdiis_,-1.0,diis_previous_,1,err,1);
 
-    psio->close(PSIF_DCC_EVEC,1);
-    psio.reset();
+    C_DCOPY(dimdiis_,vec,1,diis_previous_,1);
 
-    free(evector);
+    if ( diis_nvec_ < maxdiis_ ) diis_nvec_++;
+    diis_head_ = ( diis_head_ + 1 ) % maxdiis_;
+
+    // new row of the error matrix
+    for (long int j = 0; j < diis_nvec_; j++) {
+        double dum = C_DDOT(dimdiis_,err,1,diis_errors_ + j * dimdiis_,1);
+        diis_gram_[slot * maxdiis_ + j] = dum;
+        diis_gram_[j * maxdiis_ + slot] = dum;
+    }
 }
-void v2RDMSolver::DIIS_Extrapolate(int diis_iter,int&replace_diis_iter){
 
-    char*oldvector;
-    oldvector=(char*)malloc(1000*sizeof(char));
+// x = rx^2, z = rz^2 from the extrapolated vector.  returns false (and 
+// leaves x and z alone) if the DIIS equations cannot be solved
+bool v2RDMSolver::DIIS_Extrapolate() {
 
-    std::shared_ptr<PSIO> psio(new PSIO());
-    psio->open(PSIF_DCC_OVEC,PSIO_OPEN_OLD);
+    long int nvec = diis_nvec_;
+    if ( nvec < 2 ) return false;
 
-    psio_address addr;
+    long int nvar = nvec + 1;
+    long int * ipiv = (long int*)malloc(nvar*sizeof(long int));
+    double * A      = (double*)malloc(nvar*nvar*sizeof(double));
+    double * B      = (double*)malloc(nvar*sizeof(double));
 
-    memset((void*)rx->pointer(),'\0',dimdiis_*sizeof(double));
-    memset((void*)rz->pointer(),'\0',dimdiis_*sizeof(double));
+    // scale the error matrix for conditioning
+    double scale = 0.0;
+    for (long int i = 0; i < nvec; i++) {
+        if ( diis_gram_[i * maxdiis_ + i] > scale ) scale = diis_gram_[i * maxdiis_ + i];
+    }
+    if ( scale == 0.0 ) scale = 1.0;
 
-    long int max = diis_iter;
-    if (max > maxdiis_) max = maxdiis_;
+    for (long int i = 0; i < nvec; i++) {
+        for (long int j = 0; j < nvec; j++) {
+            A[i*nvar+j] = diis_gram_[i * maxdiis_ + j] / scale;
+        }
+        A[i*nvar+nvec] = -1.0;
+        A[nvec*nvar+i] = -1.0;
+        B[i] = 0.0;
+    }
+    A[nvar*nvar-1] = 0.0;
+    B[nvec] = -1.0;
 
-    double min = 1.e9;
-    for (long int j=1; j<=max; j++){
-        addr = PSIO_ZERO;
-        sprintf(oldvector,"oldvector%li",j);
+    long int nrhs,lda,ldb,info;
+    nrhs = 1;
+    lda = ldb = nvar;
+    info = 0;
+    DGESV(nvar,nrhs,A,lda,ipiv,B,ldb,info);
+    C_DCOPY(nvec,B,1,diisvec_,1);
 
-        psio->read(PSIF_DCC_OVEC,oldvector,(char*)&junk1[0],dimdiis_*sizeof(double),addr,&addr);
-        C_DAXPY(dimdiis_,diisvec_[j-1],junk1,1,rx->pointer(),1);
+    free(A);
+    free(B);
+    free(ipiv);
 
-        psio->read(PSIF_DCC_OVEC,oldvector,(char*)&junk1[0],dimdiis_*sizeof(double),addr,&addr);
-        C_DAXPY(dimdiis_,diisvec_[j-1],junk1,1,rz->pointer(),1);
+    if ( info != 0 ) return false;
 
-        //if ( fabs( diisvec[j-1] ) < min ) {
-        //    min = fabs( diisvec[j-1] );
-        //    replace_diis_iter = j;
-        //}
+    // extrapolated (rx, rz).  this is also the reference for the next error
+    memset((void*)diis_previous_,'\0',dimdiis_*sizeof(double));
+    for (long int j = 0; j < nvec; j++) {
+        C_DAXPY(dimdiis_,diisvec_[j],diis_vectors_ + j * dimdiis_,1,diis_previous_,1);
     }
-    psio->close(PSIF_DCC_OVEC,1);
-    free(oldvector);
+    C_DCOPY(primal_dim_,diis_previous_,1,rx->pointer(),1);
+    C_DCOPY(primal_dim_,diis_previous_ + primal_dim_,1,rz->pointer(),1);
 
     // now, build x = rx^2, z = rz^2
     double * x_p  = x->pointer();
@@ -233,18 +179,44 @@ void v2RDMSolver::DIIS_Extrapolate(int diis_iter,int&replace_diis_iter){
     double * rx_p = rx->pointer();
     double * rz_p = rz->pointer();
 
+    if ( packed_storage_ ) {
+        DIIS_SquarePacked(rx_p,x_p);
+        DIIS_SquarePacked(rz_p,z_p);
+        return true;
+    }
+
     // loop over each block of x/z
     for (int i = 0; i < dimensions_.size(); i++) {
         if ( dimensions_[i] == 0 ) continue;
-        int myoffset = 0;
-        for (int j = 0; j < i; j++) {
-            myoffset += dimensions_[j] * dimensions_[j];
-        }
+        long int myoffset = dimensions_offset_[i];
         F_DGEMM('n','n',dimensions_[i],dimensions_[i],dimensions_[i],1.0,rx_p+myoffset,dimensions_[i],rx_p+myoffset,dimensions_[i],0.0,x_p+myoffset,dimensions_[i]);
         F_DGEMM('n','n',dimensions_[i],dimensions_[i],dimensions_[i],1.0,rz_p+myoffset,dimensions_[i],rz_p+myoffset,dimensions_[i],0.0,z_p+myoffset,dimensions_[i]);
     }
 
-    psio.reset();
+    return true;
+}
+
+// out = in^2, block by block, for packed in and out.  the squares of 
+// the blocks of in are staged in unpacked_
+void v2RDMSolver::DIIS_SquarePacked(double * in, double * out) {
+
+    double * full_p = unpacked_->pointer();
+    UnpackPrimal(in,full_p);
+
+    long int maxdim = 0;
+    for (int i = 0; i < dimensions_.size(); i++) {
+        if ( dimensions_[i] > maxdim ) maxdim = dimensions_[i];
+    }
+    double * tmp = (double*)malloc(maxdim*maxdim*sizeof(double));
+
+    for (int i = 0; i < dimensions_.size(); i++) {
+        if ( dimensions_[i] == 0 ) continue;
+        long int myoffset = dimensions_offset_[i];
+        F_DGEMM('n','n',dimensions_[i],dimensions_[i],dimensions_[i],1.0,full_p+myoffset,dimensions_[i],full_p+myoffset,dimensions_[i],0.0,tmp,dimensions_[i]);
+        PackBlock(dimensions_[i],tmp,out+dimensions_packed_offset_[i]);
+    }
+
+    free(tmp);
 }
 
 }}
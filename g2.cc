@@ -233,6 +233,7 @@ void v2RDMSolver::G2_constraints_guess_spin_adapted(SharedVector u){
     }
 }
 void v2RDMSolver::G2_constraints_Au_spin_adapted(SharedVector A,SharedVector u){
+    long int offset = g2_constraints_offset_;
 
     double * A_p = A->pointer();
     double * u_p = u->pointer();
@@ -547,9 +548,12 @@ printf("%20.12lf\n",maxs);
 }
 // G2 portion of A^T.y (spin adapted)
 void v2RDMSolver::G2_constraints_ATu_spin_adapted(SharedVector A,SharedVector u){
+    G2_constraints_ATu_spin_adapted(A->pointer(),u->pointer());
+}
 
-    double * A_p = A->pointer();
-    double * u_p = u->pointer();
+template <typename TargetType, typename SourceType>
+long int v2RDMSolver::G2_constraints_ATu_spin_adapted(TargetType A_p,SourceType u_p){
+    long int offset = g2_constraints_offset_;
 
     // G200
     for (int h = 0; h < nirrep_; h++) {
@@ -563,7 +567,7 @@ void v2RDMSolver::G2_constraints_ATu_spin_adapted(SharedVector A,SharedVector u)
                 int k = bas_ab_sym[h][klg][0];
                 int l = bas_ab_sym[h][klg][1];
 
-                double dum = u_p[offset + ijg*gems_ab[h]+klg];
+                auto dum = u_p[offset + ijg*gems_ab[h]+klg];
 
                 A_p[g2soff[h] + ijg*gems_ab[h]+klg] -= dum;
 
@@ -628,7 +632,7 @@ void v2RDMSolver::G2_constraints_ATu_spin_adapted(SharedVector A,SharedVector u)
                 int k = bas_ab_sym[h][klg][0];
                 int l = bas_ab_sym[h][klg][1];
 
-                double dum = u_p[offset + ijg*gems_ab[h]+klg];
+                auto dum = u_p[offset + ijg*gems_ab[h]+klg];
 
                 A_p[g2toff[h] + ijg*gems_ab[h]+klg] -= dum;
 
@@ -701,7 +705,7 @@ void v2RDMSolver::G2_constraints_ATu_spin_adapted(SharedVector A,SharedVector u)
                 int k = bas_ab_sym[h][klg][0];
                 int l = bas_ab_sym[h][klg][1];
 
-                double dum = u_p[offset + ijg*gems_ab[h]+klg];
+                auto dum = u_p[offset + ijg*gems_ab[h]+klg];
 
                 A_p[g2toff_p1[h] + ijg*gems_ab[h]+klg] -= dum;    // - G2ab(ij,kl)
 
@@ -750,7 +754,7 @@ void v2RDMSolver::G2_constraints_ATu_spin_adapted(SharedVector A,SharedVector u)
                 int k = bas_ab_sym[h][klg][0];
                 int l = bas_ab_sym[h][klg][1];
 
-                double dum = u_p[offset + ijg*gems_ab[h]+klg];
+                auto dum = u_p[offset + ijg*gems_ab[h]+klg];
 
                 A_p[g2toff_m1[h] + ijg*gems_ab[h]+klg] -= dum;    // - G2ab(ij,kl)
 
@@ -819,7 +823,7 @@ void v2RDMSolver::G2_constraints_ATu_spin_adapted(SharedVector A,SharedVector u)
             int k = bas_ab_sym[h][klg][0];
             int l = bas_ab_sym[h][klg][1];
 
-            double dum = u_p[offset + k * amo_ + l];
+            auto dum = u_p[offset + k * amo_ + l];
 
             for (int ijg = 0; ijg < gems_ab[h]; ijg++) {
 
@@ -839,7 +843,7 @@ void v2RDMSolver::G2_constraints_ATu_spin_adapted(SharedVector A,SharedVector u)
             int k = bas_ab_sym[h][klg][0];
             int l = bas_ab_sym[h][klg][1];
 
-            double dum = u_p[offset + k * amo_ + l];
+            auto dum = u_p[offset + k * amo_ + l];
 
             for (int ijg = 0; ijg < gems_ab[h]; ijg++) {
 
@@ -853,6 +857,8 @@ void v2RDMSolver::G2_constraints_ATu_spin_adapted(SharedVector A,SharedVector u)
         }
     }
     offset += amo_*amo_;*/
+
+    return offset;
 }
 
 void v2RDMSolver::G2_constraints_guess(SharedVector u){
@@ -1059,6 +1065,7 @@ void v2RDMSolver::G2_constraints_guess(SharedVector u){
 
 // G2 portion of A.x (with symmetry)
 void v2RDMSolver::G2_constraints_Au(SharedVector A,SharedVector u){
+    long int offset = g2_constraints_offset_;
     double* A_p = A->pointer();
     double* u_p = u->pointer();
 
@@ -1279,9 +1286,12 @@ void v2RDMSolver::G2_constraints_Au(SharedVector A,SharedVector u){
 
 // G2 portion of A^T.y (with symmetry)
 void v2RDMSolver::G2_constraints_ATu(SharedVector A,SharedVector u){
+    G2_constraints_ATu(A->pointer(),u->pointer());
+}
 
-    double* A_p = A->pointer();
-    double* u_p = u->pointer();
+template <typename TargetType, typename SourceType>
+long int v2RDMSolver::G2_constraints_ATu(TargetType A_p,SourceType u_p){
+    long int offset = g2_constraints_offset_;
 
     // G2ab constraints:
 // heyheyhey
@@ -1296,7 +1306,7 @@ void v2RDMSolver::G2_constraints_ATu(SharedVector A,SharedVector u){
                 int k = bas_ab_sym[h][klg][0];
                 int l = bas_ab_sym[h][klg][1];
 
-                double dum = u_p[offset + ijg*gems_ab[h]+klg];
+                auto dum = u_p[offset + ijg*gems_ab[h]+klg];
 
                 A_p[g2aboff[h] + ijg*gems_ab[h]+klg] -= dum;    // - G2ab(ij,kl)
 
@@ -1328,7 +1338,7 @@ void v2RDMSolver::G2_constraints_ATu(SharedVector A,SharedVector u){
                 int k = bas_ab_sym[h][klg][0];
                 int l = bas_ab_sym[h][klg][1];
 
-                double dum = u_p[offset + ijg*gems_ab[h]+klg];
+                auto dum = u_p[offset + ijg*gems_ab[h]+klg];
 
                 A_p[g2baoff[h] + ijg*gems_ab[h]+klg]  -= dum;
 
@@ -1361,7 +1371,7 @@ void v2RDMSolver::G2_constraints_ATu(SharedVector A,SharedVector u){
                 int k = bas_ab_sym[h][klg][0];
                 int l = bas_ab_sym[h][klg][1];
 
-                double dum = u_p[offset + ijg*2*gems_ab[h]+klg];
+                auto dum = u_p[offset + ijg*2*gems_ab[h]+klg];
 
                 A_p[g2aaoff[h] + ijg*2*gems_ab[h]+klg] -= dum;
 
@@ -1397,7 +1407,7 @@ void v2RDMSolver::G2_constraints_ATu(SharedVector A,SharedVector u){
                 int k = bas_ab_sym[h][klg][0];
                 int l = bas_ab_sym[h][klg][1];
 
-                double dum = u_p[offset + (gems_ab[h] + ijg)*2*gems_ab[h]+(gems_ab[h] + klg)];
+                auto dum = u_p[offset + (gems_ab[h] + ijg)*2*gems_ab[h]+(gems_ab[h] + klg)];
 
                 A_p[g2aaoff[h] + (gems_ab[h] + ijg)*2*gems_ab[h]+(gems_ab[h] + klg)] -= dum;
 
@@ -1433,7 +1443,7 @@ void v2RDMSolver::G2_constraints_ATu(SharedVector A,SharedVector u){
                 int k = bas_ab_sym[h][klg][0];
                 int l = bas_ab_sym[h][klg][1];
 
-                double dum = u_p[offset + ijg*2*gems_ab[h]+(klg + gems_ab[h])];
+                auto dum = u_p[offset + ijg*2*gems_ab[h]+(klg + gems_ab[h])];
 
                 A_p[g2aaoff[h] + ijg*2*gems_ab[h]+(klg + gems_ab[h])] -= dum;
 
@@ -1456,7 +1466,7 @@ void v2RDMSolver::G2_constraints_ATu(SharedVector A,SharedVector u){
                 int k = bas_ab_sym[h][klg][0];
                 int l = bas_ab_sym[h][klg][1];
 
-                double dum = u_p[offset + (ijg + gems_ab[h])*2*gems_ab[h]+klg];
+                auto dum = u_p[offset + (ijg + gems_ab[h])*2*gems_ab[h]+klg];
 
                 A_p[g2aaoff[h] + (ijg + gems_ab[h])*2*gems_ab[h]+klg] -= dum;
 
@@ -1474,7 +1484,7 @@ void v2RDMSolver::G2_constraints_ATu(SharedVector A,SharedVector u){
 
     // maximal spin constraint (sum_i G2(kl,ii) = 0)
     /*for (int kl = 0; kl < gems_ab[0]; kl++) {
-        double dum = u_p[offset + kl];
+        auto dum = u_p[offset + kl];
         for (int i = 0; i < amo_; i++) {
             int ii = ibas_ab_sym[0][i][i];
             A_p[g2aboff[0] + kl*gems_ab[0]+ii] += dum;
@@ -1482,13 +1492,21 @@ void v2RDMSolver::G2_constraints_ATu(SharedVector A,SharedVector u){
     }
     offset += gems_ab[0];
     for (int kl = 0; kl < gems_ab[0]; kl++) {
-        double dum = u_p[offset + kl];
+        auto dum = u_p[offset + kl];
         for (int i = 0; i < amo_; i++) {
             int ii = ibas_ab_sym[0][i][i];
             A_p[g2aboff[0] + ii*gems_ab[0]+kl] += dum;
         }
     }
     offset += gems_ab[0];*/
+
+    return offset;
 }
 
+// instantiations used by RecordConstraints and bpsdp_ATu_tasks
+template long int v2RDMSolver::G2_constraints_ATu<SparseTarget,SparseSource>(SparseTarget A_p,SparseSource u_p);
+template long int v2RDMSolver::G2_constraints_ATu_spin_adapted<SparseTarget,SparseSource>(SparseTarget A_p,SparseSource u_p);
+template long int v2RDMSolver::G2_constraints_ATu<double*,double*>(double* A_p,double* u_p);
+template long int v2RDMSolver::G2_constraints_ATu_spin_adapted<double*,double*>(double* A_p,double* u_p);
+
 }} // end namespaces
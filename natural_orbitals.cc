@@ -111,19 +111,21 @@ void v2RDMSolver::ComputeNaturalOrbitals() {
         }
     }
 
-    // transform the beta 1-RDM to natural orbital basis
-    for (int h = 0; h < nirrep_; h++) {
-        for (int i = 0; i < amopi_[h]; i++) {
-            for (int j = 0; j < amopi_[h]; j++) {
-                D->pointer(h)[i][j]  = x->pointer()[d1boff[h]+i*amopi_[h]+j];
+    // transform the beta 1-RDM to natural orbital basis (D1b is D1a for closed shells)
+    if ( !closed_shell_ ) {
+        for (int h = 0; h < nirrep_; h++) {
+            for (int i = 0; i < amopi_[h]; i++) {
+                for (int j = 0; j < amopi_[h]; j++) {
+                    D->pointer(h)[i][j]  = x->pointer()[d1boff[h]+i*amopi_[h]+j];
+                }
             }
         }
-    }
-    D->transform(eigvec);
-    for (int h = 0; h < nirrep_; h++) {
-        for (int i = 0; i < amopi_[h]; i++) {
-            for (int j = 0; j < amopi_[h]; j++) {
-                x->pointer()[d1boff[h]+i*amopi_[h]+j] = D->pointer(h)[i][j];
+        D->transform(eigvec);
+        for (int h = 0; h < nirrep_; h++) {
+            for (int i = 0; i < amopi_[h]; i++) {
+                for (int j = 0; j < amopi_[h]; j++) {
+                    x->pointer()[d1boff[h]+i*amopi_[h]+j] = D->pointer(h)[i][j];
+                }
             }
         }
     }
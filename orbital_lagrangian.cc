@@ -169,7 +169,9 @@ void v2RDMSolver::DualD1Q1() {
     }
     offset += 1;                   // Tr(D2ab)
     offset += 1;                   // Tr(D2aa)
-    offset += 1;                   // Tr(D2bb)
+    if ( !closed_shell_ ) {
+        offset += 1;               // Tr(D2bb)
+    }
 
     Fa_->zero();
     double * y_p = y->pointer();
@@ -183,14 +185,20 @@ void v2RDMSolver::DualD1Q1() {
         offset += amopi_[h] * amopi_[h];
     }
     Fb_->zero();
-    for (int h = 0; h < nirrep_; h++) {
-        double ** F_p = Fb_->pointer(h);
-        for (int i = 0; i < amopi_[h]; i++) {
-            for (int j = 0; j < amopi_[h]; j++) {
-                F_p[i+rstcpi_[h] + frzcpi_[h]][j+rstcpi_[h] + frzcpi_[h]] = y_p[offset + i*amopi_[h] + j];
+    if ( closed_shell_ ) {
+        // one D1/Q1 block carries the multipliers for both spins
+        Fa_->scale(0.5);
+        Fb_->copy(Fa_);
+    }else {
+        for (int h = 0; h < nirrep_; h++) {
+            double ** F_p = Fb_->pointer(h);
+            for (int i = 0; i < amopi_[h]; i++) {
+                for (int j = 0; j < amopi_[h]; j++) {
+                    F_p[i+rstcpi_[h] + frzcpi_[h]][j+rstcpi_[h] + frzcpi_[h]] = y_p[offset + i*amopi_[h] + j];
+                }
             }
+            offset += amopi_[h] * amopi_[h];
         }
-        offset += amopi_[h] * amopi_[h];
     }
 
     // transform dual to SO basis
@@ -0,0 +1,187 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * v2RDM-CASSCF, a plugin to:
+ *
+ * Psi4: an open-source quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (c) 2014, The Florida State University. All rights reserved.
+ * 
+ *@END LICENSE
+ *
+ */
+
+#include <psi4/psi4-dec.h>
+#include <psi4/liboptions/liboptions.h>
+#include <psi4/libqt/qt.h>
+
+#include<psi4/libmints/wavefunction.h>
+#include<psi4/libmints/vector.h>
+#include<psi4/libmints/matrix.h>
+#include<time.h>
+
+#include<algorithm>
+#include<math.h>
+
+#include"v2rdm_solver.h"
+
+#ifdef _OPENMP
+    #include<omp.h>
+#else
+    #define omp_get_wtime() ( (double)clock() / CLOCKS_PER_SEC )
+    #define omp_get_max_threads() 1
+#endif
+
+using namespace psi;
+
+/*================================================================
+
+   packed storage of the primal and dual solutions
+
+   every block of x and z is symmetric.  with PACKED_STORAGE, z, c, 
+   ATy, rx, and rz (and x, during the iterations) hold only the lower 
+   triangle of each block, row by row: element (p,q), p >= q, is at 
+   p(p+1)/2 + q.  off-diagonal elements are scaled by sqrt(2), so the 
+   packing is an isometry: dot products, norms, and DIIS are unchanged.
+   the constraint kernels still see full squares, through unpacked_.
+
+   with SPIN_ADAPT_D2, the D2ab, D2aa, and D2bb blocks are replaced by 
+   one singlet (D2s) and one triplet (D2t) block per irrep, which come 
+   first in z (see spin_adapted_d2.cc).  ExpandPrimal and ContractPrimal 
+   translate between z-like vectors and x-like vectors in either case.
+
+================================================================*/
+
+namespace psi{ namespace v2rdm_casscf{
+
+void v2RDMSolver::PackBlock(long int dim, double * full, double * packed) {
+    for (long int p = 0; p < dim; p++) {
+        double * row = packed + p * ( p + 1 ) / 2;
+        for (long int q = 0; q < p; q++) {
+            row[q] = M_SQRT1_2 * ( full[p * dim + q] + full[q * dim + p] );
+        }
+        row[p] = full[p * dim + p];
+    }
+}
+
+void v2RDMSolver::UnpackBlock(long int dim, double * packed, double * full) {
+    for (long int p = 0; p < dim; p++) {
+        double * row = packed + p * ( p + 1 ) / 2;
+        for (long int q = 0; q < p; q++) {
+            full[p * dim + q] = full[q * dim + p] = M_SQRT1_2 * row[q];
+        }
+        full[p * dim + p] = row[p];
+    }
+}
+
+void v2RDMSolver::PackPrimal(double * full, double * packed) {
+    #pragma omp parallel for schedule (dynamic,1)
+    for (int i = 0; i < (int)dimensions_.size(); i++) {
+        PackBlock(dimensions_[i],full + dimensions_offset_[i],packed + dimensions_packed_offset_[i]);
+    }
+}
+
+void v2RDMSolver::UnpackPrimal(double * packed, double * full) {
+    #pragma omp parallel for schedule (dynamic,1)
+    for (int i = 0; i < (int)dimensions_.size(); i++) {
+        UnpackBlock(dimensions_[i],packed + dimensions_packed_offset_[i],full + dimensions_offset_[i]);
+    }
+}
+
+long int v2RDMSolver::PrimalOffset(long int offset) {
+    // the D2s and D2t blocks come first in z.  every other block is where 
+    // it is in x, less the difference in the lengths of the D2 blocks
+    if ( spin_adapt_d2_ ) {
+        offset -= d2_full_dim_ - dimensions_offset_[2 * nirrep_];
+    }
+    if ( !packed_storage_ ) return offset;
+    long int i = std::lower_bound(dimensions_offset_.begin(),dimensions_offset_.end(),offset) - dimensions_offset_.begin();
+    return dimensions_packed_offset_[i];
+}
+
+void v2RDMSolver::ExpandPrimal(double * in, double * out) {
+    if ( !spin_adapt_d2_ ) {
+        UnpackPrimal(in,out);
+        return;
+    }
+    int nd2 = 2 * nirrep_;
+    long int shift = d2_full_dim_ - dimensions_offset_[nd2];
+    #pragma omp parallel for schedule (dynamic,1)
+    for (int i = nd2; i < (int)dimensions_.size(); i++) {
+        long int dim = dimensions_[i];
+        if ( packed_storage_ ) {
+            UnpackBlock(dim,in + dimensions_packed_offset_[i],out + dimensions_offset_[i] + shift);
+        }else {
+            C_DCOPY(dim*dim,in + dimensions_offset_[i],1,out + dimensions_offset_[i] + shift,1);
+        }
+    }
+    SpinAdaptedD2ExpandBlocks(in,out);
+}
+
+void v2RDMSolver::ContractPrimal(double * in, double * out) {
+    if ( !spin_adapt_d2_ ) {
+        PackPrimal(in,out);
+        return;
+    }
+    int nd2 = 2 * nirrep_;
+    long int shift = d2_full_dim_ - dimensions_offset_[nd2];
+    #pragma omp parallel for schedule (dynamic,1)
+    for (int i = nd2; i < (int)dimensions_.size(); i++) {
+        long int dim = dimensions_[i];
+        if ( packed_storage_ ) {
+            PackBlock(dim,in + dimensions_offset_[i] + shift,out + dimensions_packed_offset_[i]);
+        }else {
+            C_DCOPY(dim*dim,in + dimensions_offset_[i] + shift,1,out + dimensions_offset_[i],1);
+        }
+    }
+    SpinAdaptedD2ContractBlocks(in,out);
+}
+
+void v2RDMSolver::bpsdp_Au_packed(SharedVector A, SharedVector u) {
+    if ( !reduced_primal_ ) {
+        bpsdp_Au(A,u);
+        return;
+    }
+    ExpandPrimal(u->pointer(),unpacked_->pointer());
+    bpsdp_Au(A,unpacked_);
+}
+
+void v2RDMSolver::bpsdp_ATu_packed(SharedVector A, SharedVector u) {
+    if ( !reduced_primal_ ) {
+        bpsdp_ATu(A,u);
+        return;
+    }
+    bpsdp_ATu(unpacked_,u);
+    ContractPrimal(unpacked_->pointer(),A->pointer());
+}
+
+// x lives in unpacked_ until the iterations start, and again after they end
+void v2RDMSolver::PackX() {
+    if ( !reduced_primal_ || primal_packed_ ) return;
+    x = SharedVector(new Vector("primal solution",primal_dim_));
+    ContractPrimal(unpacked_->pointer(),x->pointer());
+    primal_packed_ = true;
+}
+
+void v2RDMSolver::UnpackX() {
+    if ( !primal_packed_ ) return;
+    ExpandPrimal(x->pointer(),unpacked_->pointer());
+    x = unpacked_;
+    primal_packed_ = false;
+}
+
+}} // end of namespaces
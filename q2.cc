@@ -212,52 +212,55 @@ void v2RDMSolver::Q2_constraints_guess_spin_adapted(SharedVector u){
         offset += gems_aa[h]*gems_aa[h];
     }
     // map D2bb to Q21-1
-    for (int h = 0; h < nirrep_; h++) {
-        #pragma omp parallel for schedule (static)
-        for (int ij = 0; ij < gems_aa[h]; ij++) {
-            int i = bas_aa_sym[h][ij][0];
-            int j = bas_aa_sym[h][ij][1];
-            for (int kl = 0; kl < gems_aa[h]; kl++) {
-                int k = bas_aa_sym[h][kl][0];
-                int l = bas_aa_sym[h][kl][1];
-
-                double dum  = 0.0;
-
-                dum        +=  u_p[d2bboff[h] + kl*gems_aa[h]+ij];    // +D2(kl,ij)
-
-                if ( j==l ) {
-                    int h2 = symmetry[i];
-                    int ii = i - pitzer_offset[h2];
-                    int kk = k - pitzer_offset[h2];
-                    dum        +=  u_p[q1boff[h2] + ii*amopi_[h2]+kk];  // +Q1(i,k) djl
-                }
-                if ( j==k ) {
-                    int h2 = symmetry[i];
-                    int ii = i - pitzer_offset[h2];
-                    int ll = l - pitzer_offset[h2];
-                    dum        +=  u_p[d1boff[h2] + ll*amopi_[h2]+ii];  // +D1(l,i) djk
-                }
-                if ( i==l ) {
-                    int h2 = symmetry[j];
-                    int jj = j - pitzer_offset[h2];
-                    int kk = k - pitzer_offset[h2];
-                    dum        -=  u_p[q1boff[h2] + jj*amopi_[h2]+kk];  // -Q1(j,k) dil
+    if ( !closed_shell_ ) {
+        for (int h = 0; h < nirrep_; h++) {
+            #pragma omp parallel for schedule (static)
+            for (int ij = 0; ij < gems_aa[h]; ij++) {
+                int i = bas_aa_sym[h][ij][0];
+                int j = bas_aa_sym[h][ij][1];
+                for (int kl = 0; kl < gems_aa[h]; kl++) {
+                    int k = bas_aa_sym[h][kl][0];
+                    int l = bas_aa_sym[h][kl][1];
+
+                    double dum  = 0.0;
+
+                    dum        +=  u_p[d2bboff[h] + kl*gems_aa[h]+ij];    // +D2(kl,ij)
+
+                    if ( j==l ) {
+                        int h2 = symmetry[i];
+                        int ii = i - pitzer_offset[h2];
+                        int kk = k - pitzer_offset[h2];
+                        dum        +=  u_p[q1boff[h2] + ii*amopi_[h2]+kk];  // +Q1(i,k) djl
+                    }
+                    if ( j==k ) {
+                        int h2 = symmetry[i];
+                        int ii = i - pitzer_offset[h2];
+                        int ll = l - pitzer_offset[h2];
+                        dum        +=  u_p[d1boff[h2] + ll*amopi_[h2]+ii];  // +D1(l,i) djk
+                    }
+                    if ( i==l ) {
+                        int h2 = symmetry[j];
+                        int jj = j - pitzer_offset[h2];
+                        int kk = k - pitzer_offset[h2];
+                        dum        -=  u_p[q1boff[h2] + jj*amopi_[h2]+kk];  // -Q1(j,k) dil
+                    }
+                    if ( i==k ) {
+                        int h2 = symmetry[j];
+                        int jj = j - pitzer_offset[h2];
+                        int ll = l - pitzer_offset[h2];
+                        dum        -=  u_p[d1boff[h2] + ll*amopi_[h2]+jj];  // -D1(l,j) dkl
+                    }
+
+                    u_p[q2toff_m1[h] + ij*gems_aa[h]+kl] = dum;
                 }
-                if ( i==k ) {
-                    int h2 = symmetry[j];
-                    int jj = j - pitzer_offset[h2];
-                    int ll = l - pitzer_offset[h2];
-                    dum        -=  u_p[d1boff[h2] + ll*amopi_[h2]+jj];  // -D1(l,j) dkl
-                }
-
-                u_p[q2toff_m1[h] + ij*gems_aa[h]+kl] = dum;
             }
+            offset += gems_aa[h]*gems_aa[h];
         }
-        offset += gems_aa[h]*gems_aa[h];
     }
 }
 
 void v2RDMSolver::Q2_constraints_Au_spin_adapted(SharedVector A,SharedVector u){
+    long int offset = q2_constraints_offset_;
 
     double * A_p = A->pointer();
     double * u_p = u->pointer();
@@ -423,54 +426,59 @@ void v2RDMSolver::Q2_constraints_Au_spin_adapted(SharedVector A,SharedVector u){
         offset += gems_aa[h]*gems_aa[h];
     }
     // map D2bb to Q21-1
-    for (int h = 0; h < nirrep_; h++) {
-        #pragma omp parallel for schedule (static)
-        for (int ij = 0; ij < gems_aa[h]; ij++) {
-            int i = bas_aa_sym[h][ij][0];
-            int j = bas_aa_sym[h][ij][1];
-            for (int kl = 0; kl < gems_aa[h]; kl++) {
-                int k = bas_aa_sym[h][kl][0];
-                int l = bas_aa_sym[h][kl][1];
-                double dum  = -u_p[q2toff_m1[h] + ij*gems_aa[h]+kl];    // -Q2(ij,kl)
-                dum        +=  u_p[d2bboff[h] + kl*gems_aa[h]+ij];    // +D2(kl,ij)
-
-                if ( j==l ) {
-                    int h2 = symmetry[i];
-                    int ii = i - pitzer_offset[h2];
-                    int kk = k - pitzer_offset[h2];
-                    dum        +=  u_p[q1boff[h2] + ii*amopi_[h2]+kk];  // +Q1(i,k) djl
-                }
-                if ( j==k ) {
-                    int h2 = symmetry[i];
-                    int ii = i - pitzer_offset[h2];
-                    int ll = l - pitzer_offset[h2];
-                    dum        +=  u_p[d1boff[h2] + ll*amopi_[h2]+ii];  // +D1(l,i) djk
+    if ( !closed_shell_ ) {
+        for (int h = 0; h < nirrep_; h++) {
+            #pragma omp parallel for schedule (static)
+            for (int ij = 0; ij < gems_aa[h]; ij++) {
+                int i = bas_aa_sym[h][ij][0];
+                int j = bas_aa_sym[h][ij][1];
+                for (int kl = 0; kl < gems_aa[h]; kl++) {
+                    int k = bas_aa_sym[h][kl][0];
+                    int l = bas_aa_sym[h][kl][1];
+                    double dum  = -u_p[q2toff_m1[h] + ij*gems_aa[h]+kl];    // -Q2(ij,kl)
+                    dum        +=  u_p[d2bboff[h] + kl*gems_aa[h]+ij];    // +D2(kl,ij)
+
+                    if ( j==l ) {
+                        int h2 = symmetry[i];
+                        int ii = i - pitzer_offset[h2];
+                        int kk = k - pitzer_offset[h2];
+                        dum        +=  u_p[q1boff[h2] + ii*amopi_[h2]+kk];  // +Q1(i,k) djl
+                    }
+                    if ( j==k ) {
+                        int h2 = symmetry[i];
+                        int ii = i - pitzer_offset[h2];
+                        int ll = l - pitzer_offset[h2];
+                        dum        +=  u_p[d1boff[h2] + ll*amopi_[h2]+ii];  // +D1(l,i) djk
+                    }
+                    if ( i==l ) {
+                        int h2 = symmetry[j];
+                        int jj = j - pitzer_offset[h2];
+                        int kk = k - pitzer_offset[h2];
+                        dum        -=  u_p[q1boff[h2] + jj*amopi_[h2]+kk];  // -Q1(j,k) dil
+                    }
+                    if ( i==k ) {
+                        int h2 = symmetry[j];
+                        int jj = j - pitzer_offset[h2];
+                        int ll = l - pitzer_offset[h2];
+                        dum        -=  u_p[d1boff[h2] + ll*amopi_[h2]+jj];  // -D1(l,j) dkl
+                    }
+
+                    A_p[offset + ij*gems_aa[h]+kl] = dum;
                 }
-                if ( i==l ) {
-                    int h2 = symmetry[j];
-                    int jj = j - pitzer_offset[h2];
-                    int kk = k - pitzer_offset[h2];
-                    dum        -=  u_p[q1boff[h2] + jj*amopi_[h2]+kk];  // -Q1(j,k) dil
-                }
-                if ( i==k ) {
-                    int h2 = symmetry[j];
-                    int jj = j - pitzer_offset[h2];
-                    int ll = l - pitzer_offset[h2];
-                    dum        -=  u_p[d1boff[h2] + ll*amopi_[h2]+jj];  // -D1(l,j) dkl
-                }
-
-                A_p[offset + ij*gems_aa[h]+kl] = dum;
             }
+            offset += gems_aa[h]*gems_aa[h];
         }
-        offset += gems_aa[h]*gems_aa[h];
     }
 }
 
 // Q2 portion of A^T.y (spin adapted)
 void v2RDMSolver::Q2_constraints_ATu_spin_adapted(SharedVector A,SharedVector u){
+    Q2_constraints_ATu_spin_adapted(A->pointer(),u->pointer());
+}
 
-    double * A_p = A->pointer();
-    double * u_p = u->pointer();
+template <typename TargetType, typename SourceType>
+long int v2RDMSolver::Q2_constraints_ATu_spin_adapted(TargetType A_p,SourceType u_p){
+    long int offset = q2_constraints_offset_;
 
     // map D2ab to Q2s
     for (int h = 0; h < nirrep_; h++) {
@@ -483,7 +491,7 @@ void v2RDMSolver::Q2_constraints_ATu_spin_adapted(SharedVector A,SharedVector u)
                 int k = bas_00_sym[h][kl][0];
                 int l = bas_00_sym[h][kl][1];
 
-                double dum  = u_p[offset + ij*gems_00[h]+kl];
+                auto dum  = u_p[offset + ij*gems_00[h]+kl];
 
                 A_p[q2soff[h] + ij*gems_00[h]+kl]    -= dum;          // -Q2(ij,kl)
 
@@ -541,7 +549,7 @@ void v2RDMSolver::Q2_constraints_ATu_spin_adapted(SharedVector A,SharedVector u)
                 int k   =  bas_aa_sym[h][kl][0];
                 int l   =  bas_aa_sym[h][kl][1];
 
-                double dum  = u_p[offset + ij*gems_aa[h]+kl];
+                auto dum  = u_p[offset + ij*gems_aa[h]+kl];
 
                 A_p[q2toff[h] + ij*gems_aa[h]+kl]    -= dum;          // -Q2(ij,kl)
 
@@ -596,7 +604,7 @@ void v2RDMSolver::Q2_constraints_ATu_spin_adapted(SharedVector A,SharedVector u)
             for (int kl = 0; kl < gems_aa[h]; kl++) {
                 int k = bas_aa_sym[h][kl][0];
                 int l = bas_aa_sym[h][kl][1];
-                double val = u_p[offset + ij*gems_aa[h]+kl];
+                auto val = u_p[offset + ij*gems_aa[h]+kl];
                 A_p[q2toff_p1[h] + ij*gems_aa[h]+kl] -= val;
                 A_p[d2aaoff[h] + kl*gems_aa[h]+ij]   += val;
                 if ( j==l ) {
@@ -628,45 +636,49 @@ void v2RDMSolver::Q2_constraints_ATu_spin_adapted(SharedVector A,SharedVector u)
         offset += gems_aa[h]*gems_aa[h];
     }
     // map D2bb to Q21-1
-    for (int h = 0; h < nirrep_; h++) {
-        for (int ij = 0; ij < gems_aa[h]; ij++) {
-            int i = bas_aa_sym[h][ij][0];
-            int j = bas_aa_sym[h][ij][1];
-            for (int kl = 0; kl < gems_aa[h]; kl++) {
-                int k = bas_aa_sym[h][kl][0];
-                int l = bas_aa_sym[h][kl][1];
-                double val = u_p[offset + ij*gems_aa[h]+kl];
-                A_p[q2toff_m1[h] + ij*gems_aa[h]+kl] -= val;
-                //A_p[d2toff_m1[h] + INDEX(kl,ij)] += u_p[offset + INDEX(ij,kl)];
-                A_p[d2bboff[h] + kl*gems_aa[h]+ij] += val;
-                if ( j==l ) {
-                    int h2 = symmetry[i];
-                    int ii = i - pitzer_offset[h2];
-                    int kk = k - pitzer_offset[h2];
-                    A_p[q1boff[h2]  + ii*amopi_[h2]+kk]      += val;
-                }
-                if ( j==k ) {
-                    int h2 = symmetry[i];
-                    int ii = i - pitzer_offset[h2];
-                    int ll = l - pitzer_offset[h2];
-                    A_p[d1boff[h2]  + ll*amopi_[h2]+ii]      += val;
-                }
-                if ( i==l ) {
-                    int h2 = symmetry[j];
-                    int jj = j - pitzer_offset[h2];
-                    int kk = k - pitzer_offset[h2];
-                    A_p[q1boff[h2]  + jj*amopi_[h2]+kk]      -= val;
-                }
-                if ( i==k ) {
-                    int h2 = symmetry[j];
-                    int jj = j - pitzer_offset[h2];
-                    int ll = l - pitzer_offset[h2];
-                    A_p[d1boff[h2]  + ll*amopi_[h2]+jj]      -= val;
+    if ( !closed_shell_ ) {
+        for (int h = 0; h < nirrep_; h++) {
+            for (int ij = 0; ij < gems_aa[h]; ij++) {
+                int i = bas_aa_sym[h][ij][0];
+                int j = bas_aa_sym[h][ij][1];
+                for (int kl = 0; kl < gems_aa[h]; kl++) {
+                    int k = bas_aa_sym[h][kl][0];
+                    int l = bas_aa_sym[h][kl][1];
+                    auto val = u_p[offset + ij*gems_aa[h]+kl];
+                    A_p[q2toff_m1[h] + ij*gems_aa[h]+kl] -= val;
+                    //A_p[d2toff_m1[h] + INDEX(kl,ij)] += u_p[offset + INDEX(ij,kl)];
+                    A_p[d2bboff[h] + kl*gems_aa[h]+ij] += val;
+                    if ( j==l ) {
+                        int h2 = symmetry[i];
+                        int ii = i - pitzer_offset[h2];
+                        int kk = k - pitzer_offset[h2];
+                        A_p[q1boff[h2]  + ii*amopi_[h2]+kk]      += val;
+                    }
+                    if ( j==k ) {
+                        int h2 = symmetry[i];
+                        int ii = i - pitzer_offset[h2];
+                        int ll = l - pitzer_offset[h2];
+                        A_p[d1boff[h2]  + ll*amopi_[h2]+ii]      += val;
+                    }
+                    if ( i==l ) {
+                        int h2 = symmetry[j];
+                        int jj = j - pitzer_offset[h2];
+                        int kk = k - pitzer_offset[h2];
+                        A_p[q1boff[h2]  + jj*amopi_[h2]+kk]      -= val;
+                    }
+                    if ( i==k ) {
+                        int h2 = symmetry[j];
+                        int jj = j - pitzer_offset[h2];
+                        int ll = l - pitzer_offset[h2];
+                        A_p[d1boff[h2]  + ll*amopi_[h2]+jj]      -= val;
+                    }
                 }
             }
+            offset += gems_aa[h]*gems_aa[h];
         }
-        offset += gems_aa[h]*gems_aa[h];
     }
+
+    return offset;
 }
 
 // Q2 guess
@@ -753,52 +765,55 @@ void v2RDMSolver::Q2_constraints_guess(SharedVector u){
     }
 
     // map D2bb to Q2bb
-    for (int h = 0; h < nirrep_; h++) {
-        #pragma omp parallel for schedule (static)
-        for (int ij = 0; ij < gems_aa[h]; ij++) {
-            int i = bas_aa_sym[h][ij][0];
-            int j = bas_aa_sym[h][ij][1];
-            for (int kl = 0; kl < gems_aa[h]; kl++) {
-                int k = bas_aa_sym[h][kl][0];
-                int l = bas_aa_sym[h][kl][1];
-
-                double dum  = 0.0;
-
-                dum        +=  u_p[d2bboff[h] + kl*gems_aa[h]+ij];    // +D2(kl,ij)
-
-                if ( j==l ) {
-                    int h2 = symmetry[i];
-                    int ii = i - pitzer_offset[h2];
-                    int kk = k - pitzer_offset[h2];
-                    dum        +=  u_p[q1boff[h2] + ii*amopi_[h2]+kk];  // +Q1(i,k) djl
-                }
-                if ( j==k ) {
-                    int h2 = symmetry[i];
-                    int ii = i - pitzer_offset[h2];
-                    int ll = l - pitzer_offset[h2];
-                    dum        +=  u_p[d1boff[h2] + ll*amopi_[h2]+ii];  // +D1(l,i) djk
-                }
-                if ( i==l ) {
-                    int h2 = symmetry[j];
-                    int jj = j - pitzer_offset[h2];
-                    int kk = k - pitzer_offset[h2];
-                    dum        -=  u_p[q1boff[h2] + jj*amopi_[h2]+kk];  // -Q1(j,k) dil
-                }
-                if ( i==k ) {
-                    int h2 = symmetry[j];
-                    int jj = j - pitzer_offset[h2];
-                    int ll = l - pitzer_offset[h2];
-                    dum        -=  u_p[d1boff[h2] + ll*amopi_[h2]+jj];  // -D1(l,j) dkl
+    if ( !closed_shell_ ) {
+        for (int h = 0; h < nirrep_; h++) {
+            #pragma omp parallel for schedule (static)
+            for (int ij = 0; ij < gems_aa[h]; ij++) {
+                int i = bas_aa_sym[h][ij][0];
+                int j = bas_aa_sym[h][ij][1];
+                for (int kl = 0; kl < gems_aa[h]; kl++) {
+                    int k = bas_aa_sym[h][kl][0];
+                    int l = bas_aa_sym[h][kl][1];
+
+                    double dum  = 0.0;
+
+                    dum        +=  u_p[d2bboff[h] + kl*gems_aa[h]+ij];    // +D2(kl,ij)
+
+                    if ( j==l ) {
+                        int h2 = symmetry[i];
+                        int ii = i - pitzer_offset[h2];
+                        int kk = k - pitzer_offset[h2];
+                        dum        +=  u_p[q1boff[h2] + ii*amopi_[h2]+kk];  // +Q1(i,k) djl
+                    }
+                    if ( j==k ) {
+                        int h2 = symmetry[i];
+                        int ii = i - pitzer_offset[h2];
+                        int ll = l - pitzer_offset[h2];
+                        dum        +=  u_p[d1boff[h2] + ll*amopi_[h2]+ii];  // +D1(l,i) djk
+                    }
+                    if ( i==l ) {
+                        int h2 = symmetry[j];
+                        int jj = j - pitzer_offset[h2];
+                        int kk = k - pitzer_offset[h2];
+                        dum        -=  u_p[q1boff[h2] + jj*amopi_[h2]+kk];  // -Q1(j,k) dil
+                    }
+                    if ( i==k ) {
+                        int h2 = symmetry[j];
+                        int jj = j - pitzer_offset[h2];
+                        int ll = l - pitzer_offset[h2];
+                        dum        -=  u_p[d1boff[h2] + ll*amopi_[h2]+jj];  // -D1(l,j) dkl
+                    }
+                    u_p[q2bboff[h] + ij*gems_aa[h]+kl] = dum;
                 }
-                u_p[q2bboff[h] + ij*gems_aa[h]+kl] = dum;
             }
+            offset += gems_aa[h]*gems_aa[h];
         }
-        offset += gems_aa[h]*gems_aa[h];
     }
 }
 
 // Q2 portion of A.x (with symmetry)
 void v2RDMSolver::Q2_constraints_Au(SharedVector A,SharedVector u){
+    long int offset = q2_constraints_offset_;
     double * A_p = A->pointer();
     double * u_p = u->pointer();
 
@@ -899,61 +914,66 @@ void v2RDMSolver::Q2_constraints_Au(SharedVector A,SharedVector u){
 
 
     // map D2bb to Q2bb
-    C_DCOPY(blocksize_aa,u_p + d2bboff[0],1,A_p + offset,1);      // + D2(kl,ij)
-    C_DAXPY(blocksize_aa,-1.0,u_p + q2bboff[0],1,A_p + offset,1); // - Q2(kl,ij)
-    for (int h = 0; h < nirrep_; h++) {
-        #pragma omp parallel for schedule (static)
-        for (int ij = 0; ij < gems_aa[h]; ij++) {
-            int i = bas_aa_sym[h][ij][0];
-            int j = bas_aa_sym[h][ij][1];
-            for (int kl = 0; kl < gems_aa[h]; kl++) {
-                int k = bas_aa_sym[h][kl][0];
-                int l = bas_aa_sym[h][kl][1];
-                double dum  = 0.0;
-                if ( j==l ) {
-                    //int h2 = symmetry[i];
-                    //int ii = i - pitzer_offset[h2];
-                    //int kk = k - pitzer_offset[h2];
-                    //dum        +=  u_p[q1boff[h2] + ii*amopi_[h2]+kk];  // +Q1(i,k) djl
-                    int h2 = symmetry[i];
-                    int ii = i - pitzer_offset[h2];
-                    int kk = k - pitzer_offset[h2];
-                    dum        -=  u_p[d1boff[h2] + kk*amopi_[h2]+ii];  // -D1(k,i) djl
-                }
-                if ( j==k ) {
-                    int h2 = symmetry[i];
-                    int ii = i - pitzer_offset[h2];
-                    int ll = l - pitzer_offset[h2];
-                    dum        +=  u_p[d1boff[h2] + ll*amopi_[h2]+ii];  // +D1(l,i) djk
-                }
-                if ( i==l ) {
-                    //int h2 = symmetry[j];
-                    //int jj = j - pitzer_offset[h2];
-                    //int kk = k - pitzer_offset[h2];
-                    //dum        -=  u_p[q1boff[h2] + jj*amopi_[h2]+kk];  // -Q1(j,k) dil
-                    int h2 = symmetry[j];
-                    int jj = j - pitzer_offset[h2];
-                    int kk = k - pitzer_offset[h2];
-                    dum        +=  u_p[d1boff[h2] + kk*amopi_[h2]+jj];  // +Q1(k,j) dil
+    if ( !closed_shell_ ) {
+        C_DCOPY(blocksize_aa,u_p + d2bboff[0],1,A_p + offset,1);      // + D2(kl,ij)
+        C_DAXPY(blocksize_aa,-1.0,u_p + q2bboff[0],1,A_p + offset,1); // - Q2(kl,ij)
+        for (int h = 0; h < nirrep_; h++) {
+            #pragma omp parallel for schedule (static)
+            for (int ij = 0; ij < gems_aa[h]; ij++) {
+                int i = bas_aa_sym[h][ij][0];
+                int j = bas_aa_sym[h][ij][1];
+                for (int kl = 0; kl < gems_aa[h]; kl++) {
+                    int k = bas_aa_sym[h][kl][0];
+                    int l = bas_aa_sym[h][kl][1];
+                    double dum  = 0.0;
+                    if ( j==l ) {
+                        //int h2 = symmetry[i];
+                        //int ii = i - pitzer_offset[h2];
+                        //int kk = k - pitzer_offset[h2];
+                        //dum        +=  u_p[q1boff[h2] + ii*amopi_[h2]+kk];  // +Q1(i,k) djl
+                        int h2 = symmetry[i];
+                        int ii = i - pitzer_offset[h2];
+                        int kk = k - pitzer_offset[h2];
+                        dum        -=  u_p[d1boff[h2] + kk*amopi_[h2]+ii];  // -D1(k,i) djl
+                    }
+                    if ( j==k ) {
+                        int h2 = symmetry[i];
+                        int ii = i - pitzer_offset[h2];
+                        int ll = l - pitzer_offset[h2];
+                        dum        +=  u_p[d1boff[h2] + ll*amopi_[h2]+ii];  // +D1(l,i) djk
+                    }
+                    if ( i==l ) {
+                        //int h2 = symmetry[j];
+                        //int jj = j - pitzer_offset[h2];
+                        //int kk = k - pitzer_offset[h2];
+                        //dum        -=  u_p[q1boff[h2] + jj*amopi_[h2]+kk];  // -Q1(j,k) dil
+                        int h2 = symmetry[j];
+                        int jj = j - pitzer_offset[h2];
+                        int kk = k - pitzer_offset[h2];
+                        dum        +=  u_p[d1boff[h2] + kk*amopi_[h2]+jj];  // +Q1(k,j) dil
+                    }
+                    if ( i==k ) {
+                        int h2 = symmetry[j];
+                        int jj = j - pitzer_offset[h2];
+                        int ll = l - pitzer_offset[h2];
+                        dum        -=  u_p[d1boff[h2] + ll*amopi_[h2]+jj];  // -D1(l,j) dkl
+                    }
+                    A_p[offset + ij*gems_aa[h]+kl] += dum;
                 }
-                if ( i==k ) {
-                    int h2 = symmetry[j];
-                    int jj = j - pitzer_offset[h2];
-                    int ll = l - pitzer_offset[h2];
-                    dum        -=  u_p[d1boff[h2] + ll*amopi_[h2]+jj];  // -D1(l,j) dkl
-                }
-                A_p[offset + ij*gems_aa[h]+kl] += dum;
             }
+            offset += gems_aa[h]*gems_aa[h];
         }
-        offset += gems_aa[h]*gems_aa[h];
     }
 }
 
 // Q2 portion of A^T.y (with symmetry)
 void v2RDMSolver::Q2_constraints_ATu(SharedVector A,SharedVector u){
+    Q2_constraints_ATu(A->pointer(),u->pointer());
+}
 
-    double * A_p = A->pointer();
-    double * u_p = u->pointer();
+template <typename TargetType, typename SourceType>
+long int v2RDMSolver::Q2_constraints_ATu(TargetType A_p,SourceType u_p){
+    long int offset = q2_constraints_offset_;
 
     long int blocksize_ab = 0;
     long int blocksize_aa = 0;
@@ -1009,7 +1029,7 @@ void v2RDMSolver::Q2_constraints_ATu(SharedVector A,SharedVector u){
             for (int kl = 0; kl < gems_aa[h]; kl++) {
                 int k = bas_aa_sym[h][kl][0];
                 int l = bas_aa_sym[h][kl][1];
-                double val = u_p[offset + ij*gems_aa[h]+kl];
+                auto val = u_p[offset + ij*gems_aa[h]+kl];
                 if ( j==l ) {
                     //int h2 = symmetry[i];
                     //int ii = i - pitzer_offset[h2];
@@ -1049,53 +1069,63 @@ void v2RDMSolver::Q2_constraints_ATu(SharedVector A,SharedVector u){
 
 
     // map D2bb to Q2bb
-    C_DAXPY(blocksize_aa, 1.0,u_p + offset,1,A_p + d2bboff[0],1); // + D2(kl,ij)
-    C_DAXPY(blocksize_aa,-1.0,u_p + offset,1,A_p + q2bboff[0],1); // - Q2(ij,kl)
-    for (int h = 0; h < nirrep_; h++) {
-        for (int ij = 0; ij < gems_aa[h]; ij++) {
-            int i = bas_aa_sym[h][ij][0];
-            int j = bas_aa_sym[h][ij][1];
-            for (int kl = 0; kl < gems_aa[h]; kl++) {
-                int k = bas_aa_sym[h][kl][0];
-                int l = bas_aa_sym[h][kl][1];
-                double val = u_p[offset + ij*gems_aa[h]+kl];
-                if ( j==l ) {
-                    //int h2 = symmetry[i];
-                    //int ii = i - pitzer_offset[h2];
-                    //int kk = k - pitzer_offset[h2];
-                    //A_p[q1boff[h2]  + ii*amopi_[h2]+kk] += val;
-                    int h2 = symmetry[i];
-                    int ii = i - pitzer_offset[h2];
-                    int kk = k - pitzer_offset[h2];
-                    A_p[d1boff[h2]  + kk*amopi_[h2]+ii] -= val;
-                }
-                if ( j==k ) {
-                    int h2 = symmetry[i];
-                    int ii = i - pitzer_offset[h2];
-                    int ll = l - pitzer_offset[h2];
-                    A_p[d1boff[h2]  + ll*amopi_[h2]+ii] += val;
-                }
-                if ( i==l ) {
-                    //int h2 = symmetry[j];
-                    //int jj = j - pitzer_offset[h2];
-                    //int kk = k - pitzer_offset[h2];
-                    //A_p[q1boff[h2]  + jj*amopi_[h2]+kk] -= val;
-                    int h2 = symmetry[j];
-                    int jj = j - pitzer_offset[h2];
-                    int kk = k - pitzer_offset[h2];
-                    A_p[d1boff[h2]  + kk*amopi_[h2]+jj] += val;
-                }
-                if ( i==k ) {
-                    int h2 = symmetry[j];
-                    int jj = j - pitzer_offset[h2];
-                    int ll = l - pitzer_offset[h2];
-                    A_p[d1boff[h2]  + ll*amopi_[h2]+jj] -= val;
+    if ( !closed_shell_ ) {
+        C_DAXPY(blocksize_aa, 1.0,u_p + offset,1,A_p + d2bboff[0],1); // + D2(kl,ij)
+        C_DAXPY(blocksize_aa,-1.0,u_p + offset,1,A_p + q2bboff[0],1); // - Q2(ij,kl)
+        for (int h = 0; h < nirrep_; h++) {
+            for (int ij = 0; ij < gems_aa[h]; ij++) {
+                int i = bas_aa_sym[h][ij][0];
+                int j = bas_aa_sym[h][ij][1];
+                for (int kl = 0; kl < gems_aa[h]; kl++) {
+                    int k = bas_aa_sym[h][kl][0];
+                    int l = bas_aa_sym[h][kl][1];
+                    auto val = u_p[offset + ij*gems_aa[h]+kl];
+                    if ( j==l ) {
+                        //int h2 = symmetry[i];
+                        //int ii = i - pitzer_offset[h2];
+                        //int kk = k - pitzer_offset[h2];
+                        //A_p[q1boff[h2]  + ii*amopi_[h2]+kk] += val;
+                        int h2 = symmetry[i];
+                        int ii = i - pitzer_offset[h2];
+                        int kk = k - pitzer_offset[h2];
+                        A_p[d1boff[h2]  + kk*amopi_[h2]+ii] -= val;
+                    }
+                    if ( j==k ) {
+                        int h2 = symmetry[i];
+                        int ii = i - pitzer_offset[h2];
+                        int ll = l - pitzer_offset[h2];
+                        A_p[d1boff[h2]  + ll*amopi_[h2]+ii] += val;
+                    }
+                    if ( i==l ) {
+                        //int h2 = symmetry[j];
+                        //int jj = j - pitzer_offset[h2];
+                        //int kk = k - pitzer_offset[h2];
+                        //A_p[q1boff[h2]  + jj*amopi_[h2]+kk] -= val;
+                        int h2 = symmetry[j];
+                        int jj = j - pitzer_offset[h2];
+                        int kk = k - pitzer_offset[h2];
+                        A_p[d1boff[h2]  + kk*amopi_[h2]+jj] += val;
+                    }
+                    if ( i==k ) {
+                        int h2 = symmetry[j];
+                        int jj = j - pitzer_offset[h2];
+                        int ll = l - pitzer_offset[h2];
+                        A_p[d1boff[h2]  + ll*amopi_[h2]+jj] -= val;
+                    }
                 }
             }
+            offset += gems_aa[h]*gems_aa[h];
         }
-        offset += gems_aa[h]*gems_aa[h];
+
     }
 
+    return offset;
 }
 
+// instantiations used by RecordConstraints and bpsdp_ATu_tasks
+template long int v2RDMSolver::Q2_constraints_ATu<SparseTarget,SparseSource>(SparseTarget A_p,SparseSource u_p);
+template long int v2RDMSolver::Q2_constraints_ATu_spin_adapted<SparseTarget,SparseSource>(SparseTarget A_p,SparseSource u_p);
+template long int v2RDMSolver::Q2_constraints_ATu<double*,double*>(double* A_p,double* u_p);
+template long int v2RDMSolver::Q2_constraints_ATu_spin_adapted<double*,double*>(double* A_p,double* u_p);
+
 }} // end namespaces
@@ -32,6 +32,8 @@
 #include <psi4/libtrans/integraltransform.h>
 #include <psi4/libpsi4util/PsiOutStream.h>
 
+#include <future>
+
 #include "v2rdm_solver.h"
 
 using namespace psi;
@@ -42,75 +44,105 @@ namespace psi{namespace v2rdm_casscf{
 
 void v2RDMSolver::ReadAllIntegrals(iwlbuf *Buf) {
 
-  unsigned long int lastbuf;
-  Label *lblptr;
-  Value *valptr;
-
-  unsigned long int idx, p, q, r, s, pq, rs, pqrs;
-
-  lblptr = Buf->labels;
-  valptr = Buf->values;
-  lastbuf = Buf->lastbuf;
-
   outfile->Printf("\n");
   outfile->Printf("        Read integrals......");
+
+  // offsets of the symmetry blocks of tei_full_sym_
+  int * gems_tei = TEIPairs();
+  long int * offset = (long int*)malloc(nirrep_*sizeof(long int));
+  offset[0] = 0;
+  for (int h = 1; h < nirrep_; h++) {
+      offset[h] = offset[h-1] + (long int)gems_tei[h-1] * ( (long int)gems_tei[h-1] + 1 ) / 2;
+  }
+
   /**
-    * first buffer (read in when Buf was initialized)
+    * the integrals are staged in chunks of several iwl buffers.  the next 
+    * chunk is fetched on a separate thread while the labels of the current 
+    * one are decoded in parallel.  only the reader thread touches Buf.  
+    * the reader runs through std::async so that an exception thrown by 
+    * iwl_buf_fetch is rethrown here by get(), and so that the future's 
+    * destructor waits for the reader if the decode loop throws first.
     */
-  for (idx=4*Buf->idx; Buf->idx<Buf->inbuf; Buf->idx++) {
-      p = (unsigned long int) lblptr[idx++];
-      q = (unsigned long int) lblptr[idx++];
-      r = (unsigned long int) lblptr[idx++];
-      s = (unsigned long int) lblptr[idx++];
+  long int maxints = 64L * Buf->ints_per_buf;
+
+  Label * lblbuf[2];
+  Value * valbuf[2];
+  long int nints[2];
+  for (int i = 0; i < 2; i++) {
+      lblbuf[i] = (Label*)malloc(4*maxints*sizeof(Label));
+      valbuf[i] = (Value*)malloc(maxints*sizeof(Value));
+      nints[i]  = 0;
+  }
 
-      double val = (double)valptr[Buf->idx];
+  // copy buffers into chunk c until it is full or the file is exhausted.  
+  // the first buffer was read in when Buf was initialized
+  bool done = false;
+  auto stage = [&](int c) {
+      long int n = 0;
+      while ( n + Buf->ints_per_buf <= maxints ) {
+          long int nbuf = Buf->inbuf - Buf->idx;
+          memcpy((void*)(lblbuf[c] + 4*n),(void*)(Buf->labels + 4*Buf->idx),4*nbuf*sizeof(Label));
+          memcpy((void*)(valbuf[c] + n),(void*)(Buf->values + Buf->idx),nbuf*sizeof(Value));
+          n += nbuf;
+          Buf->idx = Buf->inbuf;
+          if ( Buf->lastbuf ) {
+              done = true;
+              break;
+          }
+          iwl_buf_fetch(Buf);
+      }
+      nints[c] = n;
+  };
 
-      // none of this will work with frozen virtuals ...
+  stage(0);
 
-      int hp = symmetry_full[p];
-      int hq = symmetry_full[q];
-      int hpq = SymmetryPair(hp,hq);
+  int c = 0;
+  while ( true ) {
 
-      pq = ibas_really_full_sym[hpq][p][q];
-      rs = ibas_really_full_sym[hpq][r][s];
+      bool more = !done;
 
-      long int offset = 0;
-      for (int h = 0; h < hpq; h++) {
-          offset += (long int)gems_full[h] * ( (long int)gems_full[h] + 1 ) / 2;
+      std::future<void> reader;
+      if ( more ) {
+          reader = std::async(std::launch::async,stage,1 - c);
       }
-      tei_full_sym_[offset + INDEX(pq,rs)] = val;
 
-  }
-  /**
-    * now do the same for the rest of the buffers
-    */
-  while(!lastbuf){
-      iwl_buf_fetch(Buf);
-      lastbuf = Buf->lastbuf;
-      for (idx=4*Buf->idx; Buf->idx<Buf->inbuf; Buf->idx++) {
+      // none of this will work with frozen virtuals ...
+      Label * lblptr = lblbuf[c];
+      Value * valptr = valbuf[c];
 
-          p = (unsigned long int) lblptr[idx++];
-          q = (unsigned long int) lblptr[idx++];
-          r = (unsigned long int) lblptr[idx++];
-          s = (unsigned long int) lblptr[idx++];
+      #pragma omp parallel for schedule (static)
+      for (long int n = 0; n < nints[c]; n++) {
 
-          double val = (double)valptr[Buf->idx];
+          long int p = (long int) lblptr[4*n];
+          long int q = (long int) lblptr[4*n+1];
+          long int r = (long int) lblptr[4*n+2];
+          long int s = (long int) lblptr[4*n+3];
 
-          int hp = symmetry_full[p];
-          int hq = symmetry_full[q];
-          int hpq = SymmetryPair(hp,hq);
+          int hpq = SymmetryPair(symmetry_full[p],symmetry_full[q]);
 
-          pq = ibas_really_full_sym[hpq][p][q];
-          rs = ibas_really_full_sym[hpq][r][s];
+          long int pq = ibas_really_full_sym[hpq][p][q];
+          long int rs = ibas_really_full_sym[hpq][r][s];
 
-          long int offset = 0;
-          for (int h = 0; h < hpq; h++) {
-              offset += (long int)gems_full[h] * ( (long int)gems_full[h] + 1 ) / 2;
-          }
-          tei_full_sym_[offset + INDEX(pq,rs)] = val;
+          // skip integrals that are not stored (TEI_STORAGE = ACTIVE)
+          if ( pq >= gems_tei[hpq] || rs >= gems_tei[hpq] ) continue;
+
+          tei_full_sym_[offset[hpq] + INDEX(pq,rs)] = (double)valptr[n];
       }
 
+      if ( reader.valid() ) {
+          reader.get();
+      }
+      if ( !more ) break;
+
+      c = 1 - c;
   }
+
+  for (int i = 0; i < 2; i++) {
+      free(lblbuf[i]);
+      free(valbuf[i]);
+  }
+  free(offset);
+
   outfile->Printf("done.\n\n");
 }
 
@@ -0,0 +1,296 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * v2RDM-CASSCF, a plugin to:
+ *
+ * Psi4: an open-source quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (c) 2014, The Florida State University. All rights reserved.
+ * 
+ *@END LICENSE
+ *
+ */
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<math.h>
+
+#include<algorithm>
+#include<queue>
+
+#include <psi4/psi4-dec.h>
+
+#include"sparse_cholesky.h"
+
+namespace psi{ namespace v2rdm_casscf{
+
+SparseCholesky::SparseCholesky() {
+    n_        = 0;
+    nnz_      = 0;
+    ndropped_ = 0;
+    colptr_   = NULL;
+    rowind_   = NULL;
+    values_   = NULL;
+    rlptr_    = NULL;
+    rlind_    = NULL;
+}
+
+SparseCholesky::~SparseCholesky() {
+    free(colptr_);
+    free(rowind_);
+    free(values_);
+    free(rlptr_);
+    free(rlind_);
+}
+
+double SparseCholesky::memory() {
+    // L (indices and values) plus its row structure
+    return (double)( 2 * (n_ + 1) ) * sizeof(long int) 
+         + (double)nnz_ * ( sizeof(long int) + sizeof(double) ) 
+         + (double)( nnz_ - n_ ) * sizeof(long int);
+}
+
+bool SparseCholesky::analyze(std::shared_ptr<SparseMatrix> A, double max_memory) {
+
+    n_ = A->nrow_;
+
+    // elimination graph, initially the off-diagonal pattern of A
+    long int stored = 0;
+    std::vector< std::vector<long int> > adj(n_);
+    for (long int i = 0; i < n_; i++) {
+        for (long int p = A->rowptr_[i]; p < A->rowptr_[i+1]; p++) {
+            if ( A->colind_[p] != i ) adj[i].push_back(A->colind_[p]);
+        }
+        stored += adj[i].size();
+    }
+
+    // minimum degree ordering on the explicit elimination graph.  the 
+    // neighbors of a node when it is eliminated are exactly the 
+    // off-diagonal pattern of its column of L.
+    std::vector< std::vector<long int> > pattern(n_);
+    std::vector<char> eliminated(n_,0);
+    std::priority_queue< std::pair<long int,long int>, 
+                         std::vector< std::pair<long int,long int> >, 
+                         std::greater< std::pair<long int,long int> > > heap;
+    for (long int i = 0; i < n_; i++) {
+        heap.push(std::make_pair((long int)adj[i].size(),i));
+    }
+
+    perm_.resize(n_);
+    iperm_.resize(n_);
+
+    std::vector<long int> merged;
+    long int k = 0;
+    while ( k < n_ ) {
+
+        std::pair<long int,long int> top = heap.top();
+        heap.pop();
+        long int v = top.second;
+
+        // skip stale heap entries
+        if ( eliminated[v] || top.first != (long int)adj[v].size() ) continue;
+
+        eliminated[v] = 1;
+        perm_[k]  = v;
+        iperm_[v] = k;
+        k++;
+
+        // neighbors of v become a clique
+        std::vector<long int> & nv = adj[v];
+        for (size_t p = 0; p < nv.size(); p++) {
+            long int u = nv[p];
+            std::vector<long int> & nu = adj[u];
+            merged.clear();
+            size_t a = 0, b = 0;
+            while ( a < nu.size() || b < nv.size() ) {
+                long int next;
+                if ( b == nv.size() || ( a < nu.size() && nu[a] < nv[b] ) ) {
+                    next = nu[a++];
+                }else if ( a == nu.size() || nv[b] < nu[a] ) {
+                    next = nv[b++];
+                }else {
+                    next = nu[a++];
+                    b++;
+                }
+                if ( next == u || next == v ) continue;
+                merged.push_back(next);
+            }
+            stored += (long int)merged.size() - (long int)nu.size();
+            nu.swap(merged);
+            heap.push(std::make_pair((long int)nu.size(),u));
+        }
+
+        // adj[v] is now the pattern of column v
+        pattern[v].swap(nv);
+
+        if ( (double)stored * sizeof(long int) > max_memory ) {
+            return false;
+        }
+    }
+
+    // column pointers and row indices of L in the permuted ordering
+    nnz_ = n_;
+    for (long int i = 0; i < n_; i++) {
+        nnz_ += pattern[i].size();
+    }
+    if ( memory() > max_memory ) {
+        return false;
+    }
+
+    colptr_ = (long int*)malloc((n_+1)*sizeof(long int));
+    rowind_ = (long int*)malloc(nnz_*sizeof(long int));
+    values_ = (double*)malloc(nnz_*sizeof(double));
+    rlptr_  = (long int*)malloc((n_+1)*sizeof(long int));
+    rlind_  = (long int*)malloc((nnz_-n_ > 0 ? nnz_-n_ : 1)*sizeof(long int));
+    memset((void*)rlptr_,'\0',(n_+1)*sizeof(long int));
+
+    colptr_[0] = 0;
+    for (long int j = 0; j < n_; j++) {
+        std::vector<long int> & pj = pattern[perm_[j]];
+        long int p = colptr_[j];
+        rowind_[p++] = j;
+        for (size_t q = 0; q < pj.size(); q++) {
+            rowind_[p + q] = iperm_[pj[q]];
+        }
+        std::sort(rowind_ + p,rowind_ + p + pj.size());
+        colptr_[j+1] = p + pj.size();
+        for (size_t q = 0; q < pj.size(); q++) {
+            rlptr_[rowind_[p + q]+1]++;
+        }
+        std::vector<long int>().swap(pj);
+    }
+
+    // row structure: rows are filled in column order, so each row is sorted
+    for (long int i = 0; i < n_; i++) {
+        rlptr_[i+1] += rlptr_[i];
+    }
+    std::vector<long int> fill(rlptr_,rlptr_ + n_);
+    for (long int j = 0; j < n_; j++) {
+        for (long int p = colptr_[j] + 1; p < colptr_[j+1]; p++) {
+            rlind_[fill[rowind_[p]]++] = j;
+        }
+    }
+
+    dropped_.resize(n_,0);
+    work_.resize(n_,0.0);
+
+    return true;
+}
+
+void SparseCholesky::factorize(std::shared_ptr<SparseMatrix> A) {
+
+    // pivots smaller than this fraction of the original diagonal are dropped
+    double pivot_tolerance = 1e-10;
+
+    double * work = work_.data();
+
+    // position of the next unused off-diagonal element in each column
+    std::vector<long int> first(n_);
+    for (long int j = 0; j < n_; j++) {
+        first[j] = colptr_[j] + 1;
+    }
+
+    ndropped_ = 0;
+
+    // left-looking column Cholesky
+    for (long int j = 0; j < n_; j++) {
+
+        // scatter column perm_[j] of A (lower triangle in the new ordering)
+        long int row = perm_[j];
+        double diag = 0.0;
+        for (long int p = A->rowptr_[row]; p < A->rowptr_[row+1]; p++) {
+            long int i = iperm_[A->colind_[p]];
+            if ( i < j ) continue;
+            work[i] = A->values_[p];
+            if ( i == j ) diag = A->values_[p];
+        }
+
+        // subtract contributions of previous columns with L(j,k) != 0
+        for (long int q = rlptr_[j]; q < rlptr_[j+1]; q++) {
+            long int k   = rlind_[q];
+            long int p   = first[k]++;
+            double   ljk = values_[p];
+            if ( ljk == 0.0 ) continue;
+            for ( ; p < colptr_[k+1]; p++) {
+                work[rowind_[p]] -= values_[p] * ljk;
+            }
+        }
+
+        double d = work[j];
+        work[j] = 0.0;
+        if ( d <= pivot_tolerance * fabs(diag) || diag == 0.0 ) {
+            dropped_[j] = 1;
+            ndropped_++;
+            values_[colptr_[j]] = 1.0;
+            for (long int p = colptr_[j] + 1; p < colptr_[j+1]; p++) {
+                values_[p] = 0.0;
+                work[rowind_[p]] = 0.0;
+            }
+        }else {
+            dropped_[j] = 0;
+            double ljj = sqrt(d);
+            values_[colptr_[j]] = ljj;
+            for (long int p = colptr_[j] + 1; p < colptr_[j+1]; p++) {
+                values_[p] = work[rowind_[p]] / ljj;
+                work[rowind_[p]] = 0.0;
+            }
+        }
+    }
+}
+
+void SparseCholesky::solve(double * b, double * x) {
+
+    double * z = work_.data();
+
+    for (long int k = 0; k < n_; k++) {
+        z[k] = b[perm_[k]];
+    }
+
+    // L.z = P.b
+    for (long int k = 0; k < n_; k++) {
+        if ( dropped_[k] ) {
+            z[k] = 0.0;
+            continue;
+        }
+        z[k] /= values_[colptr_[k]];
+        double zk = z[k];
+        for (long int p = colptr_[k] + 1; p < colptr_[k+1]; p++) {
+            z[rowind_[p]] -= values_[p] * zk;
+        }
+    }
+
+    // L^T.(P.x) = z
+    for (long int k = n_ - 1; k >= 0; k--) {
+        if ( dropped_[k] ) {
+            z[k] = 0.0;
+            continue;
+        }
+        double dum = z[k];
+        for (long int p = colptr_[k] + 1; p < colptr_[k+1]; p++) {
+            dum -= values_[p] * z[rowind_[p]];
+        }
+        z[k] = dum / values_[colptr_[k]];
+    }
+
+    for (long int k = 0; k < n_; k++) {
+        x[perm_[k]] = z[k];
+        z[k] = 0.0;
+    }
+}
+
+}} // end of namespaces
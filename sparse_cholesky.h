@@ -0,0 +1,96 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * v2RDM-CASSCF, a plugin to:
+ *
+ * Psi4: an open-source quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (c) 2014, The Florida State University. All rights reserved.
+ * 
+ *@END LICENSE
+ *
+ */
+
+#ifndef SPARSE_CHOLESKY_H
+#define SPARSE_CHOLESKY_H
+
+#include<vector>
+#include<memory>
+
+#include"sparse_matrix.h"
+
+namespace psi{ namespace v2rdm_casscf{
+
+/// 
+/// sparse Cholesky factorization, P A P^T = L L^T, of a symmetric positive 
+/// semidefinite matrix stored in full (both triangles) CSR format.  P is a 
+/// minimum degree ordering.  pivots that vanish relative to the original 
+/// diagonal (linearly dependent rows) are dropped, and solve() then returns 
+/// a solution of the consistent part of A.x = b.
+/// 
+class SparseCholesky {
+  public:
+    SparseCholesky();
+    ~SparseCholesky();
+
+    /// minimum degree ordering and symbolic factorization.  returns false if
+    /// the ordering or the factor would need more than max_memory bytes.
+    bool analyze(std::shared_ptr<SparseMatrix> A, double max_memory);
+
+    /// numeric factorization (after analyze)
+    void factorize(std::shared_ptr<SparseMatrix> A);
+
+    /// x = A^-1 . b
+    void solve(double * b, double * x);
+
+    /// nonzero elements in L
+    long int nnz() { return nnz_; }
+
+    /// number of dropped pivots
+    long int ndropped() { return ndropped_; }
+
+    /// storage (bytes) for the factor
+    double memory();
+
+  private:
+    long int n_;
+    long int nnz_;
+    long int ndropped_;
+
+    /// perm_[k] = row of A that is eliminated k-th; iperm_ is the inverse
+    std::vector<long int> perm_;
+    std::vector<long int> iperm_;
+
+    /// L by columns.  the diagonal element is first in each column
+    long int * colptr_;
+    long int * rowind_;
+    double   * values_;
+
+    /// row structure of the strict lower triangle of L
+    long int * rlptr_;
+    long int * rlind_;
+
+    /// dropped pivots
+    std::vector<char> dropped_;
+
+    /// scratch vector for solve()
+    std::vector<double> work_;
+};
+
+}} // end of namespaces
+
+#endif
@@ -0,0 +1,364 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * v2RDM-CASSCF, a plugin to:
+ *
+ * Psi4: an open-source quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (c) 2014, The Florida State University. All rights reserved.
+ * 
+ *@END LICENSE
+ *
+ */
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<math.h>
+#include<time.h>
+
+#include<algorithm>
+
+#include <psi4/psi4-dec.h>
+
+#include"sparse_matrix.h"
+
+#ifdef _OPENMP
+    #include<omp.h>
+#else
+    #define omp_get_wtime() ( (double)clock() / CLOCKS_PER_SEC )
+    #define omp_get_max_threads() 1
+    #define omp_get_thread_num() 0
+#endif
+
+namespace psi{ namespace v2rdm_casscf{
+
+static bool compare_col(const std::pair<long int,double> & a, const std::pair<long int,double> & b) {
+    return a.first < b.first;
+}
+
+SparseRecorder::SparseRecorder(bool count_only) {
+    count_only_ = count_only;
+    count_.resize(omp_get_max_threads(),0);
+    entries_.resize(omp_get_max_threads());
+}
+SparseRecorder::~SparseRecorder() {
+}
+
+void SparseRecorder::add(long int row, long int col, double value) {
+    int thread = omp_get_thread_num();
+    count_[thread]++;
+    if ( count_only_ ) return;
+    SparseEntry e = { row, col, value };
+    entries_[thread].push_back(e);
+}
+
+long int SparseRecorder::size() {
+    long int n = 0;
+    for (size_t i = 0; i < count_.size(); i++) {
+        n += count_[i];
+    }
+    return n;
+}
+
+void SparseRecorder::clear() {
+    for (size_t i = 0; i < entries_.size(); i++) {
+        std::vector<SparseEntry>().swap(entries_[i]);
+        count_[i] = 0;
+    }
+}
+
+double SparseMatrix::memory(long int nrow, long int nnz) {
+    return (double)(nrow + 1) * sizeof(long int) + (double)nnz * ( sizeof(long int) + sizeof(double) );
+}
+
+SparseMatrix::SparseMatrix(long int nrow, long int ncol, long int nnz) {
+    nrow_   = nrow;
+    ncol_   = ncol;
+    nnz_    = nnz;
+    rowptr_ = (long int*)malloc((nrow_+1)*sizeof(long int));
+    colind_ = (long int*)malloc(nnz_*sizeof(long int));
+    values_ = (double*)malloc(nnz_*sizeof(double));
+    memset((void*)rowptr_,'\0',(nrow_+1)*sizeof(long int));
+}
+
+SparseMatrix::SparseMatrix(long int nrow, long int ncol, SparseRecorder * recorder) {
+
+    nrow_ = nrow;
+    ncol_ = ncol;
+
+    std::vector< std::vector<SparseEntry> > & entries = recorder->entries();
+
+    // count elements in each row
+    long int nraw = 0;
+    rowptr_ = (long int*)malloc((nrow_+1)*sizeof(long int));
+    memset((void*)rowptr_,'\0',(nrow_+1)*sizeof(long int));
+    for (size_t t = 0; t < entries.size(); t++) {
+        for (size_t i = 0; i < entries[t].size(); i++) {
+            long int row = entries[t][i].row;
+            if ( row < 0 || row >= nrow_ || entries[t][i].col < 0 || entries[t][i].col >= ncol_ ) {
+                throw PsiException("sparse matrix element out of range",__FILE__,__LINE__);
+            }
+            rowptr_[row+1]++;
+        }
+        nraw += entries[t].size();
+    }
+    for (long int i = 0; i < nrow_; i++) {
+        rowptr_[i+1] += rowptr_[i];
+    }
+
+    // scatter elements into rows
+    colind_ = (long int*)malloc(nraw*sizeof(long int));
+    values_ = (double*)malloc(nraw*sizeof(double));
+    long int * fill = (long int*)malloc(nrow_*sizeof(long int));
+    memcpy((void*)fill,(void*)rowptr_,nrow_*sizeof(long int));
+    for (size_t t = 0; t < entries.size(); t++) {
+        for (size_t i = 0; i < entries[t].size(); i++) {
+            long int pos = fill[entries[t][i].row]++;
+            colind_[pos] = entries[t][i].col;
+            values_[pos] = entries[t][i].value;
+        }
+    }
+    recorder->clear();
+
+    // sort each row by column, sum duplicates, and drop zeros.  the
+    // compacted row i is left at the start of its original range.
+    long int * rowlen = fill;
+    #pragma omp parallel
+    {
+        std::vector< std::pair<long int,double> > row;
+        #pragma omp for schedule (dynamic)
+        for (long int i = 0; i < nrow_; i++) {
+            row.clear();
+            for (long int j = rowptr_[i]; j < rowptr_[i+1]; j++) {
+                row.push_back(std::make_pair(colind_[j],values_[j]));
+            }
+            std::sort(row.begin(),row.end(),compare_col);
+            long int pos = rowptr_[i];
+            for (size_t j = 0; j < row.size(); ) {
+                long int col = row[j].first;
+                double val = 0.0;
+                for ( ; j < row.size() && row[j].first == col; j++) {
+                    val += row[j].second;
+                }
+                if ( fabs(val) < 1e-14 ) continue;
+                colind_[pos] = col;
+                values_[pos] = val;
+                pos++;
+            }
+            rowlen[i] = pos - rowptr_[i];
+        }
+    }
+
+    // close the gaps left by merged elements
+    nnz_ = 0;
+    for (long int i = 0; i < nrow_; i++) {
+        long int start = rowptr_[i];
+        rowptr_[i] = nnz_;
+        memmove((void*)(colind_+nnz_),(void*)(colind_+start),rowlen[i]*sizeof(long int));
+        memmove((void*)(values_+nnz_),(void*)(values_+start),rowlen[i]*sizeof(double));
+        nnz_ += rowlen[i];
+    }
+    rowptr_[nrow_] = nnz_;
+    free(fill);
+
+    colind_ = (long int*)realloc(colind_,(nnz_ > 0 ? nnz_ : 1)*sizeof(long int));
+    values_ = (double*)realloc(values_,(nnz_ > 0 ? nnz_ : 1)*sizeof(double));
+
+    BuildPartition();
+}
+
+SparseMatrix::~SparseMatrix() {
+    free(rowptr_);
+    free(colind_);
+    free(values_);
+}
+
+std::shared_ptr<SparseMatrix> SparseMatrix::transpose() {
+
+    std::shared_ptr<SparseMatrix> T (new SparseMatrix(ncol_,nrow_,nnz_));
+
+    // count elements in each column
+    for (long int j = 0; j < nnz_; j++) {
+        T->rowptr_[colind_[j]+1]++;
+    }
+    for (long int i = 0; i < ncol_; i++) {
+        T->rowptr_[i+1] += T->rowptr_[i];
+    }
+
+    // scatter.  rows of A are visited in order, so columns of A^T come out sorted
+    long int * fill = (long int*)malloc(ncol_*sizeof(long int));
+    memcpy((void*)fill,(void*)T->rowptr_,ncol_*sizeof(long int));
+    for (long int i = 0; i < nrow_; i++) {
+        for (long int j = rowptr_[i]; j < rowptr_[i+1]; j++) {
+            long int pos = fill[colind_[j]]++;
+            T->colind_[pos] = i;
+            T->values_[pos] = values_[j];
+        }
+    }
+    free(fill);
+
+    T->BuildPartition();
+
+    return T;
+}
+
+void SparseMatrix::row_norms_squared(double * d) {
+
+    #pragma omp parallel for schedule (static)
+    for (long int i = 0; i < nrow_; i++) {
+        double dum = 0.0;
+        for (long int j = rowptr_[i]; j < rowptr_[i+1]; j++) {
+            dum += values_[j] * values_[j];
+        }
+        d[i] = dum;
+    }
+}
+
+long int SparseMatrix::product_nnz(std::shared_ptr<SparseMatrix> B) {
+
+    if ( ncol_ != B->nrow_ ) {
+        throw PsiException("sparse matrix dimensions do not match",__FILE__,__LINE__);
+    }
+
+    long int nnz = 0;
+
+    #pragma omp parallel reduction(+:nnz)
+    {
+        // marker[k] == i if column k already appears in row i of A.B
+        std::vector<long int> marker(B->ncol_,-1);
+
+        #pragma omp for schedule (dynamic,64)
+        for (long int i = 0; i < nrow_; i++) {
+            for (long int j = rowptr_[i]; j < rowptr_[i+1]; j++) {
+                long int row = colind_[j];
+                for (long int k = B->rowptr_[row]; k < B->rowptr_[row+1]; k++) {
+                    long int col = B->colind_[k];
+                    if ( marker[col] == i ) continue;
+                    marker[col] = i;
+                    nnz++;
+                }
+            }
+        }
+    }
+    return nnz;
+}
+
+std::shared_ptr<SparseMatrix> SparseMatrix::product(std::shared_ptr<SparseMatrix> B) {
+
+    if ( ncol_ != B->nrow_ ) {
+        throw PsiException("sparse matrix dimensions do not match",__FILE__,__LINE__);
+    }
+
+    // symbolic pass: number of elements in each row of A.B
+    std::vector<long int> rowptr(nrow_+1,0);
+    #pragma omp parallel
+    {
+        std::vector<long int> marker(B->ncol_,-1);
+
+        #pragma omp for schedule (dynamic,64)
+        for (long int i = 0; i < nrow_; i++) {
+            long int count = 0;
+            for (long int j = rowptr_[i]; j < rowptr_[i+1]; j++) {
+                long int row = colind_[j];
+                for (long int k = B->rowptr_[row]; k < B->rowptr_[row+1]; k++) {
+                    long int col = B->colind_[k];
+                    if ( marker[col] == i ) continue;
+                    marker[col] = i;
+                    count++;
+                }
+            }
+            rowptr[i+1] = count;
+        }
+    }
+    for (long int i = 0; i < nrow_; i++) {
+        rowptr[i+1] += rowptr[i];
+    }
+
+    std::shared_ptr<SparseMatrix> C (new SparseMatrix(nrow_,B->ncol_,rowptr[nrow_]));
+    memcpy((void*)C->rowptr_,(void*)rowptr.data(),(nrow_+1)*sizeof(long int));
+
+    // numeric pass: accumulate each row in a dense workspace, then gather
+    #pragma omp parallel
+    {
+        std::vector<long int> marker(B->ncol_,-1);
+        std::vector<double> work(B->ncol_,0.0);
+        std::vector<long int> cols;
+
+        #pragma omp for schedule (dynamic,64)
+        for (long int i = 0; i < nrow_; i++) {
+            cols.clear();
+            for (long int j = rowptr_[i]; j < rowptr_[i+1]; j++) {
+                long int row = colind_[j];
+                double val = values_[j];
+                for (long int k = B->rowptr_[row]; k < B->rowptr_[row+1]; k++) {
+                    long int col = B->colind_[k];
+                    if ( marker[col] != i ) {
+                        marker[col] = i;
+                        work[col] = 0.0;
+                        cols.push_back(col);
+                    }
+                    work[col] += val * B->values_[k];
+                }
+            }
+            std::sort(cols.begin(),cols.end());
+            long int pos = C->rowptr_[i];
+            for (size_t k = 0; k < cols.size(); k++) {
+                C->colind_[pos] = cols[k];
+                C->values_[pos] = work[cols[k]];
+                pos++;
+            }
+        }
+    }
+
+    C->BuildPartition();
+
+    return C;
+}
+
+void SparseMatrix::BuildPartition() {
+
+    int nthreads = omp_get_max_threads();
+    row_partition_.resize(nthreads+1);
+
+    // row_partition_[t] is the first row whose elements begin at or past t/nthreads of the total
+    long int row = 0;
+    for (int t = 0; t < nthreads; t++) {
+        long int target = (long int)( (double)nnz_ * t / nthreads );
+        while ( row < nrow_ && rowptr_[row] < target ) row++;
+        row_partition_[t] = row;
+    }
+    row_partition_[nthreads] = nrow_;
+}
+
+void SparseMatrix::multiply(double * x, double * y) {
+
+    long int npart = (long int)row_partition_.size() - 1;
+
+    #pragma omp parallel for schedule (static,1)
+    for (long int t = 0; t < npart; t++) {
+        for (long int i = row_partition_[t]; i < row_partition_[t+1]; i++) {
+            double dum = 0.0;
+            for (long int j = rowptr_[i]; j < rowptr_[i+1]; j++) {
+                dum += values_[j] * x[colind_[j]];
+            }
+            y[i] = dum;
+        }
+    }
+}
+
+}} // end of namespaces
@@ -0,0 +1,193 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * v2RDM-CASSCF, a plugin to:
+ *
+ * Psi4: an open-source quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (c) 2014, The Florida State University. All rights reserved.
+ * 
+ *@END LICENSE
+ *
+ */
+
+#ifndef SPARSE_MATRIX_H
+#define SPARSE_MATRIX_H
+
+#include<vector>
+#include<memory>
+
+namespace psi{ namespace v2rdm_casscf{
+
+/// one (row, column, value) element of a sparse matrix
+struct SparseEntry {
+    long int row;
+    long int col;
+    double value;
+};
+
+/// 
+/// the classes below stand in for the double * arguments of the A^T.u 
+/// kernels.  u_p[i] returns a SparseTerm (coefficient 1 on row i), any 
+/// scaling applied by the kernel is carried along, and A_p[j] += term 
+/// records the element (term.row, j, term.value) of A.  running the 
+/// kernels once with these types yields the explicit constraint matrix.
+/// 
+
+/// coefficient multiplying element "row" of the source vector u
+struct SparseTerm {
+    long int row;
+    double value;
+};
+
+inline SparseTerm operator*(double a, const SparseTerm & t) {
+    SparseTerm r = { t.row, a * t.value };
+    return r;
+}
+inline SparseTerm operator*(const SparseTerm & t, double a) {
+    SparseTerm r = { t.row, a * t.value };
+    return r;
+}
+inline SparseTerm operator/(const SparseTerm & t, double a) {
+    SparseTerm r = { t.row, t.value / a };
+    return r;
+}
+inline SparseTerm operator-(const SparseTerm & t) {
+    SparseTerm r = { t.row, -t.value };
+    return r;
+}
+
+/// collects recorded elements in one buffer per thread
+class SparseRecorder {
+  public:
+    /// if count_only, elements are counted but not stored
+    SparseRecorder(bool count_only);
+    ~SparseRecorder();
+
+    /// record element (row, col, value)
+    void add(long int row, long int col, double value);
+
+    /// number of elements recorded so far (duplicates included)
+    long int size();
+
+    /// per-thread element buffers
+    std::vector< std::vector<SparseEntry> > & entries() { return entries_; }
+
+    /// release element buffers
+    void clear();
+
+  private:
+    bool count_only_;
+    std::vector<long int> count_;
+    std::vector< std::vector<SparseEntry> > entries_;
+};
+
+/// stand-in for the source vector u_p
+class SparseSource {
+  public:
+    SparseSource(long int offset = 0) : offset_(offset) {}
+    SparseTerm operator[](long int i) const {
+        SparseTerm t = { offset_ + i, 1.0 };
+        return t;
+    }
+    SparseSource operator+(long int i) const { return SparseSource(offset_ + i); }
+  private:
+    long int offset_;
+};
+
+/// stand-in for the target vector A_p
+class SparseTarget {
+  public:
+    class Element {
+      public:
+        Element(SparseRecorder * recorder, long int col) : recorder_(recorder), col_(col) {}
+        void operator+=(const SparseTerm & t) { recorder_->add(t.row, col_,  t.value); }
+        void operator-=(const SparseTerm & t) { recorder_->add(t.row, col_, -t.value); }
+      private:
+        SparseRecorder * recorder_;
+        long int col_;
+    };
+
+    SparseTarget(SparseRecorder * recorder, long int offset = 0) : recorder_(recorder), offset_(offset) {}
+    Element operator[](long int i) const { return Element(recorder_, offset_ + i); }
+    SparseTarget operator+(long int i) const { return SparseTarget(recorder_, offset_ + i); }
+
+    /// y += a x, found by argument-dependent lookup when the kernels call C_DAXPY
+    friend void C_DAXPY(long int n, double a, SparseSource x, int incx, SparseTarget y, int incy) {
+        for (long int i = 0; i < n; i++) {
+            y[i * incy] += a * x[i * incx];
+        }
+    }
+
+  private:
+    SparseRecorder * recorder_;
+    long int offset_;
+};
+
+/// 
+/// real matrix in compressed sparse row (CSR) format
+/// 
+class SparseMatrix {
+  public:
+    /// build from recorded elements.  duplicates are summed and zeros dropped.
+    SparseMatrix(long int nrow, long int ncol, SparseRecorder * recorder);
+    ~SparseMatrix();
+
+    /// explicit transpose (also CSR)
+    std::shared_ptr<SparseMatrix> transpose();
+
+    /// y = A.x
+    void multiply(double * x, double * y);
+
+    /// squared norm of each row, i.e., the diagonal of A.A^T
+    void row_norms_squared(double * d);
+
+    /// number of nonzero elements in the product A.B
+    long int product_nnz(std::shared_ptr<SparseMatrix> B);
+
+    /// explicit product A.B (also CSR)
+    std::shared_ptr<SparseMatrix> product(std::shared_ptr<SparseMatrix> B);
+
+    long int nrow() { return nrow_; }
+    long int ncol() { return ncol_; }
+    long int nnz()  { return nnz_; }
+
+    /// storage (bytes) for a CSR matrix with nrow rows and nnz nonzero elements
+    static double memory(long int nrow, long int nnz);
+
+  private:
+    friend class SparseCholesky;
+
+    /// empty matrix, filled by transpose()
+    SparseMatrix(long int nrow, long int ncol, long int nnz);
+
+    /// split rows into contiguous ranges with similar numbers of nonzeros, one per thread
+    void BuildPartition();
+
+    long int nrow_;
+    long int ncol_;
+    long int nnz_;
+    long int * rowptr_;
+    long int * colind_;
+    double   * values_;
+
+    std::vector<long int> row_partition_;
+};
+
+}} // end of namespaces
+
+#endif
@@ -0,0 +1,221 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * v2RDM-CASSCF, a plugin to:
+ *
+ * Psi4: an open-source quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (c) 2014, The Florida State University. All rights reserved.
+ * 
+ *@END LICENSE
+ *
+ */
+
+#include <psi4/psi4-dec.h>
+#include <psi4/liboptions/liboptions.h>
+#include <psi4/libqt/qt.h>
+
+#include<psi4/libmints/wavefunction.h>
+#include<psi4/libmints/vector.h>
+#include<psi4/libmints/matrix.h>
+
+#include<math.h>
+
+#include"v2rdm_solver.h"
+
+using namespace psi;
+
+/*================================================================
+
+   spin-adapted D2 for singlets
+
+   for a singlet, D2ab, D2aa, and D2bb are determined by two blocks per 
+   irrep: a singlet block, S, in the basis of normalized symmetric 
+   geminals 
+
+       |ij>_s = (|ij> + |ji>) / sqrt(2(1+dij)),  i <= j  (gems_00)
+
+   and a triplet block, T, in the basis of antisymmetric geminals
+
+       |ij>_t = (|ij> - |ji>) / sqrt(2),         i < j   (gems_aa)
+
+   so that
+
+       D2ab = sum_{PQ} S(P,Q) |P>_s <Q|_s + sum_{PQ} T(P,Q) |P>_t <Q|_t / sqrt(n)
+       D2aa = D2bb = T / sqrt(n)
+
+   with n = 3 (n = 2 with CLOSED_SHELL, where D2bb is D2aa).  the factor 
+   of 1/sqrt(n) makes the map from (S,T) to x an isometry, like the 
+   packed storage, so c.x, norms, and DIIS are the same either way.  D2ab, 
+   D2aa, and D2bb are positive semidefinite if and only if S and T are.
+
+================================================================*/
+
+namespace psi{ namespace v2rdm_casscf{
+
+void v2RDMSolver::SpinAdaptedD2Expand(int h, double * s, double * t, double * full) {
+
+    long int nab = gems_ab[h];
+    long int naa = gems_aa[h];
+    long int n00 = gems_00[h];
+
+    double scale = 1.0 / sqrt( closed_shell_ ? 2.0 : 3.0 );
+
+    double * ab = full + d2aboff[h];
+    double * aa = full + d2aaoff[h];
+    double * bb = full + d2bboff[h];
+
+    // singlet part of D2ab (this touches every element of D2ab)
+    for (long int ij = 0; ij < n00; ij++) {
+        int i = bas_00_sym[h][ij][0];
+        int j = bas_00_sym[h][ij][1];
+        long int ijb = ibas_ab_sym[h][i][j];
+        long int jib = ibas_ab_sym[h][j][i];
+        double wij = ( i == j ) ? 1.0 : M_SQRT1_2;
+        for (long int kl = 0; kl < n00; kl++) {
+            int k = bas_00_sym[h][kl][0];
+            int l = bas_00_sym[h][kl][1];
+            long int klb = ibas_ab_sym[h][k][l];
+            long int lkb = ibas_ab_sym[h][l][k];
+            double wkl = ( k == l ) ? 1.0 : M_SQRT1_2;
+            double dum = wij * wkl * s[ij*n00+kl];
+            ab[ijb*nab+klb] = dum;
+            ab[jib*nab+klb] = dum;
+            ab[ijb*nab+lkb] = dum;
+            ab[jib*nab+lkb] = dum;
+        }
+    }
+
+    // triplet part of D2ab, D2aa, and D2bb
+    for (long int ij = 0; ij < naa; ij++) {
+        int i = bas_aa_sym[h][ij][0];
+        int j = bas_aa_sym[h][ij][1];
+        long int ijb = ibas_ab_sym[h][i][j];
+        long int jib = ibas_ab_sym[h][j][i];
+        for (long int kl = 0; kl < naa; kl++) {
+            int k = bas_aa_sym[h][kl][0];
+            int l = bas_aa_sym[h][kl][1];
+            long int klb = ibas_ab_sym[h][k][l];
+            long int lkb = ibas_ab_sym[h][l][k];
+            double dum = scale * t[ij*naa+kl];
+            ab[ijb*nab+klb] += 0.5 * dum;
+            ab[jib*nab+klb] -= 0.5 * dum;
+            ab[ijb*nab+lkb] -= 0.5 * dum;
+            ab[jib*nab+lkb] += 0.5 * dum;
+            aa[ij*naa+kl] = dum;
+            bb[ij*naa+kl] = dum;
+        }
+    }
+}
+
+void v2RDMSolver::SpinAdaptedD2Contract(int h, double * full, double * s, double * t) {
+
+    long int nab = gems_ab[h];
+    long int naa = gems_aa[h];
+    long int n00 = gems_00[h];
+
+    double scale = 1.0 / sqrt( closed_shell_ ? 2.0 : 3.0 );
+
+    double * ab = full + d2aboff[h];
+    double * aa = full + d2aaoff[h];
+    double * bb = full + d2bboff[h];
+
+    for (long int ij = 0; ij < n00; ij++) {
+        int i = bas_00_sym[h][ij][0];
+        int j = bas_00_sym[h][ij][1];
+        long int ijb = ibas_ab_sym[h][i][j];
+        long int jib = ibas_ab_sym[h][j][i];
+        double wij = ( i == j ) ? 1.0 : M_SQRT1_2;
+        for (long int kl = 0; kl < n00; kl++) {
+            int k = bas_00_sym[h][kl][0];
+            int l = bas_00_sym[h][kl][1];
+            long int klb = ibas_ab_sym[h][k][l];
+            long int lkb = ibas_ab_sym[h][l][k];
+            double wkl = ( k == l ) ? 1.0 : M_SQRT1_2;
+            double dum = ab[ijb*nab+klb];
+            if ( i != j )             dum += ab[jib*nab+klb];
+            if ( k != l )             dum += ab[ijb*nab+lkb];
+            if ( i != j && k != l )   dum += ab[jib*nab+lkb];
+            s[ij*n00+kl] = wij * wkl * dum;
+        }
+    }
+
+    for (long int ij = 0; ij < naa; ij++) {
+        int i = bas_aa_sym[h][ij][0];
+        int j = bas_aa_sym[h][ij][1];
+        long int ijb = ibas_ab_sym[h][i][j];
+        long int jib = ibas_ab_sym[h][j][i];
+        for (long int kl = 0; kl < naa; kl++) {
+            int k = bas_aa_sym[h][kl][0];
+            int l = bas_aa_sym[h][kl][1];
+            long int klb = ibas_ab_sym[h][k][l];
+            long int lkb = ibas_ab_sym[h][l][k];
+            double dum = 0.5 * ( ab[ijb*nab+klb] - ab[jib*nab+klb] - ab[ijb*nab+lkb] + ab[jib*nab+lkb] );
+            dum += aa[ij*naa+kl];
+            if ( !closed_shell_ ) dum += bb[ij*naa+kl];
+            t[ij*naa+kl] = scale * dum;
+        }
+    }
+}
+
+// D2s and D2t (packed if packed_storage_) at the start of in -> D2ab, D2aa, and D2bb in full
+void v2RDMSolver::SpinAdaptedD2ExpandBlocks(double * in, double * full) {
+    #pragma omp parallel for schedule (dynamic,1)
+    for (int h = 0; h < nirrep_; h++) {
+        double * s = in + dimensions_offset_[h];
+        double * t = in + dimensions_offset_[nirrep_ + h];
+        if ( packed_storage_ ) {
+            s = spin_adapted_d2_scratch_ + dimensions_offset_[h];
+            t = spin_adapted_d2_scratch_ + dimensions_offset_[nirrep_ + h];
+            UnpackBlock(gems_00[h],in + dimensions_packed_offset_[h],s);
+            UnpackBlock(gems_aa[h],in + dimensions_packed_offset_[nirrep_ + h],t);
+        }
+        SpinAdaptedD2Expand(h,s,t,full);
+    }
+}
+
+// D2ab, D2aa, and D2bb in full -> D2s and D2t (packed if packed_storage_) at the start of out
+void v2RDMSolver::SpinAdaptedD2ContractBlocks(double * full, double * out) {
+    #pragma omp parallel for schedule (dynamic,1)
+    for (int h = 0; h < nirrep_; h++) {
+        double * s = out + dimensions_offset_[h];
+        double * t = out + dimensions_offset_[nirrep_ + h];
+        if ( packed_storage_ ) {
+            s = spin_adapted_d2_scratch_ + dimensions_offset_[h];
+            t = spin_adapted_d2_scratch_ + dimensions_offset_[nirrep_ + h];
+        }
+        SpinAdaptedD2Contract(h,full,s,t);
+        if ( packed_storage_ ) {
+            PackBlock(gems_00[h],s,out + dimensions_packed_offset_[h]);
+            PackBlock(gems_aa[h],t,out + dimensions_packed_offset_[nirrep_ + h]);
+        }
+    }
+}
+
+// x <- E.E^T.x on the D2 blocks: the part of A^T.u that the singlet and 
+// triplet blocks can see
+void v2RDMSolver::SpinAdaptedD2Project(double * full) {
+    #pragma omp parallel for schedule (dynamic,1)
+    for (int h = 0; h < nirrep_; h++) {
+        double * s = spin_adapted_d2_scratch_ + dimensions_offset_[h];
+        double * t = spin_adapted_d2_scratch_ + dimensions_offset_[nirrep_ + h];
+        SpinAdaptedD2Contract(h,full,s,t);
+        SpinAdaptedD2Expand(h,s,t,full);
+    }
+}
+
+}} // end of namespaces
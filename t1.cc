@@ -58,6 +58,10 @@ void v2RDMSolver::T1_constraints_guess(SharedVector u){
 
     double * u_p = u->pointer();
 
+    // G2ab and G2ba are G2t_p1 and G2t_m1 if G2 is spin adapted
+    int * g2ab = spin_adapt_g2_ ? g2toff_p1 : g2aboff;
+    int * g2ba = spin_adapt_g2_ ? g2toff_m1 : g2baoff;
+
     // T1aab
     for (int h = 0; h < nirrep_; h++) {
 
@@ -102,7 +106,7 @@ void v2RDMSolver::T1_constraints_guess(SharedVector u){
                     int hni = SymmetryPair(symmetry[n],symmetry[i]);
                     int ni = ibas_ab_sym[hni][n][i];
                     int kl = ibas_ab_sym[hni][k][l];
-                    dum -= u_p[g2baoff[hni] + ni*gems_ab[hni] + kl];  // -G2(ni,kl) djm
+                    dum -= u_p[g2ba[hni] + ni*gems_ab[hni] + kl];  // -G2(ni,kl) djm
                     
                 }
 
@@ -110,7 +114,7 @@ void v2RDMSolver::T1_constraints_guess(SharedVector u){
                     int hkl = SymmetryPair(symmetry[k],symmetry[l]);
                     int nj = ibas_ab_sym[hkl][n][j];
                     int kl = ibas_ab_sym[hkl][k][l];
-                    dum += u_p[g2baoff[hkl] + nj*gems_ab[hkl] + kl];  // G2(nj,kl) dim
+                    dum += u_p[g2ba[hkl] + nj*gems_ab[hkl] + kl];  // G2(nj,kl) dim
                     
                 }
 
@@ -164,7 +168,7 @@ void v2RDMSolver::T1_constraints_guess(SharedVector u){
                     int hni = SymmetryPair(symmetry[n],symmetry[i]);
                     int ni = ibas_ab_sym[hni][n][i];
                     int kl = ibas_ab_sym[hni][k][l];
-                    dum -= u_p[g2aboff[hni] + ni*gems_ab[hni] + kl];  // -G2(ni,kl) djm
+                    dum -= u_p[g2ab[hni] + ni*gems_ab[hni] + kl];  // -G2(ni,kl) djm
                     
                 }
 
@@ -172,7 +176,7 @@ void v2RDMSolver::T1_constraints_guess(SharedVector u){
                     int hkl = SymmetryPair(symmetry[k],symmetry[l]);
                     int nj = ibas_ab_sym[hkl][n][j];
                     int kl = ibas_ab_sym[hkl][k][l];
-                    dum += u_p[g2aboff[hkl] + nj*gems_ab[hkl] + kl];  // G2(nj,kl) dim
+                    dum += u_p[g2ab[hkl] + nj*gems_ab[hkl] + kl];  // G2(nj,kl) dim
                     
                 }
 
@@ -264,7 +268,11 @@ void v2RDMSolver::T1_constraints_guess(SharedVector u){
                     int hni = SymmetryPair(symmetry[n],symmetry[i]);
                     int ni = ibas_ab_sym[hni][n][i];
                     int jl = ibas_ab_sym[hni][j][l];
-                    dum += u_p[g2aaoff[hni] + ni*2*gems_ab[hni] + jl];  // G2(ni,jl) dkm
+                    if ( spin_adapt_g2_ ) {
+                        dum += 0.5 * ( u_p[g2soff[hni] + ni*gems_ab[hni] + jl] + u_p[g2toff[hni] + ni*gems_ab[hni] + jl] );  // G2(ni,jl) dkm
+                    }else {
+                        dum += u_p[g2aaoff[hni] + ni*2*gems_ab[hni] + jl];  // G2(ni,jl) dkm
+                    }
                     
                 }
 
@@ -278,7 +286,11 @@ void v2RDMSolver::T1_constraints_guess(SharedVector u){
                     int hni = SymmetryPair(symmetry[n],symmetry[i]);
                     int ni = ibas_ab_sym[hni][n][i];
                     int kl = ibas_ab_sym[hni][k][l];
-                    dum -= u_p[g2aaoff[hni] + ni*2*gems_ab[hni] + kl];  // -G2(ni,kl) djm
+                    if ( spin_adapt_g2_ ) {
+                        dum -= 0.5 * ( u_p[g2soff[hni] + ni*gems_ab[hni] + kl] + u_p[g2toff[hni] + ni*gems_ab[hni] + kl] );  // -G2(ni,kl) djm
+                    }else {
+                        dum -= u_p[g2aaoff[hni] + ni*2*gems_ab[hni] + kl];  // -G2(ni,kl) djm
+                    }
                     
                 }
 
@@ -292,7 +304,11 @@ void v2RDMSolver::T1_constraints_guess(SharedVector u){
                     int hkl = SymmetryPair(symmetry[k],symmetry[l]);
                     int nj = ibas_ab_sym[hkl][n][j];
                     int kl = ibas_ab_sym[hkl][k][l];
-                    dum += u_p[g2aaoff[hkl] + nj*2*gems_ab[hkl] + kl];  // G2(nj,kl) dim
+                    if ( spin_adapt_g2_ ) {
+                        dum += 0.5 * ( u_p[g2soff[hkl] + nj*gems_ab[hkl] + kl] + u_p[g2toff[hkl] + nj*gems_ab[hkl] + kl] );  // G2(nj,kl) dim
+                    }else {
+                        dum += u_p[g2aaoff[hkl] + nj*2*gems_ab[hkl] + kl];  // G2(nj,kl) dim
+                    }
                     
                 }
 
@@ -385,7 +401,11 @@ void v2RDMSolver::T1_constraints_guess(SharedVector u){
                     int hni = SymmetryPair(symmetry[n],symmetry[i]);
                     int ni = ibas_ab_sym[hni][n][i];
                     int jl = ibas_ab_sym[hni][j][l];
-                    dum += u_p[g2aaoff[hni] + (ni+gems_ab[hni])*2*gems_ab[hni] + (jl+gems_ab[hni])];  // G2(ni,jl) dkm
+                    if ( spin_adapt_g2_ ) {
+                        dum += 0.5 * ( u_p[g2soff[hni] + ni*gems_ab[hni] + jl] + u_p[g2toff[hni] + ni*gems_ab[hni] + jl] );  // G2(ni,jl) dkm
+                    }else {
+                        dum += u_p[g2aaoff[hni] + (ni+gems_ab[hni])*2*gems_ab[hni] + (jl+gems_ab[hni])];  // G2(ni,jl) dkm
+                    }
                     
                 }
 
@@ -399,7 +419,11 @@ void v2RDMSolver::T1_constraints_guess(SharedVector u){
                     int hni = SymmetryPair(symmetry[n],symmetry[i]);
                     int ni = ibas_ab_sym[hni][n][i];
                     int kl = ibas_ab_sym[hni][k][l];
-                    dum -= u_p[g2aaoff[hni] + (ni+gems_ab[hni])*2*gems_ab[hni] + (kl+gems_ab[hni])];  // -G2(ni,kl) djm
+                    if ( spin_adapt_g2_ ) {
+                        dum -= 0.5 * ( u_p[g2soff[hni] + ni*gems_ab[hni] + kl] + u_p[g2toff[hni] + ni*gems_ab[hni] + kl] );  // -G2(ni,kl) djm
+                    }else {
+                        dum -= u_p[g2aaoff[hni] + (ni+gems_ab[hni])*2*gems_ab[hni] + (kl+gems_ab[hni])];  // -G2(ni,kl) djm
+                    }
                     
                 }
 
@@ -413,7 +437,11 @@ void v2RDMSolver::T1_constraints_guess(SharedVector u){
                     int hkl = SymmetryPair(symmetry[k],symmetry[l]);
                     int nj = ibas_ab_sym[hkl][n][j];
                     int kl = ibas_ab_sym[hkl][k][l];
-                    dum += u_p[g2aaoff[hkl] + (nj+gems_ab[hkl])*2*gems_ab[hkl] + (kl+gems_ab[hkl])];  // G2(nj,kl) dim
+                    if ( spin_adapt_g2_ ) {
+                        dum += 0.5 * ( u_p[g2soff[hkl] + nj*gems_ab[hkl] + kl] + u_p[g2toff[hkl] + nj*gems_ab[hkl] + kl] );  // G2(nj,kl) dim
+                    }else {
+                        dum += u_p[g2aaoff[hkl] + (nj+gems_ab[hkl])*2*gems_ab[hkl] + (kl+gems_ab[hkl])];  // G2(nj,kl) dim
+                    }
                     
                 }
 
@@ -431,10 +459,15 @@ void v2RDMSolver::T1_constraints_guess(SharedVector u){
 
 // T1 portion of A.u 
 void v2RDMSolver::T1_constraints_Au(SharedVector A,SharedVector u){
+    long int offset = t1_constraints_offset_;
 
     double * A_p = A->pointer();
     double * u_p = u->pointer();
 
+    // G2ab and G2ba are G2t_p1 and G2t_m1 if G2 is spin adapted
+    int * g2ab = spin_adapt_g2_ ? g2toff_p1 : g2aboff;
+    int * g2ba = spin_adapt_g2_ ? g2toff_m1 : g2baoff;
+
     // T1aab
     for (int h = 0; h < nirrep_; h++) {
 
@@ -478,7 +511,7 @@ void v2RDMSolver::T1_constraints_Au(SharedVector A,SharedVector u){
                     int hni = SymmetryPair(symmetry[n],symmetry[i]);
                     int ni = ibas_ab_sym[hni][n][i];
                     int kl = ibas_ab_sym[hni][k][l];
-                    dum -= u_p[g2baoff[hni] + ni*gems_ab[hni] + kl];  // -G2(ni,kl) djm
+                    dum -= u_p[g2ba[hni] + ni*gems_ab[hni] + kl];  // -G2(ni,kl) djm
                     
                 }
 
@@ -486,7 +519,7 @@ void v2RDMSolver::T1_constraints_Au(SharedVector A,SharedVector u){
                     int hkl = SymmetryPair(symmetry[k],symmetry[l]);
                     int nj = ibas_ab_sym[hkl][n][j];
                     int kl = ibas_ab_sym[hkl][k][l];
-                    dum += u_p[g2baoff[hkl] + nj*gems_ab[hkl] + kl];  // G2(nj,kl) dim
+                    dum += u_p[g2ba[hkl] + nj*gems_ab[hkl] + kl];  // G2(nj,kl) dim
                     
                 }
 
@@ -542,7 +575,7 @@ void v2RDMSolver::T1_constraints_Au(SharedVector A,SharedVector u){
                     int hni = SymmetryPair(symmetry[n],symmetry[i]);
                     int ni = ibas_ab_sym[hni][n][i];
                     int kl = ibas_ab_sym[hni][k][l];
-                    dum -= u_p[g2aboff[hni] + ni*gems_ab[hni] + kl];  // -G2(ni,kl) djm
+                    dum -= u_p[g2ab[hni] + ni*gems_ab[hni] + kl];  // -G2(ni,kl) djm
                     
                 }
 
@@ -550,7 +583,7 @@ void v2RDMSolver::T1_constraints_Au(SharedVector A,SharedVector u){
                     int hkl = SymmetryPair(symmetry[k],symmetry[l]);
                     int nj = ibas_ab_sym[hkl][n][j];
                     int kl = ibas_ab_sym[hkl][k][l];
-                    dum += u_p[g2aboff[hkl] + nj*gems_ab[hkl] + kl];  // G2(nj,kl) dim
+                    dum += u_p[g2ab[hkl] + nj*gems_ab[hkl] + kl];  // G2(nj,kl) dim
                     
                 }
 
@@ -643,7 +676,11 @@ void v2RDMSolver::T1_constraints_Au(SharedVector A,SharedVector u){
                     int hni = SymmetryPair(symmetry[n],symmetry[i]);
                     int ni = ibas_ab_sym[hni][n][i];
                     int jl = ibas_ab_sym[hni][j][l];
-                    dum += u_p[g2aaoff[hni] + ni*2*gems_ab[hni] + jl];  // G2(ni,jl) dkm
+                    if ( spin_adapt_g2_ ) {
+                        dum += 0.5 * ( u_p[g2soff[hni] + ni*gems_ab[hni] + jl] + u_p[g2toff[hni] + ni*gems_ab[hni] + jl] );  // G2(ni,jl) dkm
+                    }else {
+                        dum += u_p[g2aaoff[hni] + ni*2*gems_ab[hni] + jl];  // G2(ni,jl) dkm
+                    }
                     
                 }
 
@@ -657,7 +694,11 @@ void v2RDMSolver::T1_constraints_Au(SharedVector A,SharedVector u){
                     int hni = SymmetryPair(symmetry[n],symmetry[i]);
                     int ni = ibas_ab_sym[hni][n][i];
                     int kl = ibas_ab_sym[hni][k][l];
-                    dum -= u_p[g2aaoff[hni] + ni*2*gems_ab[hni] + kl];  // -G2(ni,kl) djm
+                    if ( spin_adapt_g2_ ) {
+                        dum -= 0.5 * ( u_p[g2soff[hni] + ni*gems_ab[hni] + kl] + u_p[g2toff[hni] + ni*gems_ab[hni] + kl] );  // -G2(ni,kl) djm
+                    }else {
+                        dum -= u_p[g2aaoff[hni] + ni*2*gems_ab[hni] + kl];  // -G2(ni,kl) djm
+                    }
                     
                 }
 
@@ -671,7 +712,11 @@ void v2RDMSolver::T1_constraints_Au(SharedVector A,SharedVector u){
                     int hkl = SymmetryPair(symmetry[k],symmetry[l]);
                     int nj = ibas_ab_sym[hkl][n][j];
                     int kl = ibas_ab_sym[hkl][k][l];
-                    dum += u_p[g2aaoff[hkl] + nj*2*gems_ab[hkl] + kl];  // G2(nj,kl) dim
+                    if ( spin_adapt_g2_ ) {
+                        dum += 0.5 * ( u_p[g2soff[hkl] + nj*gems_ab[hkl] + kl] + u_p[g2toff[hkl] + nj*gems_ab[hkl] + kl] );  // G2(nj,kl) dim
+                    }else {
+                        dum += u_p[g2aaoff[hkl] + nj*2*gems_ab[hkl] + kl];  // G2(nj,kl) dim
+                    }
                     
                 }
 
@@ -764,7 +809,11 @@ void v2RDMSolver::T1_constraints_Au(SharedVector A,SharedVector u){
                     int hni = SymmetryPair(symmetry[n],symmetry[i]);
                     int ni = ibas_ab_sym[hni][n][i];
                     int jl = ibas_ab_sym[hni][j][l];
-                    dum += u_p[g2aaoff[hni] + (ni+gems_ab[hni])*2*gems_ab[hni] + (jl+gems_ab[hni])];  // G2(ni,jl) dkm
+                    if ( spin_adapt_g2_ ) {
+                        dum += 0.5 * ( u_p[g2soff[hni] + ni*gems_ab[hni] + jl] + u_p[g2toff[hni] + ni*gems_ab[hni] + jl] );  // G2(ni,jl) dkm
+                    }else {
+                        dum += u_p[g2aaoff[hni] + (ni+gems_ab[hni])*2*gems_ab[hni] + (jl+gems_ab[hni])];  // G2(ni,jl) dkm
+                    }
                     
                 }
 
@@ -778,7 +827,11 @@ void v2RDMSolver::T1_constraints_Au(SharedVector A,SharedVector u){
                     int hni = SymmetryPair(symmetry[n],symmetry[i]);
                     int ni = ibas_ab_sym[hni][n][i];
                     int kl = ibas_ab_sym[hni][k][l];
-                    dum -= u_p[g2aaoff[hni] + (ni+gems_ab[hni])*2*gems_ab[hni] + (kl+gems_ab[hni])];  // -G2(ni,kl) djm
+                    if ( spin_adapt_g2_ ) {
+                        dum -= 0.5 * ( u_p[g2soff[hni] + ni*gems_ab[hni] + kl] + u_p[g2toff[hni] + ni*gems_ab[hni] + kl] );  // -G2(ni,kl) djm
+                    }else {
+                        dum -= u_p[g2aaoff[hni] + (ni+gems_ab[hni])*2*gems_ab[hni] + (kl+gems_ab[hni])];  // -G2(ni,kl) djm
+                    }
                     
                 }
 
@@ -792,7 +845,11 @@ void v2RDMSolver::T1_constraints_Au(SharedVector A,SharedVector u){
                     int hkl = SymmetryPair(symmetry[k],symmetry[l]);
                     int nj = ibas_ab_sym[hkl][n][j];
                     int kl = ibas_ab_sym[hkl][k][l];
-                    dum += u_p[g2aaoff[hkl] + (nj+gems_ab[hkl])*2*gems_ab[hkl] + (kl+gems_ab[hkl])];  // G2(nj,kl) dim
+                    if ( spin_adapt_g2_ ) {
+                        dum += 0.5 * ( u_p[g2soff[hkl] + nj*gems_ab[hkl] + kl] + u_p[g2toff[hkl] + nj*gems_ab[hkl] + kl] );  // G2(nj,kl) dim
+                    }else {
+                        dum += u_p[g2aaoff[hkl] + (nj+gems_ab[hkl])*2*gems_ab[hkl] + (kl+gems_ab[hkl])];  // G2(nj,kl) dim
+                    }
                     
                 }
 
@@ -810,9 +867,16 @@ void v2RDMSolver::T1_constraints_Au(SharedVector A,SharedVector u){
 
 // T1 portion of A^T.y 
 void v2RDMSolver::T1_constraints_ATu(SharedVector A,SharedVector u){
+    T1_constraints_ATu(A->pointer(),u->pointer());
+}
 
-    double * A_p = A->pointer();
-    double * u_p = u->pointer();
+template <typename TargetType, typename SourceType>
+long int v2RDMSolver::T1_constraints_ATu(TargetType A_p,SourceType u_p){
+    long int offset = t1_constraints_offset_;
+
+    // G2ab and G2ba are G2t_p1 and G2t_m1 if G2 is spin adapted
+    int * g2ab = spin_adapt_g2_ ? g2toff_p1 : g2aboff;
+    int * g2ba = spin_adapt_g2_ ? g2toff_m1 : g2baoff;
 
     // T1aab
     for (int h = 0; h < nirrep_; h++) {
@@ -829,7 +893,7 @@ void v2RDMSolver::T1_constraints_ATu(SharedVector A,SharedVector u){
                 int m = bas_aab_sym[h][lmn][1];
                 int n = bas_aab_sym[h][lmn][2];
 
-                double dum = u_p[offset + ijk*trip_aab[h]+lmn]; 
+                auto dum = u_p[offset + ijk*trip_aab[h]+lmn]; 
 
                 A_p[t1aaboff[h] + ijk*trip_aab[h]+lmn] -= dum; // - T1(ijk,lmn)
 
@@ -858,7 +922,7 @@ void v2RDMSolver::T1_constraints_ATu(SharedVector A,SharedVector u){
                     int hni = SymmetryPair(symmetry[n],symmetry[i]);
                     int ni = ibas_ab_sym[hni][n][i];
                     int kl = ibas_ab_sym[hni][k][l];
-                    A_p[g2baoff[hni] + ni*gems_ab[hni] + kl] -= dum;  // -G2(ni,kl) djm
+                    A_p[g2ba[hni] + ni*gems_ab[hni] + kl] -= dum;  // -G2(ni,kl) djm
                     
                 }
 
@@ -866,7 +930,7 @@ void v2RDMSolver::T1_constraints_ATu(SharedVector A,SharedVector u){
                     int hkl = SymmetryPair(symmetry[k],symmetry[l]);
                     int nj = ibas_ab_sym[hkl][n][j];
                     int kl = ibas_ab_sym[hkl][k][l];
-                    A_p[g2baoff[hkl] + nj*gems_ab[hkl] + kl] += dum;  // G2(nj,kl) dim
+                    A_p[g2ba[hkl] + nj*gems_ab[hkl] + kl] += dum;  // G2(nj,kl) dim
                     
                 }
             }
@@ -889,7 +953,7 @@ void v2RDMSolver::T1_constraints_ATu(SharedVector A,SharedVector u){
                 int m = bas_aab_sym[h][lmn][1];
                 int n = bas_aab_sym[h][lmn][2];
 
-                double dum = u_p[offset + ijk*trip_aab[h]+lmn]; 
+                auto dum = u_p[offset + ijk*trip_aab[h]+lmn]; 
 
                 A_p[t1bbaoff[h] + ijk*trip_aab[h]+lmn] -= dum; // - T1(ijk,lmn)
 
@@ -918,7 +982,7 @@ void v2RDMSolver::T1_constraints_ATu(SharedVector A,SharedVector u){
                     int hni = SymmetryPair(symmetry[n],symmetry[i]);
                     int ni = ibas_ab_sym[hni][n][i];
                     int kl = ibas_ab_sym[hni][k][l];
-                    A_p[g2aboff[hni] + ni*gems_ab[hni] + kl] -= dum;  // -G2(ni,kl) djm
+                    A_p[g2ab[hni] + ni*gems_ab[hni] + kl] -= dum;  // -G2(ni,kl) djm
                     
                 }
 
@@ -926,7 +990,7 @@ void v2RDMSolver::T1_constraints_ATu(SharedVector A,SharedVector u){
                     int hkl = SymmetryPair(symmetry[k],symmetry[l]);
                     int nj = ibas_ab_sym[hkl][n][j];
                     int kl = ibas_ab_sym[hkl][k][l];
-                    A_p[g2aboff[hkl] + nj*gems_ab[hkl] + kl] += dum;  // G2(nj,kl) dim
+                    A_p[g2ab[hkl] + nj*gems_ab[hkl] + kl] += dum;  // G2(nj,kl) dim
                     
                 }
             }
@@ -949,7 +1013,7 @@ void v2RDMSolver::T1_constraints_ATu(SharedVector A,SharedVector u){
                 int m = bas_aaa_sym[h][lmn][1];
                 int n = bas_aaa_sym[h][lmn][2];
 
-                double dum = u_p[offset + ijk*trip_aaa[h] + lmn];
+                auto dum = u_p[offset + ijk*trip_aaa[h] + lmn];
 
                 A_p[t1aaaoff[h] + ijk*trip_aaa[h]+lmn] -= dum; // - T1(ijk,lmn)
 
@@ -1015,7 +1079,12 @@ void v2RDMSolver::T1_constraints_ATu(SharedVector A,SharedVector u){
                     int hni = SymmetryPair(symmetry[n],symmetry[i]);
                     int ni = ibas_ab_sym[hni][n][i];
                     int jl = ibas_ab_sym[hni][j][l];
-                    A_p[g2aaoff[hni] + ni*2*gems_ab[hni] + jl] += dum;  // G2(ni,jl) dkm
+                    if ( spin_adapt_g2_ ) {
+                        A_p[g2soff[hni] + ni*gems_ab[hni] + jl] += 0.5 * dum;  // G2(ni,jl) dkm
+                        A_p[g2toff[hni] + ni*gems_ab[hni] + jl] += 0.5 * dum;
+                    }else {
+                        A_p[g2aaoff[hni] + ni*2*gems_ab[hni] + jl] += dum;  // G2(ni,jl) dkm
+                    }
                     
                 }
 
@@ -1029,7 +1098,12 @@ void v2RDMSolver::T1_constraints_ATu(SharedVector A,SharedVector u){
                     int hni = SymmetryPair(symmetry[n],symmetry[i]);
                     int ni = ibas_ab_sym[hni][n][i];
                     int kl = ibas_ab_sym[hni][k][l];
-                    A_p[g2aaoff[hni] + ni*2*gems_ab[hni] + kl] -= dum;  // -G2(ni,kl) djm
+                    if ( spin_adapt_g2_ ) {
+                        A_p[g2soff[hni] + ni*gems_ab[hni] + kl] -= 0.5 * dum;  // -G2(ni,kl) djm
+                        A_p[g2toff[hni] + ni*gems_ab[hni] + kl] -= 0.5 * dum;
+                    }else {
+                        A_p[g2aaoff[hni] + ni*2*gems_ab[hni] + kl] -= dum;  // -G2(ni,kl) djm
+                    }
                     
                 }
 
@@ -1043,7 +1117,12 @@ void v2RDMSolver::T1_constraints_ATu(SharedVector A,SharedVector u){
                     int hkl = SymmetryPair(symmetry[k],symmetry[l]);
                     int nj = ibas_ab_sym[hkl][n][j];
                     int kl = ibas_ab_sym[hkl][k][l];
-                    A_p[g2aaoff[hkl] + nj*2*gems_ab[hkl] + kl] += dum;  // G2(nj,kl) dim
+                    if ( spin_adapt_g2_ ) {
+                        A_p[g2soff[hkl] + nj*gems_ab[hkl] + kl] += 0.5 * dum;  // G2(nj,kl) dim
+                        A_p[g2toff[hkl] + nj*gems_ab[hkl] + kl] += 0.5 * dum;
+                    }else {
+                        A_p[g2aaoff[hkl] + nj*2*gems_ab[hkl] + kl] += dum;  // G2(nj,kl) dim
+                    }
                     
                 }
 
@@ -1067,7 +1146,7 @@ void v2RDMSolver::T1_constraints_ATu(SharedVector A,SharedVector u){
                 int m = bas_aaa_sym[h][lmn][1];
                 int n = bas_aaa_sym[h][lmn][2];
 
-                double dum = u_p[offset + ijk*trip_aaa[h] + lmn];
+                auto dum = u_p[offset + ijk*trip_aaa[h] + lmn];
 
                 A_p[t1bbboff[h] + ijk*trip_aaa[h]+lmn] -= dum; // - T1(ijk,lmn)
 
@@ -1133,7 +1212,12 @@ void v2RDMSolver::T1_constraints_ATu(SharedVector A,SharedVector u){
                     int hni = SymmetryPair(symmetry[n],symmetry[i]);
                     int ni = ibas_ab_sym[hni][n][i];
                     int jl = ibas_ab_sym[hni][j][l];
-                    A_p[g2aaoff[hni] + (ni+gems_ab[hni])*2*gems_ab[hni] + (jl+gems_ab[hni])] += dum;  // G2(ni,jl) dkm
+                    if ( spin_adapt_g2_ ) {
+                        A_p[g2soff[hni] + ni*gems_ab[hni] + jl] += 0.5 * dum;  // G2(ni,jl) dkm
+                        A_p[g2toff[hni] + ni*gems_ab[hni] + jl] += 0.5 * dum;
+                    }else {
+                        A_p[g2aaoff[hni] + (ni+gems_ab[hni])*2*gems_ab[hni] + (jl+gems_ab[hni])] += dum;  // G2(ni,jl) dkm
+                    }
                     
                 }
 
@@ -1147,7 +1231,12 @@ void v2RDMSolver::T1_constraints_ATu(SharedVector A,SharedVector u){
                     int hni = SymmetryPair(symmetry[n],symmetry[i]);
                     int ni = ibas_ab_sym[hni][n][i];
                     int kl = ibas_ab_sym[hni][k][l];
-                    A_p[g2aaoff[hni] + (ni+gems_ab[hni])*2*gems_ab[hni] + (kl+gems_ab[hni])] -= dum;  // -G2(ni,kl) djm
+                    if ( spin_adapt_g2_ ) {
+                        A_p[g2soff[hni] + ni*gems_ab[hni] + kl] -= 0.5 * dum;  // -G2(ni,kl) djm
+                        A_p[g2toff[hni] + ni*gems_ab[hni] + kl] -= 0.5 * dum;
+                    }else {
+                        A_p[g2aaoff[hni] + (ni+gems_ab[hni])*2*gems_ab[hni] + (kl+gems_ab[hni])] -= dum;  // -G2(ni,kl) djm
+                    }
                     
                 }
 
@@ -1161,7 +1250,12 @@ void v2RDMSolver::T1_constraints_ATu(SharedVector A,SharedVector u){
                     int hkl = SymmetryPair(symmetry[k],symmetry[l]);
                     int nj = ibas_ab_sym[hkl][n][j];
                     int kl = ibas_ab_sym[hkl][k][l];
-                    A_p[g2aaoff[hkl] + (nj+gems_ab[hkl])*2*gems_ab[hkl] + (kl+gems_ab[hkl])] += dum;  // G2(nj,kl) dim
+                    if ( spin_adapt_g2_ ) {
+                        A_p[g2soff[hkl] + nj*gems_ab[hkl] + kl] += 0.5 * dum;  // G2(nj,kl) dim
+                        A_p[g2toff[hkl] + nj*gems_ab[hkl] + kl] += 0.5 * dum;
+                    }else {
+                        A_p[g2aaoff[hkl] + (nj+gems_ab[hkl])*2*gems_ab[hkl] + (kl+gems_ab[hkl])] += dum;  // G2(nj,kl) dim
+                    }
                     
                 }
 
@@ -1170,6 +1264,12 @@ void v2RDMSolver::T1_constraints_ATu(SharedVector A,SharedVector u){
         offset += trip_aaa[h]*trip_aaa[h];
 
     }
+
+    return offset;
 }
 
+// instantiations used by RecordConstraints and bpsdp_ATu_tasks
+template long int v2RDMSolver::T1_constraints_ATu<SparseTarget,SparseSource>(SparseTarget A_p,SparseSource u_p);
+template long int v2RDMSolver::T1_constraints_ATu<double*,double*>(double* A_p,double* u_p);
+
 }} // end namespaces
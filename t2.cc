@@ -55,6 +55,7 @@ namespace psi{ namespace v2rdm_casscf{
 
 // T2 portion of A.u 
 void v2RDMSolver::T2_constraints_Au(SharedVector A,SharedVector u){
+    long int offset = t2_constraints_offset_;
 
     double * A_p = A->pointer();
     double * u_p = u->pointer();
@@ -444,7 +445,7 @@ void v2RDMSolver::T2_constraints_Au(SharedVector A,SharedVector u){
                 int n = k;
                 int hln  = SymmetryPair(symmetry[n],symmetry[l]);
                 int hm  = SymmetryPair(h,hln);
-                for (int m = ( l + 1 > pitzer_offset[hm] ? l : pitzer_offset[hm] ); m < pitzer_offset[hm]+amopi_[hm]; m++) {
+                for (int m = ( l + 1 > pitzer_offset[hm] ? l + 1 : pitzer_offset[hm] ); m < pitzer_offset[hm]+amopi_[hm]; m++) {
                     int lm = ibas_aa_sym[hij][l][m];
                     int lmn  = ibas_aab_sym[h][l][m][n];
 
@@ -656,7 +657,7 @@ void v2RDMSolver::T2_constraints_Au(SharedVector A,SharedVector u){
                     int jn = ibas_ab_sym[hkm][j][n];
                     int lmn  = ibas_aba_sym[h][l][m][n];
                     A_p[ijk_id + (trip_aab[h] + lmn)] += u_p[d2aboff[hkm]+jn*gems_ab[hkm]+km]; // D2(jn,km) dil
-                    A_p[offset + (trip_aab[h] + lmn)*(trip_aab[h]+trip_aba[h]) + ijk] += u_p[d2aboff[hkm]+jn*gems_ab[hkm]+km]; // D2(jn,km) dil
+                    A_p[offset + (trip_aab[h] + lmn)*(trip_aab[h]+trip_aba[h]) + ijk] += u_p[d2aboff[hkm]+km*gems_ab[hkm]+jn]; // D2(km,jn) dil
                 }
             }
             for (int m = 0; m < amo_; m++) {
@@ -669,7 +670,7 @@ void v2RDMSolver::T2_constraints_Au(SharedVector A,SharedVector u){
                     int in = ibas_ab_sym[hkm][i][n];
                     int lmn  = ibas_aba_sym[h][l][m][n];
                     A_p[ijk_id + (trip_aab[h] + lmn)] -= u_p[d2aboff[hkm]+in*gems_ab[hkm]+km]; // -D2(in,km) djl
-                    A_p[offset + (trip_aab[h] + lmn)*(trip_aab[h]+trip_aba[h]) + ijk] -= u_p[d2aboff[hkm]+in*gems_ab[hkm]+km]; // -D2(in,km) djl
+                    A_p[offset + (trip_aab[h] + lmn)*(trip_aab[h]+trip_aba[h]) + ijk] -= u_p[d2aboff[hkm]+km*gems_ab[hkm]+in]; // -D2(km,in) djl
                 }
             }
         }
@@ -884,7 +885,7 @@ void v2RDMSolver::T2_constraints_Au(SharedVector A,SharedVector u){
                 int n = k;
                 int hln  = SymmetryPair(symmetry[n],symmetry[l]);
                 int hm  = SymmetryPair(h,hln);
-                for (int m = ( l + 1 > pitzer_offset[hm] ? l : pitzer_offset[hm] ); m < pitzer_offset[hm]+amopi_[hm]; m++) {
+                for (int m = ( l + 1 > pitzer_offset[hm] ? l + 1 : pitzer_offset[hm] ); m < pitzer_offset[hm]+amopi_[hm]; m++) {
                     int lm = ibas_aa_sym[hij][l][m];
                     int lmn  = ibas_aab_sym[h][l][m][n];
 
@@ -1096,7 +1097,7 @@ void v2RDMSolver::T2_constraints_Au(SharedVector A,SharedVector u){
                     int jn = ibas_ab_sym[hkm][n][j];
                     int lmn  = ibas_aba_sym[h][l][m][n];
                     A_p[ijk_id + (trip_aab[h] + lmn)] += u_p[d2aboff[hkm]+jn*gems_ab[hkm]+km]; // D2(jn,km) dil
-                    A_p[offset + (trip_aab[h] + lmn)*(trip_aab[h]+trip_aba[h]) + ijk] += u_p[d2aboff[hkm]+jn*gems_ab[hkm]+km]; // D2(jn,km) dil
+                    A_p[offset + (trip_aab[h] + lmn)*(trip_aab[h]+trip_aba[h]) + ijk] += u_p[d2aboff[hkm]+km*gems_ab[hkm]+jn]; // D2(km,jn) dil
                 }
             }
             for (int m = 0; m < amo_; m++) {
@@ -1109,7 +1110,7 @@ void v2RDMSolver::T2_constraints_Au(SharedVector A,SharedVector u){
                     int in = ibas_ab_sym[hkm][n][i];
                     int lmn  = ibas_aba_sym[h][l][m][n];
                     A_p[ijk_id + (trip_aab[h] + lmn)] -= u_p[d2aboff[hkm]+in*gems_ab[hkm]+km]; // -D2(in,km) djl
-                    A_p[offset + (trip_aab[h] + lmn)*(trip_aab[h]+trip_aba[h]) + ijk] -= u_p[d2aboff[hkm]+in*gems_ab[hkm]+km]; // -D2(in,km) djl
+                    A_p[offset + (trip_aab[h] + lmn)*(trip_aab[h]+trip_aba[h]) + ijk] -= u_p[d2aboff[hkm]+km*gems_ab[hkm]+in]; // -D2(km,in) djl
                 }
             }
         }
@@ -1191,53 +1192,57 @@ void v2RDMSolver::T2_constraints_Au(SharedVector A,SharedVector u){
             int j = bas_aba_sym[h][ijk][1];
             int k = bas_aba_sym[h][ijk][2];
 
-            for (int lmn = 0; lmn < trip_aba[h]; lmn++) {
-
-                int l = bas_aba_sym[h][lmn][0];
-                int m = bas_aba_sym[h][lmn][1];
-                int n = bas_aba_sym[h][lmn][2];
-
-                int id = (ijk+trip_aab[h])*(trip_aab[h]+trip_aba[h])+(lmn+trip_aab[h]);
-
-                double dum = 0.0;//-u_p[t2bbboff[h] + id]; // - T2(ijk,lmn)
-
-                if ( k == n ) {
-                    int hij = SymmetryPair(symmetry[i],symmetry[j]);
-                    int ij = ibas_ab_sym[hij][j][i];
-                    int lm = ibas_ab_sym[hij][m][l];
-                    dum += u_p[d2aboff[hij] + ij*gems_ab[hij]+lm]; // + D2(ij,lm) dkn
-                }
-
-                if ( j == m && i == l ) {
-                    int h2 = symmetry[k];
-                    int kk = k - pitzer_offset[h2];
-                    int nn = n - pitzer_offset[h2];
-                    dum += u_p[d1aoff[h2] + nn*amopi_[h2]+kk]; // + D1(n,k) djm dil
-                }
-
-                if ( i == l ) {
-                    if ( n != j && k != m ) {
-                        int hnj = SymmetryPair(symmetry[n],symmetry[j]);
-                        int nj = ibas_aa_sym[hnj][n][j];
-                        int km = ibas_aa_sym[hnj][k][m];
-
-                        int s = 1;
-                        if ( n > j ) s = -s;
-                        if ( k > m ) s = -s;
+            int ijk_id = offset + (ijk+trip_aab[h])*(trip_aab[h]+trip_aba[h]);
+            int hij = SymmetryPair(symmetry[i],symmetry[j]);
+            int ij = ibas_ab_sym[hij][j][i];
+            for (int lm = 0; lm < gems_ab[hij]; lm++) {
+                int m = bas_ab_sym[hij][lm][0];
+                int l = bas_ab_sym[hij][lm][1];
+                int n = k;
+                int lmn = ibas_aba_sym[h][l][m][n];
+                A_p[ijk_id + (trip_aab[h] + lmn)] += u_p[d2aboff[hij] + ij*gems_ab[hij]+lm]; // + D2(ij,lm) dkn
+            }
 
-                        dum -= s * u_p[d2aaoff[hnj] + nj*gems_aa[hnj]+km]; // - D2(nj,km) dil
-                    }
+            for (int l = 0; l < amo_; l++) {
+                int hlk = SymmetryPair(symmetry[k],symmetry[l]);
+                int lk = ibas_ab_sym[hlk][k][l];
+                int m = j;
+                int hlm = SymmetryPair(symmetry[l],symmetry[m]);
+                int hn = SymmetryPair(h,hlm);
+                for (int n = pitzer_offset[hn]; n < pitzer_offset[hn]+amopi_[hn]; n++) {
+                    int ni = ibas_ab_sym[hlk][n][i];
+                    int lmn = ibas_aba_sym[h][l][m][n];
+                    A_p[ijk_id + (trip_aab[h] + lmn)] -= u_p[d2aboff[hlk] + ni*gems_ab[hlk]+lk]; // -D2(ni,kl) djm
                 }
-                if ( j == m ) {
-                    int hni = SymmetryPair(symmetry[n],symmetry[i]);
-                    int ni = ibas_ab_sym[hni][n][i];
-                    int kl = ibas_ab_sym[hni][k][l];
-                    dum -= u_p[d2aboff[hni] + ni*gems_ab[hni]+kl]; // -D2(ni,kl) djm
+            }
+            for (int m = 0; m < amo_; m++) {
+                if ( k == m ) continue;
+                int hkm = SymmetryPair(symmetry[k],symmetry[m]);
+                int km = ibas_aa_sym[hkm][k][m];
+                int l = i;
+                int hlm = SymmetryPair(symmetry[l],symmetry[m]);
+                int hn = SymmetryPair(h,hlm);
+                int s1 = 1;
+                if ( k > m ) s1 = -s1;
+                for (int n = pitzer_offset[hn]; n < pitzer_offset[hn]+amopi_[hn]; n++) {
+                    if ( n == j ) continue;
+                    int nj = ibas_aa_sym[hkm][n][j];
+                    int lmn = ibas_aba_sym[h][l][m][n];
+                    int s2 = s1;
+                    if ( n > j ) s2 = -s2;
+                    A_p[ijk_id + (trip_aab[h] + lmn)] -= s2 * u_p[d2aaoff[hkm] + nj*gems_aa[hkm]+km]; // - D2(nj,km) dil
                 }
-    
-                A_p[offset + id] = dum;
-
             }
+            int m = j;
+            int l = i;
+            int hk = symmetry[k];
+            int kk = k - pitzer_offset[hk];
+            for (int n = pitzer_offset[hk]; n < pitzer_offset[hk]+amopi_[hk]; n++) {
+                int nn = n - pitzer_offset[hk];
+                int lmn = ibas_aba_sym[h][l][m][n];
+                A_p[ijk_id + (trip_aab[h] + lmn)] += u_p[d1aoff[hk] + nn*amopi_[hk]+kk]; // + D1(n,k) djm dil
+            }
+
         }
         C_DAXPY((trip_aba[h] + trip_aab[h]) * (trip_aba[h] + trip_aab[h]), -1.0, &u_p[t2bbboff[h]],1,&A_p[offset],1);
 
@@ -1249,6 +1254,7 @@ void v2RDMSolver::T2_constraints_Au(SharedVector A,SharedVector u){
 }
 // T2 portion of A.u (slow version!)
 void v2RDMSolver::T2_constraints_Au_slow(SharedVector A,SharedVector u){
+    long int offset = t2_constraints_offset_;
 
     double * A_p = A->pointer();
     double * u_p = u->pointer();
@@ -2473,9 +2479,12 @@ void v2RDMSolver::T2_constraints_guess(SharedVector u){
 
 // T2 portion of A^T.y 
 void v2RDMSolver::T2_constraints_ATu(SharedVector A,SharedVector u){
+    T2_constraints_ATu(A->pointer(),u->pointer());
+}
 
-    double * A_p = A->pointer();
-    double * u_p = u->pointer();
+template <typename TargetType, typename SourceType>
+long int v2RDMSolver::T2_constraints_ATu(TargetType A_p,SourceType u_p){
+    long int offset = t2_constraints_offset_;
 
     int saveoff = offset;
 
@@ -2587,7 +2596,7 @@ void v2RDMSolver::T2_constraints_ATu(SharedVector A,SharedVector u){
                 A_p[d1boff[h2] + nn*amopi_[h2]+kk] += u_p[offset + ijk*trip_aab[h]+lmn]; // + D1(n,k) djm dil
             }
         }
-        C_DAXPY(trip_aab[h] * trip_aab[h], -1.0, &u_p[offset],1,&A_p[t2aaboff[h]],1);
+        C_DAXPY(trip_aab[h] * trip_aab[h], -1.0, u_p + offset,1,A_p + t2aaboff[h],1);
 
 
         /*for (int ijk = 0; ijk < trip_aab[h]; ijk++) {
@@ -2765,7 +2774,7 @@ void v2RDMSolver::T2_constraints_ATu(SharedVector A,SharedVector u){
                 A_p[d1aoff[h2] + nn*amopi_[h2]+kk] += u_p[offset + ijk*trip_aab[h]+lmn]; // + D1(n,k) djm dil
             }
         }
-        C_DAXPY(trip_aab[h] * trip_aab[h], -1.0, &u_p[offset],1,&A_p[t2bbaoff[h]],1);
+        C_DAXPY(trip_aab[h] * trip_aab[h], -1.0, u_p + offset,1,A_p + t2bbaoff[h],1);
 
         /*for (int ijk = 0; ijk < trip_aab[h]; ijk++) {
 
@@ -2850,7 +2859,7 @@ void v2RDMSolver::T2_constraints_ATu(SharedVector A,SharedVector u){
                 int n = k;
                 int hln  = SymmetryPair(symmetry[n],symmetry[l]);
                 int hm  = SymmetryPair(h,hln);
-                for (int m = ( l + 1 > pitzer_offset[hm] ? l : pitzer_offset[hm] ); m < pitzer_offset[hm]+amopi_[hm]; m++) {
+                for (int m = ( l + 1 > pitzer_offset[hm] ? l + 1 : pitzer_offset[hm] ); m < pitzer_offset[hm]+amopi_[hm]; m++) {
                     int lm = ibas_aa_sym[hij][l][m];
                     int lmn  = ibas_aab_sym[h][l][m][n];
 
@@ -3038,38 +3047,39 @@ void v2RDMSolver::T2_constraints_ATu(SharedVector A,SharedVector u){
                 }
             }
         }*/
-        // T2aaa/abb
+        // T2aaa/abb (and T2abb/aaa)
         for (int ijk = 0; ijk < trip_aab[h]; ijk++) {
 
             int i = bas_aab_sym[h][ijk][0];
             int j = bas_aab_sym[h][ijk][1];
             int k = bas_aab_sym[h][ijk][2];
 
-            for (int lmn = 0; lmn < trip_aba[h]; lmn++) {
-
-                int l = bas_aba_sym[h][lmn][0];
-                int m = bas_aba_sym[h][lmn][1];
-                int n = bas_aba_sym[h][lmn][2];
-
-                int id = ijk*(trip_aab[h]+trip_aba[h])+(lmn+trip_aab[h]);
-                double dum = u_p[offset + id];
-
-                int id2 = (lmn+trip_aab[h])*(trip_aab[h]+trip_aba[h])+ijk;
-                double dum2 = u_p[offset + id2];
-
-                //A_p[t2aaaoff[h] + id] -= dum; // - T2(ijk,lmn)
+            int ijk_id = offset + ijk*(trip_aab[h]+trip_aba[h]);
 
-                if ( i == l ) {
-                    int hjn = SymmetryPair(symmetry[j],symmetry[n]);
-                    int jn = ibas_ab_sym[hjn][j][n];
-                    int km = ibas_ab_sym[hjn][k][m];
-                    A_p[d2aboff[hjn]+jn*gems_ab[hjn]+km] += dum + dum2; // D2(jn,km) dil
+            for (int m = 0; m < amo_; m++) {
+                int l = i;
+                int hml = SymmetryPair(symmetry[m],symmetry[l]);
+                int hkm = SymmetryPair(symmetry[m],symmetry[k]);
+                int hn  = SymmetryPair(h,hml);
+                int km = ibas_ab_sym[hkm][k][m];
+                for (int n = pitzer_offset[hn]; n < pitzer_offset[hn]+amopi_[hn]; n++) {
+                    int jn = ibas_ab_sym[hkm][j][n];
+                    int lmn  = ibas_aba_sym[h][l][m][n];
+                    A_p[d2aboff[hkm]+jn*gems_ab[hkm]+km] += u_p[ijk_id + (trip_aab[h] + lmn)]; // D2(jn,km) dil
+                    A_p[d2aboff[hkm]+km*gems_ab[hkm]+jn] += u_p[offset + (trip_aab[h] + lmn)*(trip_aab[h]+trip_aba[h]) + ijk]; // D2(km,jn) dil
                 }
-                if ( j == l ) {
-                    int hin = SymmetryPair(symmetry[i],symmetry[n]);
-                    int in = ibas_ab_sym[hin][i][n];
-                    int km = ibas_ab_sym[hin][k][m];
-                    A_p[d2aboff[hin]+in*gems_ab[hin]+km] -= dum + dum2; // -D2(in,km) djl
+            }
+            for (int m = 0; m < amo_; m++) {
+                int l = j;
+                int hml = SymmetryPair(symmetry[m],symmetry[l]);
+                int hkm = SymmetryPair(symmetry[m],symmetry[k]);
+                int hn  = SymmetryPair(h,hml);
+                int km = ibas_ab_sym[hkm][k][m];
+                for (int n = pitzer_offset[hn]; n < pitzer_offset[hn]+amopi_[hn]; n++) {
+                    int in = ibas_ab_sym[hkm][i][n];
+                    int lmn  = ibas_aba_sym[h][l][m][n];
+                    A_p[d2aboff[hkm]+in*gems_ab[hkm]+km] -= u_p[ijk_id + (trip_aab[h] + lmn)]; // -D2(in,km) djl
+                    A_p[d2aboff[hkm]+km*gems_ab[hkm]+in] -= u_p[offset + (trip_aab[h] + lmn)*(trip_aab[h]+trip_aba[h]) + ijk]; // -D2(km,in) djl
                 }
             }
         }
@@ -3115,54 +3125,59 @@ void v2RDMSolver::T2_constraints_ATu(SharedVector A,SharedVector u){
             int j = bas_aba_sym[h][ijk][1];
             int k = bas_aba_sym[h][ijk][2];
 
-            for (int lmn = 0; lmn < trip_aba[h]; lmn++) {
-
-                int l = bas_aba_sym[h][lmn][0];
-                int m = bas_aba_sym[h][lmn][1];
-                int n = bas_aba_sym[h][lmn][2];
-
-                int id = (ijk+trip_aab[h])*(trip_aab[h]+trip_aba[h])+(lmn+trip_aab[h]);
-
-                double dum = u_p[offset + id];
-
-                //A_p[t2aaaoff[h] + id] -= dum; // - T2(ijk,lmn)
-
-                if ( k == n ) {
-                    int hij = SymmetryPair(symmetry[i],symmetry[j]);
-                    int ij = ibas_ab_sym[hij][i][j];
-                    int lm = ibas_ab_sym[hij][l][m];
-                    A_p[d2aboff[hij] + ij*gems_ab[hij]+lm] += dum; // + D2(ij,lm) dkn
-                }
-
-                if ( j == m && i == l ) {
-                    int h2 = symmetry[k];
-                    int kk = k - pitzer_offset[h2];
-                    int nn = n - pitzer_offset[h2];
-                    A_p[d1boff[h2] + nn*amopi_[h2]+kk] += dum; // + D1(n,k) djm dil
-                }
-
-                if ( i == l ) {
-                    if ( n != j && k != m ) {
-                        int hnj = SymmetryPair(symmetry[n],symmetry[j]);
-                        int nj = ibas_aa_sym[hnj][n][j];
-                        int km = ibas_aa_sym[hnj][k][m];
-
-                        int s = 1;
-                        if ( n > j ) s = -s;
-                        if ( k > m ) s = -s;
+            int ijk_id = offset + (ijk+trip_aab[h])*(trip_aab[h]+trip_aba[h]);
+            int hij = SymmetryPair(symmetry[i],symmetry[j]);
+            int ij = ibas_ab_sym[hij][i][j];
+            for (int lm = 0; lm < gems_ab[hij]; lm++) {
+                int l = bas_ab_sym[hij][lm][0];
+                int m = bas_ab_sym[hij][lm][1];
+                int n = k;
+                int lmn = ibas_aba_sym[h][l][m][n];
+                A_p[d2aboff[hij] + ij*gems_ab[hij]+lm] += u_p[ijk_id + (trip_aab[h] + lmn)]; // + D2(ij,lm) dkn
+            }
 
-                        A_p[d2bboff[hnj] + nj*gems_aa[hnj]+km] -= s * dum; // - D2(nj,km) dil
-                    }
+            for (int l = 0; l < amo_; l++) {
+                int hlk = SymmetryPair(symmetry[k],symmetry[l]);
+                int lk = ibas_ab_sym[hlk][l][k];
+                int m = j;
+                int hlm = SymmetryPair(symmetry[l],symmetry[m]);
+                int hn = SymmetryPair(h,hlm);
+                for (int n = pitzer_offset[hn]; n < pitzer_offset[hn]+amopi_[hn]; n++) {
+                    int ni = ibas_ab_sym[hlk][i][n];
+                    int lmn = ibas_aba_sym[h][l][m][n];
+                    A_p[d2aboff[hlk] + ni*gems_ab[hlk]+lk] -= u_p[ijk_id + (trip_aab[h] + lmn)]; // -D2(ni,kl) djm
                 }
-                if ( j == m ) {
-                    int hni = SymmetryPair(symmetry[n],symmetry[i]);
-                    int ni = ibas_ab_sym[hni][i][n];
-                    int kl = ibas_ab_sym[hni][l][k];
-                    A_p[d2aboff[hni] + ni*gems_ab[hni]+kl] -= dum; // -D2(ni,kl) djm
+            }
+            for (int m = 0; m < amo_; m++) {
+                if ( k == m ) continue;
+                int hkm = SymmetryPair(symmetry[k],symmetry[m]);
+                int km = ibas_aa_sym[hkm][k][m];
+                int l = i;
+                int hlm = SymmetryPair(symmetry[l],symmetry[m]);
+                int hn = SymmetryPair(h,hlm);
+                int s1 = 1;
+                if ( k > m ) s1 = -s1;
+                for (int n = pitzer_offset[hn]; n < pitzer_offset[hn]+amopi_[hn]; n++) {
+                    if ( n == j ) continue;
+                    int nj = ibas_aa_sym[hkm][n][j];
+                    int lmn = ibas_aba_sym[h][l][m][n];
+                    int s2 = s1;
+                    if ( n > j ) s2 = -s2;
+                    A_p[d2bboff[hkm] + nj*gems_aa[hkm]+km] -= s2 * u_p[ijk_id + (trip_aab[h] + lmn)]; // - D2(nj,km) dil
                 }
             }
+            int m = j;
+            int l = i;
+            int hk = symmetry[k];
+            int kk = k - pitzer_offset[hk];
+            for (int n = pitzer_offset[hk]; n < pitzer_offset[hk]+amopi_[hk]; n++) {
+                int nn = n - pitzer_offset[hk];
+                int lmn = ibas_aba_sym[h][l][m][n];
+                A_p[d1boff[hk] + nn*amopi_[hk]+kk] += u_p[ijk_id + (trip_aab[h] + lmn)]; // + D1(n,k) djm dil
+            }
+
         }
-        C_DAXPY((trip_aba[h] + trip_aab[h]) * (trip_aba[h] + trip_aab[h]), -1.0, &u_p[offset],1,&A_p[t2aaaoff[h]],1);
+        C_DAXPY((trip_aba[h] + trip_aab[h]) * (trip_aba[h] + trip_aab[h]), -1.0, u_p + offset,1,A_p + t2aaaoff[h],1);
         offset += (trip_aba[h]+trip_aab[h])*(trip_aba[h]+trip_aab[h]);
         //offset += trip_aab[h]*trip_aab[h];
     }
@@ -3176,126 +3191,143 @@ void v2RDMSolver::T2_constraints_ATu(SharedVector A,SharedVector u){
             int i = bas_aab_sym[h][ijk][0];
             int j = bas_aab_sym[h][ijk][1];
             int k = bas_aab_sym[h][ijk][2];
+            int hij = SymmetryPair(symmetry[i],symmetry[j]);
+            int ij = ibas_aa_sym[hij][i][j];
+            int ijk_id = offset + ijk*(trip_aab[h]+trip_aba[h]);
 
-            for (int lmn = 0; lmn < trip_aab[h]; lmn++) {
-
-                int l = bas_aab_sym[h][lmn][0];
-                int m = bas_aab_sym[h][lmn][1];
-                int n = bas_aab_sym[h][lmn][2];
-
-                int id = ijk*(trip_aab[h]+trip_aba[h])+lmn;
-                //int id = ijk*trip_aab[h]+lmn;
-
-                double dum = u_p[offset + id];
-
-                //A_p[t2bbboff[h] + id] -= dum; // - T2(ijk,lmn)
-
-                if ( k == n ) {
-                    int hij = SymmetryPair(symmetry[i],symmetry[j]);
-                    int ij = ibas_aa_sym[hij][i][j];
+            for (int l = 0; l < amo_; l++) {
+                int n = k;
+                int hln  = SymmetryPair(symmetry[n],symmetry[l]);
+                int hm  = SymmetryPair(h,hln);
+                for (int m = ( l + 1 > pitzer_offset[hm] ? l + 1 : pitzer_offset[hm] ); m < pitzer_offset[hm]+amopi_[hm]; m++) {
                     int lm = ibas_aa_sym[hij][l][m];
-                    A_p[d2bboff[hij] + ij*gems_aa[hij]+lm] += dum; // + D2(ij,lm) dkn
-                }
+                    int lmn  = ibas_aab_sym[h][l][m][n];
 
-                if ( j == m && i == l ) {
-                    int h2 = symmetry[k];
-                    int kk = k - pitzer_offset[h2];
-                    int nn = n - pitzer_offset[h2];
-                    A_p[d1boff[h2] + nn*amopi_[h2]+kk] += dum; // + D1(n,k) djm dil
+                    A_p[d2bboff[hij] + ij*gems_aa[hij]+lm] += u_p[ijk_id + lmn]; // + D2(ij,lm) dkn
                 }
-                if ( j == l && i == m ) {
-                    int h2 = symmetry[k];
-                    int kk = k - pitzer_offset[h2];
-                    int nn = n - pitzer_offset[h2];
-                    A_p[d1boff[h2] + nn*amopi_[h2]+kk] -= dum; // - D1(n,k) djl dim
-                }
-
-                if ( i == l ) {
-                    if ( n != j && k != m ) {
-                        int hnj = SymmetryPair(symmetry[n],symmetry[j]);
-                        int nj = ibas_aa_sym[hnj][n][j];
-                        int km = ibas_aa_sym[hnj][k][m];
+            }
 
-                        int s = 1;
-                        if ( n > j ) s = -s;
-                        if ( k > m ) s = -s;
+            for (int m = i+1; m < amo_; m++) {
+                if ( k == m ) continue;
+                int l = i;
+                int hml = SymmetryPair(symmetry[m],symmetry[l]);
+                int hkm = SymmetryPair(symmetry[m],symmetry[k]);
+                int hn  = SymmetryPair(h,hml);
+                int km = ibas_aa_sym[hkm][k][m];
+                int s1 = 1;
+                if ( k > m ) s1 = -s1;
+                for (int n = pitzer_offset[hn]; n < pitzer_offset[hn]+amopi_[hn]; n++) {
+                    if ( j == n ) continue;
+                    int s2 = s1;
+                    if ( n > j ) s2 = -s2;
 
-                        A_p[d2bboff[hnj] + nj*gems_aa[hnj]+km] -= s * dum; // - D2(nj,km) dil
-                    }
+                    int nj   = ibas_aa_sym[hkm][n][j];
+                    int lmn  = ibas_aab_sym[h][l][m][n];
+                    A_p[d2bboff[hkm] + nj*gems_aa[hkm]+km] -= s2 * u_p[ijk_id + lmn]; // - D2(nj,km) dil
                 }
-                if ( j == l ) {
-                    if ( n != i && k != m ) {
-                        int hni = SymmetryPair(symmetry[n],symmetry[i]);
-                        int ni = ibas_aa_sym[hni][n][i];
-                        int km = ibas_aa_sym[hni][k][m];
+            }
+            for (int m = j+1; m < amo_; m++) {
+                if ( k == m ) continue;
+                int l = j;
+                int hml = SymmetryPair(symmetry[m],symmetry[l]);
+                int hkm = SymmetryPair(symmetry[m],symmetry[k]);
+                int hn  = SymmetryPair(h,hml);
+                int km = ibas_aa_sym[hkm][k][m];
+                int s1 = 1;
+                if ( k > m ) s1 = -s1;
+                for (int n = pitzer_offset[hn]; n < pitzer_offset[hn]+amopi_[hn]; n++) {
+                    if ( i == n ) continue;
+                    int s2 = s1;
+                    if ( n > i ) s2 = -s2;
 
-                        int s = 1;
-                        if ( n > i ) s = -s;
-                        if ( k > m ) s = -s;
+                    int ni   = ibas_aa_sym[hkm][n][i];
+                    int lmn  = ibas_aab_sym[h][l][m][n];
 
-                        A_p[d2bboff[hni] + ni*gems_aa[hni]+km] += s * dum; // D2(ni,km) djl
-                    }
+                    A_p[d2bboff[hkm] + ni*gems_aa[hkm]+km] += s2 * u_p[ijk_id + lmn]; // D2(ni,km) djl
                 }
-                if ( i == m ) {
-                    if ( n != j && k != l ) {
-                        int hnj = SymmetryPair(symmetry[n],symmetry[j]);
-                        int nj = ibas_aa_sym[hnj][n][j];
-                        int kl = ibas_aa_sym[hnj][k][l];
-
-                        int s = 1;
-                        if ( n > j ) s = -s;
-                        if ( k > l ) s = -s;
+            }
+            for (int l = 0; l < i; l++) {
+                if ( k == l ) continue;
+                int m = i;
+                int hml = SymmetryPair(symmetry[m],symmetry[l]);
+                int hkl = SymmetryPair(symmetry[l],symmetry[k]);
+                int hn  = SymmetryPair(h,hml);
+                int kl = ibas_aa_sym[hkl][k][l];
+                int s1 = 1;
+                if ( k > l ) s1 = -s1;
+                for (int n = pitzer_offset[hn]; n < pitzer_offset[hn]+amopi_[hn]; n++) {
+                    if ( j == n ) continue;
+                    int s2 = s1;
+                    if ( n > j ) s2 = -s2;
 
-                        A_p[d2bboff[hnj] + nj*gems_aa[hnj]+kl] += s * dum; // D2(nj,kl) dim
-                    }
+                    int nj   = ibas_aa_sym[hkl][n][j];
+                    int lmn  = ibas_aab_sym[h][l][m][n];
+                    A_p[d2bboff[hkl] + nj*gems_aa[hkl]+kl] += s2 * u_p[ijk_id + lmn]; // D2(nj,kl) dim
                 }
-                if ( j == m ) {
-                    if ( n != i && k != l ) {
-                        int hni = SymmetryPair(symmetry[n],symmetry[i]);
-                        int ni = ibas_aa_sym[hni][n][i];
-                        int kl = ibas_aa_sym[hni][k][l];
-
-                        int s = 1;
-                        if ( n > i ) s = -s;
-                        if ( k > l ) s = -s;
+            }
+            for (int l = 0; l < j; l++) {
+                if ( k == l ) continue;
+                int m = j;
+                int hml = SymmetryPair(symmetry[m],symmetry[l]);
+                int hkl = SymmetryPair(symmetry[l],symmetry[k]);
+                int hn  = SymmetryPair(h,hml);
+                int kl = ibas_aa_sym[hkl][k][l];
+                int s1 = 1;
+                if ( k > l ) s1 = -s1;
+                for (int n = pitzer_offset[hn]; n < pitzer_offset[hn]+amopi_[hn]; n++) {
+                    if ( i == n ) continue;
+                    int s2 = s1;
+                    if ( n > i ) s2 = -s2;
 
-                        A_p[d2bboff[hni] + ni*gems_aa[hni]+kl] -= s * dum; // -D2(ni,kl) djm
-                    }
+                    int ni   = ibas_aa_sym[hkl][n][i];
+                    int lmn  = ibas_aab_sym[h][l][m][n];
+                    A_p[d2bboff[hkl] + ni*gems_aa[hkl]+kl] -= s2 * u_p[ijk_id + lmn]; // -D2(ni,kl) djm
                 }
             }
+            int hk = symmetry[k];
+            int kk = k - pitzer_offset[hk];
+            int m = j;
+            int l = i;
+            for (int n = pitzer_offset[hk]; n < pitzer_offset[hk] + amopi_[hk]; n++) {
+                int nn = n - pitzer_offset[hk];
+                int lmn  = ibas_aab_sym[h][l][m][n];
+                A_p[d1boff[hk] + nn*amopi_[hk]+kk] += u_p[ijk_id + lmn]; // + D1(n,k) djm dil
+            }
         }
-        // T2bbb/baa
+
+        // T2bbb/baa (and T2baa/bbb)
         for (int ijk = 0; ijk < trip_aab[h]; ijk++) {
 
             int i = bas_aab_sym[h][ijk][0];
             int j = bas_aab_sym[h][ijk][1];
             int k = bas_aab_sym[h][ijk][2];
 
-            for (int lmn = 0; lmn < trip_aba[h]; lmn++) {
-
-                int l = bas_aba_sym[h][lmn][0];
-                int m = bas_aba_sym[h][lmn][1];
-                int n = bas_aba_sym[h][lmn][2];
-
-                int id = ijk*(trip_aab[h]+trip_aba[h])+(lmn+trip_aab[h]);
-                double dum = u_p[offset + id];
-
-                int id2 = (lmn+trip_aab[h])*(trip_aab[h]+trip_aba[h])+ijk;
-                double dum2 = u_p[offset + id2];
-
-                //A_p[t2bbboff[h] + id] -= dum; // - T2(ijk,lmn)
+            int ijk_id = offset + ijk*(trip_aab[h]+trip_aba[h]);
 
-                if ( i == l ) {
-                    int hjn = SymmetryPair(symmetry[j],symmetry[n]);
-                    int jn = ibas_ab_sym[hjn][n][j];
-                    int km = ibas_ab_sym[hjn][m][k];
-                    A_p[d2aboff[hjn]+jn*gems_ab[hjn]+km] += dum + dum2; // D2(jn,km) dil
+            for (int m = 0; m < amo_; m++) {
+                int l = i;
+                int hml = SymmetryPair(symmetry[m],symmetry[l]);
+                int hkm = SymmetryPair(symmetry[m],symmetry[k]);
+                int hn  = SymmetryPair(h,hml);
+                int km = ibas_ab_sym[hkm][m][k];
+                for (int n = pitzer_offset[hn]; n < pitzer_offset[hn]+amopi_[hn]; n++) {
+                    int jn = ibas_ab_sym[hkm][n][j];
+                    int lmn  = ibas_aba_sym[h][l][m][n];
+                    A_p[d2aboff[hkm]+jn*gems_ab[hkm]+km] += u_p[ijk_id + (trip_aab[h] + lmn)]; // D2(jn,km) dil
+                    A_p[d2aboff[hkm]+km*gems_ab[hkm]+jn] += u_p[offset + (trip_aab[h] + lmn)*(trip_aab[h]+trip_aba[h]) + ijk]; // D2(km,jn) dil
                 }
-                if ( j == l ) {
-                    int hin = SymmetryPair(symmetry[i],symmetry[n]);
-                    int in = ibas_ab_sym[hin][n][i];
-                    int km = ibas_ab_sym[hin][m][k];
-                    A_p[d2aboff[hin]+in*gems_ab[hin]+km] -= dum + dum2; // -D2(in,km) djl
+            }
+            for (int m = 0; m < amo_; m++) {
+                int l = j;
+                int hml = SymmetryPair(symmetry[m],symmetry[l]);
+                int hkm = SymmetryPair(symmetry[m],symmetry[k]);
+                int hn  = SymmetryPair(h,hml);
+                int km = ibas_ab_sym[hkm][m][k];
+                for (int n = pitzer_offset[hn]; n < pitzer_offset[hn]+amopi_[hn]; n++) {
+                    int in = ibas_ab_sym[hkm][n][i];
+                    int lmn  = ibas_aba_sym[h][l][m][n];
+                    A_p[d2aboff[hkm]+in*gems_ab[hkm]+km] -= u_p[ijk_id + (trip_aab[h] + lmn)]; // -D2(in,km) djl
+                    A_p[d2aboff[hkm]+km*gems_ab[hkm]+in] -= u_p[offset + (trip_aab[h] + lmn)*(trip_aab[h]+trip_aba[h]) + ijk]; // -D2(km,in) djl
                 }
             }
         }
@@ -3341,65 +3373,74 @@ void v2RDMSolver::T2_constraints_ATu(SharedVector A,SharedVector u){
             int j = bas_aba_sym[h][ijk][1];
             int k = bas_aba_sym[h][ijk][2];
 
-            for (int lmn = 0; lmn < trip_aba[h]; lmn++) {
-
-                int l = bas_aba_sym[h][lmn][0];
-                int m = bas_aba_sym[h][lmn][1];
-                int n = bas_aba_sym[h][lmn][2];
-
-                int id = (ijk+trip_aab[h])*(trip_aab[h]+trip_aba[h])+(lmn+trip_aab[h]);
-
-                double dum = u_p[offset + id];
-
-                ///A_p[t2bbboff[h] + id] -= dum; // - T2(ijk,lmn)
-
-                if ( k == n ) {
-                    int hij = SymmetryPair(symmetry[i],symmetry[j]);
-                    int ij = ibas_ab_sym[hij][j][i];
-                    int lm = ibas_ab_sym[hij][m][l];
-                    A_p[d2aboff[hij] + ij*gems_ab[hij]+lm] += dum; // + D2(ij,lm) dkn
-                }
-
-                if ( j == m && i == l ) {
-                    int h2 = symmetry[k];
-                    int kk = k - pitzer_offset[h2];
-                    int nn = n - pitzer_offset[h2];
-                    A_p[d1aoff[h2] + nn*amopi_[h2]+kk] += dum; // + D1(n,k) djm dil
-                }
-
-                if ( i == l ) {
-                    if ( n != j && k != m ) {
-                        int hnj = SymmetryPair(symmetry[n],symmetry[j]);
-                        int nj = ibas_aa_sym[hnj][n][j];
-                        int km = ibas_aa_sym[hnj][k][m];
-
-                        int s = 1;
-                        if ( n > j ) s = -s;
-                        if ( k > m ) s = -s;
+            int ijk_id = offset + (ijk+trip_aab[h])*(trip_aab[h]+trip_aba[h]);
+            int hij = SymmetryPair(symmetry[i],symmetry[j]);
+            int ij = ibas_ab_sym[hij][j][i];
+            for (int lm = 0; lm < gems_ab[hij]; lm++) {
+                int m = bas_ab_sym[hij][lm][0];
+                int l = bas_ab_sym[hij][lm][1];
+                int n = k;
+                int lmn = ibas_aba_sym[h][l][m][n];
+                A_p[d2aboff[hij] + ij*gems_ab[hij]+lm] += u_p[ijk_id + (trip_aab[h] + lmn)]; // + D2(ij,lm) dkn
+            }
 
-                        A_p[d2aaoff[hnj] + nj*gems_aa[hnj]+km] -= s * dum; // - D2(nj,km) dil
-                    }
+            for (int l = 0; l < amo_; l++) {
+                int hlk = SymmetryPair(symmetry[k],symmetry[l]);
+                int lk = ibas_ab_sym[hlk][k][l];
+                int m = j;
+                int hlm = SymmetryPair(symmetry[l],symmetry[m]);
+                int hn = SymmetryPair(h,hlm);
+                for (int n = pitzer_offset[hn]; n < pitzer_offset[hn]+amopi_[hn]; n++) {
+                    int ni = ibas_ab_sym[hlk][n][i];
+                    int lmn = ibas_aba_sym[h][l][m][n];
+                    A_p[d2aboff[hlk] + ni*gems_ab[hlk]+lk] -= u_p[ijk_id + (trip_aab[h] + lmn)]; // -D2(ni,kl) djm
                 }
-                if ( j == m ) {
-                    int hni = SymmetryPair(symmetry[n],symmetry[i]);
-                    int ni = ibas_ab_sym[hni][n][i];
-                    int kl = ibas_ab_sym[hni][k][l];
-                    A_p[d2aboff[hni] + ni*gems_ab[hni]+kl] -= dum; // -D2(ni,kl) djm
+            }
+            for (int m = 0; m < amo_; m++) {
+                if ( k == m ) continue;
+                int hkm = SymmetryPair(symmetry[k],symmetry[m]);
+                int km = ibas_aa_sym[hkm][k][m];
+                int l = i;
+                int hlm = SymmetryPair(symmetry[l],symmetry[m]);
+                int hn = SymmetryPair(h,hlm);
+                int s1 = 1;
+                if ( k > m ) s1 = -s1;
+                for (int n = pitzer_offset[hn]; n < pitzer_offset[hn]+amopi_[hn]; n++) {
+                    if ( n == j ) continue;
+                    int nj = ibas_aa_sym[hkm][n][j];
+                    int lmn = ibas_aba_sym[h][l][m][n];
+                    int s2 = s1;
+                    if ( n > j ) s2 = -s2;
+                    A_p[d2aaoff[hkm] + nj*gems_aa[hkm]+km] -= s2 * u_p[ijk_id + (trip_aab[h] + lmn)]; // - D2(nj,km) dil
                 }
             }
+            int m = j;
+            int l = i;
+            int hk = symmetry[k];
+            int kk = k - pitzer_offset[hk];
+            for (int n = pitzer_offset[hk]; n < pitzer_offset[hk]+amopi_[hk]; n++) {
+                int nn = n - pitzer_offset[hk];
+                int lmn = ibas_aba_sym[h][l][m][n];
+                A_p[d1aoff[hk] + nn*amopi_[hk]+kk] += u_p[ijk_id + (trip_aab[h] + lmn)]; // + D1(n,k) djm dil
+            }
+
         }
-        C_DAXPY((trip_aba[h] + trip_aab[h]) * (trip_aba[h] + trip_aab[h]), -1.0, &u_p[offset],1,&A_p[t2bbboff[h]],1);
+        C_DAXPY((trip_aba[h] + trip_aab[h]) * (trip_aba[h] + trip_aab[h]), -1.0, u_p + offset,1,A_p + t2bbboff[h],1);
         offset += (trip_aba[h]+trip_aab[h])*(trip_aba[h]+trip_aab[h]);
         //offset += trip_aab[h]*trip_aab[h];
     }
 #endif
 
+    return offset;
 }
 // T2 portion of A^T.y (slow version!)
 void v2RDMSolver::T2_constraints_ATu_slow(SharedVector A,SharedVector u){
+    T2_constraints_ATu_slow(A->pointer(),u->pointer());
+}
 
-    double * A_p = A->pointer();
-    double * u_p = u->pointer();
+template <typename TargetType, typename SourceType>
+long int v2RDMSolver::T2_constraints_ATu_slow(TargetType A_p,SourceType u_p){
+    long int offset = t2_constraints_offset_;
 
     int saveoff = offset;
 
@@ -3418,7 +3459,7 @@ void v2RDMSolver::T2_constraints_ATu_slow(SharedVector A,SharedVector u){
                 int m = bas_aab_sym[h][lmn][1];
                 int n = bas_aab_sym[h][lmn][2];
 
-                double dum = u_p[offset + ijk*trip_aab[h]+lmn];
+                auto dum = u_p[offset + ijk*trip_aab[h]+lmn];
 
                 A_p[t2aaboff[h] + ijk*trip_aab[h]+lmn] -= dum; // - T2(ijk,lmn)
 
@@ -3488,7 +3529,7 @@ void v2RDMSolver::T2_constraints_ATu_slow(SharedVector A,SharedVector u){
                 int m = bas_aab_sym[h][lmn][1];
                 int n = bas_aab_sym[h][lmn][2];
 
-                double dum = u_p[offset + ijk*trip_aab[h]+lmn];
+                auto dum = u_p[offset + ijk*trip_aab[h]+lmn];
 
                 A_p[t2bbaoff[h] + ijk*trip_aab[h]+lmn] -= dum; // - T2(ijk,lmn)
 
@@ -3560,7 +3601,7 @@ void v2RDMSolver::T2_constraints_ATu_slow(SharedVector A,SharedVector u){
                 int id = ijk*(trip_aab[h]+trip_aba[h])+lmn;
                 //int id = ijk*trip_aab[h]+lmn;
 
-                double dum = u_p[offset + id];
+                auto dum = u_p[offset + id];
 
                 A_p[t2aaaoff[h] + id] -= dum; // - T2(ijk,lmn)
 
@@ -3653,7 +3694,7 @@ void v2RDMSolver::T2_constraints_ATu_slow(SharedVector A,SharedVector u){
 
                 int id = ijk*(trip_aab[h]+trip_aba[h])+(lmn+trip_aab[h]);
 
-                double dum = u_p[offset + id];
+                auto dum = u_p[offset + id];
 
                 A_p[t2aaaoff[h] + id] -= dum; // - T2(ijk,lmn)
 
@@ -3687,7 +3728,7 @@ void v2RDMSolver::T2_constraints_ATu_slow(SharedVector A,SharedVector u){
 
                 int id = (ijk+trip_aab[h])*(trip_aab[h]+trip_aba[h])+lmn;
 
-                double dum = u_p[offset + id];
+                auto dum = u_p[offset + id];
 
                 A_p[t2aaaoff[h] + id] -= dum; // - T2(ijk,lmn)
 
@@ -3721,7 +3762,7 @@ void v2RDMSolver::T2_constraints_ATu_slow(SharedVector A,SharedVector u){
 
                 int id = (ijk+trip_aab[h])*(trip_aab[h]+trip_aba[h])+(lmn+trip_aab[h]);
 
-                double dum = u_p[offset + id];
+                auto dum = u_p[offset + id];
 
                 A_p[t2aaaoff[h] + id] -= dum; // - T2(ijk,lmn)
 
@@ -3783,7 +3824,7 @@ void v2RDMSolver::T2_constraints_ATu_slow(SharedVector A,SharedVector u){
                 int id = ijk*(trip_aab[h]+trip_aba[h])+lmn;
                 //int id = ijk*trip_aab[h]+lmn;
 
-                double dum = u_p[offset + id];
+                auto dum = u_p[offset + id];
 
                 A_p[t2bbboff[h] + id] -= dum; // - T2(ijk,lmn)
 
@@ -3876,7 +3917,7 @@ void v2RDMSolver::T2_constraints_ATu_slow(SharedVector A,SharedVector u){
 
                 int id = ijk*(trip_aab[h]+trip_aba[h])+(lmn+trip_aab[h]);
 
-                double dum = u_p[offset + id];
+                auto dum = u_p[offset + id];
 
                 A_p[t2bbboff[h] + id] -= dum; // - T2(ijk,lmn)
 
@@ -3910,7 +3951,7 @@ void v2RDMSolver::T2_constraints_ATu_slow(SharedVector A,SharedVector u){
 
                 int id = (ijk+trip_aab[h])*(trip_aab[h]+trip_aba[h])+lmn;
 
-                double dum = u_p[offset + id];
+                auto dum = u_p[offset + id];
 
                 A_p[t2bbboff[h] + id] -= dum; // - T2(ijk,lmn)
 
@@ -3944,7 +3985,7 @@ void v2RDMSolver::T2_constraints_ATu_slow(SharedVector A,SharedVector u){
 
                 int id = (ijk+trip_aab[h])*(trip_aab[h]+trip_aba[h])+(lmn+trip_aab[h]);
 
-                double dum = u_p[offset + id];
+                auto dum = u_p[offset + id];
 
                 A_p[t2bbboff[h] + id] -= dum; // - T2(ijk,lmn)
 
@@ -3988,6 +4029,7 @@ void v2RDMSolver::T2_constraints_ATu_slow(SharedVector A,SharedVector u){
     }
 #endif
 
+    return offset;
 }
 
 // T2 tilde portion of A.u (actually what Mazziotti calls T2)
@@ -4518,4 +4560,10 @@ void v2RDMSolver::T2_tilde_constraints_ATu(SharedVector A,SharedVector u){
 */
 }
 
+// instantiations used by RecordConstraints and bpsdp_ATu_tasks
+template long int v2RDMSolver::T2_constraints_ATu<SparseTarget,SparseSource>(SparseTarget A_p,SparseSource u_p);
+template long int v2RDMSolver::T2_constraints_ATu_slow<SparseTarget,SparseSource>(SparseTarget A_p,SparseSource u_p);
+template long int v2RDMSolver::T2_constraints_ATu<double*,double*>(double* A_p,double* u_p);
+template long int v2RDMSolver::T2_constraints_ATu_slow<double*,double*>(double* A_p,double* u_p);
+
 }} // end namespaces
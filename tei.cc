@@ -37,8 +37,10 @@
 #include<psi4/libmints/matrix.h>
 
 #include<time.h>
+#include<math.h>
 
 #include"v2rdm_solver.h"
+#include"blas.h"
 
 #ifdef _OPENMP
     #include<omp.h>
@@ -48,7 +50,7 @@
 #endif
 
 using namespace psi;
-//using namespace fnocc;
+using namespace fnocc;
 
 namespace psi{ namespace v2rdm_casscf{
 
@@ -70,9 +72,10 @@ void v2RDMSolver::GetIntegrals() {
     }else {
 
         // size of the 4-index integral buffer
+        int * gems_tei = TEIPairs();
         tei_full_dim_ = 0;
         for (int h = 0; h < nirrep_; h++) {
-            tei_full_dim_ += (long int)gems_full[h] * ( (long int)gems_full[h] + 1L ) / 2L;
+            tei_full_dim_ += (long int)gems_tei[h] * ( (long int)gems_tei[h] + 1L ) / 2L;
         }
 
         tei_full_sym_ = (double*)malloc(tei_full_dim_*sizeof(double));
@@ -134,7 +137,9 @@ void v2RDMSolver::GetIntegrals() {
 
     if ( !is_df_ ) {
         // read tei's from disk
+        double start = omp_get_wtime();
         GetTEIFromDisk();
+        timers_.accumulate(TIMER_READ_TEI,omp_get_wtime() - start);
     }
     RepackIntegrals();
 
@@ -143,14 +148,33 @@ void v2RDMSolver::GetIntegrals() {
 // repack rotated full-space integrals into active-space integrals
 void v2RDMSolver::RepackIntegrals(){
 
+    double start = omp_get_wtime();
+
     FrozenCoreEnergy();
 
     double * c_p = c->pointer();
 
-    // two-electron part
+    // with density fitting, build all active-space integrals (tu|vw) at 
+    // once rather than contracting over Q for every element
+    long int ntri = (long int)amo_ * ( amo_ + 1 ) / 2;
+    double * tei_act = NULL;
+    if ( is_df_ ) {
+        tei_act = (double*)malloc(ntri*ntri*sizeof(double));
+        ActiveTEIDF(tei_act);
+    }
+
+    // two-electron part.  the blocks are symmetric, so only the lower 
+    // triangles are needed if c is packed.  with SPIN_ADAPT_D2, c for 
+    // D2ab, D2aa, and D2bb is built as full squares and then contracted 
+    // to the singlet and triplet blocks
+    bool packed = packed_storage_ && !spin_adapt_d2_;
+    if ( spin_adapt_d2_ ) {
+        c_p = (double*)malloc(d2_full_dim_*sizeof(double));
+    }
     long int na = nalpha_ - nrstc_ - nfrzc_;
     long int nb = nbeta_ - nrstc_ - nfrzc_;
     for (int h = 0; h < nirrep_; h++) {
+        long int poff = packed ? PrimalOffset(d2aboff[h]) : 0;
         #pragma omp parallel for schedule (static)
         for (long int ij = 0; ij < gems_ab[h]; ij++) {
             long int i = bas_ab_sym[h][ij][0];
@@ -159,7 +183,8 @@ void v2RDMSolver::RepackIntegrals(){
             long int ii = full_basis[i];
             long int jj = full_basis[j];
 
-            for (long int kl = 0; kl < gems_ab[h]; kl++) {
+            long int klmax = packed ? ij + 1 : gems_ab[h];
+            for (long int kl = 0; kl < klmax; kl++) {
                 long int k = bas_ab_sym[h][kl][0];
                 long int l = bas_ab_sym[h][kl][1];
 
@@ -168,13 +193,21 @@ void v2RDMSolver::RepackIntegrals(){
 
                 int hik = SymmetryPair(symmetry[i],symmetry[k]);
 
-                c_p[d2aboff[h] + ij*gems_ab[h]+kl] = TEI(ii,kk,jj,ll,hik);
+                double dum = is_df_ ? tei_act[INDEX(i,k)*ntri + INDEX(j,l)] : TEI(ii,kk,jj,ll,hik);
+
+                if ( packed ) {
+                    c_p[poff + ij*(ij+1)/2 + kl] = ( kl == ij ) ? dum : M_SQRT2 * dum;
+                }else {
+                    c_p[d2aboff[h] + ij*gems_ab[h]+kl] = dum;
+                }
 
             }
         }
     }
 
     for (int h = 0; h < nirrep_; h++) {
+        long int poffa = packed ? PrimalOffset(d2aaoff[h]) : 0;
+        long int poffb = packed ? PrimalOffset(d2bboff[h]) : 0;
         #pragma omp parallel for schedule (static)
         for (long int ij = 0; ij < gems_aa[h]; ij++) {
             long int i = bas_aa_sym[h][ij][0];
@@ -183,7 +216,8 @@ void v2RDMSolver::RepackIntegrals(){
             long int ii = full_basis[i];
             long int jj = full_basis[j];
 
-            for (long int kl = 0; kl < gems_aa[h]; kl++) {
+            long int klmax = packed ? ij + 1 : gems_aa[h];
+            for (long int kl = 0; kl < klmax; kl++) {
                 long int k = bas_aa_sym[h][kl][0];
                 long int l = bas_aa_sym[h][kl][1];
 
@@ -193,20 +227,53 @@ void v2RDMSolver::RepackIntegrals(){
                 int hik = SymmetryPair(symmetry[i],symmetry[k]);
                 int hil = SymmetryPair(symmetry[i],symmetry[l]);
 
-                double dum1 = TEI(ii,kk,jj,ll,hik);
-                double dum2 = TEI(ii,ll,jj,kk,hil);
+                double dum1 = is_df_ ? tei_act[INDEX(i,k)*ntri + INDEX(j,l)] : TEI(ii,kk,jj,ll,hik);
+                double dum2 = is_df_ ? tei_act[INDEX(i,l)*ntri + INDEX(j,k)] : TEI(ii,ll,jj,kk,hil);
+
+                // closed shells: D2bb shares storage with D2aa and carries both spin cases
+                if ( closed_shell_ ) {
+                    if ( packed ) {
+                        double scale = ( kl == ij ) ? 1.0 : M_SQRT2;
+                        c_p[poffa + ij*(ij+1)/2 + kl] = 2.0 * scale * ( dum1 - dum2 );
+                    }else {
+                        c_p[d2aaoff[h] + ij*gems_aa[h]+kl]    = 2.0 * ( dum1 - dum2 );
+                    }
+                    continue;
+                }
 
-                c_p[d2aaoff[h] + ij*gems_aa[h]+kl]    = dum1 - dum2;
-                c_p[d2bboff[h] + ij*gems_aa[h]+kl]    = dum1 - dum2;
+                if ( packed ) {
+                    double scale = ( kl == ij ) ? 1.0 : M_SQRT2;
+                    c_p[poffa + ij*(ij+1)/2 + kl] = scale * ( dum1 - dum2 );
+                    c_p[poffb + ij*(ij+1)/2 + kl] = scale * ( dum1 - dum2 );
+                }else {
+                    c_p[d2aaoff[h] + ij*gems_aa[h]+kl]    = dum1 - dum2;
+                    c_p[d2bboff[h] + ij*gems_aa[h]+kl]    = dum1 - dum2;
+                }
             }
         }
     }
 
+    if ( spin_adapt_d2_ ) {
+        SpinAdaptedD2ContractBlocks(c_p,c->pointer());
+        free(c_p);
+    }
+    free(tei_act);
+
+    timers_.accumulate(TIMER_REPACK_INTEGRALS,omp_get_wtime() - start);
+
 }
 void v2RDMSolver::FrozenCoreEnergy() {
 
     // if frozen core, adjust oei's and compute frozen core energy:
     efzc_ = 0.0;
+
+    // with density fitting, the two-electron core terms come from a few dgemms
+    double * fock_act = NULL;
+    if ( is_df_ ) {
+        fock_act = (double*)malloc(amo_*amo_*sizeof(double));
+        efzc_ = FrozenCoreDF(fock_act);
+    }
+
     offset = 0;
     long int offset3 = 0;
     for (int h = 0; h < nirrep_; h++) {
@@ -216,6 +283,8 @@ void v2RDMSolver::FrozenCoreEnergy() {
 
             efzc_ += 2.0 * oei_full_sym_[offset3 + INDEX(i,i)];
 
+            if ( is_df_ ) continue;
+
             long int offset2 = 0;
             for (int h2 = 0; h2 < nirrep_; h2++) {
                 for (int j = 0; j < rstcpi_[h2] + frzcpi_[h2]; j++) {
@@ -241,6 +310,7 @@ void v2RDMSolver::FrozenCoreEnergy() {
     // adjust one-electron integrals for core repulsion contribution
     offset = 0;
     offset3 = 0;
+    long int offact = 0;
     for (int h = 0; h < nirrep_; h++) {
         for (int i = rstcpi_[h] + frzcpi_[h]; i < nmopi_[h] - rstvpi_[h] - frzvpi_[h]; i++) {
 
@@ -248,35 +318,258 @@ void v2RDMSolver::FrozenCoreEnergy() {
 
             for (int j = rstcpi_[h] + frzcpi_[h]; j < nmopi_[h] - rstvpi_[h] - frzvpi_[h]; j++) {
 
+                if ( packed_storage_ && j > i ) continue;
+
                 int jfull = j + offset;
 
                 double dum = 0.0;
 
-                long int offset2 = 0;
-                for (int h2 = 0; h2 < nirrep_; h2++) {
-                    for (int k = 0; k < rstcpi_[h2] + frzcpi_[h2]; k++) {
+                if ( is_df_ ) {
+                    long int it = offact + i - rstcpi_[h] - frzcpi_[h];
+                    long int jt = offact + j - rstcpi_[h] - frzcpi_[h];
+                    dum = fock_act[it*amo_+jt];
+                }else {
+                    long int offset2 = 0;
+                    for (int h2 = 0; h2 < nirrep_; h2++) {
+                        for (int k = 0; k < rstcpi_[h2] + frzcpi_[h2]; k++) {
 
-                        int kfull = k + offset2;
+                            int kfull = k + offset2;
 
-                        int hik = SymmetryPair(h,h2);
+                            int hik = SymmetryPair(h,h2);
 
-                        double dum1 = TEI(ifull,jfull,kfull,kfull,0);
-                        double dum2 = TEI(ifull,kfull,jfull,kfull,hik);
-                        dum += 2.0 * dum1 - dum2;
+                            double dum1 = TEI(ifull,jfull,kfull,kfull,0);
+                            double dum2 = TEI(ifull,kfull,jfull,kfull,hik);
+                            dum += 2.0 * dum1 - dum2;
 
+                        }
+                        offset2 += nmopi_[h2] - frzvpi_[h2];
+                    }
+                }
+                // packed c: lower triangle only, off-diagonal elements scaled by sqrt(2)
+                if ( packed_storage_ ) {
+                    long int ia = i-rstcpi_[h]-frzcpi_[h];
+                    long int ja = j-rstcpi_[h]-frzcpi_[h];
+                    double scale = ( i == j ) ? 1.0 : M_SQRT2;
+                    if ( closed_shell_ ) {
+                        c_p[PrimalOffset(d1aoff[h]) + ia*(ia+1)/2 + ja] = 2.0 * scale * ( oei_full_sym_[offset3+INDEX(i,j)] + dum );
+                        continue;
                     }
-                    offset2 += nmopi_[h2] - frzvpi_[h2];
+                    c_p[PrimalOffset(d1aoff[h]) + ia*(ia+1)/2 + ja] = scale * ( oei_full_sym_[offset3+INDEX(i,j)] + dum );
+                    c_p[PrimalOffset(d1boff[h]) + ia*(ia+1)/2 + ja] = scale * ( oei_full_sym_[offset3+INDEX(i,j)] + dum );
+                    continue;
+                }
+                // closed shells: D1b shares storage with D1a
+                if ( closed_shell_ ) {
+                    c_p[PrimalOffset(d1aoff[h]) + (i-rstcpi_[h]-frzcpi_[h])*amopi_[h] + (j-rstcpi_[h]-frzcpi_[h])] = 2.0 * ( oei_full_sym_[offset3+INDEX(i,j)] + dum );
+                    continue;
                 }
-                c_p[d1aoff[h] + (i-rstcpi_[h]-frzcpi_[h])*amopi_[h] + (j-rstcpi_[h]-frzcpi_[h])] = oei_full_sym_[offset3+INDEX(i,j)];
-                c_p[d1boff[h] + (i-rstcpi_[h]-frzcpi_[h])*amopi_[h] + (j-rstcpi_[h]-frzcpi_[h])] = oei_full_sym_[offset3+INDEX(i,j)];
-                c_p[d1aoff[h] + (i-rstcpi_[h]-frzcpi_[h])*amopi_[h] + (j-rstcpi_[h]-frzcpi_[h])] += dum;
-                c_p[d1boff[h] + (i-rstcpi_[h]-frzcpi_[h])*amopi_[h] + (j-rstcpi_[h]-frzcpi_[h])] += dum;
+                c_p[PrimalOffset(d1aoff[h]) + (i-rstcpi_[h]-frzcpi_[h])*amopi_[h] + (j-rstcpi_[h]-frzcpi_[h])] = oei_full_sym_[offset3+INDEX(i,j)];
+                c_p[PrimalOffset(d1boff[h]) + (i-rstcpi_[h]-frzcpi_[h])*amopi_[h] + (j-rstcpi_[h]-frzcpi_[h])] = oei_full_sym_[offset3+INDEX(i,j)];
+                c_p[PrimalOffset(d1aoff[h]) + (i-rstcpi_[h]-frzcpi_[h])*amopi_[h] + (j-rstcpi_[h]-frzcpi_[h])] += dum;
+                c_p[PrimalOffset(d1boff[h]) + (i-rstcpi_[h]-frzcpi_[h])*amopi_[h] + (j-rstcpi_[h]-frzcpi_[h])] += dum;
             }
         }
         offset += nmopi_[h] - frzvpi_[h];
         offset3 += ( nmopi_[h] - frzvpi_[h] ) * ( nmopi_[h] - frzvpi_[h] + 1 ) / 2;
+        offact += amopi_[h];
+    }
+
+    free(fock_act);
+
+}
+
+// number of auxiliary functions per batch when slabs of Qmo_ that need
+// per_Q doubles per auxiliary function are gathered.  the slabs are sized
+// to fit in the memory that is left over (see common_init)
+long int v2RDMSolver::ThreeIndexBatchSize(long int per_Q) {
+    long int nb = nQ_;
+    if ( per_Q > 0 ) {
+        nb = ( available_memory_ / 8L ) / per_Q;
+    }
+    if ( nb > nQ_ ) nb = nQ_;
+    if ( nb < 1 )   nb = 1;
+    return nb;
+}
+
+// active-space integrals (tu|vw) = sum_Q (Q|tu)(Q|vw), one dgemm per batch
+// of Q.  the (Q|tu) slab of each batch is first copied out of Qmo_ so that
+// both operands are contiguous.  the copy walks Qmo_ in storage order so
+// that each block is read only once, which matters when Qmo_ is
+// memory-mapped (DF_INTEGRAL_STORAGE = DISK).  tei_act is ntri x ntri,
+// with ntri = amo(amo+1)/2 and pairs indexed by INDEX(t,u)
+void v2RDMSolver::ActiveTEIDF(double * tei_act) {
+
+    long int ntri  = (long int)amo_ * ( amo_ + 1 ) / 2;
+
+    long int nQb = ThreeIndexBatchSize(ntri);
+
+    double * Qact = (double*)malloc(nQb*ntri*sizeof(double));
+
+    for (long int Q0 = 0; Q0 < nQ_; Q0 += nQb) {
+
+        long int nb = ( Q0 + nQb > nQ_ ) ? nQ_ - Q0 : nQb;
+
+        if ( qmo_qstride_ == 1 ) {
+
+            // (mn|Q): one block of nQ values per pair
+            #pragma omp parallel for schedule (static)
+            for (long int t = 0; t < amo_; t++) {
+                long int tt = full_basis[t];
+                for (long int u = 0; u <= t; u++) {
+                    long int uu = full_basis[u];
+                    double * Qtu = Qmo_ + INDEX(tt,uu)*qmo_pqstride_ + Q0;
+                    for (long int q = 0; q < nb; q++) {
+                        Qact[q*ntri + INDEX(t,u)] = Qtu[q];
+                    }
+                }
+            }
+
+        }else {
+
+            // (Q|mn): one block of pairs per Q
+            #pragma omp parallel for schedule (static)
+            for (long int q = 0; q < nb; q++) {
+                double * QmoQ = Qmo_ + (Q0 + q)*qmo_qstride_;
+                for (long int t = 0; t < amo_; t++) {
+                    long int tt = full_basis[t];
+                    for (long int u = 0; u <= t; u++) {
+                        long int uu = full_basis[u];
+                        Qact[q*ntri + INDEX(t,u)] = QmoQ[INDEX(tt,uu)*qmo_pqstride_];
+                    }
+                }
+            }
+
+        }
+
+        F_DGEMM('n','t',ntri,ntri,nb,1.0,Qact,ntri,Qact,ntri,( Q0 == 0 ) ? 0.0 : 1.0,tei_act,ntri);
     }
 
+    free(Qact);
+}
+
+// core contributions from the three-index integrals.  on return, fock_act
+// (amo x amo) holds sum_k [ 2(tu|kk) - (tk|uk) ], and the function returns
+// the two-electron part of the core energy, sum_kl [ 2(kk|ll) - (kl|kl) ].
+// like ActiveTEIDF, this works on batches of Q
+double v2RDMSolver::FrozenCoreDF(double * fock_act) {
+
+    long int ncore = nfrzc_ + nrstc_;
+
+    memset((void*)fock_act,'\0',amo_*amo_*sizeof(double));
+
+    if ( ncore == 0 ) return 0.0;
+
+    // core orbitals in the full (no frozen virtuals) basis
+    long int * core = (long int*)malloc(ncore*sizeof(long int));
+    long int count = 0;
+    long int off = 0;
+    for (int h = 0; h < nirrep_; h++) {
+        for (int i = 0; i < rstcpi_[h] + frzcpi_[h]; i++) {
+            core[count++] = off + i;
+        }
+        off += nmopi_[h] - frzvpi_[h];
+    }
+
+    // (Q|tu) and (Q|tk) slabs and D(Q) = sum_k (Q|kk) for one batch of Q.
+    // (Q|tk) is stored t-major so the exchange term is one dgemm over the
+    // combined Qk index.  (Q|kl) is only needed for sum_kl (kl|kl), which
+    // is accumulated directly from Qmo_
+    long int nQb = ThreeIndexBatchSize(amo_*amo_ + amo_*ncore + 1);
+
+    double * Qaa = (double*)malloc(nQb*amo_*amo_*sizeof(double));
+    double * Qac = (double*)malloc(nQb*amo_*ncore*sizeof(double));
+    double * Dk  = (double*)malloc(nQb*sizeof(double));
+
+    double ecore = 0.0;
+
+    for (long int Q0 = 0; Q0 < nQ_; Q0 += nQb) {
+
+        long int nb = ( Q0 + nQb > nQ_ ) ? nQ_ - Q0 : nQb;
+
+        double exch = 0.0;
+
+        // as in ActiveTEIDF, walk Qmo_ in storage order
+        if ( qmo_qstride_ == 1 ) {
+
+            // (mn|Q): one block of nQ values per pair
+            memset((void*)Dk,'\0',nb*sizeof(double));
+            for (long int k = 0; k < ncore; k++) {
+                double * Qkk = Qmo_ + INDEX(core[k],core[k])*qmo_pqstride_ + Q0;
+                for (long int q = 0; q < nb; q++) {
+                    Dk[q] += Qkk[q];
+                }
+            }
+
+            #pragma omp parallel for schedule (static) reduction(+:exch)
+            for (long int k = 0; k < ncore; k++) {
+                for (long int l = 0; l < ncore; l++) {
+                    double * Qkl = Qmo_ + INDEX(core[k],core[l])*qmo_pqstride_ + Q0;
+                    for (long int q = 0; q < nb; q++) {
+                        exch += Qkl[q] * Qkl[q];
+                    }
+                }
+            }
+
+            #pragma omp parallel for schedule (static)
+            for (long int t = 0; t < amo_; t++) {
+                long int tt = full_basis[t];
+                for (long int u = 0; u < amo_; u++) {
+                    double * Qtu = Qmo_ + INDEX(tt,full_basis[u])*qmo_pqstride_ + Q0;
+                    for (long int q = 0; q < nb; q++) {
+                        Qaa[q*amo_*amo_ + t*amo_ + u] = Qtu[q];
+                    }
+                }
+                for (long int k = 0; k < ncore; k++) {
+                    double * Qtk = Qmo_ + INDEX(tt,core[k])*qmo_pqstride_ + Q0;
+                    for (long int q = 0; q < nb; q++) {
+                        Qac[t*nb*ncore + q*ncore + k] = Qtk[q];
+                    }
+                }
+            }
+
+        }else {
+
+            // (Q|mn): one block of pairs per Q
+            #pragma omp parallel for schedule (static) reduction(+:exch)
+            for (long int q = 0; q < nb; q++) {
+                double * QmoQ = Qmo_ + (Q0 + q)*qmo_qstride_;
+                double dum = 0.0;
+                for (long int k = 0; k < ncore; k++) {
+                    for (long int l = 0; l < ncore; l++) {
+                        double Qkl = QmoQ[INDEX(core[k],core[l])*qmo_pqstride_];
+                        exch += Qkl * Qkl;
+                    }
+                    dum += QmoQ[INDEX(core[k],core[k])*qmo_pqstride_];
+                }
+                Dk[q] = dum;
+                for (long int t = 0; t < amo_; t++) {
+                    long int tt = full_basis[t];
+                    for (long int u = 0; u < amo_; u++) {
+                        Qaa[q*amo_*amo_ + t*amo_ + u] = QmoQ[INDEX(tt,full_basis[u])*qmo_pqstride_];
+                    }
+                    for (long int k = 0; k < ncore; k++) {
+                        Qac[t*nb*ncore + q*ncore + k] = QmoQ[INDEX(tt,core[k])*qmo_pqstride_];
+                    }
+                }
+            }
+
+        }
+
+        ecore += 2.0 * C_DDOT(nb,Dk,1,Dk,1) - exch;
+
+        // coulomb: 2 sum_Q (Q|tu) D(Q)
+        F_DGEMM('n','n',amo_*amo_,1,nb,2.0,Qaa,amo_*amo_,Dk,nb,1.0,fock_act,amo_*amo_);
+
+        // exchange: - sum_Qk (Q|tk)(Q|uk)
+        F_DGEMM('t','n',amo_,amo_,nb*ncore,-1.0,Qac,nb*ncore,Qac,nb*ncore,1.0,fock_act,amo_);
+    }
+
+    free(Dk);
+    free(Qac);
+    free(Qaa);
+    free(core);
+
+    return ecore;
 }
 
 double v2RDMSolver::TEI(int i, int j, int k, int l, int h) {
@@ -285,13 +578,14 @@ double v2RDMSolver::TEI(int i, int j, int k, int l, int h) {
     if ( is_df_ ) {
 
         //dum = C_DDOT(nQ_,Qmo_ + nQ_*INDEX(i,j),1,Qmo_+nQ_*INDEX(k,l),1);
-        dum = C_DDOT(nQ_,Qmo_ + INDEX(i,j),(nmo_-nfrzv_)*(nmo_-nfrzv_+1)/2,Qmo_+INDEX(k,l),(nmo_-nfrzv_)*(nmo_-nfrzv_+1)/2);
+        dum = C_DDOT(nQ_,Qmo_ + INDEX(i,j)*qmo_pqstride_,qmo_qstride_,Qmo_ + INDEX(k,l)*qmo_pqstride_,qmo_qstride_);
 
     }else {
 
-        int myoff = 0;
+        int * gems_tei = TEIPairs();
+        long int myoff = 0;
         for (int myh = 0; myh < h; myh++) {
-            myoff += (long int)gems_full[myh] * ( (long int)gems_full[myh] + 1L ) / 2L;
+            myoff += (long int)gems_tei[myh] * ( (long int)gems_tei[myh] + 1L ) / 2L;
         }
 
         int ij    = ibas_full_sym[h][i][j];
@@ -34,6 +34,12 @@
 #include <psi4/psifiles.h>
 #include <psi4/libtrans/integraltransform.h>
 
+#include <future>
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "blas.h"
 
 
@@ -105,14 +111,29 @@ void v2RDMSolver::ThreeIndexIntegrals() {
         sym[i]                    = minh;
     }
 
-    // how many rows of (Q|mn) can we read in at once?
-    if ( ndoubles < nso_*nso_ ) {
+    long int nn1fv = (nmo_-nfrzv_)*(nmo_-nfrzv_+1)/2;
+
+    // the MO integrals are built directly in Qmo_, in the requested order: (Q|mn) or (mn|Q)
+    bool q_fast = ( options_.get_str("DF_INTEGRAL_ORDER") == "MNQ" );
+    qmo_qstride_  = q_fast ? 1   : nn1fv;
+    qmo_pqstride_ = q_fast ? nQ_ : 1;
+
+    AllocateThreeIndexBuffer(nn1fv*nQ_);
+
+    // how many rows of (Q|mn) can we read in at once?  each row needs two 
+    // nso^2 work buffers plus two ntri read buffers (one is filled in the 
+    // background while the other is transformed)
+    long int rowdoubles = 2L*nso_*nso_ + 2L*ntri;
+    if ( qmo_map_bytes_ == 0 ) {
+        ndoubles -= nn1fv*nQ_;
+    }
+    if ( ndoubles < rowdoubles ) {
         throw PsiException("holy moses, we can't fit nso^2 doubles in memory.  increase memory!",__FILE__,__LINE__);
     }
 
     long int nrows = 1;
     long int rowsize = nQ_;
-    while ( rowsize*nso_*nso_*2 > ndoubles ) {
+    while ( rowsize*rowdoubles > ndoubles ) {
         nrows++;
         rowsize = nQ_ / nrows;
         if (nrows * rowsize < nQ_) rowsize++;
@@ -126,35 +147,55 @@ void v2RDMSolver::ThreeIndexIntegrals() {
     double * tmp1 = (double*)malloc(rowdims[0]*nso_*nso_*sizeof(double));
     double * tmp2 = (double*)malloc(rowdims[0]*nso_*nso_*sizeof(double));
 
-    long int nn1mo = nmo_*(nmo_+1)/2;
-    long int nn1fv = (nmo_-nfrzv_)*(nmo_-nfrzv_+1)/2;
+    // double-buffered reads of the SCF integrals
+    double * readbuf[2];
+    readbuf[0] = (double*)malloc(rowdims[0]*ntri*sizeof(double));
+    readbuf[1] = (double*)malloc(rowdims[0]*ntri*sizeof(double));
+
+    // pitzer-order position of each orbital (-1 for frozen virtuals)
+    long int * pitzer = (long int*)malloc(nmo_*sizeof(long int));
+    for (long int m = 0; m < nmo_; m++) {
+        int hm = sym[m];
+        long int offm = 0;
+        for (int h = 0; h < hm; h++) {
+            offm += nmopi_[h] - frzvpi_[h];
+        }
+        pitzer[m] = ( reorder[m] < nmopi_[hm] - frzvpi_[hm] ) ? reorder[m] + offm : -1;
+    }
 
+    // AO->MO transformation matrix:
+    SharedMatrix myCa (new Matrix(reference_wavefunction_->Ca_subset("AO","ALL")));
+
+    // stream the integrals from the SCF one block of Q at a time: 
+    // read, unpack, transform both indices, and sort into Qmo_.  
+    // block row+1 is read on a separate thread while block row is 
+    // being transformed.  only that thread touches psio in the meantime.
+    // the read goes through std::async so that a psio exception is
+    // rethrown here by get(), and so that the future's destructor waits
+    // for the read if anything on this thread throws first
     std::shared_ptr<PSIO> psio(new PSIO());
+    psio_address addr = PSIO_ZERO;
+    psio->open(PSIF_DFSCF_BJ,PSIO_OPEN_OLD);
 
-    psio->open(PSIF_DCC_QSO,PSIO_OPEN_NEW);
-    psio->open(PSIF_DCC_QMO,PSIO_OPEN_NEW);
-    psio_address addr  = PSIO_ZERO;
-    psio_address addr2 = PSIO_ZERO;
-    for (long int row = 0; row < nrows; row++) {
-        psio->write(PSIF_DCC_QSO, "(Q|mn) Integrals", (char*) tmp1, sizeof(double) * rowdims[row] * nso_ * nso_,addr,&addr);
-        psio->write(PSIF_DCC_QMO, "(Q|mn) Integrals", (char*) tmp1, sizeof(double) * rowdims[row] * nn1mo,addr2,&addr2);
-    }
-    psio->close(PSIF_DCC_QSO,1);
-    psio->close(PSIF_DCC_QMO,1);
+    auto read_row = [&](long int row) {
+        psio->read(PSIF_DFSCF_BJ, "(Q|mn) Integrals", (char*) readbuf[row % 2], sizeof(double) * ntri * rowdims[row],addr,&addr);
+    };
 
-    // read integrals from SCF and unpack them
-    addr  = PSIO_ZERO;
-    addr2 = PSIO_ZERO;
-    psio->open(PSIF_DFSCF_BJ,PSIO_OPEN_OLD);
-    psio->open(PSIF_DCC_QSO,PSIO_OPEN_OLD);
+    read_row(0);
 
-    memset((void*)tmp1,'\0',nso_*nso_*rowdims[0]*sizeof(double));
+    long int totalQ = 0;
     for (long int row = 0; row < nrows; row++) {
 
-        // read
-        psio->read(PSIF_DFSCF_BJ, "(Q|mn) Integrals", (char*) tmp2, sizeof(double) * ntri * rowdims[row],addr,&addr);
+        // prefetch the next block
+        std::future<void> prefetch;
+        if ( row + 1 < nrows ) {
+            prefetch = std::async(std::launch::async,read_row,row + 1);
+        }
+
+        double * bj = readbuf[row % 2];
 
         // unpack
+        memset((void*)tmp1,'\0',nso_*nso_*rowdims[row]*sizeof(double));
         #pragma omp parallel for schedule (static)
         for (long int Q = 0; Q < rowdims[row]; Q++) {
             for (long int mn = 0; mn < ntri; mn++) {
@@ -162,26 +203,11 @@ void v2RDMSolver::ThreeIndexIntegrals() {
                 long int m = function_pairs[mn].first;
                 long int n = function_pairs[mn].second;
 
-                tmp1[Q*nso_*nso_+m*nso_+n] = tmp2[Q*ntri+mn];
-                tmp1[Q*nso_*nso_+n*nso_+m] = tmp2[Q*ntri+mn];
+                tmp1[Q*nso_*nso_+m*nso_+n] = bj[Q*ntri+mn];
+                tmp1[Q*nso_*nso_+n*nso_+m] = bj[Q*ntri+mn];
             }
         }
 
-        // write
-        psio->write(PSIF_DCC_QSO, "(Q|mn) Integrals", (char*) tmp1, sizeof(double) * nso_*nso_ * rowdims[row],addr2,&addr2);
-    }
-    psio->close(PSIF_DFSCF_BJ,1);
-
-    // AO->MO transformation matrix:
-    SharedMatrix myCa (new Matrix(reference_wavefunction_->Ca_subset("AO","ALL")));
-
-    // transform first index:
-    addr  = PSIO_ZERO;
-    addr2 = PSIO_ZERO;
-    for (long int row = 0; row < nrows; row++) {
-        // read
-        psio->read(PSIF_DCC_QSO, "(Q|mn) Integrals", (char*) tmp1, sizeof(double) * nso_*nso_ * rowdims[row],addr,&addr);
-
         // transform first index:
         F_DGEMM('n','n',nmo_,nso_*rowdims[row],nso_,1.0,&(myCa->pointer()[0][0]),nmo_,tmp1,nso_,0.0,tmp2,nmo_);
 
@@ -195,107 +221,94 @@ void v2RDMSolver::ThreeIndexIntegrals() {
             }
         }
 
-        // write
-        psio->write(PSIF_DCC_QSO, "(Q|mn) Integrals", (char*) tmp1, sizeof(double) * nso_*nmo_ * rowdims[row],addr2,&addr2);
-    }
-    // transform second index:
-    addr  = PSIO_ZERO;
-    addr2 = PSIO_ZERO;
-    psio->open(PSIF_DCC_QMO,PSIO_OPEN_OLD);
-    for (long int row = 0; row < nrows; row++) {
-        // read
-        psio->read(PSIF_DCC_QSO, "(Q|mn) Integrals", (char*) tmp1, sizeof(double) * nso_*nmo_ * rowdims[row],addr,&addr);
-
         // transform second index:
         F_DGEMM('n','n',nmo_,nmo_*rowdims[row],nso_,1.0,&(myCa->pointer()[0][0]),nmo_,tmp1,nso_,0.0,tmp2,nmo_);
 
         // sort orbitals into pitzer order
         #pragma omp parallel for schedule (static)
         for (long int Q = 0; Q < rowdims[row]; Q++) {
+            double * QmoQ = Qmo_ + ( totalQ + Q ) * qmo_qstride_;
             for (long int m = 0; m < nmo_; m++) {
-                int hm = sym[m];
-                long int offm = 0;
-                for (int h = 0; h < hm; h++) {
-                    offm += nmopi_[h] - frzvpi_[h];
-                }
-                if ( reorder[m] >= nmopi_[hm] - frzvpi_[hm] ) continue;
-                long int mm = reorder[m] + offm;
+                long int mm = pitzer[m];
+                if ( mm < 0 ) continue;
                 for (long int n = 0; n < nmo_; n++) {
-                    int hn = sym[n];
-                    long int offn = 0;
-                    for (int h = 0; h < hn; h++) {
-                        offn += nmopi_[h] - frzvpi_[h];
-                    }
-                    if ( reorder[n] >= nmopi_[hn] - frzvpi_[hn] ) continue;
-                    long int nn = reorder[n] + offn;
-                    tmp1[Q*nn1fv+INDEX(mm,nn)] = tmp2[Q*nmo_*nmo_+m*nmo_+n];
+                    long int nn = pitzer[n];
+                    if ( nn < 0 ) continue;
+                    QmoQ[INDEX(mm,nn)*qmo_pqstride_] = tmp2[Q*nmo_*nmo_+m*nmo_+n];
                 }
             }
         }
 
-        // write
-        psio->write(PSIF_DCC_QMO, "(Q|mn) Integrals", (char*) tmp1, sizeof(double) * nn1fv * rowdims[row],addr2,&addr2);
+        totalQ += rowdims[row];
+
+        if ( prefetch.valid() ) {
+            prefetch.get();
+        }
     }
-    psio->close(PSIF_DCC_QMO,1);
-    psio->close(PSIF_DCC_QSO,1);
+    psio->close(PSIF_DFSCF_BJ,1);
 
     delete[] rowdims;
 
-    //F_DGEMM('t','t',nso_*nQ_,nso_,nso_,1.0,tmp1,nso_,&(myCa->pointer()[0][0]),nso_,0.0,tmp2,nso_*nQ_);
-    //F_DGEMM('t','t',nso_*nQ_,nso_,nso_,1.0,tmp2,nso_,&(myCa->pointer()[0][0]),nso_,0.0,tmp1,nso_*nQ_);
-
+    free(readbuf[0]);
+    free(readbuf[1]);
+    free(pitzer);
     free(reorder);
     free(skip);
     free(sym);
     free(tmp2);
     free(tmp1);
+}
 
-    Qmo_ = (double*)malloc(nn1fv*nQ_*sizeof(double));
-    memset((void*)Qmo_,'\0',nn1fv*nQ_*sizeof(double));
-    psio->open(PSIF_DCC_QMO,PSIO_OPEN_OLD);
-    psio->read_entry(PSIF_DCC_QMO,"(Q|mn) Integrals",(char*)Qmo_,sizeof(double)*nQ_ * nn1fv);
-    psio->close(PSIF_DCC_QMO,1);
+void v2RDMSolver::AllocateThreeIndexBuffer(long int n) {
 
-    // the following code would transpose the three-index integrals (Q|mn) -> (mn|Q)
+    FreeThreeIndexBuffer();
 
-/*
-    // with 3-index integrals in memory, how much else can we hold?
-    ndoubles -= nn1fv*nQ_;
-
-    nrows = 1;
-    rowsize = nQ_;
-    while ( rowsize*nn1fv > ndoubles ) {
-        nrows++;
-        rowsize = nQ_ / nrows;
-        if (nrows * rowsize < nQ_) rowsize++;
-        if (rowsize == 1) break;
+    if ( options_.get_str("DF_INTEGRAL_STORAGE") == "CORE" ) {
+        Qmo_ = (double*)malloc(n*sizeof(double));
+        memset((void*)Qmo_,'\0',n*sizeof(double));
+        return;
     }
 
-    lastrowsize = nQ_ - (nrows - 1L) * rowsize;
-    long int * rowdims2 = new long int [nrows];
-    for (long int i = 0; i < nrows-1; i++) rowdims2[i] = rowsize;
-    rowdims2[nrows-1] = lastrowsize;
+    // back Qmo_ with a file in the scratch directory.  the file is unlinked 
+    // as soon as it is mapped, so it disappears with the mapping, even if 
+    // we don't exit cleanly.  a freshly truncated file reads as zeros.
+    std::string filename = PSIOManager::shared_object()->get_default_path() 
+                         + "psi." + std::to_string(getpid()) + ".v2rdm_casscf.qmo";
 
-    double * tmp3 = (double*)malloc(rowdims2[0] * nn1fv*sizeof(double));
-    memset((void*)tmp3,'\0',rowdims2[0] * nn1fv*sizeof(double));
-    addr = PSIO_ZERO;
-    psio->open(PSIF_DCC_QMO,PSIO_OPEN_OLD);
+    int fd = open(filename.c_str(),O_RDWR | O_CREAT | O_TRUNC,0600);
+    if ( fd < 0 ) {
+        throw PsiException("could not create scratch file for the three-index integrals",__FILE__,__LINE__);
+    }
 
-    long int totalQ = 0;
-    for (long int row = 0; row < nrows; row++) {
-        psio->read(PSIF_DCC_QMO,"(Q|mn) Integrals",(char*)tmp3,sizeof(double)*rowdims2[row] * nn1fv,addr,&addr);
-        for (long int Q = 0; Q < rowdims2[row]; Q++) {
-            for (long int mn = 0; mn < nn1fv; mn++) {
-                Qmo_[mn*nQ_+totalQ] = tmp3[Q*nn1fv+mn];
-            }
-            totalQ++;
-        }
+    size_t bytes = (size_t)n * sizeof(double);
+    if ( ftruncate(fd,(off_t)bytes) != 0 ) {
+        close(fd);
+        unlink(filename.c_str());
+        throw PsiException("could not resize scratch file for the three-index integrals",__FILE__,__LINE__);
     }
-    psio->close(PSIF_DCC_QMO,1);
 
-    delete rowdims2;
-    free(tmp3);
-*/
+    void * map = mmap(NULL,bytes,PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+    close(fd);
+    unlink(filename.c_str());
+    if ( map == MAP_FAILED ) {
+        throw PsiException("could not map scratch file for the three-index integrals",__FILE__,__LINE__);
+    }
+
+    Qmo_           = (double*)map;
+    qmo_map_bytes_ = bytes;
+
+    outfile->Printf("        Three-index integrals are memory-mapped (%7.2lf mb on disk)\n",bytes / 1024.0 / 1024.0);
+    outfile->Printf("\n");
+}
+
+void v2RDMSolver::FreeThreeIndexBuffer() {
+    if ( qmo_map_bytes_ > 0 ) {
+        munmap((void*)Qmo_,qmo_map_bytes_);
+    }else {
+        free(Qmo_);
+    }
+    Qmo_           = NULL;
+    qmo_map_bytes_ = 0;
 }
 
 
@@ -0,0 +1,257 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * v2RDM-CASSCF, a plugin to:
+ *
+ * Psi4: an open-source quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (c) 2014, The Florida State University. All rights reserved.
+ * 
+ *@END LICENSE
+ *
+ */
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<math.h>
+#include<time.h>
+#include<sys/resource.h>
+
+#include <psi4/psi4-dec.h>
+
+#include"timers.h"
+
+#ifdef _OPENMP
+    #include<omp.h>
+#else
+    #define omp_get_wtime() ( (double)clock() / CLOCKS_PER_SEC )
+    #define omp_get_max_threads() 1
+#endif
+
+using namespace psi;
+
+namespace psi{ namespace v2rdm_casscf{
+
+// labels of the fixed phases, in the order of TimerPhase
+static const char * phase_labels[TIMER_NUMBER_OF_PHASES] = {
+    "A.u D2",
+    "A.u Q2",
+    "A.u G2",
+    "A.u T1",
+    "A.u T2",
+    "A.u D3",
+    "A.u sparse",
+    "A^T.u D2",
+    "A^T.u Q2",
+    "A^T.u G2",
+    "A^T.u T1",
+    "A^T.u T2",
+    "A^T.u D3",
+    "A^T.u sparse",
+    "A^T.u task reduction",
+    "CG A.A^T.p",
+    "CG preconditioner",
+    "CG dot",
+    "CG axpy",
+    "Update_xz",
+    "RotateOrbitals",
+    "OrbOpt",
+    "RepackIntegrals",
+    "transform two-electron integrals",
+    "transform three-index integrals",
+    "read two-electron integrals",
+    "UpdatePrimal",
+    "write OPDM",
+    "write TPDM",
+    "write active TPDM",
+    "write active 3PDM",
+    "write TPDM (IWL)",
+    "write checkpoint file",
+    "write molden file"
+};
+
+// JSON string, with quotes and backslashes escaped and control 
+// characters written as \u00XX
+static std::string json_string(const std::string & s) {
+    std::string out = "\"";
+    for (size_t i = 0; i < s.size(); i++) {
+        if ( (unsigned char)s[i] < 0x20 ) {
+            char buf[8];
+            snprintf(buf,sizeof(buf),"\\u%04x",(unsigned char)s[i]);
+            out += buf;
+            continue;
+        }
+        if ( s[i] == '"' || s[i] == '\\' ) out += '\\';
+        out += s[i];
+    }
+    return out + "\"";
+}
+
+// JSON number.  JSON has no nan or inf, so those are written as null
+static std::string json_number(const std::string & s) {
+    if ( !std::isfinite(strtod(s.c_str(),NULL)) ) return "null";
+    return s;
+}
+
+// CSV field, quoted if it contains a comma or a quote
+static std::string csv_string(const std::string & s) {
+    if ( s.find_first_of(",\"") == std::string::npos ) return s;
+    std::string out = "\"";
+    for (size_t i = 0; i < s.size(); i++) {
+        if ( s[i] == '"' ) out += '"';
+        out += s[i];
+    }
+    return out + "\"";
+}
+
+Timers::Timers() {
+    start_ = omp_get_wtime();
+    for (int i = 0; i < TIMER_NUMBER_OF_PHASES; i++) {
+        add(phase_labels[i]);
+    }
+}
+
+int Timers::add(const std::string & label) {
+    labels_.push_back(label);
+    seconds_.push_back(0.0);
+    calls_.push_back(0);
+    return (int)labels_.size() - 1;
+}
+
+void Timers::accumulate(int id, double seconds) {
+    #pragma omp atomic
+    seconds_[id] += seconds;
+    #pragma omp atomic
+    calls_[id]++;
+}
+
+double Timers::peak_memory() {
+    struct rusage usage;
+    if ( getrusage(RUSAGE_SELF,&usage) != 0 ) return 0.0;
+#ifdef __APPLE__
+    // bytes
+    return (double)usage.ru_maxrss / 1024.0 / 1024.0;
+#else
+    // kilobytes
+    return (double)usage.ru_maxrss / 1024.0;
+#endif
+}
+
+void Timers::sample_memory(const std::string & label) {
+    memory_labels_.push_back(label);
+    memory_times_.push_back(omp_get_wtime() - start_);
+    memory_peaks_.push_back(peak_memory());
+}
+
+void Timers::add_info(const std::string & key, const std::string & value) {
+    info_keys_.push_back(key);
+    info_values_.push_back(value);
+    info_numeric_.push_back(false);
+}
+
+void Timers::add_info(const std::string & key, double value) {
+    char buf[64];
+    snprintf(buf,sizeof(buf),"%.12g",value);
+    info_keys_.push_back(key);
+    info_values_.push_back(buf);
+    info_numeric_.push_back(true);
+}
+
+void Timers::print() {
+    outfile->Printf("\n");
+    outfile->Printf("  ==> Timers <==\n");
+    outfile->Printf("\n");
+    outfile->Printf("      %-36s %12s %12s %12s\n","phase","calls","time (s)","per call (s)");
+    for (size_t i = 0; i < labels_.size(); i++) {
+        if ( calls_[i] == 0 ) continue;
+        outfile->Printf("      %-36s %12li %12.3lf %12.3le\n",labels_[i].c_str(),calls_[i],seconds_[i],seconds_[i] / calls_[i]);
+    }
+    outfile->Printf("\n");
+    outfile->Printf("      %-36s %12s %12s\n","memory sample","time (s)","peak (mb)");
+    for (size_t i = 0; i < memory_labels_.size(); i++) {
+        outfile->Printf("      %-36s %12.3lf %12.2lf\n",memory_labels_[i].c_str(),memory_times_[i],memory_peaks_[i]);
+    }
+    outfile->Printf("\n");
+}
+
+void Timers::write_json(const std::string & filename) {
+
+    FILE * fp = fopen(filename.c_str(),"w");
+    if ( fp == NULL ) {
+        outfile->Printf("\n");
+        outfile->Printf("    <<< WARNING >>> could not open %s for writing\n",filename.c_str());
+        outfile->Printf("\n");
+        return;
+    }
+
+    fprintf(fp,"{\n");
+    fprintf(fp,"  \"wall_time\": %.6f,\n",omp_get_wtime() - start_);
+    fprintf(fp,"  \"threads\": %i,\n",omp_get_max_threads());
+
+    fprintf(fp,"  \"info\": {");
+    for (size_t i = 0; i < info_keys_.size(); i++) {
+        fprintf(fp,"%s\n    %s: %s",i > 0 ? "," : "",json_string(info_keys_[i]).c_str(),
+            info_numeric_[i] ? json_number(info_values_[i]).c_str() : json_string(info_values_[i]).c_str());
+    }
+    fprintf(fp,"\n  },\n");
+
+    fprintf(fp,"  \"timers\": [");
+    for (size_t i = 0; i < labels_.size(); i++) {
+        fprintf(fp,"%s\n    {\"phase\": %s, \"calls\": %li, \"seconds\": %.6f}",i > 0 ? "," : "",
+            json_string(labels_[i]).c_str(),calls_[i],seconds_[i]);
+    }
+    fprintf(fp,"\n  ],\n");
+
+    fprintf(fp,"  \"memory\": [");
+    for (size_t i = 0; i < memory_labels_.size(); i++) {
+        fprintf(fp,"%s\n    {\"label\": %s, \"seconds\": %.6f, \"peak_mb\": %.3f}",i > 0 ? "," : "",
+            json_string(memory_labels_[i]).c_str(),memory_times_[i],memory_peaks_[i]);
+    }
+    fprintf(fp,"\n  ]\n");
+    fprintf(fp,"}\n");
+
+    fclose(fp);
+}
+
+void Timers::write_csv(const std::string & filename) {
+
+    FILE * fp = fopen(filename.c_str(),"w");
+    if ( fp == NULL ) {
+        outfile->Printf("\n");
+        outfile->Printf("    <<< WARNING >>> could not open %s for writing\n",filename.c_str());
+        outfile->Printf("\n");
+        return;
+    }
+
+    fprintf(fp,"kind,label,calls,seconds,value\n");
+    fprintf(fp,"info,wall_time,,%.6f,\n",omp_get_wtime() - start_);
+    fprintf(fp,"info,threads,,,%i\n",omp_get_max_threads());
+    for (size_t i = 0; i < info_keys_.size(); i++) {
+        fprintf(fp,"info,%s,,,%s\n",csv_string(info_keys_[i]).c_str(),csv_string(info_values_[i]).c_str());
+    }
+    for (size_t i = 0; i < labels_.size(); i++) {
+        fprintf(fp,"timer,%s,%li,%.6f,\n",csv_string(labels_[i]).c_str(),calls_[i],seconds_[i]);
+    }
+    for (size_t i = 0; i < memory_labels_.size(); i++) {
+        fprintf(fp,"memory,%s,,%.6f,%.3f\n",csv_string(memory_labels_[i]).c_str(),memory_times_[i],memory_peaks_[i]);
+    }
+
+    fclose(fp);
+}
+
+}} // end of namespaces
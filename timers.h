@@ -0,0 +1,131 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * v2RDM-CASSCF, a plugin to:
+ *
+ * Psi4: an open-source quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (c) 2014, The Florida State University. All rights reserved.
+ * 
+ *@END LICENSE
+ *
+ */
+
+#ifndef TIMERS_H
+#define TIMERS_H
+
+#include<string>
+#include<vector>
+
+namespace psi{ namespace v2rdm_casscf{
+
+/// phases of the solver with a fixed timer.  the labels are set in 
+/// Timers::Timers() and must follow this order.
+enum TimerPhase {
+    TIMER_AU_D2 = 0,
+    TIMER_AU_Q2,
+    TIMER_AU_G2,
+    TIMER_AU_T1,
+    TIMER_AU_T2,
+    TIMER_AU_D3,
+    TIMER_AU_SPARSE,
+    TIMER_ATU_D2,
+    TIMER_ATU_Q2,
+    TIMER_ATU_G2,
+    TIMER_ATU_T1,
+    TIMER_ATU_T2,
+    TIMER_ATU_D3,
+    TIMER_ATU_SPARSE,
+    TIMER_ATU_REDUCTION,
+    TIMER_CG_AX,
+    TIMER_CG_PRECONDITION,
+    TIMER_CG_DOT,
+    TIMER_CG_AXPY,
+    TIMER_UPDATE_XZ,
+    TIMER_ROTATE_ORBITALS,
+    TIMER_ORBOPT,
+    TIMER_REPACK_INTEGRALS,
+    TIMER_TRANSFORM_TEI,
+    TIMER_TRANSFORM_THREE_INDEX,
+    TIMER_READ_TEI,
+    TIMER_UPDATE_PRIMAL,
+    TIMER_WRITE_OPDM,
+    TIMER_WRITE_TPDM,
+    TIMER_WRITE_ACTIVE_TPDM,
+    TIMER_WRITE_ACTIVE_3PDM,
+    TIMER_WRITE_TPDM_IWL,
+    TIMER_WRITE_CHECKPOINT,
+    TIMER_WRITE_MOLDEN,
+    TIMER_NUMBER_OF_PHASES
+};
+
+/// 
+/// wall time and number of calls accumulated for each phase of the 
+/// solver, and samples of the peak memory (resident set size).  phases 
+/// may be nested, so times are inclusive.  accumulate() may be called 
+/// by several threads at once, but add() may not.
+/// 
+class Timers {
+  public:
+    Timers();
+
+    /// add a timer beyond the fixed phases.  returns its index
+    int add(const std::string & label);
+
+    /// one call to timer "id" that took "seconds"
+    void accumulate(int id, double seconds);
+
+    /// store the peak resident set size so far, labeled
+    void sample_memory(const std::string & label);
+
+    /// descriptive (key, value) pairs written along with the timers
+    void add_info(const std::string & key, const std::string & value);
+    void add_info(const std::string & key, double value);
+
+    /// print all timers that were called to the output file
+    void print();
+
+    /// write info, timers, and memory samples as JSON or as CSV 
+    /// (columns: kind, label, calls, seconds, value)
+    void write_json(const std::string & filename);
+    void write_csv(const std::string & filename);
+
+    /// peak resident set size of this process (mb)
+    static double peak_memory();
+
+  private:
+    /// wall time at construction
+    double start_;
+
+    std::vector<std::string> labels_;
+    std::vector<double> seconds_;
+    std::vector<long int> calls_;
+
+    std::vector<std::string> memory_labels_;
+    std::vector<double> memory_times_;
+    std::vector<double> memory_peaks_;
+
+    std::vector<std::string> info_keys_;
+    std::vector<std::string> info_values_;
+
+    /// is info_values_[i] a number (written without quotes)?
+    std::vector<bool> info_numeric_;
+};
+
+}} // end of namespaces
+
+#endif
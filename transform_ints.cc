@@ -6,7 +6,8 @@
 using namespace psi;
 using namespace fnocc;
 
-void transform_ints_driver(double * int1, double * int2, double * U, int *nmopi, int *frzvpi, int nirrep, int nQ){
+void transform_ints_driver(double * int1, double * int2, double * U, int *nmopi, int *frzvpi, int nirrep, int nQ,
+                           long int Qstride, long int pqstride){
 
   int max_num_threads = 1;
 
@@ -47,7 +48,7 @@ void transform_ints_driver(double * int1, double * int2, double * U, int *nmopi,
 
   // 3-index transformation
   transform_3index_tei( int2, U, nmopi, U_offset, nmo_offset, nirrep, nQ, 
-                        max_nmopi, nmo_tot, ngem_tot_lt, max_num_threads);
+                        max_nmopi, nmo_tot, ngem_tot_lt, max_num_threads, Qstride, pqstride);
 
   // 2-index transformation
   transform_oei( int1, U, nmopi, frzvpi, U_offset, nmo_offset, nirrep,
@@ -62,7 +63,8 @@ void transform_ints_driver(double * int1, double * int2, double * U, int *nmopi,
 
 void transform_3index_tei(double *int2, double *U, int *nmopi, int* U_offset, 
                                    int* nmo_offset, int nirrep, int nQ, int max_nmopi, 
-                                   int nmo_tot, int ngem_tot_lt, int max_num_threads){
+                                   int nmo_tot, int ngem_tot_lt, int max_num_threads,
+                                   long int Qstride, long int pqstride){
 
   long int int_ind_off, int_ind, int_tmp_off;
 
@@ -78,7 +80,7 @@ void transform_3index_tei(double *int2, double *U, int *nmopi, int* U_offset,
 
       int_tmp_off = 0; //(long int) Q * (long int) max_nmopi * (long int) max_nmopi;
 
-      int_ind_off = (long int) ngem_tot_lt * (long int) Q;  
+      int_ind_off = Qstride * (long int) Q;  
   
       // unpack integrals for this Q  (L > R)
 
@@ -94,12 +96,12 @@ void transform_3index_tei(double *int2, double *U, int *nmopi, int* U_offset,
 
               for (int L = 0; L < nmopi[sym_L]; L++){
 
-                  int_ind = int_ind_off + (long int) INDEX(L+nmo_offset[sym_L],nmo_offset[sym_R]);
+                  int_ind = int_ind_off + pqstride * (long int) INDEX(L+nmo_offset[sym_L],nmo_offset[sym_R]);
 
                   for (int R = 0; R < nmopi[sym_R]; R++){
 
                       int2_tmp1[L*nmopi[sym_R] + R] = int2[int_ind];
-                      int_ind++;
+                      int_ind += pqstride;
   
                   }
 
@@ -129,12 +131,12 @@ void transform_3index_tei(double *int2, double *U, int *nmopi, int* U_offset,
 
               for (int L = 0; L < nmopi[sym_L]; L++){
 
-                  int_ind = int_ind_off + (long int) INDEX(L+nmo_offset[sym_L],nmo_offset[sym_R]);
+                  int_ind = int_ind_off + pqstride * (long int) INDEX(L+nmo_offset[sym_L],nmo_offset[sym_R]);
 
                   for (int R = 0; R < nmopi[sym_R]; R++){
   
                       int2[int_ind] = int2_tmp1[L*nmopi[sym_R] + R];
-                      int_ind++;
+                      int_ind += pqstride;
 
                   }
 
@@ -150,14 +152,14 @@ void transform_3index_tei(double *int2, double *U, int *nmopi, int* U_offset,
 
           for (int L = 0; L < nmopi[sym_L]; L++){
 
-              int_ind = int_ind_off + (long int) INDEX(L+nmo_offset[sym_L],nmo_offset[sym_L]);
+              int_ind = int_ind_off + pqstride * (long int) INDEX(L+nmo_offset[sym_L],nmo_offset[sym_L]);
 
               for (int R = 0; R < L; R++){
 
                   int2_tmp1[L*nmopi[sym_L] + R] = int2[int_ind];
                   int2_tmp1[R*nmopi[sym_L] + L] = int2[int_ind];
 
-                  int_ind++;
+                  int_ind += pqstride;
   
               }
 
@@ -178,12 +180,12 @@ void transform_3index_tei(double *int2, double *U, int *nmopi, int* U_offset,
 
           for (int L = 0; L < nmopi[sym_L]; L++){
 
-              int_ind = int_ind_off + (long int) INDEX(L+nmo_offset[sym_L],nmo_offset[sym_L]);
+              int_ind = int_ind_off + pqstride * (long int) INDEX(L+nmo_offset[sym_L],nmo_offset[sym_L]);
 
               for (int R = 0; R < L; R++){
 
                   int2[int_ind] = int2_tmp1[L*nmopi[sym_L] + R];
-                  int_ind++;
+                  int_ind += pqstride;
 
               }
 
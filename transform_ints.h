@@ -5,11 +5,15 @@
 #include<stdio.h>
 
 
-void transform_ints_driver(double * int1, double *int2, double *U, int *nmopi, int *frzvpi, int nirrep, int nQ);
+// Qstride and pqstride are the strides of the auxiliary and orbital-pair indices
+// of int2: ngem and 1 for (Q|pq) ordering, or 1 and nQ for (pq|Q) ordering
+void transform_ints_driver(double * int1, double *int2, double *U, int *nmopi, int *frzvpi, int nirrep, int nQ,
+                           long int Qstride, long int pqstride);
 
 void transform_3index_tei(double *int2, double *U, int *nmopi, int* U_offset,
                           int* nmo_offset, int nirrep, int nQ, int max_nmopi,
-                          int nmo_tot, int ngem_tot_lt, int max_num_threads);
+                          int nmo_tot, int ngem_tot_lt, int max_num_threads,
+                          long int Qstride, long int pqstride);
 
 void transform_oei(double *int1, double *U, int *nmopi, int * frzvpi, int* U_offset,
                    int* nmo_offset, int nirrep, int max_nmopi,
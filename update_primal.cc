@@ -57,10 +57,20 @@ namespace psi{ namespace v2rdm_casscf{
 // note, we're only transforming the D1/D2/D3
 void v2RDMSolver::UpdatePrimal() {
 
+    // only D1 and D2, at the front of x, are touched.  z and ATy serve as 
+    // scratch, unless they are packed or spin adapted (and shorter than x)
+    long int nd = d1boff[nirrep_-1] + amopi_[nirrep_-1]*amopi_[nirrep_-1];
+    SharedVector zs  = z;
+    SharedVector tmp = ATy;
+    if ( reduced_primal_ ) {
+        zs  = SharedVector(new Vector("UpdatePrimal scratch",nd));
+        tmp = SharedVector(new Vector("UpdatePrimal scratch",nd));
+    }
+
     // D1a, D1b
-    double * z_p  = z->pointer();
+    double * z_p  = zs->pointer();
     double * x_p  = x->pointer();
-    double * tmp_p = ATy->pointer();
+    double * tmp_p = tmp->pointer();
     for (int h = 0; h < nirrep_; h++) {
         double ** t_p = newMO_->pointer(h);
         for (int i = 0; i < amopi_[h]; i++) {
@@ -93,7 +103,7 @@ void v2RDMSolver::UpdatePrimal() {
     TransformFourIndex(x_p+d2aboff[0],tmp_p+d2aboff[0],newMO_);
 
     // unpack D2aa block and copy into z
-    memset((void*)z_p,'\0',dimx_*sizeof(double));
+    memset((void*)z_p,'\0',nd*sizeof(double));
     for (int h = 0; h < nirrep_; h++) {
         for (int ij = 0; ij < gems_aa[h]; ij++) {
             int i = bas_aa_sym[h][ij][0];
@@ -134,8 +144,11 @@ void v2RDMSolver::UpdatePrimal() {
         }
     }
 
+    // D2bb is D2aa for closed shells
+    if ( closed_shell_ ) return;
+
     // unpack D2bb block and copy into z
-    memset((void*)z_p,'\0',dimx_*sizeof(double));
+    memset((void*)z_p,'\0',nd*sizeof(double));
     for (int h = 0; h < nirrep_; h++) {
         for (int ij = 0; ij < gems_aa[h]; ij++) {
             int i = bas_aa_sym[h][ij][0];
@@ -0,0 +1,717 @@
+/*
+ *@BEGIN LICENSE
+ *
+ * v2RDM-CASSCF, a plugin to:
+ *
+ * Psi4: an open-source quantum chemistry software package
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (c) 2014, The Florida State University. All rights reserved.
+ * 
+ *@END LICENSE
+ *
+ */
+
+#include <psi4/psi4-dec.h>
+#include <psi4/liboptions/liboptions.h>
+#include <psi4/libqt/qt.h>
+
+#include<psi4/libmints/wavefunction.h>
+#include<psi4/libmints/vector.h>
+#include<psi4/libmints/matrix.h>
+#include<time.h>
+
+#include<algorithm>
+#include<string.h>
+
+#include"blas.h"
+#include"v2rdm_solver.h"
+
+#ifdef _OPENMP
+    #include<omp.h>
+#else
+    #define omp_get_wtime() ( (double)clock() / CLOCKS_PER_SEC )
+    #define omp_get_max_threads() 1
+    #define omp_get_thread_num() 0
+#endif
+
+using namespace psi;
+using namespace fnocc;
+
+namespace psi{ namespace v2rdm_casscf{
+
+// blocks smaller than this are grouped into tasks of roughly this size
+static const long int update_xz_batch_dim = 32;
+
+static bool compare_cost(const std::pair<double,int> & a, const std::pair<double,int> & b) {
+    return a.first > b.first;
+}
+
+// warm-started projections: relative tolerance on the off-diagonal part 
+// of V^T M V, the number of refinements before giving up, and the number 
+// of warm starts before the eigenvectors are recomputed from scratch
+static double update_xz_warm_tol = 1e-10;
+static int update_xz_warm_maxiter = 3;
+static int update_xz_warm_maxage = 50;
+
+// Newton-Schulz projections: relative size of eigenvalues that are 
+// allowed to remain unconverged, and the maximum number of iterations
+static double update_xz_sign_tol = 1e-11;
+static int update_xz_sign_maxiter = 100;
+
+// number of dim x dim matrices in the Update_xz workspace
+static int update_xz_nmat(const std::string & projection) {
+    if ( projection == "WARM_START" || projection == "NEWTON_SCHULZ" ) return 4;
+    return 2;
+}
+
+// with packed storage, ATy, x, z, rx, and rz are also staged as full squares
+static const int update_xz_nstage = 5;
+
+// out = sum_j f_j v_j v_j^T, f_j = scale * vals[j] >= 0, for n vectors v_j 
+// stored in the rows of vecs.  if out_sqrt is not NULL, also 
+// out_sqrt = sum_j sqrt(f_j) v_j v_j^T (then out is formed as its square)
+static void spectral_sum(long int dim, long int n, double * vecs, double * vals, double scale,
+                         double * scaled, double * out, double * out_sqrt) {
+    if ( out_sqrt == NULL ) {
+        for (long int j = 0; j < n; j++) {
+            double val = scale * vals[j];
+            for (long int q = 0; q < dim; q++) {
+                scaled[j * dim + q] = vecs[j * dim + q] * val;
+            }
+        }
+        F_DGEMM('n','t',dim,dim,n,1.0,scaled,dim,vecs,dim,0.0,out,dim);
+        return;
+    }
+    for (long int j = 0; j < n; j++) {
+        double val = sqrt(scale * vals[j]);
+        for (long int q = 0; q < dim; q++) {
+            scaled[j * dim + q] = vecs[j * dim + q] * val;
+        }
+    }
+    F_DGEMM('n','t',dim,dim,n,1.0,scaled,dim,scaled,dim,0.0,out,dim);
+    F_DGEMM('n','t',dim,dim,n,1.0,scaled,dim,vecs,dim,0.0,out_sqrt,dim);
+}
+
+// optimal dsyev / dsyevr workspace for an n x n matrix
+static long int dsyev_lwork(long int n) {
+    if ( n == 0 ) return 1;
+    double dum = 0.0;
+    double lwork = 0.0;
+    C_DSYEV('V','U',n,&dum,n,&dum,&lwork,-1);
+    return (long int)lwork;
+}
+static void dsyevr_lwork(long int n, long int & lwork, long int & liwork) {
+    lwork  = 1;
+    liwork = 1;
+    if ( n == 0 ) return;
+    double dum = 0.0;
+    double wquery = 0.0;
+    int idum = 0;
+    int iquery = 0;
+    int m = 0;
+    C_DSYEVR('V','V','U',n,&dum,n,0.0,1.0,0,0,0.0,&m,&dum,&dum,n,&idum,&wquery,-1,&iquery,-1);
+    lwork  = (long int)wquery;
+    liwork = (long int)iquery;
+}
+
+// the blocks of x/z range from a few elements (D1) to thousands of rows 
+// (T2).  the largest blocks are diagonalized one at a time so that 
+// threaded LAPACK can use all cores.  the rest are grouped into tasks that
+// are handed to threads largest first.  the dividing line is chosen so 
+// that one workspace per thread costs no more than the workspace for the 
+// largest block.
+void v2RDMSolver::BuildUpdateXZSchedule() {
+
+    int nthreads = omp_get_max_threads();
+
+    dimensions_offset_.resize(dimensions_.size());
+    dimensions_packed_offset_.resize(dimensions_.size());
+    long int myoffset = 0;
+    long int mypackedoffset = 0;
+    long int maxdim = 0;
+    for (int i = 0; i < dimensions_.size(); i++) {
+        dimensions_offset_[i] = myoffset;
+        dimensions_packed_offset_[i] = mypackedoffset;
+        myoffset += (long int)dimensions_[i] * (long int)dimensions_[i];
+        mypackedoffset += (long int)dimensions_[i] * ( (long int)dimensions_[i] + 1 ) / 2;
+        if ( dimensions_[i] > maxdim ) maxdim = dimensions_[i];
+    }
+    dimx_packed_ = mypackedoffset;
+    primal_dim_  = packed_storage_ ? dimx_packed_ : myoffset; // dimx_, unless spin_adapt_d2_
+
+    long int cutoff = (long int)( maxdim / sqrt((double)nthreads) );
+    if ( nthreads == 1 ) cutoff = 0;
+
+    update_xz_serial_blocks_.clear();
+    update_xz_tasks_.clear();
+
+    std::vector< std::pair<double,int> > order;
+    for (int i = 0; i < dimensions_.size(); i++) {
+        if ( dimensions_[i] == 0 ) continue;
+        order.push_back(std::make_pair(pow((double)dimensions_[i],3.0),i));
+    }
+    std::stable_sort(order.begin(),order.end(),compare_cost);
+
+    long int maxpar = 0;
+    std::vector< std::pair<double,int> > tasks;
+    std::vector<int> batch;
+    double batch_cost = 0.0;
+    double batch_target = pow((double)update_xz_batch_dim,3.0);
+    for (size_t k = 0; k < order.size(); k++) {
+        int i = order[k].second;
+        long int dim = dimensions_[i];
+        if ( dim > cutoff ) {
+            update_xz_serial_blocks_.push_back(i);
+            continue;
+        }
+        if ( dim > maxpar ) maxpar = dim;
+        if ( dim >= update_xz_batch_dim ) {
+            update_xz_tasks_.push_back(std::vector<int>(1,i));
+            tasks.push_back(std::make_pair(order[k].first,(int)update_xz_tasks_.size()-1));
+            continue;
+        }
+        batch.push_back(i);
+        batch_cost += order[k].first;
+        if ( batch_cost >= batch_target ) {
+            update_xz_tasks_.push_back(batch);
+            tasks.push_back(std::make_pair(batch_cost,(int)update_xz_tasks_.size()-1));
+            batch.clear();
+            batch_cost = 0.0;
+        }
+    }
+    if ( batch.size() > 0 ) {
+        update_xz_tasks_.push_back(batch);
+        tasks.push_back(std::make_pair(batch_cost,(int)update_xz_tasks_.size()-1));
+    }
+
+    // largest tasks first
+    std::stable_sort(tasks.begin(),tasks.end(),compare_cost);
+    std::vector< std::vector<int> > sorted;
+    for (size_t k = 0; k < tasks.size(); k++) {
+        sorted.push_back(update_xz_tasks_[tasks[k].second]);
+    }
+    update_xz_tasks_.swap(sorted);
+
+    // workspace: two matrices (four for warm starts), eigenvalues, and LAPACK scratch (dsyev or dsyevr)
+    double nmat = (double)( update_xz_nmat(psd_projection_) + ( packed_storage_ ? update_xz_nstage : 0 ) );
+    long int maxser = update_xz_serial_blocks_.size() > 0 ? dimensions_[update_xz_serial_blocks_[0]] : 0;
+    long int lwork_r, liwork_r;
+
+    dsyevr_lwork(maxser,lwork_r,liwork_r);
+    update_xz_serial_lwork_  = std::max(dsyev_lwork(maxser),lwork_r);
+    update_xz_serial_liwork_ = liwork_r + 2 * maxser;
+
+    dsyevr_lwork(maxpar,lwork_r,liwork_r);
+    update_xz_thread_lwork_  = std::max(dsyev_lwork(maxpar),lwork_r);
+    update_xz_thread_liwork_ = liwork_r + 2 * maxpar;
+
+    // number of positive eigenvalues of each block in the previous iteration (unknown)
+    update_xz_npos_.assign(dimensions_.size(),-1);
+
+    // no eigenvectors from a previous iteration yet
+    update_xz_warm_.assign(dimensions_.size(),0);
+
+    // (in doubles; integer workspace counted as half a double)
+    update_xz_memory_  = nmat * maxser * maxser + maxser + update_xz_serial_lwork_ + 0.5 * update_xz_serial_liwork_;
+    if ( update_xz_tasks_.size() > 0 ) {
+        update_xz_memory_ += (double)nthreads * ( nmat * maxpar * maxpar + maxpar + update_xz_thread_lwork_ + 0.5 * update_xz_thread_liwork_ );
+    }
+
+    // eigenvectors of every block, kept between iterations
+    if ( psd_projection_ == "WARM_START" ) {
+        update_xz_memory_ += (double)myoffset;
+    }
+}
+
+void v2RDMSolver::AllocateUpdateXZWorkspace() {
+
+    int nthreads = omp_get_max_threads();
+
+    long int maxser = update_xz_serial_blocks_.size() > 0 ? dimensions_[update_xz_serial_blocks_[0]] : 0;
+    long int maxpar = 0;
+    for (size_t t = 0; t < update_xz_tasks_.size(); t++) {
+        for (size_t k = 0; k < update_xz_tasks_[t].size(); k++) {
+            if ( dimensions_[update_xz_tasks_[t][k]] > maxpar ) maxpar = dimensions_[update_xz_tasks_[t][k]];
+        }
+    }
+
+    long int nmat = update_xz_nmat(psd_projection_) + ( packed_storage_ ? update_xz_nstage : 0 );
+
+    update_xz_serial_work_  = (double*)malloc((nmat * maxser * maxser + maxser + update_xz_serial_lwork_)*sizeof(double));
+    update_xz_serial_iwork_ = (int*)malloc(update_xz_serial_liwork_*sizeof(int));
+
+    update_xz_thread_work_.resize(nthreads);
+    update_xz_thread_iwork_.resize(nthreads);
+    for (int t = 0; t < nthreads; t++) {
+        update_xz_thread_work_[t]  = NULL;
+        update_xz_thread_iwork_[t] = NULL;
+        if ( update_xz_tasks_.size() == 0 ) continue;
+        update_xz_thread_work_[t]  = (double*)malloc((nmat * maxpar * maxpar + maxpar + update_xz_thread_lwork_)*sizeof(double));
+        update_xz_thread_iwork_[t] = (int*)malloc(update_xz_thread_liwork_*sizeof(int));
+    }
+
+    update_xz_evec_ = NULL;
+    if ( psd_projection_ == "WARM_START" ) {
+        update_xz_evec_ = (double*)malloc(dimx_*sizeof(double));
+    }
+}
+
+// update x and z
+void v2RDMSolver::Update_xz() {
+
+    // evaluate M(mu*x + ATy - c)
+    bpsdp_ATu_packed(ATy,y);
+    ATy->subtract(c);
+    x->scale(mu);
+    ATy->add(x);
+
+    // large blocks, one at a time
+    for (size_t k = 0; k < update_xz_serial_blocks_.size(); k++) {
+        double start = omp_get_wtime();
+        UpdateBlock(update_xz_serial_blocks_[k],
+                    update_xz_serial_work_,update_xz_serial_lwork_,
+                    update_xz_serial_iwork_,update_xz_serial_liwork_);
+        timers_.accumulate(update_xz_block_timers_ + update_xz_serial_blocks_[k],omp_get_wtime() - start);
+    }
+
+    // everything else, distributed over threads
+    #pragma omp parallel for schedule (dynamic,1)
+    for (int t = 0; t < (int)update_xz_tasks_.size(); t++) {
+        int thread = omp_get_thread_num();
+        for (size_t k = 0; k < update_xz_tasks_[t].size(); k++) {
+            double start = omp_get_wtime();
+            UpdateBlock(update_xz_tasks_[t][k],
+                        update_xz_thread_work_[thread],update_xz_thread_lwork_,
+                        update_xz_thread_iwork_[thread],update_xz_thread_liwork_);
+            timers_.accumulate(update_xz_block_timers_ + update_xz_tasks_[t][k],omp_get_wtime() - start);
+        }
+    }
+}
+
+// project one block of M(mu*x + ATy - c) = U+ + U-.  x = U+/mu, z = -U-
+void v2RDMSolver::UpdateBlock(int block, double * work, long int lwork, int * iwork, long int liwork) {
+
+    long int dim = dimensions_[block];
+
+    if ( !packed_storage_ ) {
+        long int myoffset = dimensions_offset_[block];
+        ProjectBlock(block,ATy->pointer() + myoffset,x->pointer() + myoffset,z->pointer() + myoffset,
+                     update_xz_sqrt_ ? rx->pointer() + myoffset : NULL,
+                     update_xz_sqrt_ ? rz->pointer() + myoffset : NULL,
+                     work,lwork,iwork,liwork);
+        return;
+    }
+
+    // packed storage: the projections work on full squares, which are 
+    // staged at the front of the workspace
+    long int myoffset = dimensions_packed_offset_[block];
+
+    double * A_p  = work;
+    double * x_p  = A_p + dim * dim;
+    double * z_p  = x_p + dim * dim;
+    double * rx_p = update_xz_sqrt_ ? z_p + dim * dim : NULL;
+    double * rz_p = update_xz_sqrt_ ? rx_p + dim * dim : NULL;
+
+    UnpackBlock(dim,ATy->pointer() + myoffset,A_p);
+
+    ProjectBlock(block,A_p,x_p,z_p,rx_p,rz_p,work + update_xz_nstage * dim * dim,lwork,iwork,liwork);
+
+    PackBlock(dim,x_p,x->pointer() + myoffset);
+    PackBlock(dim,z_p,z->pointer() + myoffset);
+    if ( update_xz_sqrt_ ) {
+        PackBlock(dim,rx_p,rx->pointer() + myoffset);
+        PackBlock(dim,rz_p,rz->pointer() + myoffset);
+    }
+}
+
+void v2RDMSolver::ProjectBlock(int block, double * A_p, double * x_p, double * z_p, double * rx_p, double * rz_p,
+                               double * work, long int lwork, int * iwork, long int liwork) {
+
+    // partial spectra do not pay off for small blocks.  neither the partial 
+    // nor the Newton-Schulz projection gives the square roots for DIIS
+    if ( psd_projection_ == "PARTIAL" && update_xz_npos_[block] >= 0 && dimensions_[block] >= update_xz_batch_dim && !update_xz_sqrt_ ) {
+        UpdateBlockPartial(block,A_p,x_p,z_p,work,lwork,iwork,liwork);
+        return;
+    }
+
+    // matrix sign function by Newton-Schulz iteration, for large blocks only
+    if ( psd_projection_ == "NEWTON_SCHULZ" && dimensions_[block] >= newton_schulz_min_dim_ && !update_xz_sqrt_ ) {
+        if ( UpdateBlockNewtonSchulz(block,A_p,x_p,z_p,work) ) return;
+    }
+
+    // refine the eigenvectors of the last iteration.  diagonalize from scratch if that fails
+    if ( psd_projection_ == "WARM_START" && update_xz_warm_[block] ) {
+        if ( UpdateBlockWarm(block,A_p,x_p,z_p,rx_p,rz_p,work) ) return;
+    }
+
+    long int dim      = dimensions_[block];
+    long int myoffset = dimensions_offset_[block];
+
+    double * mat    = work;
+    double * scaled = work + dim * dim;
+    double * eval   = scaled + dim * dim;
+    double * lwork_p = eval + dim;
+
+    for (long int p = 0; p < dim; p++) {
+        for (long int q = p; q < dim; q++) {
+            double dum = 0.5 * ( A_p[p * dim + q] + A_p[q * dim + p] );
+            mat[p * dim + q] = mat[q * dim + p] = dum;
+        }
+    }
+
+    // eigenvalues in ascending order; eigenvector j in row j of mat
+    C_DSYEV('V','U',dim,mat,dim,eval,lwork_p,lwork);
+
+    long int nneg = 0;
+    while ( nneg < dim && eval[nneg] < 0.0 ) nneg++;
+    long int first_pos = nneg;
+    while ( first_pos < dim && eval[first_pos] == 0.0 ) first_pos++;
+    long int npos = dim - first_pos;
+
+    update_xz_npos_[block] = npos;
+
+    // keep the eigenvectors as a guess for the next iteration
+    if ( psd_projection_ == "WARM_START" && dim >= update_xz_batch_dim ) {
+        C_DCOPY(dim * dim,mat,1,update_xz_evec_ + myoffset,1);
+        update_xz_warm_[block] = 1;
+    }
+
+    // (+) part
+    spectral_sum(dim,npos,mat + first_pos * dim,eval + first_pos,1.0/mu,scaled,x_p,rx_p);
+
+    // (-) part
+    spectral_sum(dim,nneg,mat,eval,-1.0,scaled,z_p,rz_p);
+}
+
+// project one block of M(mu*x + ATy - c) using only the eigenpairs of the
+// smaller of U+ and U-, as judged by the previous iteration.  the other 
+// part follows from M = U+ + U-.  if the guess is wrong, the result is 
+// still exact, only more expensive.
+void v2RDMSolver::UpdateBlockPartial(int block, double * A_p, double * x_p, double * z_p,
+                                     double * work, long int lwork, int * iwork, long int liwork) {
+
+    long int dim      = dimensions_[block];
+
+    double * mat    = work;
+    double * evec   = work + dim * dim;
+    double * eval   = evec + dim * dim;
+    double * lwork_p = eval + dim;
+    int * isuppz    = iwork;
+    int * liwork_p  = iwork + 2 * dim;
+
+    for (long int p = 0; p < dim; p++) {
+        for (long int q = p; q < dim; q++) {
+            double dum = 0.5 * ( A_p[p * dim + q] + A_p[q * dim + p] );
+            mat[p * dim + q] = mat[q * dim + p] = dum;
+        }
+    }
+
+    // which part is smaller?
+    bool positive = ( 2 * update_xz_npos_[block] <= dim );
+
+    // eigenpairs in (0, inf) or (-inf, 0].  eigenvector j in row j of evec
+    double big = 1.0;
+    for (long int p = 0; p < dim; p++) {
+        double rowsum = 0.0;
+        for (long int q = 0; q < dim; q++) {
+            rowsum += fabs(mat[p * dim + q]);
+        }
+        if ( rowsum > big ) big = rowsum;
+    }
+    big *= 2.0;
+    double vl = positive ? 0.0 : -big;
+    double vu = positive ? big : 0.0;
+
+    int m = 0;
+    C_DSYEVR('V','V','U',dim,mat,dim,vl,vu,0,0,0.0,&m,eval,evec,dim,isuppz,lwork_p,lwork,liwork_p,liwork - 2 * dim);
+
+    // U = sum_j eval_j v_j v_j^T, for the computed part.  mat is free again
+    for (long int j = 0; j < m; j++) {
+        for (long int q = 0; q < dim; q++) {
+            mat[j * dim + q] = evec[j * dim + q] * eval[j];
+        }
+    }
+
+    if ( positive ) {
+
+        // x = U+/mu
+        F_DGEMM('n','t',dim,dim,m,1.0/mu,mat,dim,evec,dim,0.0,x_p,dim);
+
+        // z = -U- = U+ - M
+        for (long int p = 0; p < dim; p++) {
+            for (long int q = 0; q < dim; q++) {
+                double M = 0.5 * ( A_p[p * dim + q] + A_p[q * dim + p] );
+                z_p[p * dim + q] = mu * x_p[p * dim + q] - M;
+            }
+        }
+
+        update_xz_npos_[block] = m;
+
+    }else {
+
+        // z = -U-
+        F_DGEMM('n','t',dim,dim,m,-1.0,mat,dim,evec,dim,0.0,z_p,dim);
+
+        // x = U+/mu = (M - U-)/mu
+        for (long int p = 0; p < dim; p++) {
+            for (long int q = 0; q < dim; q++) {
+                double M = 0.5 * ( A_p[p * dim + q] + A_p[q * dim + p] );
+                x_p[p * dim + q] = ( M + z_p[p * dim + q] ) / mu;
+            }
+        }
+
+        // (-inf, 0] includes zero eigenvalues
+        update_xz_npos_[block] = dim - m;
+    }
+}
+
+// project one block of M(mu*x + ATy - c), starting from the eigenvectors
+// V of the previous iteration.  B = V^T M V is nearly diagonal, so all 
+// the Jacobi rotations that would diagonalize it can be applied at once: 
+// V <- V W, where W = (1 + K)(1 - K^2)^(-1/2) for antisymmetric K.  the 
+// error is second order in the off-diagonal part of B.  everything is 
+// done with DGEMM.  returns false if the refinement cannot be trusted (V 
+// is then left in an undefined state).
+bool v2RDMSolver::UpdateBlockWarm(int block, double * A_p, double * x_p, double * z_p, double * rx_p, double * rz_p, double * work) {
+
+    long int dim      = dimensions_[block];
+    long int myoffset = dimensions_offset_[block];
+
+    double * mat  = work;
+    double * tmp  = mat + dim * dim;
+    double * B    = tmp + dim * dim;
+    double * W    = B + dim * dim;
+    double * eval = W + dim * dim;
+
+    double * V   = update_xz_evec_ + myoffset;
+
+    // the orthonormality of V slowly degrades; start over once in a while
+    if ( update_xz_warm_[block] > update_xz_warm_maxage ) return false;
+
+    for (long int p = 0; p < dim; p++) {
+        for (long int q = p; q < dim; q++) {
+            double dum = 0.5 * ( A_p[p * dim + q] + A_p[q * dim + p] );
+            mat[p * dim + q] = mat[q * dim + p] = dum;
+        }
+    }
+
+    bool converged = false;
+    for (int iter = 0; iter <= update_xz_warm_maxiter; iter++) {
+
+        // B = V^T M V (eigenvector j is column j of V)
+        F_DGEMM('n','n',dim,dim,dim,1.0,mat,dim,V,dim,0.0,tmp,dim);
+        F_DGEMM('t','n',dim,dim,dim,1.0,V,dim,tmp,dim,0.0,B,dim);
+
+        double normB = sqrt(C_DDOT(dim * dim,B,1,B,1));
+        double off = 0.0;
+        for (long int p = 0; p < dim; p++) {
+            for (long int q = p + 1; q < dim; q++) {
+                off += 2.0 * B[p * dim + q] * B[p * dim + q];
+            }
+        }
+        off = sqrt(off);
+
+        for (long int j = 0; j < dim; j++) {
+            eval[j] = B[j * dim + j];
+        }
+
+        if ( off <= update_xz_warm_tol * normB ) {
+            converged = true;
+            break;
+        }
+        if ( iter == update_xz_warm_maxiter ) break;
+
+        // K from the Jacobi rotation of every pair.  the eigenvalues pick 
+        // up the same second-order shifts as in a 2x2 rotation
+        memset((void*)W,'\0',dim * dim * sizeof(double));
+        for (long int p = 0; p < dim; p++) {
+            for (long int q = p + 1; q < dim; q++) {
+                double bpq = B[p * dim + q];
+                if ( bpq == 0.0 ) continue;
+                double theta = 0.5 * ( B[q * dim + q] - B[p * dim + p] ) / bpq;
+                double t = 1.0 / ( fabs(theta) + sqrt(theta * theta + 1.0) );
+                if ( theta < 0.0 ) t = -t;
+                // column p of K gets -t v_q, column q gets +t v_p
+                W[p * dim + q] = -t;
+                W[q * dim + p] =  t;
+                eval[p] -= t * bpq;
+                eval[q] += t * bpq;
+            }
+        }
+
+        // bound on the 2-norm of K (max column sum, K is antisymmetric, or Frobenius norm)
+        double normK = 0.0;
+        double normK_F = 0.0;
+        for (long int p = 0; p < dim; p++) {
+            double colsum = 0.0;
+            for (long int q = 0; q < dim; q++) {
+                colsum  += fabs(W[p * dim + q]);
+                normK_F += W[p * dim + q] * W[p * dim + q];
+            }
+            if ( colsum > normK ) normK = colsum;
+        }
+        normK = std::min(normK,sqrt(normK_F));
+
+        // W is orthogonal up to O(K^4) terms.  too far from the old 
+        // eigenvectors for that to be good enough
+        if ( normK * normK * normK * normK > update_xz_warm_tol ) break;
+
+        // W = (1 + K)(1 + K^2/2)
+        F_DGEMM('n','n',dim,dim,dim,0.5,W,dim,W,dim,0.0,B,dim);
+        for (long int p = 0; p < dim; p++) {
+            W[p * dim + p] += 1.0;
+            B[p * dim + p] += 1.0;
+        }
+        F_DGEMM('n','n',dim,dim,dim,1.0,W,dim,B,dim,0.0,tmp,dim);
+
+        // V = V W
+        F_DGEMM('n','n',dim,dim,dim,1.0,V,dim,tmp,dim,0.0,W,dim);
+        C_DCOPY(dim * dim,W,1,V,1);
+
+        // what is left of the off-diagonal part of B is ~ [K, B]
+        if ( 2.0 * normK * off <= update_xz_warm_tol * normB ) {
+            converged = true;
+            break;
+        }
+    }
+    if ( !converged ) return false;
+
+    update_xz_warm_[block]++;
+
+    // eigenvalues are not sorted.  gather each part into W (vectors) and 
+    // tmp (values), and use mat as scratch
+    double * packed = W;
+    double * vals   = tmp;
+
+    // (+) part
+    long int npos = 0;
+    for (long int j = 0; j < dim; j++) {
+        if ( eval[j] <= 0.0 ) continue;
+        C_DCOPY(dim,V + j * dim,1,packed + npos * dim,1);
+        vals[npos++] = eval[j];
+    }
+    spectral_sum(dim,npos,packed,vals,1.0/mu,mat,x_p,rx_p);
+
+    update_xz_npos_[block] = npos;
+
+    // (-) part
+    long int nneg = 0;
+    for (long int j = 0; j < dim; j++) {
+        if ( eval[j] >= 0.0 ) continue;
+        C_DCOPY(dim,V + j * dim,1,packed + nneg * dim,1);
+        vals[nneg++] = eval[j];
+    }
+    spectral_sum(dim,nneg,packed,vals,-1.0,mat,z_p,rz_p);
+
+    return true;
+}
+
+// sign(M) by the scaled Newton-Schulz iteration of Chen and Chow [SIAM J. 
+// Matrix Anal. Appl. 35, 1263 (2014)], X <- a X (3 - a^2 X^2) / 2, which 
+// needs nothing but DGEMM.  M need not be symmetric, but it must have real
+// eigenvalues.  the spectrum of M/alpha, with alpha >= |M|_2, lies in 
+// [-1,-l] U [l,1], and the same iteration maps that interval onto itself
+// with a larger l.  eigenvalues below l = update_xz_sign_tol never 
+// converge, but their contribution to U+ and U- is negligible anyway.
+// X is dim x dim; X2 and tmp are scratch.  returns false if l stalls.
+bool v2RDMSolver::MatrixSign(long int dim, double * mat, double * X, double * X2, double * tmp) {
+
+    // |M|_2 <= min(|M|_F, sqrt(|M|_1 |M|_inf))
+    double normF = sqrt(C_DDOT(dim * dim,mat,1,mat,1));
+    double norm1 = 0.0;
+    double normI = 0.0;
+    for (long int p = 0; p < dim; p++) {
+        double rowsum = 0.0;
+        double colsum = 0.0;
+        for (long int q = 0; q < dim; q++) {
+            rowsum += fabs(mat[p * dim + q]);
+            colsum += fabs(mat[q * dim + p]);
+        }
+        if ( rowsum > normI ) normI = rowsum;
+        if ( colsum > norm1 ) norm1 = colsum;
+    }
+    double alpha = std::min(normF,sqrt(norm1 * normI));
+
+    // M = 0
+    if ( alpha == 0.0 ) {
+        memset((void*)X,'\0',dim * dim * sizeof(double));
+        return true;
+    }
+
+    C_DCOPY(dim * dim,mat,1,X,1);
+    C_DSCAL(dim * dim,1.0/alpha,X,1);
+
+    double l = update_xz_sign_tol;
+    for (int iter = 0; iter < update_xz_sign_maxiter; iter++) {
+
+        if ( 1.0 - l < 1e-15 ) return true;
+
+        // optimal scaling for the interval [l,1]
+        double a = sqrt( 3.0 / ( 1.0 + l + l * l ) );
+
+        // X <- (3a/2) X - (a^3/2) X^3
+        F_DGEMM('n','n',dim,dim,dim,1.0,X,dim,X,dim,0.0,X2,dim);
+        F_DGEMM('n','n',dim,dim,dim,1.0,X,dim,X2,dim,0.0,tmp,dim);
+        C_DSCAL(dim * dim,1.5 * a,X,1);
+        C_DAXPY(dim * dim,-0.5 * a * a * a,tmp,1,X,1);
+
+        l = 0.5 * a * l * ( 3.0 - a * a * l * l );
+    }
+    return false;
+}
+
+// project one block of M(mu*x + ATy - c) with the matrix sign function:
+// U+ = M (1 + sign(M)) / 2 and U- = M (1 - sign(M)) / 2.  returns false 
+// if the iteration does not converge.
+bool v2RDMSolver::UpdateBlockNewtonSchulz(int block, double * A_p, double * x_p, double * z_p, double * work) {
+
+    long int dim      = dimensions_[block];
+
+    double * mat  = work;
+    double * S    = mat + dim * dim;
+    double * X2   = S + dim * dim;
+    double * tmp  = X2 + dim * dim;
+
+    for (long int p = 0; p < dim; p++) {
+        for (long int q = p; q < dim; q++) {
+            double dum = 0.5 * ( A_p[p * dim + q] + A_p[q * dim + p] );
+            mat[p * dim + q] = mat[q * dim + p] = dum;
+        }
+    }
+
+    if ( !MatrixSign(dim,mat,S,X2,tmp) ) return false;
+
+    // |M| = M sign(M), symmetrized
+    F_DGEMM('n','n',dim,dim,dim,1.0,mat,dim,S,dim,0.0,tmp,dim);
+
+    // x = (M + |M|) / (2 mu), z = (|M| - M) / 2
+    for (long int p = 0; p < dim; p++) {
+        for (long int q = p; q < dim; q++) {
+            double absM = 0.5 * ( tmp[p * dim + q] + tmp[q * dim + p] );
+            double M    = mat[p * dim + q];
+            x_p[p * dim + q] = x_p[q * dim + p] = 0.5 * ( M + absM ) / mu;
+            z_p[p * dim + q] = z_p[q * dim + p] = 0.5 * ( absM - M );
+        }
+    }
+
+    // the inertia is not available
+    update_xz_npos_[block] = -1;
+
+    return true;
+}
+
+}} // end of namespaces
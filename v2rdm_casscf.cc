@@ -87,6 +87,11 @@ int read_options(std::string name, Options& options)
         options.add_bool("SPIN_ADAPT_Q2", false);
         /*- Do constrain spin squared? -*/
         options.add_bool("CONSTRAIN_SPIN", true);
+        /*- Store alpha and beta blocks once for a closed-shell singlet? -*/
+        options.add_bool("CLOSED_SHELL", false);
+        /*- Do store D2 as singlet and triplet blocks during the iterations 
+        (singlets only)? -*/
+        options.add_bool("SPIN_ADAPT_D2", false);
         /*- convergence in the primal/dual energy gap -*/
         options.add_double("E_CONVERGENCE", 1e-4);
         /*- convergence in the primal error -*/
@@ -97,10 +102,44 @@ int read_options(std::string name, Options& options)
         options.add_int("MAXITER", 10000);
         /*- maximum number of conjugate gradient iterations -*/
         options.add_int("CG_MAXITER", 10000);
-        /*- maximum number of diis vectors -*/
-        options.add_int("DIIS_MAX_VECS", 8);
+        /*- maximum number of diis vectors for extrapolation of the primal and 
+        dual solutions.  DIIS is off if this is less than 2. -*/
+        options.add_int("DIIS_MAX_VECS", 0);
         /*- Frequency of DIIS extrapolation steps -*/
         options.add_int("DIIS_UPDATE_FREQUENCY",50);
+        /*- Algorithm for the projection of M(mu*x + A^T.y - c) onto the 
+        primal and dual solutions.  FULL diagonalizes each block.  PARTIAL 
+        computes only the eigenpairs of the smaller (positive or negative) 
+        part of each block.  WARM_START refines the eigenvectors of the 
+        previous iteration with simultaneous Jacobi rotations and diagonalizes from scratch 
+        only when that fails.  NEWTON_SCHULZ evaluates the matrix sign 
+        function with matrix multiplications only. -*/
+        options.add_str("PSD_PROJECTION","FULL","FULL PARTIAL WARM_START NEWTON_SCHULZ");
+        /*- Smallest block for which PSD_PROJECTION = NEWTON_SCHULZ is used. 
+        Smaller blocks are diagonalized. -*/
+        options.add_int("NEWTON_SCHULZ_MIN_DIM",256);
+        /*- Do store only the lower triangle of each block of the primal 
+        and dual solutions? Roughly halves the memory for x, z, c, and DIIS. -*/
+        options.add_bool("PACKED_STORAGE",false);
+        /*- Do evaluate the constraint families in A.u and A^T.u 
+        concurrently as OpenMP tasks? -*/
+        options.add_bool("CONSTRAINT_TASKS",false);
+        /*- Do use the reference (unoptimized) implementation of the 
+        T2 constraints in A.u and A^T.u? -*/
+        options.add_bool("SLOW_T2_CONSTRAINTS",false);
+        /*- Do build explicit sparse representations of the constraint 
+        matrix and its transpose for the boundary-point SDP solver? -*/
+        options.add_bool("SPARSE_CONSTRAINT_MATRIX",false);
+        /*- Do build an explicit sparse A.A^T for the conjugate gradient 
+        solver?  Implies SPARSE_CONSTRAINT_MATRIX. -*/
+        options.add_bool("SPARSE_GRAM_MATRIX",false);
+        /*- Do precondition the conjugate gradient solver with the 
+        diagonal of A.A^T? -*/
+        options.add_bool("CG_PRECONDITIONER",false);
+        /*- Do factorize A.A^T once (minimum degree ordering and sparse 
+        Cholesky) and use the factor in the dual update?  Implies 
+        SPARSE_CONSTRAINT_MATRIX. -*/
+        options.add_bool("SPARSE_CHOLESKY",false);
 
         /*- Auxiliary basis set for SCF density fitting computations.
         :ref:`Defaults <apdx:basisFamily>` to a JKFIT basis. -*/
@@ -111,6 +150,20 @@ int read_options(std::string name, Options& options)
         options.add_str("SCF_TYPE", "DF", "DF CD PK OUT_OF_CORE DIRECT");
         /*- Tolerance for Cholesky decomposition of the ERI tensor -*/
         options.add_double("CHOLESKY_TOLERANCE",1e-4);
+        /*- Order of the three-index integrals in memory.  QMN stores (Q|mn) 
+        with the auxiliary index slowest; MNQ stores (mn|Q) so that 
+        contractions over the auxiliary index run over contiguous memory. -*/
+        options.add_str("DF_INTEGRAL_ORDER", "QMN", "QMN MNQ");
+        /*- Where to keep the three-index integrals.  CORE holds them in memory.  
+        DISK keeps them in a memory-mapped file in the scratch directory, so 
+        they do not count against the memory limit. -*/
+        options.add_str("DF_INTEGRAL_STORAGE", "CORE", "CORE DISK");
+        /*- Which four-index integrals to keep for conventional (non-DF) 
+        integrals.  FULL keeps all of them.  ACTIVE keeps only those 
+        over core and active orbitals, which is all that is needed when the 
+        orbitals are fixed.  ACTIVE requires OPTIMIZE_ORBITALS = false and 
+        SEMICANONICALIZE_ORBITALS = false, and is not available for gradients. -*/
+        options.add_str("TEI_STORAGE", "FULL", "FULL ACTIVE");
 
         /*- SUBSECTION ORBITAL OPTIMIZATION -*/
 
@@ -143,6 +196,14 @@ int read_options(std::string name, Options& options)
         (if set), or else by the name of the output file plus the name of
         the current molecule. -*/
         options.add_bool("ORBOPT_WRITE", false);
+        /*- Do print per-phase timers and peak memory and write them to 
+        disk?  If so, the filename will end in .timers.json or .timers.csv, 
+        and the prefix is determined by |globals__writer_file_label| (if 
+        set), or else by the name of the output file plus the name of the 
+        current molecule. -*/
+        options.add_bool("TIMERS_WRITE", false);
+        /*- File format for TIMERS_WRITE -*/
+        options.add_str("TIMERS_FORMAT", "JSON", "JSON CSV");
         /*- Base filename for text files written by PSI, such as the
         MOLDEN output file, the Hessian file, the internal coordinate file,
         etc. Use the add_str_i function to make this string case sensitive. -*/
@@ -118,6 +118,15 @@ static void evaluate_Ap(long int n, SharedVector Ax, SharedVector x, void * data
     // call a function from class to evaluate Ax product:
     BPSDPcg->cg_Ax(n,Ax,x);
 
+}
+
+static void evaluate_Mr(long int n, SharedVector z, SharedVector r, void * data) {
+
+    // reinterpret void * as an instance of v2RDMSolver
+    v2rdm_casscf::v2RDMSolver* BPSDPcg = reinterpret_cast<v2rdm_casscf::v2RDMSolver*>(data);
+    // call a function from class to apply the preconditioner:
+    BPSDPcg->cg_precondition(n,z,r);
+
 }
 namespace psi{ namespace v2rdm_casscf{
 
@@ -127,9 +136,118 @@ v2RDMSolver::v2RDMSolver(SharedWavefunction reference_wavefunction,Options & opt
     common_init();
 }
 
+// synthetic active space: no reference wavefunction, integrals, or solver
+// workspace.  only the index maps and constraint offsets are built, which
+// is all the constraint kernels need (see BenchmarkConstraints())
+v2RDMSolver::v2RDMSolver(Options & options,int nirrep,int * amopi,int nalpha,int nbeta):
+    Wavefunction(options){
+
+    if ( nirrep != 1 && nirrep != 2 && nirrep != 4 && nirrep != 8 ) {
+        throw PsiException("the number of irreps must be 1, 2, 4, or 8",__FILE__,__LINE__);
+    }
+
+    is_df_   = false;
+    active_space_tei_ = false;
+    Qmo_     = NULL;
+    qmo_map_bytes_ = 0;
+    qmo_qstride_  = 0;
+    qmo_pqstride_ = 1;
+    nirrep_  = nirrep;
+    nalpha_  = nalpha;
+    nbeta_   = nbeta;
+    multiplicity_ = nalpha_ - nbeta_ + 1;
+
+    nalphapi_ = Dimension(nirrep_);
+    nbetapi_  = Dimension(nirrep_);
+    doccpi_   = Dimension(nirrep_);
+    soccpi_   = Dimension(nirrep_);
+    frzcpi_   = Dimension(nirrep_);
+    frzvpi_   = Dimension(nirrep_);
+    nmopi_    = Dimension(nirrep_);
+    nsopi_    = Dimension(nirrep_);
+
+    rstcpi_   = (int*)malloc(nirrep_*sizeof(int));
+    rstvpi_   = (int*)malloc(nirrep_*sizeof(int));
+    amopi_    = (int*)malloc(nirrep_*sizeof(int));
+    memset((void*)rstcpi_,'\0',nirrep_*sizeof(int));
+    memset((void*)rstvpi_,'\0',nirrep_*sizeof(int));
+
+    amo_   = 0;
+    nfrzc_ = 0;
+    nfrzv_ = 0;
+    nrstc_ = 0;
+    nrstv_ = 0;
+    for (int h = 0; h < nirrep_; h++) {
+        if ( amopi[h] < 0 ) {
+            throw PsiException("the number of active orbitals per irrep cannot be negative",__FILE__,__LINE__);
+        }
+        amopi_[h] = amopi[h];
+        nmopi_[h] = amopi[h];
+        nsopi_[h] = amopi[h];
+        amo_     += amopi[h];
+    }
+    nmo_ = amo_;
+    nso_ = amo_;
+
+    if ( nbeta_ < 0 || nbeta_ > nalpha_ || nalpha_ > amo_ ) {
+        throw PsiException("need 0 <= nbeta <= nalpha <= number of active orbitals",__FILE__,__LINE__);
+    }
+
+    // BuildBasis() orders orbitals by energy; any ordering will do here
+    epsilon_a_ = SharedVector(new Vector(nirrep_, nmopi_));
+    for (int h = 0; h < nirrep_; h++) {
+        for (int i = 0; i < nmopi_[h]; i++) {
+            epsilon_a_->pointer(h)[i] = (double)i;
+        }
+    }
+
+    // pick conditions and build the index maps, block offsets, and dimensions
+    BuildConstraintMaps();
+
+    // private A^T.u accumulators for constraint families evaluated as tasks
+    if ( constraint_tasks_ && NumberOfConstraintTaskBuffers() > 0 ) {
+        constraint_task_buffer_ = (double*)malloc(NumberOfConstraintTaskBuffers()*dimx_*sizeof(double));
+    }
+
+    // nothing else is allocated
+    packed_storage_         = false;
+    primal_packed_          = false;
+    reduced_primal_         = false;
+    spin_adapted_d2_scratch_ = NULL;
+    update_xz_block_timers_ = -1;
+    update_xz_serial_work_  = NULL;
+    update_xz_serial_iwork_ = NULL;
+    update_xz_evec_         = NULL;
+    diis_vectors_           = NULL;
+    diis_errors_            = NULL;
+    diis_previous_          = NULL;
+    diis_gram_              = NULL;
+    tei_full_sym_           = NULL;
+    oei_full_sym_           = NULL;
+    d2_plus_core_sym_       = NULL;
+    d1_act_spatial_sym_     = NULL;
+    X_                      = NULL;
+}
+
 v2RDMSolver::~v2RDMSolver()
 {
-    free(tei_full_sym_);
+    free(update_xz_serial_work_);
+    free(update_xz_serial_iwork_);
+    free(update_xz_evec_);
+    free(constraint_task_buffer_);
+    free(spin_adapted_d2_scratch_);
+    DIIS_Finalize();
+    for (size_t i = 0; i < update_xz_thread_work_.size(); i++) {
+        free(update_xz_thread_work_[i]);
+        free(update_xz_thread_iwork_[i]);
+    }
+
+    // with df integrals, tei_full_sym_ just points to Qmo_
+    if ( is_df_ ) {
+        FreeThreeIndexBuffer();
+    }else {
+        free(tei_full_sym_);
+    }
     free(oei_full_sym_);
     free(d2_plus_core_sym_);
     free(d1_act_spatial_sym_);
@@ -197,6 +315,21 @@ void  v2RDMSolver::common_init(){
     if ( options_.get_str("SCF_TYPE") == "DF" || options_.get_str("SCF_TYPE") == "CD" ) {
         is_df_ = true;
     }
+    Qmo_           = NULL;
+    qmo_map_bytes_ = 0;
+
+    // with fixed orbitals, conventional integrals are only needed over core and active orbitals
+    active_space_tei_ = ( !is_df_ && options_.get_str("TEI_STORAGE") == "ACTIVE" );
+    // anything that calls RotateOrbitals() needs the full set of integrals
+    if ( active_space_tei_ && options_.get_bool("OPTIMIZE_ORBITALS") ) {
+        throw PsiException("TEI_STORAGE = ACTIVE requires OPTIMIZE_ORBITALS = false",__FILE__,__LINE__);
+    }
+    if ( active_space_tei_ && options_.get_bool("SEMICANONICALIZE_ORBITALS") ) {
+        throw PsiException("TEI_STORAGE = ACTIVE requires SEMICANONICALIZE_ORBITALS = false",__FILE__,__LINE__);
+    }
+    if ( active_space_tei_ && options_.get_str("DERTYPE") == "FIRST" ) {
+        throw PsiException("TEI_STORAGE = ACTIVE is not available for gradients (DERTYPE = FIRST)",__FILE__,__LINE__);
+    }
 
     shallow_copy(reference_wavefunction_);
 
@@ -421,161 +554,664 @@ void  v2RDMSolver::common_init(){
     // set the wavefunction name
     name_ = "V2RDM CASSCF";
 
-    // pick conditions.  default is dqg
-    constrain_q2_ = true;
-    constrain_g2_ = true;
-    constrain_t1_ = false;
-    constrain_t2_ = false;
-    constrain_d3_ = false;
-    if (options_.get_str("POSITIVITY")=="D") {
-        constrain_q2_ = false;
-        constrain_g2_ = false;
-    }else if (options_.get_str("POSITIVITY")=="DQ") {
-        constrain_q2_ = true;
-        constrain_g2_ = false;
-    }else if (options_.get_str("POSITIVITY")=="DG") {
-        constrain_q2_ = false;
-        constrain_g2_ = true;
-    }else if (options_.get_str("POSITIVITY")=="DQGT1") {
-        constrain_q2_ = true;
-        constrain_g2_ = true;
-        constrain_t1_ = true;
-    }else if (options_.get_str("POSITIVITY")=="DQGT2") {
-        constrain_q2_ = true;
-        constrain_g2_ = true;
-        constrain_t2_ = true;
-    }else if (options_.get_str("POSITIVITY")=="DQGT1T2") {
-        constrain_q2_ = true;
-        constrain_g2_ = true;
-        constrain_t1_ = true;
-        constrain_t2_ = true;
-    }else if (options_.get_str("POSITIVITY")=="DQGT") {
-        constrain_q2_ = true;
-        constrain_g2_ = true;
-        constrain_t1_ = true;
-        constrain_t2_ = true;
-    }
+    // pick conditions and build the index maps, block offsets, and dimensions
+    BuildConstraintMaps();
 
-    if ( options_.get_bool("CONSTRAIN_D3") ) {
-        constrain_d3_ = true;
-    }
+    timers_.sample_memory("constraint maps");
 
-    spin_adapt_g2_  = options_.get_bool("SPIN_ADAPT_G2");
-    spin_adapt_q2_  = options_.get_bool("SPIN_ADAPT_Q2");
-    constrain_spin_ = options_.get_bool("CONSTRAIN_SPIN");
+    // v2rdm sdp convergence thresholds:
+    r_convergence_  = options_.get_double("R_CONVERGENCE");
+    e_convergence_  = options_.get_double("E_CONVERGENCE");
+    maxiter_        = options_.get_int("MAXITER");
+    maxdiis_        = options_.get_int("DIIS_MAX_VECS");
+    diis_update_frequency_ = options_.get_int("DIIS_UPDATE_FREQUENCY");
 
-    if ( constrain_t1_ || constrain_t2_ ) {
-        if (spin_adapt_g2_) {
-            throw PsiException("If constraining T1/T2, G2 cannot currently be spin adapted.",__FILE__,__LINE__);
-        }
-        if (spin_adapt_q2_) {
-            throw PsiException("If constraining T1/T2, Q2 cannot currently be spin adapted.",__FILE__,__LINE__);
-        }
-    }
+    diisvec_   = (double*)malloc(sizeof(double)*(maxdiis_+1));
+    memset((void*)diisvec_,'\0',(maxdiis_+1)*sizeof(double));
 
-    // build mapping arrays and determine the number of geminals per block
-    BuildBasis();
+    // DIIS buffers are allocated in common_init() if they are needed
+    diis_vectors_  = NULL;
+    diis_errors_   = NULL;
+    diis_previous_ = NULL;
+    diis_gram_     = NULL;
+    update_xz_sqrt_ = false;
 
-    double ms = (multiplicity_ - 1.0)/2.0;
-    if ( ms > 0 ) {
-        if (spin_adapt_g2_) {
-            throw PsiException("G2 not spin adapted for S = M != 0",__FILE__,__LINE__);
-        }
-        if (spin_adapt_q2_) {
-            throw PsiException("Q2 not spin adapted for S = M != 0",__FILE__,__LINE__);
+    // conjugate gradient solver thresholds:
+    cg_convergence_ = options_.get_double("CG_CONVERGENCE");
+    cg_maxiter_     = options_.get_double("CG_MAXITER");
+
+    // algorithm for projection onto x and z in Update_xz
+    psd_projection_ = options_.get_str("PSD_PROJECTION");
+    newton_schulz_min_dim_ = options_.get_int("NEWTON_SCHULZ_MIN_DIM");
+
+    // packed lower triangles for z, c, ATy (and x, during the iterations)
+    packed_storage_ = options_.get_bool("PACKED_STORAGE");
+    primal_packed_  = false;
+
+    // z, c, ATy (and x, during the iterations) are packed and/or spin adapted
+    reduced_primal_ = packed_storage_ || spin_adapt_d2_;
+    spin_adapted_d2_scratch_ = NULL;
+
+    // explicit sparse A.A^T is built in compute_energy()
+    sparse_gram_matrix_       = false;
+
+    // diagonal preconditioner is built in compute_energy()
+    cg_preconditioner_ = false;
+
+
+    // memory check happens here
+
+    outfile->Printf("\n\n");
+    outfile->Printf( "        ****************************************************\n");
+    outfile->Printf( "        *                                                  *\n");
+    outfile->Printf( "        *    v2RDM-CASSCF (PRIVATE)                        *\n");
+    outfile->Printf( "        *                                                  *\n");
+    outfile->Printf( "        *    A variational 2-RDM-driven approach to the    *\n");
+    outfile->Printf( "        *    active space self-consistent field method     *\n");
+    outfile->Printf( "        *                                                  *\n");
+    outfile->Printf( "        ****************************************************\n");
+
+    // TODO: add citations once we have volume numbers n'nat.
+    outfile->Printf("\n");
+    outfile->Printf("\n");
+    outfile->Printf("        The following papers should be cited when using v2RDM-CASSCF:\n");
+    outfile->Printf("\n");
+    outfile->Printf("        J. Fosso-Tande, D. R. Nascimento, and A. E. DePrince III,\n");
+    outfile->Printf("        Mol. Phys. 114, 423-430 (2015).\n");
+    outfile->Printf("\n");
+    outfile->Printf("            URL: http://dx.doi.org/10.1080/00268976.2015.1078008\n");
+    outfile->Printf("\n");
+    outfile->Printf("        J. Fosso-Tande, T.-S. Nguyen, G. Gidofalvi, and\n");
+    outfile->Printf("        A. E. DePrince III, J. Chem. Theory Comput. accepted (2016).\n");
+    outfile->Printf("\n");
+    outfile->Printf("            URL: http://dx.doi.org/10.1021/acs.jctc.6b00190\n");
+    outfile->Printf("\n");
+    outfile->Printf("\n");
+
+    outfile->Printf("\n");
+    outfile->Printf("  ==> Convergence parameters <==\n");
+    outfile->Printf("\n");
+    outfile->Printf("        r_convergence:                      %5.3le\n",r_convergence_);
+    outfile->Printf("        e_convergence:                      %5.3le\n",e_convergence_);
+    outfile->Printf("        cg_convergence:                     %5.3le\n",cg_convergence_);
+    outfile->Printf("        maxiter:                             %8i\n",maxiter_);
+    outfile->Printf("        cg_maxiter:                          %8i\n",cg_maxiter_);
+    outfile->Printf("        cg_preconditioner:                   %8s\n",options_.get_bool("CG_PRECONDITIONER") ? "diagonal" : "none");
+    outfile->Printf("        diis_max_vecs:                       %8i\n",maxdiis_);
+    outfile->Printf("        diis_update_frequency:               %8i\n",diis_update_frequency_);
+    outfile->Printf("\n");
+
+    // print orbitals per irrep in each space
+    outfile->Printf("  ==> Active space details <==\n");
+    outfile->Printf("\n");
+    //outfile->Printf("        Freeze core orbitals?                   %5s\n",nfrzc_ > 0 ? "yes" : "no");
+    outfile->Printf("        Number of frozen core orbitals:         %5i\n",nfrzc_);
+    outfile->Printf("        Number of restricted occupied orbitals: %5i\n",nrstc_);
+    outfile->Printf("        Number of active occupied orbitals:     %5i\n",ndoccact);
+    outfile->Printf("        Number of active virtual orbitals:      %5i\n",nvirt);
+    outfile->Printf("        Number of restricted virtual orbitals:  %5i\n",nrstv_);
+    outfile->Printf("        Number of frozen virtual orbitals:      %5i\n",nfrzv_);
+    outfile->Printf("\n");
+
+    std::vector<std::string> labels = reference_wavefunction_->molecule()->irrep_labels();
+    outfile->Printf("        Irrep:           ");
+    for (int h = 0; h < nirrep_; h++) {
+        outfile->Printf("%4s",labels[h].c_str());
+        if ( h < nirrep_ - 1 ) {
+            outfile->Printf(",");
         }
     }
+    outfile->Printf(" \n");
+    outfile->Printf(" \n");
 
-    // dimension of variable buffer (x)
-    dimx_ = 0;
-    for ( int h = 0; h < nirrep_; h++) {
-        dimx_ += gems_ab[h]*gems_ab[h]; // D2ab
-    }
-    for ( int h = 0; h < nirrep_; h++) {
-        dimx_ += gems_aa[h]*gems_aa[h]; // D2aa
-    }
-    for ( int h = 0; h < nirrep_; h++) {
-        dimx_ += gems_aa[h]*gems_aa[h]; // D2bb
-    }
-    for ( int h = 0; h < nirrep_; h++) {
-        dimx_ += amopi_[h]*amopi_[h]; // D1a
-        dimx_ += amopi_[h]*amopi_[h]; // D1b
-        dimx_ += amopi_[h]*amopi_[h]; // Q1b
-        dimx_ += amopi_[h]*amopi_[h]; // Q1a
-    }
-    if ( constrain_spin_ && nalpha_ == nbeta_ ) {
-        for ( int h = 0; h < nirrep_; h++) {
-            dimx_ += gems_ab[h] * gems_ab[h]; // D200
-        }
-    }else if ( constrain_spin_ ) {
-        for ( int h = 0; h < nirrep_; h++) {
-            dimx_ += 4 * gems_ab[h] * gems_ab[h]; // D200
+    outfile->Printf("        frozen_docc     [");
+    for (int h = 0; h < nirrep_; h++) {
+        outfile->Printf("%4i",frzcpi_[h]);
+        if ( h < nirrep_ - 1 ) {
+            outfile->Printf(",");
         }
     }
-    if ( constrain_q2_ ) {
-        if ( !spin_adapt_q2_ ) {
-            for ( int h = 0; h < nirrep_; h++) {
-                dimx_ += gems_ab[h]*gems_ab[h]; // Q2ab
-            }
-            for ( int h = 0; h < nirrep_; h++) {
-                dimx_ += gems_aa[h]*gems_aa[h]; // Q2aa
-            }
-            for ( int h = 0; h < nirrep_; h++) {
-                dimx_ += gems_aa[h]*gems_aa[h]; // Q2bb
-            }
-        }else {
-            for ( int h = 0; h < nirrep_; h++) {
-                dimx_ += gems_00[h]*gems_00[h]; // Q2s
-            }
-            for ( int h = 0; h < nirrep_; h++) {
-                dimx_ += gems_aa[h]*gems_aa[h]; // Q2t
-            }
-            for ( int h = 0; h < nirrep_; h++) {
-                dimx_ += gems_aa[h]*gems_aa[h]; // Q2t_p1
-            }
-            for ( int h = 0; h < nirrep_; h++) {
-                dimx_ += gems_aa[h]*gems_aa[h]; // Q2t_m1
-            }
+    outfile->Printf(" ]\n");
+    outfile->Printf("        restricted_docc [");
+    for (int h = 0; h < nirrep_; h++) {
+        outfile->Printf("%4i",rstcpi_[h]);
+        if ( h < nirrep_ - 1 ) {
+            outfile->Printf(",");
         }
     }
-    if ( constrain_g2_ ) {
-        if ( !spin_adapt_g2_ ) {
-            for ( int h = 0; h < nirrep_; h++) {
-                dimx_ += gems_ab[h]*gems_ab[h]; // G2ab
-            }
-            for ( int h = 0; h < nirrep_; h++) {
-                dimx_ += gems_ab[h]*gems_ab[h]; // G2ba
-            }
-            for ( int h = 0; h < nirrep_; h++) {
-                dimx_ += 2*gems_ab[h]*2*gems_ab[h]; // G2aa/bb
-            }
-        }else {
-            for ( int h = 0; h < nirrep_; h++) {
-                dimx_ += gems_ab[h]*gems_ab[h]; // G2s
-            }
-            for ( int h = 0; h < nirrep_; h++) {
-                dimx_ += gems_ab[h]*gems_ab[h]; // G2t
-            }
-            for ( int h = 0; h < nirrep_; h++) {
-                dimx_ += gems_ab[h]*gems_ab[h]; // G2t_p1
-            }
-            for ( int h = 0; h < nirrep_; h++) {
-                dimx_ += gems_ab[h]*gems_ab[h]; // G2t_m1
-            }
+    outfile->Printf(" ]\n");
+    outfile->Printf("        active          [");
+    for (int h = 0; h < nirrep_; h++) {
+        outfile->Printf("%4i",amopi_[h]);
+        if ( h < nirrep_ - 1 ) {
+            outfile->Printf(",");
         }
     }
-    if ( constrain_t1_ ) {
-        for ( int h = 0; h < nirrep_; h++) {
-            dimx_ += trip_aaa[h]*trip_aaa[h]; // T1aaa
-        }
-        for ( int h = 0; h < nirrep_; h++) {
-            dimx_ += trip_aaa[h]*trip_aaa[h]; // T1bbb
+    outfile->Printf(" ]\n");
+    outfile->Printf("        restricted_uocc [");
+    for (int h = 0; h < nirrep_; h++) {
+        outfile->Printf("%4i",rstvpi_[h]);
+        if ( h < nirrep_ - 1 ) {
+            outfile->Printf(",");
+        }
+    }
+    outfile->Printf(" ]\n");
+    outfile->Printf("        frozen_uocc     [");
+    for (int h = 0; h < nirrep_; h++) {
+        outfile->Printf("%4i",frzvpi_[h]);
+        if ( h < nirrep_ - 1 ) {
+            outfile->Printf(",");
+        }
+    }
+    outfile->Printf(" ]\n");
+    outfile->Printf("\n");
+
+    outfile->Printf("  ==> Orbital optimization parameters <==\n");
+    outfile->Printf("\n");
+// gg
+    outfile->Printf("        1-step algorithm:                   %5s\n",options_.get_bool("ORBOPT_ONE_STEP") ? "true" : "false");
+    outfile->Printf("        g_convergence:                  %5.3le\n",options_.get_double("ORBOPT_GRADIENT_CONVERGENCE"));
+    outfile->Printf("        e_convergence:                  %5.3le\n",options_.get_double("ORBOPT_ENERGY_CONVERGENCE"));
+    outfile->Printf("        maximum iterations:                 %5i\n",options_.get_int("ORBOPT_MAXITER"));
+    outfile->Printf("        frequency:                          %5i\n",options_.get_int("ORBOPT_FREQUENCY"));
+    outfile->Printf("        active-active rotations:            %5s\n",options_.get_bool("ORBOPT_ACTIVE_ACTIVE_ROTATIONS") ? "true" : "false");
+    outfile->Printf("        exact diagonal Hessian:             %5s\n",options_.get_bool("ORBOPT_EXACT_DIAGONAL_HESSIAN") ? "true" : "false");
+    outfile->Printf("        number of DIIS vectors:             %5i\n",options_.get_int("ORBOPT_NUM_DIIS_VECTORS"));
+    outfile->Printf("        print iteration info:               %5s\n",options_.get_bool("ORBOPT_WRITE") ? "true" : "false");
+// gg
+
+    outfile->Printf("\n");
+    outfile->Printf("  ==> Memory requirements <==\n");
+    outfile->Printf("\n");
+    int nd2   = 0;
+    int ng2    = 0;
+    int nt1    = 0;
+    int nt2    = 0;
+    for (int h = 0; h < nirrep_; h++) {
+        nd2 +=     gems_ab[h]*gems_ab[h];
+        nd2 += 2 * gems_aa[h]*gems_aa[h];
+
+        ng2 +=     gems_ab[h] * gems_ab[h]; // G2ab
+        ng2 +=     gems_ab[h] * gems_ab[h]; // G2ba
+        ng2 += 4 * gems_ab[h] * gems_ab[h]; // G2aa
+
+        if ( constrain_t1_ ) {
+            nt1 += trip_aaa[h] * trip_aaa[h]; // T1aaa
+            nt1 += trip_aaa[h] * trip_aaa[h]; // T1bbb
+            nt1 += trip_aab[h] * trip_aab[h]; // T1aab
+            nt1 += trip_aab[h] * trip_aab[h]; // T1bba
+        }
+
+        if ( constrain_t2_ ) {
+            nt2 += (trip_aab[h]+trip_aba[h]) * (trip_aab[h]+trip_aba[h]); // T2aaa
+            nt2 += (trip_aab[h]+trip_aba[h]) * (trip_aab[h]+trip_aba[h]); // T2bbb
+            nt2 += trip_aab[h] * trip_aab[h]; // T2aab
+            nt2 += trip_aab[h] * trip_aab[h]; // T2bba
+        }
+
+    }
+
+    outfile->Printf("        D2:                       %7.2lf mb\n",nd2 * 8.0 / 1024.0 / 1024.0);
+    if ( constrain_q2_ ) {
+        outfile->Printf("        Q2:                       %7.2lf mb\n",nd2 * 8.0 / 1024.0 / 1024.0);
+    }
+    if ( constrain_g2_ ) {
+        outfile->Printf("        G2:                       %7.2lf mb\n",ng2 * 8.0 / 1024.0 / 1024.0);
+    }
+    if ( constrain_d3_ ) {
+        outfile->Printf("        D3:                       %7.2lf mb\n",nt1 * 8.0 / 1024.0 / 1024.0);
+    }
+    if ( constrain_t1_ ) {
+        outfile->Printf("        T1:                       %7.2lf mb\n",nt1 * 8.0 / 1024.0 / 1024.0);
+    }
+    if ( constrain_t2_ ) {
+        outfile->Printf("        T2:                       %7.2lf mb\n",nt2 * 8.0 / 1024.0 / 1024.0);
+    }
+    outfile->Printf("\n");
+
+    // we have 4 arrays the size of x and 4 the size of y
+    // in addition, we need workspace for the diagonalization step
+    // integrals:
+    //     K2a, K2b
+    // casscf:
+    //     4-index integrals (no permutational symmetry)
+    //     3-index integrals
+
+    BuildUpdateXZSchedule();
+
+    // x, z, c, and ATy.  with packed storage or spin-adapted D2: three 
+    // reduced vectors, plus x, which is reduced only during the iterations, 
+    // and one full vector for the constraint kernels
+    double tot = 4.0*dimx_ + 4.0*nconstraints_ + update_xz_memory_;
+    if ( reduced_primal_ ) {
+        tot = 4.0*primal_dim_ + dimx_ + 4.0*nconstraints_ + update_xz_memory_;
+    }
+    if ( spin_adapt_d2_ ) {
+        tot += dimensions_offset_[2*nirrep_]; // for D2s and D2t scratch
+    }
+    tot += nd2; // for K2a, K2b
+    tot += 2.0*nconstraints_; // for CG preconditioner and preconditioned residual
+    if ( maxdiis_ > 1 && diis_update_frequency_ > 0 ) {
+        tot += (4.0*maxdiis_ + 4.0)*primal_dim_; // for DIIS vectors, errors, reference, rx, and rz
+    }
+    if ( constraint_tasks_ ) {
+        tot += (double)NumberOfConstraintTaskBuffers() * dimx_; // for A^T.u task accumulators
+    }
+
+    // for casscf, need d2 and 3- or 4-index integrals
+
+    // storage requirements for full d2
+    for (int h = 0; h < nirrep_; h++) {
+        tot += gems_plus_core[h] * ( gems_plus_core[h] + 1 ) / 2;
+    }
+    if ( is_df_ ) {
+        // storage requirements for df integrals
+        nQ_ = Process::environment.globals["NAUX (SCF)"];
+        if ( options_.get_str("SCF_TYPE") == "DF" ) {
+//            std::shared_ptr<BasisSet> primary = BasisSet::pyconstruct_orbital(molecule_,
+//                "BASIS", options_.get_str("BASIS"));
+            std::shared_ptr<BasisSet> primary = reference_wavefunction_->basisset();
+
+//            std::shared_ptr<BasisSet> auxiliary = BasisSet::pyconstruct_auxiliary(molecule_,
+//                "DF_BASIS_SCF", options_.get_str("DF_BASIS_SCF"), "JKFIT",
+//                options_.get_str("BASIS"), primary->has_puream());
+//            std::shared_ptr<BasisSet> auxiliary = reference_wavefunction_->get_basisset("DF_BASIS_MP2");
+            std::shared_ptr<BasisSet> auxiliary = reference_wavefunction_->get_basisset("DF_BASIS_SCF");
+
+            nQ_ = auxiliary->nbf();
+            Process::environment.globals["NAUX (SCF)"] = nQ_;
+        }
+        // unless they live in a memory-mapped file
+        if ( options_.get_str("DF_INTEGRAL_STORAGE") == "CORE" ) {
+            tot += (long int)nQ_*(long int)nmo_*((long int)nmo_+1)/2;
+        }
+        // active-space (tu|vw) built in RepackIntegrals.  the (Q|tu) slabs
+        // are batched over Q to fit in available_memory_
+        tot += (long int)amo_*(amo_+1)/2 * ( (long int)amo_*(amo_+1)/2 );
+    }else {
+        // storage requirements for four-index integrals
+        int * gems_tei = TEIPairs();
+        for (int h = 0; h < nirrep_; h++) {
+            tot += (long int)gems_tei[h] * ( (long int)gems_tei[h] + 1L ) / 2L;
+        }
+        // for four-index integrals stored stupidly
+        //tot += (long int)nmo_*(long int)nmo_*(long int)nmo_*(long int)nmo_;
+    }
+
+    // memory available after allocating all we need for v2RDM-CASSCF
+    available_memory_ = memory_ - tot * 8L;
+
+    outfile->Printf("        Total number of variables:     %10i\n",dimx_);
+    outfile->Printf("        Total number of constraints:   %10i\n",nconstraints_);
+    outfile->Printf("        Total memory requirements:     %7.2lf mb\n",tot * 8.0 / 1024.0 / 1024.0);
+    outfile->Printf("\n");
+
+    if ( tot * 8.0 > (double)memory_ ) {
+        outfile->Printf("\n");
+        outfile->Printf("        Not enough memory!\n");
+        outfile->Printf("\n");
+        if ( !is_df_ ) {
+            outfile->Printf("        Either increase the available memory by %7.2lf mb\n",(8.0 * tot - memory_)/1024.0/1024.0);
+            outfile->Printf("        or try scf_type = df or scf_type = cd\n");
+
+        }else {
+            outfile->Printf("        Increase the available memory by %7.2lf mb.\n",(8.0 * tot - memory_)/1024.0/1024.0);
+        }
+        outfile->Printf("\n");
+        throw PsiException("Not enough memory",__FILE__,__LINE__);
+    }
+
+    // mo-mo transformation matrix
+    newMO_ = (SharedMatrix)(new Matrix(reference_wavefunction_->Ca()));
+    newMO_->zero();
+    for (int h = 0; h < nirrep_; h++) {
+        for (int i = 0; i < nmopi_[h]; i++) {
+            newMO_->pointer(h)[i][i] = 1.0;
+        }
+    }
+
+    orbopt_transformation_matrix_ = (double*)malloc((nmo_-nfrzc_-nfrzv_)*(nmo_-nfrzc_-nfrzv_)*sizeof(double));
+    memset((void*)orbopt_transformation_matrix_,'\0',(nmo_-nfrzc_-nfrzv_)*(nmo_-nfrzc_-nfrzv_)*sizeof(double));
+    for (int i = 0; i < nmo_-nfrzc_-nfrzv_; i++) {
+        orbopt_transformation_matrix_[i*(nmo_-nfrzc_-nfrzv_)+i] = 1.0;
+    }
+
+    //  if restarting, need to grab Ca_ from disk before integral transformation
+    // checkpoint file
+    if ( options_.get_str("RESTART_FROM_CHECKPOINT_FILE") != "" ) {
+        ReadOrbitalsFromCheckpointFile();
+    }
+
+    // if using 3-index integrals, transform them before allocating any memory integrals, transform
+    if ( is_df_ ) {
+        outfile->Printf("    ==> Transform three-electron integrals <==\n");
+        outfile->Printf("\n");
+
+        double start = omp_get_wtime();
+        ThreeIndexIntegrals();
+        double end = omp_get_wtime();
+        timers_.accumulate(TIMER_TRANSFORM_THREE_INDEX,end - start);
+
+        outfile->Printf("\n");
+        outfile->Printf("        Time for integral transformation:  %7.2lf s\n",end-start);
+        outfile->Printf("\n");
+    } else {
+        // transform integrals
+        outfile->Printf("    ==> Transform two-electron integrals <==\n");
+        outfile->Printf("\n");
+
+        double start = omp_get_wtime();
+        std::vector<std::shared_ptr<MOSpace> > spaces;
+        spaces.push_back(MOSpace::all);
+        std::shared_ptr<IntegralTransform> ints(new IntegralTransform(reference_wavefunction_, spaces, 
+            IntegralTransform::TransformationType::Restricted, IntegralTransform::OutputType::IWLOnly, 
+            IntegralTransform::MOOrdering::PitzerOrder, IntegralTransform::FrozenOrbitals::None, false));
+        ints->set_dpd_id(0);
+        ints->set_keep_iwl_so_ints(true);
+        ints->set_keep_dpd_so_ints(true);
+        ints->initialize();
+        ints->transform_tei(MOSpace::all, MOSpace::all, MOSpace::all, MOSpace::all);
+        double end = omp_get_wtime();
+        timers_.accumulate(TIMER_TRANSFORM_TEI,end - start);
+        outfile->Printf("\n");
+        outfile->Printf("        Time for integral transformation:  %7.2lf s\n",end-start);
+        outfile->Printf("\n");
+
+    }
+
+    // allocate vectors
+    Ax     = SharedVector(new Vector("A . x",nconstraints_));
+    ATy    = SharedVector(new Vector("A^T . y",primal_dim_));
+    cg_precon_ = SharedVector(new Vector("CG preconditioner",nconstraints_));
+    c      = SharedVector(new Vector("OEI and TEI",primal_dim_));
+    y      = SharedVector(new Vector("dual solution",nconstraints_));
+    z      = SharedVector(new Vector("dual solution 2",primal_dim_));
+    b      = SharedVector(new Vector("constraints",nconstraints_));
+
+    // with packed storage or spin-adapted D2, x is a full vector (unpacked_) 
+    // except during the iterations (see PackX()).  otherwise, unpacked_ is just ATy
+    if ( reduced_primal_ ) {
+        unpacked_ = SharedVector(new Vector("unpacked primal",dimx_));
+        x         = unpacked_;
+    }else {
+        unpacked_ = ATy;
+        x         = SharedVector(new Vector("primal solution",dimx_));
+    }
+    if ( spin_adapt_d2_ ) {
+        spin_adapted_d2_scratch_ = (double*)malloc(dimensions_offset_[2*nirrep_]*sizeof(double));
+    }
+
+    timers_.sample_memory("integrals");
+
+    // workspace for Update_xz
+    AllocateUpdateXZWorkspace();
+
+    // one Update_xz timer per block
+    update_xz_block_timers_ = -1;
+    for (int i = 0; i < (int)dimensions_.size(); i++) {
+        char label[100];
+        snprintf(label,sizeof(label),"Update_xz block %i (dim %i)",i,dimensions_[i]);
+        int id = timers_.add(label);
+        if ( i == 0 ) update_xz_block_timers_ = id;
+    }
+
+    // private A^T.u accumulators for constraint families evaluated as tasks
+    if ( constraint_tasks_ && NumberOfConstraintTaskBuffers() > 0 ) {
+        constraint_task_buffer_ = (double*)malloc(NumberOfConstraintTaskBuffers()*dimx_*sizeof(double));
+    }
+
+    // DIIS stuff
+    if ( maxdiis_ > 1 && diis_update_frequency_ > 0 ) {
+        DIIS_Initialize();
+    }
+
+
+    // input/output array for orbopt sweeps
+
+    int nthread = 1;
+    #ifdef _OPENMP
+        nthread = omp_get_max_threads();
+    #endif
+
+    orbopt_data_    = (double*)malloc(16*sizeof(double));
+    orbopt_data_[0] = (double)nthread;
+    orbopt_data_[1] = (double)(options_.get_bool("ORBOPT_ACTIVE_ACTIVE_ROTATIONS") ? 1.0 : 0.0 );
+    orbopt_data_[2] = (double)nfrzc_; //(double)options_.get_int("ORBOPT_FROZEN_CORE");
+    orbopt_data_[3] = (double)options_.get_double("ORBOPT_GRADIENT_CONVERGENCE");
+    orbopt_data_[4] = (double)options_.get_double("ORBOPT_ENERGY_CONVERGENCE");
+    orbopt_data_[5] = (double)(options_.get_bool("ORBOPT_WRITE") ? 1.0 : 0.0 );
+    orbopt_data_[6] = (double)(options_.get_bool("ORBOPT_EXACT_DIAGONAL_HESSIAN") ? 1.0 : 0.0 );
+    orbopt_data_[7] = (double)options_.get_int("ORBOPT_NUM_DIIS_VECTORS");
+    orbopt_data_[8] = (double)options_.get_int("ORBOPT_MAXITER");
+    orbopt_data_[9] = 0.0;
+    if ( is_df_ ) {
+      orbopt_data_[9] = 1.0;
+    }
+    orbopt_data_[10] = 0.0;  // number of iterations (output)
+    orbopt_data_[11] = 0.0;  // gradient norm (output)
+    orbopt_data_[12] = 0.0;  // change in energy (output)
+    orbopt_data_[13] = 0.0;  // converged?
+
+    // orbital optimizatoin algorithm
+    orbopt_data_[14] = 0.0;
+    if      ( options_.get_str("ORBOPT_ALGORITHM") == "QUASI_NEWTON" )       orbopt_data_[14] = 0.0;
+    else if ( options_.get_str("ORBOPT_ALGORITHM") == "CONJUGATE_GRADIENT" ) orbopt_data_[14] = 1.0;
+    else if ( options_.get_str("ORBOPT_ALGORITHM") == "NEWTON_RAPHSON" )     orbopt_data_[14] = 2.0;
+
+    // ordering of the three-index integrals: 0 = (Q|mn), 1 = (mn|Q)
+    orbopt_data_[15] = 0.0;
+    if ( is_df_ && options_.get_str("DF_INTEGRAL_ORDER") == "MNQ" ) {
+        orbopt_data_[15] = 1.0;
+    }
+
+    orbopt_converged_ = false;
+
+    // don't change the length of this filename
+    orbopt_outfile_ = (char*)malloc(120*sizeof(char));
+    std::string filename = get_writer_file_prefix(reference_wavefunction_->molecule()->name()) + ".orbopt";
+    strcpy(orbopt_outfile_,filename.c_str());
+    if ( options_.get_bool("ORBOPT_WRITE") ) {
+        FILE * fp = fopen(orbopt_outfile_,"w");
+        fclose(fp);
+    }
+
+    // initialize timers and iteration counters
+    iiter_total_       = 0;
+    oiter_total_       = 0;
+    orbopt_iter_total_ = 0;
+
+    iiter_time_        = 0.0;
+    oiter_time_        = 0.0;
+    orbopt_time_       = 0.0;
+
+    // allocate memory for orbital lagrangian (TODO: make these smaller)
+    X_               = (double*)malloc(nmo_*nmo_*sizeof(double));
+
+    // even if we use rhf/rohf reference, we need same_a_b_orbs_=false
+    // to trigger the correct integral transformations in deriv.cc
+    same_a_b_orbs_ = false;
+    same_a_b_dens_ = false;
+
+}
+
+// select the N-representability conditions and build everything that
+// depends only on the active space: index maps, the offsets of each block 
+// of the primal (x) and dual (y) vectors, and the list of block dimensions
+void v2RDMSolver::BuildConstraintMaps() {
+
+    // pick conditions.  default is dqg
+    constrain_q2_ = true;
+    constrain_g2_ = true;
+    constrain_t1_ = false;
+    constrain_t2_ = false;
+    constrain_d3_ = false;
+    if (options_.get_str("POSITIVITY")=="D") {
+        constrain_q2_ = false;
+        constrain_g2_ = false;
+    }else if (options_.get_str("POSITIVITY")=="DQ") {
+        constrain_q2_ = true;
+        constrain_g2_ = false;
+    }else if (options_.get_str("POSITIVITY")=="DG") {
+        constrain_q2_ = false;
+        constrain_g2_ = true;
+    }else if (options_.get_str("POSITIVITY")=="DQGT1") {
+        constrain_q2_ = true;
+        constrain_g2_ = true;
+        constrain_t1_ = true;
+    }else if (options_.get_str("POSITIVITY")=="DQGT2") {
+        constrain_q2_ = true;
+        constrain_g2_ = true;
+        constrain_t2_ = true;
+    }else if (options_.get_str("POSITIVITY")=="DQGT1T2") {
+        constrain_q2_ = true;
+        constrain_g2_ = true;
+        constrain_t1_ = true;
+        constrain_t2_ = true;
+    }else if (options_.get_str("POSITIVITY")=="DQGT") {
+        constrain_q2_ = true;
+        constrain_g2_ = true;
+        constrain_t1_ = true;
+        constrain_t2_ = true;
+    }
+
+    if ( options_.get_bool("CONSTRAIN_D3") ) {
+        constrain_d3_ = true;
+    }
+
+    spin_adapt_g2_  = options_.get_bool("SPIN_ADAPT_G2");
+    spin_adapt_q2_  = options_.get_bool("SPIN_ADAPT_Q2");
+    constrain_spin_ = options_.get_bool("CONSTRAIN_SPIN");
+    closed_shell_   = options_.get_bool("CLOSED_SHELL");
+    spin_adapt_d2_  = options_.get_bool("SPIN_ADAPT_D2");
+
+    // T1 refers to G2 through the spin-adapted blocks if SPIN_ADAPT_G2 is set (see t1.cc)
+    if ( constrain_t1_ || constrain_t2_ ) {
+        if (spin_adapt_q2_) {
+            throw PsiException("If constraining T1/T2, Q2 cannot currently be spin adapted.",__FILE__,__LINE__);
+        }
+    }
+
+    // build mapping arrays and determine the number of geminals per block
+    BuildBasis();
+
+    double ms = (multiplicity_ - 1.0)/2.0;
+    if ( ms > 0 ) {
+        if (spin_adapt_g2_) {
+            throw PsiException("G2 not spin adapted for S = M != 0",__FILE__,__LINE__);
+        }
+        if (spin_adapt_q2_) {
+            throw PsiException("Q2 not spin adapted for S = M != 0",__FILE__,__LINE__);
+        }
+    }
+
+    // closed-shell singlets: D1b = D1a, D2bb = D2aa, Q2bb = Q2aa, etc.  each 
+    // beta block shares storage with its alpha partner, and the constraints 
+    // that only restate an alpha constraint for the beta blocks are dropped
+    if ( closed_shell_ ) {
+        if ( nalpha_ != nbeta_ || multiplicity_ != 1 ) {
+            throw PsiException("CLOSED_SHELL requires a singlet state with nalpha = nbeta",__FILE__,__LINE__);
+        }
+    }
+
+    // singlets: D2ab, D2aa, and D2bb are all built from a singlet block (in 
+    // the geminal basis of gems_00) and a triplet block (gems_aa).  only 
+    // those two blocks are stored during the iterations (see packed_storage.cc)
+    if ( spin_adapt_d2_ ) {
+        if ( nalpha_ != nbeta_ || multiplicity_ != 1 ) {
+            throw PsiException("SPIN_ADAPT_D2 requires a singlet state with nalpha = nbeta",__FILE__,__LINE__);
+        }
+    }
+
+    // dimension of variable buffer (x)
+    dimx_ = 0;
+    for ( int h = 0; h < nirrep_; h++) {
+        dimx_ += gems_ab[h]*gems_ab[h]; // D2ab
+    }
+    for ( int h = 0; h < nirrep_; h++) {
+        dimx_ += gems_aa[h]*gems_aa[h]; // D2aa
+    }
+    for ( int h = 0; h < nirrep_; h++) {
+        if ( !closed_shell_ ) dimx_ += gems_aa[h]*gems_aa[h]; // D2bb
+    }
+    for ( int h = 0; h < nirrep_; h++) {
+        dimx_ += amopi_[h]*amopi_[h]; // D1a
+        if ( !closed_shell_ ) dimx_ += amopi_[h]*amopi_[h]; // D1b
+        if ( !closed_shell_ ) dimx_ += amopi_[h]*amopi_[h]; // Q1b
+        dimx_ += amopi_[h]*amopi_[h]; // Q1a
+    }
+    if ( constrain_spin_ && nalpha_ == nbeta_ ) {
+        for ( int h = 0; h < nirrep_; h++) {
+            if ( !spin_adapt_d2_ ) dimx_ += gems_ab[h] * gems_ab[h]; // D200
+        }
+    }else if ( constrain_spin_ ) {
+        for ( int h = 0; h < nirrep_; h++) {
+            dimx_ += 4 * gems_ab[h] * gems_ab[h]; // D200
+        }
+    }
+    if ( constrain_q2_ ) {
+        if ( !spin_adapt_q2_ ) {
+            for ( int h = 0; h < nirrep_; h++) {
+                dimx_ += gems_ab[h]*gems_ab[h]; // Q2ab
+            }
+            for ( int h = 0; h < nirrep_; h++) {
+                dimx_ += gems_aa[h]*gems_aa[h]; // Q2aa
+            }
+            for ( int h = 0; h < nirrep_; h++) {
+                if ( !closed_shell_ ) dimx_ += gems_aa[h]*gems_aa[h]; // Q2bb
+            }
+        }else {
+            for ( int h = 0; h < nirrep_; h++) {
+                dimx_ += gems_00[h]*gems_00[h]; // Q2s
+            }
+            for ( int h = 0; h < nirrep_; h++) {
+                dimx_ += gems_aa[h]*gems_aa[h]; // Q2t
+            }
+            for ( int h = 0; h < nirrep_; h++) {
+                dimx_ += gems_aa[h]*gems_aa[h]; // Q2t_p1
+            }
+            for ( int h = 0; h < nirrep_; h++) {
+                if ( !closed_shell_ ) dimx_ += gems_aa[h]*gems_aa[h]; // Q2t_m1
+            }
+        }
+    }
+    if ( constrain_g2_ ) {
+        if ( !spin_adapt_g2_ ) {
+            for ( int h = 0; h < nirrep_; h++) {
+                dimx_ += gems_ab[h]*gems_ab[h]; // G2ab
+            }
+            for ( int h = 0; h < nirrep_; h++) {
+                if ( !closed_shell_ ) dimx_ += gems_ab[h]*gems_ab[h]; // G2ba
+            }
+            for ( int h = 0; h < nirrep_; h++) {
+                dimx_ += 2*gems_ab[h]*2*gems_ab[h]; // G2aa/bb
+            }
+        }else {
+            for ( int h = 0; h < nirrep_; h++) {
+                dimx_ += gems_ab[h]*gems_ab[h]; // G2s
+            }
+            for ( int h = 0; h < nirrep_; h++) {
+                dimx_ += gems_ab[h]*gems_ab[h]; // G2t
+            }
+            for ( int h = 0; h < nirrep_; h++) {
+                dimx_ += gems_ab[h]*gems_ab[h]; // G2t_p1
+            }
+            for ( int h = 0; h < nirrep_; h++) {
+                if ( !closed_shell_ ) dimx_ += gems_ab[h]*gems_ab[h]; // G2t_m1
+            }
+        }
+    }
+    if ( constrain_t1_ ) {
+        for ( int h = 0; h < nirrep_; h++) {
+            dimx_ += trip_aaa[h]*trip_aaa[h]; // T1aaa
+        }
+        for ( int h = 0; h < nirrep_; h++) {
+            if ( !closed_shell_ ) dimx_ += trip_aaa[h]*trip_aaa[h]; // T1bbb
         }
         for ( int h = 0; h < nirrep_; h++) {
             dimx_ += trip_aab[h]*trip_aab[h]; // T1aab
         }
         for ( int h = 0; h < nirrep_; h++) {
-            dimx_ += trip_aab[h]*trip_aab[h]; // T1bba
+            if ( !closed_shell_ ) dimx_ += trip_aab[h]*trip_aab[h]; // T1bba
         }
     }
     if ( constrain_t2_ ) {
@@ -583,13 +1219,13 @@ void  v2RDMSolver::common_init(){
             dimx_ += (trip_aba[h]+trip_aab[h])*(trip_aab[h]+trip_aba[h]); // T2aaa
         }
         for ( int h = 0; h < nirrep_; h++) {
-            dimx_ += (trip_aba[h]+trip_aab[h])*(trip_aab[h]+trip_aba[h]); // T2bbb
+            if ( !closed_shell_ ) dimx_ += (trip_aba[h]+trip_aab[h])*(trip_aab[h]+trip_aba[h]); // T2bbb
         }
         for ( int h = 0; h < nirrep_; h++) {
             dimx_ += trip_aab[h]*trip_aab[h]; // T2aab
         }
         for ( int h = 0; h < nirrep_; h++) {
-            dimx_ += trip_aab[h]*trip_aab[h]; // T2bba
+            if ( !closed_shell_ ) dimx_ += trip_aab[h]*trip_aab[h]; // T2bba
         }
     }
     if ( constrain_d3_ ) {
@@ -597,13 +1233,13 @@ void  v2RDMSolver::common_init(){
             dimx_ += trip_aaa[h] * trip_aaa[h]; // D3aaa
         }
         for ( int h = 0; h < nirrep_; h++) {
-            dimx_ += trip_aaa[h] * trip_aaa[h]; // D3bbb
+            if ( !closed_shell_ ) dimx_ += trip_aaa[h] * trip_aaa[h]; // D3bbb
         }
         for ( int h = 0; h < nirrep_; h++) {
             dimx_ += trip_aab[h]*trip_aab[h]; // D3aab
         }
         for ( int h = 0; h < nirrep_; h++) {
-            dimx_ += trip_aab[h]*trip_aab[h]; // D3bba
+            if ( !closed_shell_ ) dimx_ += trip_aab[h]*trip_aab[h]; // D3bba
         }
     }
 
@@ -621,10 +1257,13 @@ void  v2RDMSolver::common_init(){
         d2aaoff[h] = offset; offset += gems_aa[h]*gems_aa[h];
     }
     for (int h = 0; h < nirrep_; h++) {
+        if ( closed_shell_ ) { d2bboff[h] = d2aaoff[h]; continue; }
         d2bboff[h] = offset; offset += gems_aa[h]*gems_aa[h];
     }
+    d2_full_dim_ = offset;
     if ( constrain_spin_ && nalpha_ == nbeta_ ) {
         for (int h = 0; h < nirrep_; h++) {
+            if ( spin_adapt_d2_ ) continue;
             d200off[h] = offset; offset += gems_ab[h]*gems_ab[h];
         }
     } else if ( constrain_spin_ ) {
@@ -641,12 +1280,14 @@ void  v2RDMSolver::common_init(){
         d1aoff[h] = offset; offset += amopi_[h]*amopi_[h];
     }
     for (int h = 0; h < nirrep_; h++) {
+        if ( closed_shell_ ) { d1boff[h] = d1aoff[h]; continue; }
         d1boff[h] = offset; offset += amopi_[h]*amopi_[h];
     }
     for (int h = 0; h < nirrep_; h++) {
         q1aoff[h] = offset; offset += amopi_[h]*amopi_[h];
     }
     for (int h = 0; h < nirrep_; h++) {
+        if ( closed_shell_ ) { q1boff[h] = q1aoff[h]; continue; }
         q1boff[h] = offset; offset += amopi_[h]*amopi_[h];
     }
 
@@ -662,6 +1303,7 @@ void  v2RDMSolver::common_init(){
                 q2aaoff[h] = offset; offset += gems_aa[h]*gems_aa[h];
             }
             for (int h = 0; h < nirrep_; h++) {
+                if ( closed_shell_ ) { q2bboff[h] = q2aaoff[h]; continue; }
                 q2bboff[h] = offset; offset += gems_aa[h]*gems_aa[h];
             }
         }else {
@@ -679,6 +1321,7 @@ void  v2RDMSolver::common_init(){
                 q2toff_p1[h] = offset; offset += gems_aa[h]*gems_aa[h];
             }
             for (int h = 0; h < nirrep_; h++) {
+                if ( closed_shell_ ) { q2toff_m1[h] = q2toff_p1[h]; continue; }
                 q2toff_m1[h] = offset; offset += gems_aa[h]*gems_aa[h];
             }
         }
@@ -693,6 +1336,7 @@ void  v2RDMSolver::common_init(){
                 g2aboff[h] = offset; offset += gems_ab[h]*gems_ab[h];
             }
             for (int h = 0; h < nirrep_; h++) {
+                if ( closed_shell_ ) { g2baoff[h] = g2aboff[h]; continue; }
                 g2baoff[h] = offset; offset += gems_ab[h]*gems_ab[h];
             }
             for (int h = 0; h < nirrep_; h++) {
@@ -713,6 +1357,7 @@ void  v2RDMSolver::common_init(){
                 g2toff_p1[h] = offset; offset += gems_ab[h]*gems_ab[h];
             }
             for (int h = 0; h < nirrep_; h++) {
+                if ( closed_shell_ ) { g2toff_m1[h] = g2toff_p1[h]; continue; }
                 g2toff_m1[h] = offset; offset += gems_ab[h]*gems_ab[h];
             }
         }
@@ -727,12 +1372,14 @@ void  v2RDMSolver::common_init(){
             t1aaaoff[h] = offset; offset += trip_aaa[h]*trip_aaa[h]; // T1aaa
         }
         for (int h = 0; h < nirrep_; h++) {
+            if ( closed_shell_ ) { t1bbboff[h] = t1aaaoff[h]; continue; }
             t1bbboff[h] = offset; offset += trip_aaa[h]*trip_aaa[h]; // T1bbb
         }
         for (int h = 0; h < nirrep_; h++) {
             t1aaboff[h] = offset; offset += trip_aab[h]*trip_aab[h]; // T1aab
         }
         for (int h = 0; h < nirrep_; h++) {
+            if ( closed_shell_ ) { t1bbaoff[h] = t1aaboff[h]; continue; }
             t1bbaoff[h] = offset; offset += trip_aab[h]*trip_aab[h]; // T1bba
         }
     }
@@ -746,12 +1393,14 @@ void  v2RDMSolver::common_init(){
             t2aaaoff[h] = offset; offset += (trip_aab[h]+trip_aba[h])*(trip_aab[h]+trip_aba[h]); // T2aaa
         }
         for (int h = 0; h < nirrep_; h++) {
+            if ( closed_shell_ ) { t2bbboff[h] = t2aaaoff[h]; continue; }
             t2bbboff[h] = offset; offset += (trip_aab[h]+trip_aba[h])*(trip_aab[h]+trip_aba[h]); // T2bbb
         }
         for (int h = 0; h < nirrep_; h++) {
             t2aaboff[h] = offset; offset += trip_aab[h]*trip_aab[h]; // T2aab
         }
         for (int h = 0; h < nirrep_; h++) {
+            if ( closed_shell_ ) { t2bbaoff[h] = t2aaboff[h]; continue; }
             t2bbaoff[h] = offset; offset += trip_aab[h]*trip_aab[h]; // T2bba
         }
     }
@@ -764,24 +1413,28 @@ void  v2RDMSolver::common_init(){
             d3aaaoff[h] = offset; offset += trip_aaa[h]*trip_aaa[h]; // D3aaa
         }
         for (int h = 0; h < nirrep_; h++) {
+            if ( closed_shell_ ) { d3bbboff[h] = d3aaaoff[h]; continue; }
             d3bbboff[h] = offset; offset += trip_aaa[h]*trip_aaa[h]; // D3bbb
         }
         for (int h = 0; h < nirrep_; h++) {
             d3aaboff[h] = offset; offset += trip_aab[h]*trip_aab[h]; // D3aab
         }
         for (int h = 0; h < nirrep_; h++) {
+            if ( closed_shell_ ) { d3bbaoff[h] = d3aaboff[h]; continue; }
             d3bbaoff[h] = offset; offset += trip_aab[h]*trip_aab[h]; // D3bba
         }
     }
     // constraints:
     nconstraints_ = 0;
 
+    d2_constraints_offset_ = nconstraints_;
+
     if ( constrain_spin_ ) {
         nconstraints_ += 1;               // spin
     }
     nconstraints_ += 1;                   // Tr(D2ab)
     nconstraints_ += 1;                   // Tr(D2aa)
-    nconstraints_ += 1;                   // Tr(D2bb)
+    if ( !closed_shell_ ) nconstraints_ += 1;                   // Tr(D2bb)
 
     //for ( int h = 0; h < nirrep_; h++) {
     //    nconstraints_ += gems_ab[h]*gems_ab[h]; // D2ab hermiticity
@@ -793,7 +1446,7 @@ void  v2RDMSolver::common_init(){
         nconstraints_ += amopi_[h]*amopi_[h]; // D1a <-> Q1a
     }
     for ( int h = 0; h < nirrep_; h++) {
-        nconstraints_ += amopi_[h]*amopi_[h]; // D1b <-> Q1b
+        if ( !closed_shell_ ) nconstraints_ += amopi_[h]*amopi_[h]; // D1b <-> Q1b
     }
     for ( int h = 0; h < nirrep_; h++) {
         nconstraints_ += amopi_[h]*amopi_[h]; // contract D2ab        -> D1 a
@@ -807,19 +1460,21 @@ void  v2RDMSolver::common_init(){
     // additional spin constraints for singlets:
     if ( constrain_spin_ && nalpha_ == nbeta_ ) {
         for ( int h = 0; h < nirrep_; h++) {
-            nconstraints_ += amopi_[h]*amopi_[h]; // D1a = D1b
-        }
-        for ( int h = 0; h < nirrep_; h++) {
-            nconstraints_ += gems_aa[h]*gems_aa[h]; // D2aa = D2bb
-        }
-        for ( int h = 0; h < nirrep_; h++) {
-            nconstraints_ += gems_aa[h]*gems_aa[h]; // D2aa[pq][rs] = 1/2(D2ab[pq][rs] - D2ab[pq][sr] - D2ab[qp][rs] + D2ab[qp][sr])
-        }
-        for ( int h = 0; h < nirrep_; h++) {
-            nconstraints_ += gems_aa[h]*gems_aa[h]; // D2bb[pq][rs] = 1/2(D2ab[pq][rs] - D2ab[pq][sr] - D2ab[qp][rs] + D2ab[qp][sr])
+            if ( !closed_shell_ ) nconstraints_ += amopi_[h]*amopi_[h]; // D1a = D1b
         }
-        for ( int h = 0; h < nirrep_; h++) {
-            nconstraints_ += gems_ab[h]*gems_ab[h];  // D200[pq][rs] = 1/(2 sqrt(1+dpq)sqrt(1+drs))(D2ab[pq][rs] + D2ab[pq][sr] + D2ab[qp][rs] + D2ab[qp][sr])
+        if ( !spin_adapt_d2_ ) {
+            for ( int h = 0; h < nirrep_; h++) {
+                if ( !closed_shell_ ) nconstraints_ += gems_aa[h]*gems_aa[h]; // D2aa = D2bb
+            }
+            for ( int h = 0; h < nirrep_; h++) {
+                nconstraints_ += gems_aa[h]*gems_aa[h]; // D2aa[pq][rs] = 1/2(D2ab[pq][rs] - D2ab[pq][sr] - D2ab[qp][rs] + D2ab[qp][sr])
+            }
+            for ( int h = 0; h < nirrep_; h++) {
+                if ( !closed_shell_ ) nconstraints_ += gems_aa[h]*gems_aa[h]; // D2bb[pq][rs] = 1/2(D2ab[pq][rs] - D2ab[pq][sr] - D2ab[qp][rs] + D2ab[qp][sr])
+            }
+            for ( int h = 0; h < nirrep_; h++) {
+                nconstraints_ += gems_ab[h]*gems_ab[h];  // D200[pq][rs] = 1/(2 sqrt(1+dpq)sqrt(1+drs))(D2ab[pq][rs] + D2ab[pq][sr] + D2ab[qp][rs] + D2ab[qp][sr])
+            }
         }
     }else if ( constrain_spin_ ) { // nonsinglets
         for ( int h = 0; h < nirrep_; h++) {
@@ -828,8 +1483,9 @@ void  v2RDMSolver::common_init(){
     }
 
     for ( int h = 0; h < nirrep_; h++) {
-        nconstraints_ += amopi_[h]*amopi_[h]; // contract D2bb        -> D1 b
+        if ( !closed_shell_ ) nconstraints_ += amopi_[h]*amopi_[h]; // contract D2bb        -> D1 b
     }
+    q2_constraints_offset_ = nconstraints_;
     if ( constrain_q2_ ) {
         if ( ! spin_adapt_q2_ ) {
             for ( int h = 0; h < nirrep_; h++) {
@@ -839,7 +1495,7 @@ void  v2RDMSolver::common_init(){
                 nconstraints_ += gems_aa[h]*gems_aa[h]; // Q2aa
             }
             for ( int h = 0; h < nirrep_; h++) {
-                nconstraints_ += gems_aa[h]*gems_aa[h]; // Q2bb
+                if ( !closed_shell_ ) nconstraints_ += gems_aa[h]*gems_aa[h]; // Q2bb
             }
         }else {
             for ( int h = 0; h < nirrep_; h++) {
@@ -852,11 +1508,12 @@ void  v2RDMSolver::common_init(){
                 nconstraints_ += gems_aa[h]*gems_aa[h]; // Q2t_p1
             }
             for ( int h = 0; h < nirrep_; h++) {
-                nconstraints_ += gems_aa[h]*gems_aa[h]; // Q2t_m1
+                if ( !closed_shell_ ) nconstraints_ += gems_aa[h]*gems_aa[h]; // Q2t_m1
             }
         }
 
     }
+    g2_constraints_offset_ = nconstraints_;
     if ( constrain_g2_ ) {
         if ( ! spin_adapt_g2_ ) {
             for ( int h = 0; h < nirrep_; h++) {
@@ -887,6 +1544,7 @@ void  v2RDMSolver::common_init(){
         //    nconstraints_ += gems_ab[0];
         //}
     }
+    t1_constraints_offset_ = nconstraints_;
     if ( constrain_t1_ ) {
         for (int h = 0; h < nirrep_; h++) {
             nconstraints_ += trip_aaa[h]*trip_aaa[h]; // T1aaa
@@ -901,6 +1559,7 @@ void  v2RDMSolver::common_init(){
             nconstraints_ += trip_aab[h]*trip_aab[h]; // T1bba
         }
     }
+    t2_constraints_offset_ = nconstraints_;
     if ( constrain_t2_ ) {
         for (int h = 0; h < nirrep_; h++) {
             nconstraints_ += (trip_aab[h]+trip_aba[h])*(trip_aab[h]+trip_aba[h]); // T2aaa
@@ -915,6 +1574,7 @@ void  v2RDMSolver::common_init(){
             nconstraints_ += trip_aab[h]*trip_aab[h]; // T2bba
         }
     }
+    d3_constraints_offset_ = nconstraints_;
     if ( constrain_d3_ ) {
         if ( nalpha_ - nrstc_ - nfrzc_ > 2 ) {
             for (int h = 0; h < nirrep_; h++) {
@@ -923,14 +1583,14 @@ void  v2RDMSolver::common_init(){
         }
         if ( nbeta_ - nrstc_ - nfrzc_ > 2 ) {
             for (int h = 0; h < nirrep_; h++) {
-                nconstraints_ += gems_aa[h]*gems_aa[h]; // D3bbb -> D2bb
+                if ( !closed_shell_ ) nconstraints_ += gems_aa[h]*gems_aa[h]; // D3bbb -> D2bb
             }
         }
         for (int h = 0; h < nirrep_; h++) {
             nconstraints_ += gems_aa[h]*gems_aa[h]; // D3aab -> D2aa
         }
         for (int h = 0; h < nirrep_; h++) {
-            nconstraints_ += gems_aa[h]*gems_aa[h]; // D3bba -> D2bb
+            if ( !closed_shell_ ) nconstraints_ += gems_aa[h]*gems_aa[h]; // D3bba -> D2bb
         }
         if ( nalpha_ - nrstc_ - nfrzc_ > 1 ) {
             for (int h = 0; h < nirrep_; h++) {
@@ -945,541 +1605,159 @@ void  v2RDMSolver::common_init(){
         // additional spin constraints for singlets:
         if ( constrain_spin_ && nalpha_ == nbeta_ ) {
             for (int h = 0; h < nirrep_; h++) {
-                nconstraints_ += trip_aab[h]*trip_aab[h]; // D3aab = D3bba
+                if ( !closed_shell_ ) nconstraints_ += trip_aab[h]*trip_aab[h]; // D3aab = D3bba
             }
             for (int h = 0; h < nirrep_; h++) {
                 nconstraints_ += trip_aaa[h]*trip_aaa[h]; // D3aab -> D3aaa
-                nconstraints_ += trip_aaa[h]*trip_aaa[h]; // D3bba -> D3bbb
-            }
-        }
-    }
-
-    // list of dimensions_
-    for (int h = 0; h < nirrep_; h++) {
-        dimensions_.push_back(gems_ab[h]); // D2ab
-    }
-    for (int h = 0; h < nirrep_; h++) {
-        dimensions_.push_back(gems_aa[h]); // D2aa
-    }
-    for (int h = 0; h < nirrep_; h++) {
-        dimensions_.push_back(gems_aa[h]); // D2bb
-    }
-    if ( constrain_spin_ && nalpha_ == nbeta_ ) {
-        for (int h = 0; h < nirrep_; h++) {
-            dimensions_.push_back(gems_ab[h]); // D200
-        }
-    }else if ( constrain_spin_ ) {
-        for (int h = 0; h < nirrep_; h++) {
-            dimensions_.push_back(2*gems_ab[h]); // D200_0,D210_0,D201_0,D211_0
-        }
-    }
-    for (int h = 0; h < nirrep_; h++) {
-        dimensions_.push_back(amopi_[h]); // D1a
-    }
-    for (int h = 0; h < nirrep_; h++) {
-        dimensions_.push_back(amopi_[h]); // D1b
-    }
-    for (int h = 0; h < nirrep_; h++) {
-        dimensions_.push_back(amopi_[h]); // Q1a
-    }
-    for (int h = 0; h < nirrep_; h++) {
-        dimensions_.push_back(amopi_[h]); // Q1b
-    }
-    if ( constrain_q2_ ) {
-        if ( !spin_adapt_q2_ ) {
-            for (int h = 0; h < nirrep_; h++) {
-                dimensions_.push_back(gems_ab[h]); // Q2ab
-            }
-            for (int h = 0; h < nirrep_; h++) {
-                dimensions_.push_back(gems_aa[h]); // Q2aa
-            }
-            for (int h = 0; h < nirrep_; h++) {
-                dimensions_.push_back(gems_aa[h]); // Q2bb
-            }
-        }else {
-            for (int h = 0; h < nirrep_; h++) {
-                dimensions_.push_back(gems_00[h]); // Q2s
-            }
-            for (int h = 0; h < nirrep_; h++) {
-                dimensions_.push_back(gems_aa[h]); // Q2t
-            }
-            for (int h = 0; h < nirrep_; h++) {
-                dimensions_.push_back(gems_aa[h]); // Q2t_p1
-            }
-            for (int h = 0; h < nirrep_; h++) {
-                dimensions_.push_back(gems_aa[h]); // Q2t_m1
-            }
-        }
-    }
-    if ( constrain_g2_ ) {
-        if ( !spin_adapt_g2_ ) {
-            for (int h = 0; h < nirrep_; h++) {
-                dimensions_.push_back(gems_ab[h]); // G2ab
-            }
-            for (int h = 0; h < nirrep_; h++) {
-                dimensions_.push_back(gems_ab[h]); // G2ba
-            }
-            for (int h = 0; h < nirrep_; h++) {
-                dimensions_.push_back(2*gems_ab[h]); // G2aa
-            }
-        }else {
-            for (int h = 0; h < nirrep_; h++) {
-                dimensions_.push_back(gems_ab[h]); // G2s
-            }
-            for (int h = 0; h < nirrep_; h++) {
-                dimensions_.push_back(gems_ab[h]); // G2t
-            }
-            for (int h = 0; h < nirrep_; h++) {
-                dimensions_.push_back(gems_ab[h]); // G2t_p1
-            }
-            for (int h = 0; h < nirrep_; h++) {
-                dimensions_.push_back(gems_ab[h]); // G2t_m1
+                if ( !closed_shell_ ) nconstraints_ += trip_aaa[h]*trip_aaa[h]; // D3bba -> D3bbb
             }
         }
     }
-    if ( constrain_t1_ ) {
-        for (int h = 0; h < nirrep_; h++) {
-            dimensions_.push_back(trip_aaa[h]); // T1aaa
-        }
-        for (int h = 0; h < nirrep_; h++) {
-            dimensions_.push_back(trip_aaa[h]); // T1bbb
-        }
-        for (int h = 0; h < nirrep_; h++) {
-            dimensions_.push_back(trip_aab[h]); // T1aab
-        }
+
+    // list of dimensions_
+    if ( spin_adapt_d2_ ) {
         for (int h = 0; h < nirrep_; h++) {
-            dimensions_.push_back(trip_aab[h]); // T1bba
+            dimensions_.push_back(gems_00[h]); // D2s
         }
-    }
-    if ( constrain_t2_ ) {
         for (int h = 0; h < nirrep_; h++) {
-            dimensions_.push_back(trip_aab[h]+trip_aba[h]); // T2aaa
+            dimensions_.push_back(gems_aa[h]); // D2t
         }
+    }else {
         for (int h = 0; h < nirrep_; h++) {
-            dimensions_.push_back(trip_aab[h]+trip_aba[h]); // T2bbb
+            dimensions_.push_back(gems_ab[h]); // D2ab
         }
         for (int h = 0; h < nirrep_; h++) {
-            dimensions_.push_back(trip_aab[h]); // T2aab
+            dimensions_.push_back(gems_aa[h]); // D2aa
         }
         for (int h = 0; h < nirrep_; h++) {
-            dimensions_.push_back(trip_aab[h]); // T2bba
+            if ( !closed_shell_ ) dimensions_.push_back(gems_aa[h]); // D2bb
         }
     }
-    if ( constrain_d3_ ) {
-        for (int h = 0; h < nirrep_; h++) {
-            dimensions_.push_back(trip_aaa[h]); // D3aaa
-        }
-        for (int h = 0; h < nirrep_; h++) {
-            dimensions_.push_back(trip_aaa[h]); // D3bbb
-        }
+    if ( constrain_spin_ && nalpha_ == nbeta_ ) {
         for (int h = 0; h < nirrep_; h++) {
-            dimensions_.push_back(trip_aab[h]); // D3aab
+            if ( !spin_adapt_d2_ ) dimensions_.push_back(gems_ab[h]); // D200
         }
+    }else if ( constrain_spin_ ) {
         for (int h = 0; h < nirrep_; h++) {
-            dimensions_.push_back(trip_aab[h]); // D3bba
-        }
-    }
-
-    // v2rdm sdp convergence thresholds:
-    r_convergence_  = options_.get_double("R_CONVERGENCE");
-    e_convergence_  = options_.get_double("E_CONVERGENCE");
-    maxiter_        = options_.get_int("MAXITER");
-    maxdiis_        = options_.get_int("DIIS_MAX_VECS");
-
-    diisvec_   = (double*)malloc(sizeof(double)*(maxdiis_+1));
-    memset((void*)diisvec_,'\0',(maxdiis_+1)*sizeof(double));
-
-    // conjugate gradient solver thresholds:
-    cg_convergence_ = options_.get_double("CG_CONVERGENCE");
-    cg_maxiter_     = options_.get_double("CG_MAXITER");
-
-
-    // memory check happens here
-
-    outfile->Printf("\n\n");
-    outfile->Printf( "        ****************************************************\n");
-    outfile->Printf( "        *                                                  *\n");
-    outfile->Printf( "        *    v2RDM-CASSCF (PRIVATE)                        *\n");
-    outfile->Printf( "        *                                                  *\n");
-    outfile->Printf( "        *    A variational 2-RDM-driven approach to the    *\n");
-    outfile->Printf( "        *    active space self-consistent field method     *\n");
-    outfile->Printf( "        *                                                  *\n");
-    outfile->Printf( "        ****************************************************\n");
-
-    // TODO: add citations once we have volume numbers n'nat.
-    outfile->Printf("\n");
-    outfile->Printf("\n");
-    outfile->Printf("        The following papers should be cited when using v2RDM-CASSCF:\n");
-    outfile->Printf("\n");
-    outfile->Printf("        J. Fosso-Tande, D. R. Nascimento, and A. E. DePrince III,\n");
-    outfile->Printf("        Mol. Phys. 114, 423-430 (2015).\n");
-    outfile->Printf("\n");
-    outfile->Printf("            URL: http://dx.doi.org/10.1080/00268976.2015.1078008\n");
-    outfile->Printf("\n");
-    outfile->Printf("        J. Fosso-Tande, T.-S. Nguyen, G. Gidofalvi, and\n");
-    outfile->Printf("        A. E. DePrince III, J. Chem. Theory Comput. accepted (2016).\n");
-    outfile->Printf("\n");
-    outfile->Printf("            URL: http://dx.doi.org/10.1021/acs.jctc.6b00190\n");
-    outfile->Printf("\n");
-    outfile->Printf("\n");
-
-    outfile->Printf("\n");
-    outfile->Printf("  ==> Convergence parameters <==\n");
-    outfile->Printf("\n");
-    outfile->Printf("        r_convergence:                      %5.3le\n",r_convergence_);
-    outfile->Printf("        e_convergence:                      %5.3le\n",e_convergence_);
-    outfile->Printf("        cg_convergence:                     %5.3le\n",cg_convergence_);
-    outfile->Printf("        maxiter:                             %8i\n",maxiter_);
-    outfile->Printf("        cg_maxiter:                          %8i\n",cg_maxiter_);
-    outfile->Printf("\n");
-
-    // print orbitals per irrep in each space
-    outfile->Printf("  ==> Active space details <==\n");
-    outfile->Printf("\n");
-    //outfile->Printf("        Freeze core orbitals?                   %5s\n",nfrzc_ > 0 ? "yes" : "no");
-    outfile->Printf("        Number of frozen core orbitals:         %5i\n",nfrzc_);
-    outfile->Printf("        Number of restricted occupied orbitals: %5i\n",nrstc_);
-    outfile->Printf("        Number of active occupied orbitals:     %5i\n",ndoccact);
-    outfile->Printf("        Number of active virtual orbitals:      %5i\n",nvirt);
-    outfile->Printf("        Number of restricted virtual orbitals:  %5i\n",nrstv_);
-    outfile->Printf("        Number of frozen virtual orbitals:      %5i\n",nfrzv_);
-    outfile->Printf("\n");
-
-    std::vector<std::string> labels = reference_wavefunction_->molecule()->irrep_labels();
-    outfile->Printf("        Irrep:           ");
-    for (int h = 0; h < nirrep_; h++) {
-        outfile->Printf("%4s",labels[h].c_str());
-        if ( h < nirrep_ - 1 ) {
-            outfile->Printf(",");
-        }
-    }
-    outfile->Printf(" \n");
-    outfile->Printf(" \n");
-
-    outfile->Printf("        frozen_docc     [");
-    for (int h = 0; h < nirrep_; h++) {
-        outfile->Printf("%4i",frzcpi_[h]);
-        if ( h < nirrep_ - 1 ) {
-            outfile->Printf(",");
+            dimensions_.push_back(2*gems_ab[h]); // D200_0,D210_0,D201_0,D211_0
         }
     }
-    outfile->Printf(" ]\n");
-    outfile->Printf("        restricted_docc [");
     for (int h = 0; h < nirrep_; h++) {
-        outfile->Printf("%4i",rstcpi_[h]);
-        if ( h < nirrep_ - 1 ) {
-            outfile->Printf(",");
-        }
+        dimensions_.push_back(amopi_[h]); // D1a
     }
-    outfile->Printf(" ]\n");
-    outfile->Printf("        active          [");
     for (int h = 0; h < nirrep_; h++) {
-        outfile->Printf("%4i",amopi_[h]);
-        if ( h < nirrep_ - 1 ) {
-            outfile->Printf(",");
-        }
+        if ( !closed_shell_ ) dimensions_.push_back(amopi_[h]); // D1b
     }
-    outfile->Printf(" ]\n");
-    outfile->Printf("        restricted_uocc [");
     for (int h = 0; h < nirrep_; h++) {
-        outfile->Printf("%4i",rstvpi_[h]);
-        if ( h < nirrep_ - 1 ) {
-            outfile->Printf(",");
-        }
+        dimensions_.push_back(amopi_[h]); // Q1a
     }
-    outfile->Printf(" ]\n");
-    outfile->Printf("        frozen_uocc     [");
     for (int h = 0; h < nirrep_; h++) {
-        outfile->Printf("%4i",frzvpi_[h]);
-        if ( h < nirrep_ - 1 ) {
-            outfile->Printf(",");
-        }
+        if ( !closed_shell_ ) dimensions_.push_back(amopi_[h]); // Q1b
     }
-    outfile->Printf(" ]\n");
-    outfile->Printf("\n");
-
-    outfile->Printf("  ==> Orbital optimization parameters <==\n");
-    outfile->Printf("\n");
-// gg
-    outfile->Printf("        1-step algorithm:                   %5s\n",options_.get_bool("ORBOPT_ONE_STEP") ? "true" : "false");
-    outfile->Printf("        g_convergence:                  %5.3le\n",options_.get_double("ORBOPT_GRADIENT_CONVERGENCE"));
-    outfile->Printf("        e_convergence:                  %5.3le\n",options_.get_double("ORBOPT_ENERGY_CONVERGENCE"));
-    outfile->Printf("        maximum iterations:                 %5i\n",options_.get_int("ORBOPT_MAXITER"));
-    outfile->Printf("        frequency:                          %5i\n",options_.get_int("ORBOPT_FREQUENCY"));
-    outfile->Printf("        active-active rotations:            %5s\n",options_.get_bool("ORBOPT_ACTIVE_ACTIVE_ROTATIONS") ? "true" : "false");
-    outfile->Printf("        exact diagonal Hessian:             %5s\n",options_.get_bool("ORBOPT_EXACT_DIAGONAL_HESSIAN") ? "true" : "false");
-    outfile->Printf("        number of DIIS vectors:             %5i\n",options_.get_int("ORBOPT_NUM_DIIS_VECTORS"));
-    outfile->Printf("        print iteration info:               %5s\n",options_.get_bool("ORBOPT_WRITE") ? "true" : "false");
-// gg
-
-    outfile->Printf("\n");
-    outfile->Printf("  ==> Memory requirements <==\n");
-    outfile->Printf("\n");
-    int nd2   = 0;
-    int ng2    = 0;
-    int nt1    = 0;
-    int nt2    = 0;
-    int maxgem = 0;
-    for (int h = 0; h < nirrep_; h++) {
-        nd2 +=     gems_ab[h]*gems_ab[h];
-        nd2 += 2 * gems_aa[h]*gems_aa[h];
-
-        ng2 +=     gems_ab[h] * gems_ab[h]; // G2ab
-        ng2 +=     gems_ab[h] * gems_ab[h]; // G2ba
-        ng2 += 4 * gems_ab[h] * gems_ab[h]; // G2aa
-
-        if ( gems_ab[h] > maxgem ) {
-            maxgem = gems_ab[h];
-        }
-        if ( constrain_g2_ ) {
-            if ( 2*gems_ab[h] > maxgem ) {
-                maxgem = 2*gems_ab[h];
+    if ( constrain_q2_ ) {
+        if ( !spin_adapt_q2_ ) {
+            for (int h = 0; h < nirrep_; h++) {
+                dimensions_.push_back(gems_ab[h]); // Q2ab
             }
-        }
-
-        if ( constrain_t1_ ) {
-            nt1 += trip_aaa[h] * trip_aaa[h]; // T1aaa
-            nt1 += trip_aaa[h] * trip_aaa[h]; // T1bbb
-            nt1 += trip_aab[h] * trip_aab[h]; // T1aab
-            nt1 += trip_aab[h] * trip_aab[h]; // T1bba
-            if ( trip_aab[h] > maxgem ) {
-                maxgem = trip_aab[h];
+            for (int h = 0; h < nirrep_; h++) {
+                dimensions_.push_back(gems_aa[h]); // Q2aa
             }
-        }
-
-        if ( constrain_t2_ ) {
-            nt2 += (trip_aab[h]+trip_aba[h]) * (trip_aab[h]+trip_aba[h]); // T2aaa
-            nt2 += (trip_aab[h]+trip_aba[h]) * (trip_aab[h]+trip_aba[h]); // T2bbb
-            nt2 += trip_aab[h] * trip_aab[h]; // T2aab
-            nt2 += trip_aab[h] * trip_aab[h]; // T2bba
-
-            if ( trip_aab[h]+trip_aaa[h] > maxgem ) {
-                maxgem = trip_aab[h]+trip_aaa[h];
+            for (int h = 0; h < nirrep_; h++) {
+                if ( !closed_shell_ ) dimensions_.push_back(gems_aa[h]); // Q2bb
+            }
+        }else {
+            for (int h = 0; h < nirrep_; h++) {
+                dimensions_.push_back(gems_00[h]); // Q2s
+            }
+            for (int h = 0; h < nirrep_; h++) {
+                dimensions_.push_back(gems_aa[h]); // Q2t
+            }
+            for (int h = 0; h < nirrep_; h++) {
+                dimensions_.push_back(gems_aa[h]); // Q2t_p1
+            }
+            for (int h = 0; h < nirrep_; h++) {
+                if ( !closed_shell_ ) dimensions_.push_back(gems_aa[h]); // Q2t_m1
             }
         }
-
-    }
-
-    outfile->Printf("        D2:                       %7.2lf mb\n",nd2 * 8.0 / 1024.0 / 1024.0);
-    if ( constrain_q2_ ) {
-        outfile->Printf("        Q2:                       %7.2lf mb\n",nd2 * 8.0 / 1024.0 / 1024.0);
-    }
-    if ( constrain_g2_ ) {
-        outfile->Printf("        G2:                       %7.2lf mb\n",ng2 * 8.0 / 1024.0 / 1024.0);
-    }
-    if ( constrain_d3_ ) {
-        outfile->Printf("        D3:                       %7.2lf mb\n",nt1 * 8.0 / 1024.0 / 1024.0);
-    }
-    if ( constrain_t1_ ) {
-        outfile->Printf("        T1:                       %7.2lf mb\n",nt1 * 8.0 / 1024.0 / 1024.0);
-    }
-    if ( constrain_t2_ ) {
-        outfile->Printf("        T2:                       %7.2lf mb\n",nt2 * 8.0 / 1024.0 / 1024.0);
-    }
-    outfile->Printf("\n");
-
-    // we have 4 arrays the size of x and 4 the size of y
-    // in addition, we need to store 3 times whatever the largest
-    // block of x is for the diagonalization step
-    // integrals:
-    //     K2a, K2b
-    // casscf:
-    //     4-index integrals (no permutational symmetry)
-    //     3-index integrals
-
-    double tot = 4.0*dimx_ + 4.0*nconstraints_ + 3.0*maxgem*maxgem;
-    tot += nd2; // for K2a, K2b
-
-    // for casscf, need d2 and 3- or 4-index integrals
-
-    // storage requirements for full d2
-    for (int h = 0; h < nirrep_; h++) {
-        tot += gems_plus_core[h] * ( gems_plus_core[h] + 1 ) / 2;
-    }
-    if ( is_df_ ) {
-        // storage requirements for df integrals
-        nQ_ = Process::environment.globals["NAUX (SCF)"];
-        if ( options_.get_str("SCF_TYPE") == "DF" ) {
-//            std::shared_ptr<BasisSet> primary = BasisSet::pyconstruct_orbital(molecule_,
-//                "BASIS", options_.get_str("BASIS"));
-            std::shared_ptr<BasisSet> primary = reference_wavefunction_->basisset();
-
-//            std::shared_ptr<BasisSet> auxiliary = BasisSet::pyconstruct_auxiliary(molecule_,
-//                "DF_BASIS_SCF", options_.get_str("DF_BASIS_SCF"), "JKFIT",
-//                options_.get_str("BASIS"), primary->has_puream());
-//            std::shared_ptr<BasisSet> auxiliary = reference_wavefunction_->get_basisset("DF_BASIS_MP2");
-            std::shared_ptr<BasisSet> auxiliary = reference_wavefunction_->get_basisset("DF_BASIS_SCF");
-
-            nQ_ = auxiliary->nbf();
-            Process::environment.globals["NAUX (SCF)"] = nQ_;
-        }
-        tot += (long int)nQ_*(long int)nmo_*((long int)nmo_+1)/2;
-    }else {
-        // storage requirements for four-index integrals
-        for (int h = 0; h < nirrep_; h++) {
-            tot += (long int)gems_full[h] * ( (long int)gems_full[h] + 1L ) / 2L;
-        }
-        // for four-index integrals stored stupidly
-        //tot += (long int)nmo_*(long int)nmo_*(long int)nmo_*(long int)nmo_;
     }
-
-    // memory available after allocating all we need for v2RDM-CASSCF
-    available_memory_ = memory_ - tot * 8L;
-
-    outfile->Printf("        Total number of variables:     %10i\n",dimx_);
-    outfile->Printf("        Total number of constraints:   %10i\n",nconstraints_);
-    outfile->Printf("        Total memory requirements:     %7.2lf mb\n",tot * 8.0 / 1024.0 / 1024.0);
-    outfile->Printf("\n");
-
-    if ( tot * 8.0 > (double)memory_ ) {
-        outfile->Printf("\n");
-        outfile->Printf("        Not enough memory!\n");
-        outfile->Printf("\n");
-        if ( !is_df_ ) {
-            outfile->Printf("        Either increase the available memory by %7.2lf mb\n",(8.0 * tot - memory_)/1024.0/1024.0);
-            outfile->Printf("        or try scf_type = df or scf_type = cd\n");
-
+    if ( constrain_g2_ ) {
+        if ( !spin_adapt_g2_ ) {
+            for (int h = 0; h < nirrep_; h++) {
+                dimensions_.push_back(gems_ab[h]); // G2ab
+            }
+            for (int h = 0; h < nirrep_; h++) {
+                if ( !closed_shell_ ) dimensions_.push_back(gems_ab[h]); // G2ba
+            }
+            for (int h = 0; h < nirrep_; h++) {
+                dimensions_.push_back(2*gems_ab[h]); // G2aa
+            }
         }else {
-            outfile->Printf("        Increase the available memory by %7.2lf mb.\n",(8.0 * tot - memory_)/1024.0/1024.0);
+            for (int h = 0; h < nirrep_; h++) {
+                dimensions_.push_back(gems_ab[h]); // G2s
+            }
+            for (int h = 0; h < nirrep_; h++) {
+                dimensions_.push_back(gems_ab[h]); // G2t
+            }
+            for (int h = 0; h < nirrep_; h++) {
+                dimensions_.push_back(gems_ab[h]); // G2t_p1
+            }
+            for (int h = 0; h < nirrep_; h++) {
+                if ( !closed_shell_ ) dimensions_.push_back(gems_ab[h]); // G2t_m1
+            }
         }
-        outfile->Printf("\n");
-        throw PsiException("Not enough memory",__FILE__,__LINE__);
     }
-
-    // mo-mo transformation matrix
-    newMO_ = (SharedMatrix)(new Matrix(reference_wavefunction_->Ca()));
-    newMO_->zero();
-    for (int h = 0; h < nirrep_; h++) {
-        for (int i = 0; i < nmopi_[h]; i++) {
-            newMO_->pointer(h)[i][i] = 1.0;
+    if ( constrain_t1_ ) {
+        for (int h = 0; h < nirrep_; h++) {
+            dimensions_.push_back(trip_aaa[h]); // T1aaa
+        }
+        for (int h = 0; h < nirrep_; h++) {
+            if ( !closed_shell_ ) dimensions_.push_back(trip_aaa[h]); // T1bbb
+        }
+        for (int h = 0; h < nirrep_; h++) {
+            dimensions_.push_back(trip_aab[h]); // T1aab
+        }
+        for (int h = 0; h < nirrep_; h++) {
+            if ( !closed_shell_ ) dimensions_.push_back(trip_aab[h]); // T1bba
         }
     }
-
-    orbopt_transformation_matrix_ = (double*)malloc((nmo_-nfrzc_-nfrzv_)*(nmo_-nfrzc_-nfrzv_)*sizeof(double));
-    memset((void*)orbopt_transformation_matrix_,'\0',(nmo_-nfrzc_-nfrzv_)*(nmo_-nfrzc_-nfrzv_)*sizeof(double));
-    for (int i = 0; i < nmo_-nfrzc_-nfrzv_; i++) {
-        orbopt_transformation_matrix_[i*(nmo_-nfrzc_-nfrzv_)+i] = 1.0;
-    }
-
-    //  if restarting, need to grab Ca_ from disk before integral transformation
-    // checkpoint file
-    if ( options_.get_str("RESTART_FROM_CHECKPOINT_FILE") != "" ) {
-        ReadOrbitalsFromCheckpointFile();
-    }
-
-    // if using 3-index integrals, transform them before allocating any memory integrals, transform
-    if ( is_df_ ) {
-        outfile->Printf("    ==> Transform three-electron integrals <==\n");
-        outfile->Printf("\n");
-
-        double start = omp_get_wtime();
-        ThreeIndexIntegrals();
-        double end = omp_get_wtime();
-
-        outfile->Printf("\n");
-        outfile->Printf("        Time for integral transformation:  %7.2lf s\n",end-start);
-        outfile->Printf("\n");
-    } else {
-        // transform integrals
-        outfile->Printf("    ==> Transform two-electron integrals <==\n");
-        outfile->Printf("\n");
-
-        double start = omp_get_wtime();
-        std::vector<std::shared_ptr<MOSpace> > spaces;
-        spaces.push_back(MOSpace::all);
-        std::shared_ptr<IntegralTransform> ints(new IntegralTransform(reference_wavefunction_, spaces, 
-            IntegralTransform::TransformationType::Restricted, IntegralTransform::OutputType::IWLOnly, 
-            IntegralTransform::MOOrdering::PitzerOrder, IntegralTransform::FrozenOrbitals::None, false));
-        ints->set_dpd_id(0);
-        ints->set_keep_iwl_so_ints(true);
-        ints->set_keep_dpd_so_ints(true);
-        ints->initialize();
-        ints->transform_tei(MOSpace::all, MOSpace::all, MOSpace::all, MOSpace::all);
-        double end = omp_get_wtime();
-        outfile->Printf("\n");
-        outfile->Printf("        Time for integral transformation:  %7.2lf s\n",end-start);
-        outfile->Printf("\n");
-
-    }
-
-    // allocate vectors
-    Ax     = SharedVector(new Vector("A . x",nconstraints_));
-    ATy    = SharedVector(new Vector("A^T . y",dimx_));
-    x      = SharedVector(new Vector("primal solution",dimx_));
-    c      = SharedVector(new Vector("OEI and TEI",dimx_));
-    y      = SharedVector(new Vector("dual solution",nconstraints_));
-    z      = SharedVector(new Vector("dual solution 2",dimx_));
-    b      = SharedVector(new Vector("constraints",nconstraints_));
-
-    // DIIS stuff
-    //rx       = SharedVector(new Vector("diis x",dimx_));
-    //rz       = SharedVector(new Vector("diis z",dimx_));
-    //rx_error = SharedVector(new Vector("diis error x",dimx_));
-    //rz_error = SharedVector(new Vector("diis error z",dimx_));
-    //junk1    = (double*)malloc(2 * dimx_*sizeof(double));
-    //junk2    = (double*)malloc(2 * dimx_*sizeof(double));
-
-
-    // input/output array for orbopt sweeps
-
-    int nthread = 1;
-    #ifdef _OPENMP
-        nthread = omp_get_max_threads();
-    #endif
-
-    orbopt_data_    = (double*)malloc(15*sizeof(double));
-    orbopt_data_[0] = (double)nthread;
-    orbopt_data_[1] = (double)(options_.get_bool("ORBOPT_ACTIVE_ACTIVE_ROTATIONS") ? 1.0 : 0.0 );
-    orbopt_data_[2] = (double)nfrzc_; //(double)options_.get_int("ORBOPT_FROZEN_CORE");
-    orbopt_data_[3] = (double)options_.get_double("ORBOPT_GRADIENT_CONVERGENCE");
-    orbopt_data_[4] = (double)options_.get_double("ORBOPT_ENERGY_CONVERGENCE");
-    orbopt_data_[5] = (double)(options_.get_bool("ORBOPT_WRITE") ? 1.0 : 0.0 );
-    orbopt_data_[6] = (double)(options_.get_bool("ORBOPT_EXACT_DIAGONAL_HESSIAN") ? 1.0 : 0.0 );
-    orbopt_data_[7] = (double)options_.get_int("ORBOPT_NUM_DIIS_VECTORS");
-    orbopt_data_[8] = (double)options_.get_int("ORBOPT_MAXITER");
-    orbopt_data_[9] = 0.0;
-    if ( is_df_ ) {
-      orbopt_data_[9] = 1.0;
+    if ( constrain_t2_ ) {
+        for (int h = 0; h < nirrep_; h++) {
+            dimensions_.push_back(trip_aab[h]+trip_aba[h]); // T2aaa
+        }
+        for (int h = 0; h < nirrep_; h++) {
+            if ( !closed_shell_ ) dimensions_.push_back(trip_aab[h]+trip_aba[h]); // T2bbb
+        }
+        for (int h = 0; h < nirrep_; h++) {
+            dimensions_.push_back(trip_aab[h]); // T2aab
+        }
+        for (int h = 0; h < nirrep_; h++) {
+            if ( !closed_shell_ ) dimensions_.push_back(trip_aab[h]); // T2bba
+        }
     }
-    orbopt_data_[10] = 0.0;  // number of iterations (output)
-    orbopt_data_[11] = 0.0;  // gradient norm (output)
-    orbopt_data_[12] = 0.0;  // change in energy (output)
-    orbopt_data_[13] = 0.0;  // converged?
-
-    // orbital optimizatoin algorithm
-    orbopt_data_[14] = 0.0;
-    if      ( options_.get_str("ORBOPT_ALGORITHM") == "QUASI_NEWTON" )       orbopt_data_[14] = 0.0;
-    else if ( options_.get_str("ORBOPT_ALGORITHM") == "CONJUGATE_GRADIENT" ) orbopt_data_[14] = 1.0;
-    else if ( options_.get_str("ORBOPT_ALGORITHM") == "NEWTON_RAPHSON" )     orbopt_data_[14] = 2.0;
-
-    orbopt_converged_ = false;
-
-    // don't change the length of this filename
-    orbopt_outfile_ = (char*)malloc(120*sizeof(char));
-    std::string filename = get_writer_file_prefix(reference_wavefunction_->molecule()->name()) + ".orbopt";
-    strcpy(orbopt_outfile_,filename.c_str());
-    if ( options_.get_bool("ORBOPT_WRITE") ) {
-        FILE * fp = fopen(orbopt_outfile_,"w");
-        fclose(fp);
+    if ( constrain_d3_ ) {
+        for (int h = 0; h < nirrep_; h++) {
+            dimensions_.push_back(trip_aaa[h]); // D3aaa
+        }
+        for (int h = 0; h < nirrep_; h++) {
+            if ( !closed_shell_ ) dimensions_.push_back(trip_aaa[h]); // D3bbb
+        }
+        for (int h = 0; h < nirrep_; h++) {
+            dimensions_.push_back(trip_aab[h]); // D3aab
+        }
+        for (int h = 0; h < nirrep_; h++) {
+            if ( !closed_shell_ ) dimensions_.push_back(trip_aab[h]); // D3bba
+        }
     }
 
-    // initialize timers and iteration counters
-    iiter_total_       = 0;
-    oiter_total_       = 0;
-    orbopt_iter_total_ = 0;
-
-    iiter_time_        = 0.0;
-    oiter_time_        = 0.0;
-    orbopt_time_       = 0.0;
-
-    // allocate memory for orbital lagrangian (TODO: make these smaller)
-    X_               = (double*)malloc(nmo_*nmo_*sizeof(double));
+    // evaluate constraint families concurrently in A.u and A^T.u?
+    constraint_tasks_       = options_.get_bool("CONSTRAINT_TASKS");
+    constraint_task_buffer_ = NULL;
 
-    // even if we use rhf/rohf reference, we need same_a_b_orbs_=false
-    // to trigger the correct integral transformations in deriv.cc
-    same_a_b_orbs_ = false;
-    same_a_b_dens_ = false;
+    // reference implementation of the T2 constraints?
+    slow_t2_constraints_    = options_.get_bool("SLOW_T2_CONSTRAINTS");
 
+    // explicit sparse constraint matrix is built in compute_energy()
+    sparse_constraint_matrix_ = false;
 }
 
 int v2RDMSolver::SymmetryPair(int i,int j) {
@@ -1511,6 +1789,26 @@ double v2RDMSolver::compute_energy() {
     // generate constraint vector
     BuildConstraints();
 
+    // explicit sparse A and A^T (and A.A^T)
+    if ( options_.get_bool("SPARSE_CONSTRAINT_MATRIX") 
+      || options_.get_bool("SPARSE_GRAM_MATRIX") 
+      || options_.get_bool("SPARSE_CHOLESKY") ) {
+        BuildSparseConstraintMatrix();
+    }
+    if ( options_.get_bool("SPARSE_GRAM_MATRIX") ) {
+        BuildSparseGramMatrix();
+    }
+
+    // sparse Cholesky factor of A.A^T
+    if ( options_.get_bool("SPARSE_CHOLESKY") ) {
+        BuildCholeskyFactor();
+    }
+
+    // diagonal preconditioner for CG
+    if ( options_.get_bool("CG_PRECONDITIONER") ) {
+        BuildCGPreconditioner();
+    }
+
     // AATy = A(c-z)+tu(b-Ax) rearange w.r.t cg solver
     // Ax   = AATy and b=A(c-z)+tu(b-Ax)
     SharedVector B   = SharedVector(new Vector("compound B",nconstraints_));
@@ -1519,9 +1817,15 @@ double v2RDMSolver::compute_energy() {
     long int N = nconstraints_;
     std::shared_ptr<CGSolver> cg (new CGSolver(N));
     cg->set_max_iter(cg_maxiter_);
+    cg->set_timers(&timers_);
+
+    timers_.sample_memory("initialization");
+
+    // x is stored like z from here on
+    PackX();
 
     // evaluate guess energy (c.x):
-    double energy_primal = C_DDOT(dimx_,c->pointer(),1,x->pointer(),1);
+    double energy_primal = C_DDOT(primal_dim_,c->pointer(),1,x->pointer(),1);
 
     outfile->Printf("\n");
     outfile->Printf("    reference energy:     %20.12lf\n",escf_);
@@ -1550,9 +1854,7 @@ double v2RDMSolver::compute_energy() {
 
     int oiter=0;
 
-    diis_oiter_           = 0;
-    int diis_iter         = 0;
-    int replace_diis_iter = 1;
+    DIIS_Reset();
 
     bool stop_updating_mu = false;
     do {
@@ -1561,14 +1863,14 @@ double v2RDMSolver::compute_energy() {
         double start = omp_get_wtime();
 
         // evaluate tau * mu * (b - Ax) for CG
-        bpsdp_Au(Ax, x);
+        bpsdp_Au_packed(Ax, x);
         Ax->subtract(b);
         Ax->scale(-tau*mu);
 
         // evaluate A(c-z) ( but don't overwrite c! )
         z->scale(-1.0);
         z->add(c);
-        bpsdp_Au(B,z);
+        bpsdp_Au_packed(B,z);
 
         // add tau*mu*(b-Ax) to A(c-z) and put result in B
         B->add(Ax);
@@ -1585,7 +1887,13 @@ double v2RDMSolver::compute_energy() {
         cg->set_convergence(cg_conv_i);
 
         // solve CG problem (step 1 in table 1 of PRL 106 083001)
-        cg->solve(N,Ax,y,B,evaluate_Ap,(void*)this);
+        if ( AAT_cholesky_ ) {
+            cg->preconditioned_solve(N,Ax,y,B,evaluate_Ap,evaluate_Mr,(void*)this);
+        }else if ( cg_preconditioner_ ) {
+            cg->preconditioned_solve(N,Ax,y,B,cg_precon_,evaluate_Ap,(void*)this);
+        }else {
+            cg->solve(N,Ax,y,B,evaluate_Ap,(void*)this);
+        }
         int iiter = cg->total_iterations();
 
         double end = omp_get_wtime();
@@ -1595,8 +1903,20 @@ double v2RDMSolver::compute_energy() {
 
         start = omp_get_wtime();
 
-        // update primal and dual solutions
+        // update primal and dual solutions (and their square roots, for DIIS)
+        update_xz_sqrt_ = DIIS_Collecting();
+        double update_xz_start = omp_get_wtime();
         Update_xz();
+        timers_.accumulate(TIMER_UPDATE_XZ,omp_get_wtime() - update_xz_start);
+
+        // DIIS extrapolation of x and z
+        if ( update_xz_sqrt_ ) {
+            DIIS_StoreVectors();
+            if ( diis_oiter_ % diis_update_frequency_ == diis_update_frequency_ - 1 ) {
+                DIIS_Extrapolate();
+            }
+        }
+        diis_oiter_++;
 
         end = omp_get_wtime();
 
@@ -1606,13 +1926,13 @@ double v2RDMSolver::compute_energy() {
         // update mu (step 3)
 
         // evaluate || A^T y - c + z||
-        bpsdp_ATu(ATy, y);
+        bpsdp_ATu_packed(ATy, y);
         ATy->add(z);
         ATy->subtract(c);
         ed = ATy->norm();///sqrt(dimx_);
 
         // evaluate || Ax - b ||
-        bpsdp_Au(Ax, x);
+        bpsdp_Au_packed(Ax, x);
         Ax->subtract(b);
         ep = Ax->norm();///sqrt(nconstraints_);
 
@@ -1621,14 +1941,12 @@ double v2RDMSolver::compute_energy() {
             mu = mu*ep/ed;
 
             // reset DIIS
-            diis_oiter_       = 0;
-            diis_iter         = 0;
-            replace_diis_iter = 1;
+            DIIS_Reset();
 
         }
 
         // compute current primal and dual energies
-        double current_energy = C_DDOT(dimx_,c->pointer(),1,x->pointer(),1);
+        double current_energy = C_DDOT(primal_dim_,c->pointer(),1,x->pointer(),1);
         energy_dual   = C_DDOT(nconstraints_,b->pointer(),1,y->pointer(),1);
 
         if ( options_.get_bool("OPTIMIZE_ORBITALS") ) {
@@ -1643,12 +1961,10 @@ double v2RDMSolver::compute_energy() {
                 orbopt_iter_total_++;
 
                 // reset DIIS
-                diis_oiter_       = 0;
-                diis_iter         = 0;
-                replace_diis_iter = 1;
+                DIIS_Reset();
 
                 // compute current primal and dual energies
-                current_energy = C_DDOT(dimx_,c->pointer(),1,x->pointer(),1);
+                current_energy = C_DDOT(primal_dim_,c->pointer(),1,x->pointer(),1);
                 energy_dual   = C_DDOT(nconstraints_,b->pointer(),1,y->pointer(),1);
             }
         }else {
@@ -1679,7 +1995,7 @@ double v2RDMSolver::compute_energy() {
                 orbopt_time_      += end - start;
                 orbopt_iter_total_++;
 
-                energy_primal = C_DDOT(dimx_,c->pointer(),1,x->pointer(),1);
+                energy_primal = C_DDOT(primal_dim_,c->pointer(),1,x->pointer(),1);
             }
         }else {
             orbopt_converged_ = true;
@@ -1691,6 +2007,11 @@ double v2RDMSolver::compute_energy() {
         throw PsiException("v2RDM did not converge.",__FILE__,__LINE__);
     }
 
+    timers_.sample_memory("iterations");
+
+    // everything from here on indexes x as full squares
+    UnpackX();
+
     outfile->Printf("\n");
     outfile->Printf("      v2RDM iterations converged!\n");
     outfile->Printf("\n");
@@ -1727,7 +2048,9 @@ double v2RDMSolver::compute_energy() {
     UpdateTransformationMatrix();
 
     if ( options_.get_bool("MOLDEN_WRITE") ) {
+        double start = omp_get_wtime();
         WriteMoldenFile();
+        timers_.accumulate(TIMER_WRITE_MOLDEN,omp_get_wtime() - start);
     }
 
     if ( options_.get_bool("SEMICANONICALIZE_ORBITALS") ) {
@@ -1745,7 +2068,9 @@ double v2RDMSolver::compute_energy() {
             UpdateTransformationMatrix();
 
             // transform D1, D2, D3 to semicanonical basis
+            double start = omp_get_wtime();
             UpdatePrimal();
+            timers_.accumulate(TIMER_UPDATE_PRIMAL,omp_get_wtime() - start);
             //printf("primal energy after transformation:        %20.12lf\n",C_DDOT(dimx_,c->pointer(),1,x->pointer(),1)+efzc_);
     
         }
@@ -1764,18 +2089,26 @@ double v2RDMSolver::compute_energy() {
 
     // write tpdm to disk?
     if ( options_.get_bool("TPDM_WRITE") ) {
+        double start = omp_get_wtime();
         WriteActiveTPDM();
+        timers_.accumulate(TIMER_WRITE_ACTIVE_TPDM,omp_get_wtime() - start);
     }
     if ( options_.get_bool("TPDM_WRITE_FULL") ) {
+        double start = omp_get_wtime();
         WriteTPDM();
+        timers_.accumulate(TIMER_WRITE_TPDM,omp_get_wtime() - start);
         //ReadTPDM();
     }
     if ( options_.get_bool("OPDM_WRITE_FULL") ) {
+        double start = omp_get_wtime();
         WriteOPDM();
+        timers_.accumulate(TIMER_WRITE_OPDM,omp_get_wtime() - start);
     }
     // write 3-particle density matrix to disk?
     if ( options_.get_bool("3PDM_WRITE") && options_.get_bool("CONSTRAIN_D3")) {
+        double start = omp_get_wtime();
         WriteActive3PDM();
+        timers_.accumulate(TIMER_WRITE_ACTIVE_3PDM,omp_get_wtime() - start);
         //Read3PDM();
     }
 
@@ -1787,13 +2120,17 @@ double v2RDMSolver::compute_energy() {
         }
 
         // write checkpoint file for next step in optimization
+        double start = omp_get_wtime();
         WriteCheckpointFile();
+        timers_.accumulate(TIMER_WRITE_CHECKPOINT,omp_get_wtime() - start);
 
         orbopt_data_[8] = -1.0;
         RotateOrbitals();
 
         // write 2-RDM in IWL format
+        start = omp_get_wtime();
         WriteTPDM_IWL();
+        timers_.accumulate(TIMER_WRITE_TPDM_IWL,omp_get_wtime() - start);
 
         // push orbital lagrangian onto wave function
         OrbitalLagrangian();
@@ -1809,6 +2146,7 @@ double v2RDMSolver::compute_energy() {
     outfile->Printf("\n");
     outfile->Printf("      Microiterations:            %12li\n",iiter_total_);
     outfile->Printf("      Macroiterations:            %12li\n",oiter_total_);
+    outfile->Printf("      Microiterations per macro:  %12.2lf\n",oiter_total_ > 0 ? (double)iiter_total_ / oiter_total_ : 0.0);
     outfile->Printf("      Orbital optimization steps: %12li\n",orbopt_iter_total_);
     outfile->Printf("\n");
     outfile->Printf("  ==> Wall time <==\n");
@@ -1819,11 +2157,45 @@ double v2RDMSolver::compute_energy() {
     outfile->Printf("      Total:                      %12.2lf s\n",end_total_time - start_total_time);
     outfile->Printf("\n");
 
+    if ( options_.get_bool("TIMERS_WRITE") ) {
+        timers_.add_info("energy",energy_);
+        timers_.add_info("microiterations",(double)iiter_total_);
+        timers_.add_info("macroiterations",(double)oiter_total_);
+        timers_.add_info("orbital optimization steps",(double)orbopt_iter_total_);
+        timers_.add_info("total time",end_total_time - start_total_time);
+        WriteTimers();
+    }
+
     //CheckSpinStructure();
 
     return energy_primal + enuc_ + efzc_;
 }
 
+void v2RDMSolver::WriteTimers() {
+
+    timers_.sample_memory("final");
+
+    timers_.add_info("positivity",options_.get_str("POSITIVITY"));
+    timers_.add_info("constrain D3",options_.get_bool("CONSTRAIN_D3") ? "true" : "false");
+    timers_.add_info("active orbitals",(double)amo_);
+    timers_.add_info("primal dimension",(double)dimx_);
+    timers_.add_info("constraints",(double)nconstraints_);
+    timers_.add_info("blocks",(double)dimensions_.size());
+
+    timers_.print();
+
+    std::string format = options_.get_str("TIMERS_FORMAT");
+    std::string prefix = get_writer_file_prefix(reference_wavefunction_->molecule()->name());
+    if ( format == "JSON" ) {
+        timers_.write_json(prefix + ".timers.json");
+        outfile->Printf("    timers written to %s\n",(prefix + ".timers.json").c_str());
+    }else {
+        timers_.write_csv(prefix + ".timers.csv");
+        outfile->Printf("    timers written to %s\n",(prefix + ".timers.csv").c_str());
+    }
+    outfile->Printf("\n");
+}
+
 void v2RDMSolver::CheckSpinStructure() {
     double * x_p = x->pointer();
     // D1a = D1b
@@ -2018,7 +2390,7 @@ void v2RDMSolver::Guess(){
     double* y_p = y->pointer();
 
     memset((void*)x_p,'\0',dimx_*sizeof(double));
-    memset((void*)z_p,'\0',dimx_*sizeof(double));
+    memset((void*)z_p,'\0',primal_dim_*sizeof(double));
     memset((void*)y_p,'\0',nconstraints_*sizeof(double));
 
     if ( options_.get_str("TPDM_GUESS") == "HF" ) {
@@ -2109,7 +2481,8 @@ void v2RDMSolver::Guess(){
         srand(0);
         for (int i = 0; i < dimx_; i++) {
             x_p[i] = ( (double)rand()/RAND_MAX - 1.0 ) * 2.0;
-            z_p[i] = ( (double)rand()/RAND_MAX - 1.0 ) * 2.0;
+            double dum = ( (double)rand()/RAND_MAX - 1.0 ) * 2.0;
+            if ( i < primal_dim_ ) z_p[i] = dum;
         }
         for (int i = 0; i < nconstraints_; i++) {
             y_p[i] = ( (double)rand()/RAND_MAX - 1.0 ) * 2.0;
@@ -2646,7 +3019,7 @@ void v2RDMSolver::BuildConstraints(){
     ///Trace of D2(s=0,ms=0) and D2(s=1,ms=0)
     b_p[offset++] = trdab;
     b_p[offset++] = trdaa;
-    b_p[offset++] = trdbb;
+    if ( !closed_shell_ ) b_p[offset++] = trdbb;
 
 
     // d1 / q1 a
@@ -2660,13 +3033,15 @@ void v2RDMSolver::BuildConstraints(){
     }
 
     // d1 / q1 b
-    for (int h = 0; h < nirrep_; h++) {
-        for(int i = 0; i < amopi_[h]; i++){
-            for(int j = 0; j < amopi_[h]; j++){
-                b_p[offset + i*amopi_[h]+j] = (double)(i==j);
+    if ( !closed_shell_ ) {
+        for (int h = 0; h < nirrep_; h++) {
+            for(int i = 0; i < amopi_[h]; i++){
+                for(int j = 0; j < amopi_[h]; j++){
+                    b_p[offset + i*amopi_[h]+j] = (double)(i==j);
+                }
             }
+            offset += amopi_[h]*amopi_[h];
         }
-        offset += amopi_[h]*amopi_[h];
     }
 
     //contract D2ab -> D1a
@@ -2699,30 +3074,34 @@ void v2RDMSolver::BuildConstraints(){
         offset += amopi_[h]*amopi_[h];
     }
     //contract D2bb -> D1b
-    for (int h = 0; h < nirrep_; h++) {
-        for(int i = 0; i < amopi_[h]; i++){
-            for(int j = 0; j < amopi_[h]; j++){
-                b_p[offset + i*amopi_[h]+j] = 0.0;
+    if ( !closed_shell_ ) {
+        for (int h = 0; h < nirrep_; h++) {
+            for(int i = 0; i < amopi_[h]; i++){
+                for(int j = 0; j < amopi_[h]; j++){
+                    b_p[offset + i*amopi_[h]+j] = 0.0;
+                }
             }
+            offset += amopi_[h]*amopi_[h];
         }
-        offset += amopi_[h]*amopi_[h];
     }
     // additional spin constraints for singlets:
     if ( constrain_spin_ && nalpha_ == nbeta_ ) {
         for ( int h = 0; h < nirrep_; h++) {
-            offset += amopi_[h]*amopi_[h]; // D1a = D1b
-        }
-        for ( int h = 0; h < nirrep_; h++) {
-            offset += gems_aa[h]*gems_aa[h]; // D2aa = D2bb
-        }
-        for ( int h = 0; h < nirrep_; h++) {
-            offset += gems_aa[h]*gems_aa[h]; // D2aa[pq][rs] = 1/2(D2ab[pq][rs] - D2ab[pq][sr] - D2ab[qp][rs] + D2ab[qp][sr])
-        }
-        for ( int h = 0; h < nirrep_; h++) {
-            offset += gems_aa[h]*gems_aa[h]; // D2bb[pq][rs] = 1/2(D2ab[pq][rs] - D2ab[pq][sr] - D2ab[qp][rs] + D2ab[qp][sr]))
-        }
-        for ( int h = 0; h < nirrep_; h++) {
-            offset += gems_ab[h]*gems_ab[h]; // D200[pq][rs] = 1/(sqrt(1+dpq)sqrt(1+drs))(D2ab[pq][rs] + D2ab[pq][sr] + D2ab[qp][rs] + D2ab[qp][sr])
+            if ( !closed_shell_ ) offset += amopi_[h]*amopi_[h]; // D1a = D1b
+        }
+        if ( !spin_adapt_d2_ ) {
+            for ( int h = 0; h < nirrep_; h++) {
+                if ( !closed_shell_ ) offset += gems_aa[h]*gems_aa[h]; // D2aa = D2bb
+            }
+            for ( int h = 0; h < nirrep_; h++) {
+                offset += gems_aa[h]*gems_aa[h]; // D2aa[pq][rs] = 1/2(D2ab[pq][rs] - D2ab[pq][sr] - D2ab[qp][rs] + D2ab[qp][sr])
+            }
+            for ( int h = 0; h < nirrep_; h++) {
+                if ( !closed_shell_ ) offset += gems_aa[h]*gems_aa[h]; // D2bb[pq][rs] = 1/2(D2ab[pq][rs] - D2ab[pq][sr] - D2ab[qp][rs] + D2ab[qp][sr]))
+            }
+            for ( int h = 0; h < nirrep_; h++) {
+                offset += gems_ab[h]*gems_ab[h]; // D200[pq][rs] = 1/(sqrt(1+dpq)sqrt(1+drs))(D2ab[pq][rs] + D2ab[pq][sr] + D2ab[qp][rs] + D2ab[qp][sr])
+            }
         }
     }else if ( constrain_spin_ ) { // nonsinglets
         for ( int h = 0; h < nirrep_; h++) {
@@ -2761,17 +3140,19 @@ void v2RDMSolver::BuildConstraints(){
             }
 
             // map d2bb to q2bb
-            for (int h = 0; h < nirrep_; h++) {
-                for(int ij = 0; ij < gems_aa[h]; ij++){
-                    int i = bas_aa_sym[h][ij][0];
-                    int j = bas_aa_sym[h][ij][1];
-                    for(int kl = 0; kl < gems_aa[h]; kl++){
-                        int k = bas_aa_sym[h][kl][0];
-                        int l = bas_aa_sym[h][kl][1];
-                        b_p[offset + ij*gems_aa[h]+kl] = -(i==k)*(j==l) + (i==l)*(j==k);
+            if ( !closed_shell_ ) {
+                for (int h = 0; h < nirrep_; h++) {
+                    for(int ij = 0; ij < gems_aa[h]; ij++){
+                        int i = bas_aa_sym[h][ij][0];
+                        int j = bas_aa_sym[h][ij][1];
+                        for(int kl = 0; kl < gems_aa[h]; kl++){
+                            int k = bas_aa_sym[h][kl][0];
+                            int l = bas_aa_sym[h][kl][1];
+                            b_p[offset + ij*gems_aa[h]+kl] = -(i==k)*(j==l) + (i==l)*(j==k);
+                        }
                     }
+                    offset += gems_aa[h]*gems_aa[h];
                 }
-                offset += gems_aa[h]*gems_aa[h];
             }
         }else {
             // map d2ab to q2s
@@ -2802,13 +3183,15 @@ void v2RDMSolver::BuildConstraints(){
                 offset += gems_aa[h]*gems_aa[h];
             }
             // map d2bb to q2t_m1
-            for (int h = 0; h < nirrep_; h++) {
-                for(int i = 0; i < gems_aa[h]; i++){
-                    for(int j = 0; j < gems_aa[h]; j++){
-                        b_p[offset + INDEX(i,j)] = 0.0;
+            if ( !closed_shell_ ) {
+                for (int h = 0; h < nirrep_; h++) {
+                    for(int i = 0; i < gems_aa[h]; i++){
+                        for(int j = 0; j < gems_aa[h]; j++){
+                            b_p[offset + INDEX(i,j)] = 0.0;
+                        }
                     }
+                    offset += gems_aa[h]*gems_aa[h];
                 }
-                offset += gems_aa[h]*gems_aa[h];
             }
         }
     }
@@ -2977,7 +3360,7 @@ void v2RDMSolver::BuildConstraints(){
                 offset += gems_aa[h]*gems_aa[h];
             }
         }
-        if (  nbeta_ - nrstc_ - nfrzc_ > 2 ) {
+        if ( !closed_shell_ && nbeta_ - nrstc_ - nfrzc_ > 2 ) {
             // D3bbb -> D2bb
             for (int h = 0; h < nirrep_; h++) {
                 for(int i = 0; i < gems_aa[h]; i++){
@@ -2998,13 +3381,15 @@ void v2RDMSolver::BuildConstraints(){
             offset += gems_aa[h]*gems_aa[h];
         }
         // D3bba -> D2bb
-        for (int h = 0; h < nirrep_; h++) {
-            for(int i = 0; i < gems_aa[h]; i++){
-                for(int j = 0; j < gems_aa[h]; j++){
-                    b_p[offset + i*gems_aa[h]+j] = 0.0;
+        if ( !closed_shell_ ) {
+            for (int h = 0; h < nirrep_; h++) {
+                for(int i = 0; i < gems_aa[h]; i++){
+                    for(int j = 0; j < gems_aa[h]; j++){
+                        b_p[offset + i*gems_aa[h]+j] = 0.0;
+                    }
                 }
+                offset += gems_aa[h]*gems_aa[h];
             }
-            offset += gems_aa[h]*gems_aa[h];
         }
         if (  nalpha_ - nrstc_ - nfrzc_ > 1 ) {
             // D3aab -> D2ab
@@ -3031,11 +3416,11 @@ void v2RDMSolver::BuildConstraints(){
         // additional spin constraints for singlets:
         if ( constrain_spin_ && nalpha_ == nbeta_ ) {
             for (int h = 0; h < nirrep_; h++) {
-                offset += trip_aab[h]*trip_aab[h]; // D3aab = D3bba
+                if ( !closed_shell_ ) offset += trip_aab[h]*trip_aab[h]; // D3aab = D3bba
             }
             for (int h = 0; h < nirrep_; h++) {
                 offset += trip_aaa[h]*trip_aaa[h]; // D3aab -> D3aaa
-                offset += trip_aaa[h]*trip_aaa[h]; // D3bba -> D3bbb
+                if ( !closed_shell_ ) offset += trip_aaa[h]*trip_aaa[h]; // D3bba -> D3bbb
             }
         }
     }
@@ -3045,39 +3430,66 @@ void v2RDMSolver::BuildConstraints(){
 ///Build A dot u where u =[z,c]
 void v2RDMSolver::bpsdp_Au(SharedVector A, SharedVector u){
 
+    double start = omp_get_wtime();
+
+    if ( sparse_constraint_matrix_ ) {
+        A_sparse_->multiply(u->pointer(),A->pointer());
+        timers_.accumulate(TIMER_AU_SPARSE,omp_get_wtime() - start);
+        return;
+    }
+
     //A->zero();
     memset((void*)A->pointer(),'\0',nconstraints_*sizeof(double));
 
-    offset = 0;
+    if ( constraint_tasks_ ) {
+        bpsdp_Au_tasks(A,u);
+        return;
+    }
+
+    start = omp_get_wtime();
     D2_constraints_Au(A,u);
+    timers_.accumulate(TIMER_AU_D2,omp_get_wtime() - start);
 
     if ( constrain_q2_ ) {
+        start = omp_get_wtime();
         if ( !spin_adapt_q2_ ) {
             Q2_constraints_Au(A,u);
         }else {
             Q2_constraints_Au_spin_adapted(A,u);
         }
+        timers_.accumulate(TIMER_AU_Q2,omp_get_wtime() - start);
     }
 
     if ( constrain_g2_ ) {
+        start = omp_get_wtime();
         if ( ! spin_adapt_g2_ ) {
             G2_constraints_Au(A,u);
         }else {
             G2_constraints_Au_spin_adapted(A,u);
         }
+        timers_.accumulate(TIMER_AU_G2,omp_get_wtime() - start);
     }
 
     if ( constrain_t1_ ) {
+        start = omp_get_wtime();
         T1_constraints_Au(A,u);
+        timers_.accumulate(TIMER_AU_T1,omp_get_wtime() - start);
     }
 
     if ( constrain_t2_ ) {
-        //T2_constraints_Au(A,u);
-        T2_constraints_Au_slow(A,u);
+        start = omp_get_wtime();
+        if ( slow_t2_constraints_ ) {
+            T2_constraints_Au_slow(A,u);
+        }else {
+            T2_constraints_Au(A,u);
+        }
+        timers_.accumulate(TIMER_AU_T2,omp_get_wtime() - start);
     }
 
     if ( constrain_d3_ ) {
+        start = omp_get_wtime();
         D3_constraints_Au(A,u);
+        timers_.accumulate(TIMER_AU_D3,omp_get_wtime() - start);
     }
 
 } // end Au
@@ -3087,7 +3499,6 @@ void v2RDMSolver::bpsdp_Au_slow(SharedVector A, SharedVector u){
     //A->zero();
     memset((void*)A->pointer(),'\0',nconstraints_*sizeof(double));
 
-    offset = 0;
     D2_constraints_Au(A,u);
 
     if ( constrain_q2_ ) {
@@ -3111,7 +3522,6 @@ void v2RDMSolver::bpsdp_Au_slow(SharedVector A, SharedVector u){
     }
 
     if ( constrain_t2_ ) {
-        //T2_constraints_Au(A,u);
         T2_constraints_Au_slow(A,u);
     }
     if ( constrain_d3_ ) {
@@ -3123,38 +3533,66 @@ void v2RDMSolver::bpsdp_Au_slow(SharedVector A, SharedVector u){
 ///Build AT dot u where u =[z,c]
 void v2RDMSolver::bpsdp_ATu(SharedVector A, SharedVector u){
 
+    double start = omp_get_wtime();
+
+    if ( sparse_constraint_matrix_ ) {
+        AT_sparse_->multiply(u->pointer(),A->pointer());
+        timers_.accumulate(TIMER_ATU_SPARSE,omp_get_wtime() - start);
+        return;
+    }
+
     //A->zero();
     memset((void*)A->pointer(),'\0',dimx_*sizeof(double));
 
-    offset = 0;
+    if ( constraint_tasks_ ) {
+        bpsdp_ATu_tasks(A,u);
+        return;
+    }
+
+    start = omp_get_wtime();
     D2_constraints_ATu(A,u);
+    timers_.accumulate(TIMER_ATU_D2,omp_get_wtime() - start);
 
     if ( constrain_q2_ ) {
+        start = omp_get_wtime();
         if ( !spin_adapt_q2_ ) {
             Q2_constraints_ATu(A,u);
         }else {
             Q2_constraints_ATu_spin_adapted(A,u);
         }
+        timers_.accumulate(TIMER_ATU_Q2,omp_get_wtime() - start);
     }
 
     if ( constrain_g2_ ) {
+        start = omp_get_wtime();
         if ( ! spin_adapt_g2_ ) {
             G2_constraints_ATu(A,u);
         }else {
             G2_constraints_ATu_spin_adapted(A,u);
         }
+        timers_.accumulate(TIMER_ATU_G2,omp_get_wtime() - start);
     }
 
     if ( constrain_t1_ ) {
+        start = omp_get_wtime();
         T1_constraints_ATu(A,u);
+        timers_.accumulate(TIMER_ATU_T1,omp_get_wtime() - start);
     }
 
     if ( constrain_t2_ ) {
-        //T2_constraints_ATu(A,u);
-        T2_constraints_ATu_slow(A,u);
+        start = omp_get_wtime();
+        if ( slow_t2_constraints_ ) {
+            T2_constraints_ATu_slow(A,u);
+        }else {
+            T2_constraints_ATu(A,u);
+        }
+        timers_.accumulate(TIMER_ATU_T2,omp_get_wtime() - start);
     }
+
     if ( constrain_d3_ ) {
+        start = omp_get_wtime();
         D3_constraints_ATu(A,u);
+        timers_.accumulate(TIMER_ATU_D3,omp_get_wtime() - start);
     }
 
 }//end ATu
@@ -3164,7 +3602,6 @@ void v2RDMSolver::bpsdp_ATu_slow(SharedVector A, SharedVector u){
     //A->zero();
     memset((void*)A->pointer(),'\0',dimx_*sizeof(double));
 
-    offset = 0;
     D2_constraints_ATu(A,u);
 
     if ( constrain_q2_ ) {
@@ -3188,7 +3625,6 @@ void v2RDMSolver::bpsdp_ATu_slow(SharedVector A, SharedVector u){
     }
 
     if ( constrain_t2_ ) {
-        //T2_constraints_ATu(A,u);
         T2_constraints_ATu_slow(A,u);
     }
 
@@ -3198,91 +3634,497 @@ void v2RDMSolver::bpsdp_ATu_slow(SharedVector A, SharedVector u){
 
 }//end ATu
 
-void v2RDMSolver::cg_Ax(long int N,SharedVector A,SharedVector ux){
+// one A^T.u accumulator for each constraint family other than D2
+int v2RDMSolver::NumberOfConstraintTaskBuffers(){
+    int nbuffer = 0;
+    if ( constrain_q2_ ) nbuffer++;
+    if ( constrain_g2_ ) nbuffer++;
+    if ( constrain_t1_ ) nbuffer++;
+    if ( constrain_t2_ ) nbuffer++;
+    if ( constrain_d3_ ) nbuffer++;
+    return nbuffer;
+}
 
-    A->zero();
-    bpsdp_ATu(ATy,ux);
-    bpsdp_Au(A,ATy);
+// A.u with each constraint family evaluated as an OpenMP task.  the 
+// families write to disjoint ranges of A, so no synchronization is needed
+void v2RDMSolver::bpsdp_Au_tasks(SharedVector A, SharedVector u){
+
+    #pragma omp parallel
+    {
+        #pragma omp single
+        {
+            #pragma omp task
+            {
+                double start = omp_get_wtime();
+                D2_constraints_Au(A,u);
+                timers_.accumulate(TIMER_AU_D2,omp_get_wtime() - start);
+            }
+
+            if ( constrain_q2_ ) {
+                #pragma omp task
+                {
+                    double start = omp_get_wtime();
+                    if ( !spin_adapt_q2_ ) {
+                        Q2_constraints_Au(A,u);
+                    }else {
+                        Q2_constraints_Au_spin_adapted(A,u);
+                    }
+                    timers_.accumulate(TIMER_AU_Q2,omp_get_wtime() - start);
+                }
+            }
 
-}//end cg_Ax
+            if ( constrain_g2_ ) {
+                #pragma omp task
+                {
+                    double start = omp_get_wtime();
+                    if ( ! spin_adapt_g2_ ) {
+                        G2_constraints_Au(A,u);
+                    }else {
+                        G2_constraints_Au_spin_adapted(A,u);
+                    }
+                    timers_.accumulate(TIMER_AU_G2,omp_get_wtime() - start);
+                }
+            }
 
-// update x and z
-void v2RDMSolver::Update_xz() {
+            if ( constrain_t1_ ) {
+                #pragma omp task
+                {
+                    double start = omp_get_wtime();
+                    T1_constraints_Au(A,u);
+                    timers_.accumulate(TIMER_AU_T1,omp_get_wtime() - start);
+                }
+            }
 
-    // evaluate M(mu*x + ATy - c)
-    bpsdp_ATu(ATy,y);
-    ATy->subtract(c);
-    x->scale(mu);
-    ATy->add(x);
+            if ( constrain_t2_ ) {
+                #pragma omp task
+                {
+                    double start = omp_get_wtime();
+                    if ( slow_t2_constraints_ ) {
+                        T2_constraints_Au_slow(A,u);
+                    }else {
+                        T2_constraints_Au(A,u);
+                    }
+                    timers_.accumulate(TIMER_AU_T2,omp_get_wtime() - start);
+                }
+            }
 
-    // loop over each block of x/z
-    for (int i = 0; i < dimensions_.size(); i++) {
-        if ( dimensions_[i] == 0 ) continue;
-        int myoffset = 0;
-        for (int j = 0; j < i; j++) {
-            myoffset += dimensions_[j] * dimensions_[j];
+            if ( constrain_d3_ ) {
+                #pragma omp task
+                {
+                    double start = omp_get_wtime();
+                    D3_constraints_Au(A,u);
+                    timers_.accumulate(TIMER_AU_D3,omp_get_wtime() - start);
+                }
+            }
         }
+    }
+}
 
-        SharedMatrix mat     (new Matrix(dimensions_[i],dimensions_[i]));
-        SharedMatrix eigvec  (new Matrix(dimensions_[i],dimensions_[i]));
-        SharedMatrix eigvec2 (new Matrix(dimensions_[i],dimensions_[i]));
-        SharedVector eigval  (new Vector(dimensions_[i]));
+// A^T.u with each constraint family evaluated as an OpenMP task.  the 
+// families overlap in x, so all but D2 accumulate into private buffers 
+// that are summed into A once the tasks are complete
+void v2RDMSolver::bpsdp_ATu_tasks(SharedVector A, SharedVector u){
+
+    double * A_p = A->pointer();
+    double * u_p = u->pointer();
+
+    int nbuffer = 0;
+
+    #pragma omp parallel
+    {
+        #pragma omp single
+        {
+            #pragma omp task
+            {
+                double start = omp_get_wtime();
+                D2_constraints_ATu(A_p,u_p);
+                timers_.accumulate(TIMER_ATU_D2,omp_get_wtime() - start);
+            }
+
+            if ( constrain_q2_ ) {
+                double * buffer = constraint_task_buffer_ + (long int)(nbuffer++) * dimx_;
+                #pragma omp task firstprivate(buffer)
+                {
+                    double start = omp_get_wtime();
+                    memset((void*)buffer,'\0',dimx_*sizeof(double));
+                    if ( !spin_adapt_q2_ ) {
+                        Q2_constraints_ATu(buffer,u_p);
+                    }else {
+                        Q2_constraints_ATu_spin_adapted(buffer,u_p);
+                    }
+                    timers_.accumulate(TIMER_ATU_Q2,omp_get_wtime() - start);
+                }
+            }
 
-        double ** mat_p = mat->pointer();
-        double * A_p    = ATy->pointer();
+            if ( constrain_g2_ ) {
+                double * buffer = constraint_task_buffer_ + (long int)(nbuffer++) * dimx_;
+                #pragma omp task firstprivate(buffer)
+                {
+                    double start = omp_get_wtime();
+                    memset((void*)buffer,'\0',dimx_*sizeof(double));
+                    if ( ! spin_adapt_g2_ ) {
+                        G2_constraints_ATu(buffer,u_p);
+                    }else {
+                        G2_constraints_ATu_spin_adapted(buffer,u_p);
+                    }
+                    timers_.accumulate(TIMER_ATU_G2,omp_get_wtime() - start);
+                }
+            }
 
-        for (int p = 0; p < dimensions_[i]; p++) {
-            for (int q = p; q < dimensions_[i]; q++) {
-                double dum = 0.5 * ( A_p[myoffset + p * dimensions_[i] + q] +
-                                     A_p[myoffset + q * dimensions_[i] + p] );
-                mat_p[p][q] = mat_p[q][p] = dum;
+            if ( constrain_t1_ ) {
+                double * buffer = constraint_task_buffer_ + (long int)(nbuffer++) * dimx_;
+                #pragma omp task firstprivate(buffer)
+                {
+                    double start = omp_get_wtime();
+                    memset((void*)buffer,'\0',dimx_*sizeof(double));
+                    T1_constraints_ATu(buffer,u_p);
+                    timers_.accumulate(TIMER_ATU_T1,omp_get_wtime() - start);
+                }
+            }
 
+            if ( constrain_t2_ ) {
+                double * buffer = constraint_task_buffer_ + (long int)(nbuffer++) * dimx_;
+                #pragma omp task firstprivate(buffer)
+                {
+                    double start = omp_get_wtime();
+                    memset((void*)buffer,'\0',dimx_*sizeof(double));
+                    if ( slow_t2_constraints_ ) {
+                        T2_constraints_ATu_slow(buffer,u_p);
+                    }else {
+                        T2_constraints_ATu(buffer,u_p);
+                    }
+                    timers_.accumulate(TIMER_ATU_T2,omp_get_wtime() - start);
+                }
+            }
+
+            if ( constrain_d3_ ) {
+                double * buffer = constraint_task_buffer_ + (long int)(nbuffer++) * dimx_;
+                #pragma omp task firstprivate(buffer)
+                {
+                    double start = omp_get_wtime();
+                    memset((void*)buffer,'\0',dimx_*sizeof(double));
+                    D3_constraints_ATu(buffer,u_p);
+                    timers_.accumulate(TIMER_ATU_D3,omp_get_wtime() - start);
+                }
             }
         }
 
-        mat->diagonalize(eigvec,eigval);
-        //for (int p = 0; p < dimensions_[i]; p++) {
-        //    if ( fabs(eigval->pointer()[p]) < r_convergence_*0.1 ) eigval->pointer()[p] = 0.0;
-        //}
+        // the barrier at the end of the single region waits for all tasks
+        double start = omp_get_wtime();
+        #pragma omp for schedule (static)
+        for (long int i = 0; i < dimx_; i++) {
+            double dum = 0.0;
+            for (int n = 0; n < nbuffer; n++) {
+                dum += constraint_task_buffer_[(long int)n * dimx_ + i];
+            }
+            A_p[i] += dum;
+        }
+        #pragma omp master
+        timers_.accumulate(TIMER_ATU_REDUCTION,omp_get_wtime() - start);
+    }
+}
 
-        // separate U+ and U-, transform back to nondiagonal basis
+// record A in the same order that bpsdp_ATu evaluates A^T.u
+void v2RDMSolver::RecordConstraints(SparseRecorder * recorder){
 
-        double * eval_p   = eigval->pointer();
-        double ** evec_p  = eigvec->pointer();
-        double ** evec2_p = eigvec2->pointer();
+    SparseTarget A_p(recorder);
+    SparseSource u_p;
 
-        double * x_p      = x->pointer();
-        double * z_p      = z->pointer();
+    // the rows of each family must end exactly where the next family 
+    // starts, and the last family must end at nconstraints_.  otherwise 
+    // the counts in common_init and the kernels have drifted apart, and 
+    // rows of A would overlap or leave gaps
+    auto check = [&](long int end, long int expected, std::string family) {
+        if ( end != expected ) {
+            throw PsiException("number of recorded " + family + " constraints does not match nconstraints_",__FILE__,__LINE__);
+        }
+    };
 
-        // (+) part
-        long int mydim = 0;
-        for (long int j = 0; j < dimensions_[i]; j++) {
-            if ( eval_p[j] > 0.0 ) {
-                for (long int q = 0; q < dimensions_[i]; q++) {
-                    mat_p[q][mydim]   = evec_p[q][j] * eval_p[j]/mu;
-                    evec2_p[q][mydim] = evec_p[q][j];
-                }
-                mydim++;
-            }
+    check(D2_constraints_ATu(A_p,u_p),q2_constraints_offset_,"D2");
+
+    if ( constrain_q2_ ) {
+        if ( !spin_adapt_q2_ ) {
+            check(Q2_constraints_ATu(A_p,u_p),g2_constraints_offset_,"Q2");
+        }else {
+            check(Q2_constraints_ATu_spin_adapted(A_p,u_p),g2_constraints_offset_,"Q2");
         }
-        F_DGEMM('t','n',dimensions_[i],dimensions_[i],mydim,1.0,&mat_p[0][0],dimensions_[i],&evec2_p[0][0],dimensions_[i],0.0,x_p+myoffset,dimensions_[i]);
+    }
 
-        // (-) part
-        mydim = 0;
-        for (long int j = 0; j < dimensions_[i]; j++) {
-            if ( eval_p[j] < 0.0 ) {
-                for (long int q = 0; q < dimensions_[i]; q++) {
-                    mat_p[q][mydim]   = -evec_p[q][j] * eval_p[j];
-                    evec2_p[q][mydim] =  evec_p[q][j];
-                }
-                mydim++;
-            }
+    if ( constrain_g2_ ) {
+        if ( ! spin_adapt_g2_ ) {
+            check(G2_constraints_ATu(A_p,u_p),t1_constraints_offset_,"G2");
+        }else {
+            check(G2_constraints_ATu_spin_adapted(A_p,u_p),t1_constraints_offset_,"G2");
+        }
+    }
+
+    if ( constrain_t1_ ) {
+        check(T1_constraints_ATu(A_p,u_p),t2_constraints_offset_,"T1");
+    }
+
+    if ( constrain_t2_ ) {
+        if ( slow_t2_constraints_ ) {
+            check(T2_constraints_ATu_slow(A_p,u_p),d3_constraints_offset_,"T2");
+        }else {
+            check(T2_constraints_ATu(A_p,u_p),d3_constraints_offset_,"T2");
+        }
+    }
+    if ( constrain_d3_ ) {
+        check(D3_constraints_ATu(A_p,u_p),nconstraints_,"D3");
+    }
+}
+
+// build explicit CSR representations of A and A^T.  bpsdp_Au and 
+// bpsdp_ATu then reduce to threaded sparse matrix-vector products.
+void v2RDMSolver::BuildSparseConstraintMatrix(){
+
+    double start = omp_get_wtime();
+
+    sparse_constraint_matrix_ = false;
+    A_sparse_.reset();
+    AT_sparse_.reset();
+
+    // count elements first so we can check the memory before storing anything
+    long int nraw = 0;
+    {
+        SparseRecorder counter(true);
+        RecordConstraints(&counter);
+        nraw = counter.size();
+    }
+
+    // peak: raw elements (row, col, value) plus unmerged CSR arrays for A, 
+    // then A and A^T once the raw elements are released
+    double raw  = (double)nraw * sizeof(SparseEntry) + SparseMatrix::memory(nconstraints_,nraw);
+    double csr  = SparseMatrix::memory(nconstraints_,nraw) + SparseMatrix::memory(dimx_,nraw);
+    double need = raw > csr ? raw : csr;
+
+    outfile->Printf("\n");
+    outfile->Printf("        ==> Sparse constraint matrix <==\n");
+    outfile->Printf("\n");
+    outfile->Printf("        Recorded elements:             %10li\n",nraw);
+    outfile->Printf("        Memory for A and A^T:          %7.2lf mb\n",need / 1024.0 / 1024.0);
+
+    if ( need > (double)available_memory_ ) {
+        outfile->Printf("\n");
+        outfile->Printf("        Not enough memory for explicit A and A^T.\n");
+        outfile->Printf("        Falling back to direct evaluation of A.u and A^T.u.\n");
+        outfile->Printf("\n");
+        return;
+    }
+
+    SparseRecorder recorder(false);
+    RecordConstraints(&recorder);
+
+    A_sparse_  = std::shared_ptr<SparseMatrix>(new SparseMatrix(nconstraints_,dimx_,&recorder));
+    AT_sparse_ = A_sparse_->transpose();
+
+    sparse_constraint_matrix_ = true;
+
+    available_memory_ -= (long int)( SparseMatrix::memory(nconstraints_,A_sparse_->nnz()) 
+                                   + SparseMatrix::memory(dimx_,A_sparse_->nnz()) );
+
+    double end = omp_get_wtime();
+
+    outfile->Printf("        Nonzero elements:              %10li\n",A_sparse_->nnz());
+    outfile->Printf("        Time to build A and A^T:       %7.2lf s\n",end - start);
+    outfile->Printf("\n");
+}
+
+// build explicit A.A^T so that each conjugate gradient iteration is 
+// a single sparse matrix-vector product and A^T.u is never formed
+void v2RDMSolver::BuildSparseGramMatrix(){
+
+    sparse_gram_matrix_ = false;
+    AAT_sparse_.reset();
+
+    // A.A^T is built from the explicit A and A^T
+    if ( !sparse_constraint_matrix_ ) return;
+
+    // with SPIN_ADAPT_D2, the Gram matrix is A.E.E^T.A^T, where E builds 
+    // D2ab, D2aa, and D2bb from the singlet and triplet blocks
+    if ( spin_adapt_d2_ ) {
+        outfile->Printf("\n");
+        outfile->Printf("        A.A^T is not available with SPIN_ADAPT_D2.\n");
+        outfile->Printf("        Keeping A^T.u followed by A.u.\n");
+        outfile->Printf("\n");
+        return;
+    }
+
+    double start = omp_get_wtime();
+
+    long int nnz = A_sparse_->product_nnz(AT_sparse_);
+    double need = SparseMatrix::memory(nconstraints_,nnz);
+
+    outfile->Printf("        Nonzero elements in A.A^T:     %10li\n",nnz);
+    outfile->Printf("        Memory for A.A^T:              %7.2lf mb\n",need / 1024.0 / 1024.0);
+
+    // A.A^T can fill in considerably (e.g., with T2).  only use it if one 
+    // pass over A.A^T moves less data than A^T.u followed by A.u, which 
+    // streams A, A^T, and the primal-sized intermediate A^T.u
+    double gram_traffic = SparseMatrix::memory(nconstraints_,nnz);
+    double two_pass_traffic = SparseMatrix::memory(nconstraints_,A_sparse_->nnz())
+                            + SparseMatrix::memory(dimx_,A_sparse_->nnz())
+                            + 2.0 * dimx_ * sizeof(double);
+    if ( gram_traffic > two_pass_traffic ) {
+        outfile->Printf("\n");
+        outfile->Printf("        A.A^T is denser than A and A^T combined.\n");
+        outfile->Printf("        Keeping A^T.u followed by A.u.\n");
+        outfile->Printf("\n");
+        return;
+    }
+
+    if ( need > (double)available_memory_ ) {
+        outfile->Printf("\n");
+        outfile->Printf("        Not enough memory for explicit A.A^T.\n");
+        outfile->Printf("        Falling back to A^T.u followed by A.u.\n");
+        outfile->Printf("\n");
+        return;
+    }
+
+    AAT_sparse_ = A_sparse_->product(AT_sparse_);
+
+    sparse_gram_matrix_ = true;
+
+    available_memory_ -= (long int)need;
+
+    double end = omp_get_wtime();
+
+    outfile->Printf("        Time to build A.A^T:           %7.2lf s\n",end - start);
+    outfile->Printf("\n");
+}
+
+// diagonal preconditioner for the conjugate gradient solver: the inverse
+// of diag(A.A^T), i.e., of the squared norms of the rows of A
+void v2RDMSolver::BuildCGPreconditioner(){
+
+    cg_preconditioner_ = false;
+
+    double * d = cg_precon_->pointer();
+
+    if ( sparse_constraint_matrix_ ) {
+
+        A_sparse_->row_norms_squared(d);
+
+    }else {
+
+        // temporary explicit A, without transpose
+        long int nraw = 0;
+        {
+            SparseRecorder counter(true);
+            RecordConstraints(&counter);
+            nraw = counter.size();
+        }
+        double need = (double)nraw * sizeof(SparseEntry) + SparseMatrix::memory(nconstraints_,nraw);
+        if ( need > (double)available_memory_ ) {
+            outfile->Printf("\n");
+            outfile->Printf("        Not enough memory to build the CG preconditioner.\n");
+            outfile->Printf("        Falling back to unpreconditioned CG.\n");
+            outfile->Printf("\n");
+            return;
+        }
+
+        SparseRecorder recorder(false);
+        RecordConstraints(&recorder);
+        SparseMatrix A(nconstraints_,dimx_,&recorder);
+        A.row_norms_squared(d);
+    }
+
+    for (long int i = 0; i < nconstraints_; i++) {
+        d[i] = ( d[i] > 1e-12 ) ? 1.0 / d[i] : 1.0;
+    }
+
+    // with SPIN_ADAPT_D2, the CG operator is A.E.E^T.A^T (see cg_Ax), so 
+    // diag(A.A^T) is only an approximation to its diagonal
+    if ( spin_adapt_d2_ ) {
+        outfile->Printf("\n");
+        outfile->Printf("        The CG preconditioner is built from diag(A.A^T), which only\n");
+        outfile->Printf("        approximates diag(A.E.E^T.A^T) with SPIN_ADAPT_D2.\n");
+        outfile->Printf("\n");
+    }
+
+    cg_preconditioner_ = true;
+}
+
+// factorize A.A^T once.  A never changes during a run, so the dual 
+// update only needs triangular solves with this factor.  the factor is 
+// used as a preconditioner for CG, which then converges in one or two 
+// iterations and also absorbs dropped (redundant) pivots.
+void v2RDMSolver::BuildCholeskyFactor(){
+
+    AAT_cholesky_.reset();
+
+    if ( !sparse_constraint_matrix_ ) return;
+
+    // with SPIN_ADAPT_D2, the CG operator is A.E.E^T.A^T (see cg_Ax), and 
+    // a factor of A.A^T is no longer a near-exact preconditioner for it
+    if ( spin_adapt_d2_ ) {
+        outfile->Printf("\n");
+        outfile->Printf("        Cholesky factor of A.A^T is not available with SPIN_ADAPT_D2.\n");
+        outfile->Printf("        Falling back to conjugate gradient solver.\n");
+        outfile->Printf("\n");
+        return;
+    }
+
+    double start = omp_get_wtime();
+
+    // A.A^T is needed only while factorizing
+    std::shared_ptr<SparseMatrix> AAT = AAT_sparse_;
+    if ( !AAT ) {
+        long int nnz = A_sparse_->product_nnz(AT_sparse_);
+        if ( SparseMatrix::memory(nconstraints_,nnz) > (double)available_memory_ ) {
+            outfile->Printf("\n");
+            outfile->Printf("        Not enough memory for A.A^T.\n");
+            outfile->Printf("        Falling back to conjugate gradient solver.\n");
+            outfile->Printf("\n");
+            return;
         }
-        F_DGEMM('t','n',dimensions_[i],dimensions_[i],mydim,1.0,&mat_p[0][0],dimensions_[i],&evec2_p[0][0],dimensions_[i],0.0,z_p+myoffset,dimensions_[i]);
+        AAT = A_sparse_->product(AT_sparse_);
+    }
+    double aat_memory = AAT_sparse_ ? 0.0 : SparseMatrix::memory(nconstraints_,AAT->nnz());
 
+    std::shared_ptr<SparseCholesky> L (new SparseCholesky());
+    if ( !L->analyze(AAT,(double)available_memory_ - aat_memory) ) {
+        outfile->Printf("\n");
+        outfile->Printf("        Not enough memory for Cholesky factor of A.A^T.\n");
+        outfile->Printf("        Falling back to conjugate gradient solver.\n");
+        outfile->Printf("\n");
+        return;
     }
+    L->factorize(AAT);
+
+    AAT_cholesky_ = L;
+
+    available_memory_ -= (long int)L->memory();
+
+    double end = omp_get_wtime();
+
+    outfile->Printf("        Nonzero elements in L:         %10li\n",L->nnz());
+    outfile->Printf("        Memory for L:                  %7.2lf mb\n",L->memory() / 1024.0 / 1024.0);
+    outfile->Printf("        Dropped (dependent) pivots:    %10li\n",L->ndropped());
+    outfile->Printf("        Time to factorize A.A^T:       %7.2lf s\n",end - start);
+    outfile->Printf("\n");
+}
+
+void v2RDMSolver::cg_precondition(long int N,SharedVector z,SharedVector r){
+    AAT_cholesky_->solve(r->pointer(),z->pointer());
 }
 
+void v2RDMSolver::cg_Ax(long int N,SharedVector A,SharedVector ux){
+
+    if ( sparse_gram_matrix_ ) {
+        AAT_sparse_->multiply(ux->pointer(),A->pointer());
+        return;
+    }
+
+    A->zero();
+    bpsdp_ATu(unpacked_,ux);
+    if ( spin_adapt_d2_ ) {
+        SpinAdaptedD2Project(unpacked_->pointer());
+    }
+    bpsdp_Au(A,unpacked_);
+
+}//end cg_Ax
+
 // update x and z.  This version does not symmetrize the matrix M(mu*x+ATy-c)
 // before diagonalization.
 void v2RDMSolver::Update_xz_nonsymmetric() {
@@ -3296,9 +4138,28 @@ void v2RDMSolver::Update_xz_nonsymmetric() {
     // loop over each block of x/z
     for (int i = 0; i < dimensions_.size(); i++) {
         if ( dimensions_[i] == 0 ) continue;
-        int myoffset = 0;
-        for (int j = 0; j < i; j++) {
-            myoffset += dimensions_[j] * dimensions_[j];
+        long int myoffset = dimensions_offset_[i];
+
+        // U+ = M (1 + sign(M)) / 2, U- = M (1 - sign(M)) / 2
+        if ( psd_projection_ == "NEWTON_SCHULZ" && dimensions_[i] >= newton_schulz_min_dim_ ) {
+            long int dim = dimensions_[i];
+            double * myA = (double*)malloc(4*dim*dim*sizeof(double));
+            double * S   = myA + dim*dim;
+            double * X2  = S   + dim*dim;
+            double * tmp = X2  + dim*dim;
+            C_DCOPY(dim*dim,ATy->pointer() + myoffset,1,myA,1);
+            bool converged = MatrixSign(dim,myA,S,X2,tmp);
+            if ( converged ) {
+                F_DGEMM('n','n',dim,dim,dim,1.0,myA,dim,S,dim,0.0,tmp,dim);
+                double * x_p = x->pointer() + myoffset;
+                double * z_p = z->pointer() + myoffset;
+                for (long int pq = 0; pq < dim*dim; pq++) {
+                    x_p[pq] = 0.5 * ( myA[pq] + tmp[pq] ) / mu;
+                    z_p[pq] = 0.5 * ( tmp[pq] - myA[pq] );
+                }
+            }
+            free(myA);
+            if ( converged ) continue;
         }
 
         SharedVector Up     (new Vector(dimensions_[i]));
@@ -3769,8 +4630,19 @@ void v2RDMSolver::PackSpatialDensity() {
 
 void v2RDMSolver::RotateOrbitals(){
 
+    double start = omp_get_wtime();
+
     //UnpackDensityPlusCore();
+
+    // the spatial densities are built from the full squares of x
+    if ( primal_packed_ ) {
+        ExpandPrimal(x->pointer(),unpacked_->pointer());
+        x.swap(unpacked_);
+    }
     PackSpatialDensity();
+    if ( primal_packed_ ) {
+        x.swap(unpacked_);
+    }
 
     if ( orbopt_data_[8] > 0 ) {
         outfile->Printf("\n");
@@ -3797,11 +4669,13 @@ void v2RDMSolver::RotateOrbitals(){
     //      symmetry_energy_order,frzcpi_,nrstc_,amo_,nrstv_,nirrep_,
     //      orbopt_data_,orbopt_outfile_);
 
+    double orbopt_start = omp_get_wtime();
     OrbOpt(orbopt_transformation_matrix_,
           oei_full_sym_,oei_full_dim_,tei_full_sym_,tei_full_dim_,
           d1_act_spatial_sym_,d1_act_spatial_dim_,d2_act_spatial_sym_,d2_act_spatial_dim_,
           symmetry_energy_order,nrstc_,amo_,nrstv_,nirrep_,
           orbopt_data_,orbopt_outfile_,X_);
+    timers_.accumulate(TIMER_ORBOPT,omp_get_wtime() - orbopt_start);
 
     if ( orbopt_data_[8] > 0 ) {
         outfile->Printf("            Orbital Optimization %s in %3i iterations \n",(int)orbopt_data_[13] ? "converged" : "did not converge",(int)orbopt_data_[10]);
@@ -3815,6 +4689,8 @@ void v2RDMSolver::RotateOrbitals(){
     }
 
     RepackIntegrals();
+
+    timers_.accumulate(TIMER_ROTATE_ORBITALS,omp_get_wtime() - start);
 }
 
 }} //end namespaces
@@ -46,6 +46,10 @@
 // greg
 #include"fortran.h"
 
+#include"sparse_matrix.h"
+#include"sparse_cholesky.h"
+#include"timers.h"
+
 // TODO: move to psifiles.h
 #define PSIF_DCC_QMO          268
 #define PSIF_V2RDM_CHECKPOINT 269
@@ -64,6 +68,12 @@ namespace psi{ namespace v2rdm_casscf{
 class v2RDMSolver: public Wavefunction{
   public:
     v2RDMSolver(SharedWavefunction reference_wavefunction,Options & options);
+
+    /// synthetic active space (amopi active orbitals per irrep; nalpha and nbeta 
+    /// active electrons) without a reference wavefunction.  only the constraint 
+    /// maps are built, so the solver can do nothing but BenchmarkConstraints()
+    v2RDMSolver(Options & options,int nirrep,int * amopi,int nalpha,int nbeta);
+
     ~v2RDMSolver();
     void common_init();
     double compute_energy();
@@ -72,6 +82,11 @@ class v2RDMSolver: public Wavefunction{
 
     // public methods
     void cg_Ax(long int n,SharedVector A, SharedVector u);
+    void cg_precondition(long int n,SharedVector z, SharedVector r);
+
+    /// time the A.u and A^T.u kernels for each constraint family and check 
+    /// that <A.u,v> = <u,A^T.v>.  returns false if any check fails
+    bool BenchmarkConstraints(int nrepeat);
 
   protected:
 
@@ -99,6 +114,9 @@ class v2RDMSolver: public Wavefunction{
     /// constrain spin?
     bool constrain_spin_;
 
+    /// closed-shell singlet: beta blocks share storage with alpha blocks?
+    bool closed_shell_;
+
     /// symmetry product table:
     int * table;
 
@@ -159,20 +177,43 @@ class v2RDMSolver: public Wavefunction{
     /// three-index integral buffer
     double * Qmo_;
 
+    /// allocate/free Qmo_.  with DF_INTEGRAL_STORAGE = DISK, Qmo_ is a 
+    /// memory-mapped scratch file that is paged in and out by the OS
+    void AllocateThreeIndexBuffer(long int n);
+    void FreeThreeIndexBuffer();
+
+    /// size in bytes of the mapping behind Qmo_ (0 when Qmo_ is held in core)
+    size_t qmo_map_bytes_;
+
+    /// strides of the auxiliary and orbital-pair indices of Qmo_.  by default, 
+    /// Qmo_ is stored as (Q|mn) with Q as the slow index.  DF_INTEGRAL_ORDER = MNQ 
+    /// stores (mn|Q) instead so that contractions over Q run over contiguous memory
+    long int qmo_qstride_;
+    long int qmo_pqstride_;
+
     /// grab one-electron integrals (T+V) in MO basis
     SharedMatrix GetOEI();
 
-    /// DIIS stuff
-    void DIIS(double*c,long int nvec,int replace_diis_iter);
-    void DIIS_WriteOldVector(long int iter,int diis_iter,int replace_diis_iter);
-    void DIIS_WriteErrorVector(int diis_iter,int replace_diis_iter,int iter);
-    void DIIS_Extrapolate(int diis_iter,int&replace_diis_iter);
+    /// DIIS stuff (in-memory ring buffer of (rx, rz) and their errors)
+    void DIIS_Initialize();
+    void DIIS_Finalize();
+    void DIIS_Reset();
+    bool DIIS_Collecting();
+    void DIIS_StoreVectors();
+    bool DIIS_Extrapolate();
+    void DIIS_SquarePacked(double * in, double * out);
     long int maxdiis_;
+    long int diis_update_frequency_;
     double * diisvec_;
-    double * junk1;
-    double * junk2;
     long int diis_oiter_;
     long int dimdiis_;
+    double * diis_vectors_;
+    double * diis_errors_;
+    double * diis_previous_;
+    double * diis_gram_;
+    long int diis_nvec_;
+    long int diis_head_;
+    bool diis_have_previous_;
 
     /// offsets
     int * d1aoff;
@@ -230,6 +271,25 @@ class v2RDMSolver: public Wavefunction{
 
     int offset;
 
+    /// first constraint of each family.  the A.u and A^T.u kernels start 
+    /// from these rather than from a running offset, so the families are 
+    /// independent and can be evaluated concurrently
+    long int d2_constraints_offset_;
+    long int q2_constraints_offset_;
+    long int g2_constraints_offset_;
+    long int t1_constraints_offset_;
+    long int t2_constraints_offset_;
+    long int d3_constraints_offset_;
+
+    /// evaluate the constraint families in bpsdp_Au / bpsdp_ATu as OpenMP tasks?
+    bool constraint_tasks_;
+
+    /// use the reference implementation of the T2 constraints in A.u and A^T.u?
+    bool slow_t2_constraints_;
+
+    /// private A^T.u accumulators for the constraint families evaluated as tasks
+    double * constraint_task_buffer_;
+
     // mapping arrays with abelian symmetry
     void BuildBasis();
     int * full_basis;
@@ -279,6 +339,9 @@ class v2RDMSolver: public Wavefunction{
 
     void BuildConstraints();
 
+    /// pick conditions; build index maps, block offsets, and dimensions_
+    void BuildConstraintMaps();
+
     void Guess();
     void T1_constraints_guess(SharedVector u);
     void T2_constraints_guess(SharedVector u);
@@ -313,6 +376,64 @@ class v2RDMSolver: public Wavefunction{
     void T2_tilde_constraints_ATu(SharedVector A,SharedVector u);
     void D3_constraints_ATu(SharedVector A,SharedVector u);
 
+    /// A^T.u kernels, templated on the vector type.  TargetType / SourceType 
+    /// are double * for the matrix-free products, or SparseTarget / SparseSource 
+    /// to record the explicit constraint matrix (see sparse_matrix.h).  each 
+    /// returns its running offset, which should be the next family's first row
+    template <typename TargetType, typename SourceType> long int D2_constraints_ATu(TargetType A_p,SourceType u_p);
+    template <typename TargetType, typename SourceType> long int Q2_constraints_ATu(TargetType A_p,SourceType u_p);
+    template <typename TargetType, typename SourceType> long int Q2_constraints_ATu_spin_adapted(TargetType A_p,SourceType u_p);
+    template <typename TargetType, typename SourceType> long int G2_constraints_ATu(TargetType A_p,SourceType u_p);
+    template <typename TargetType, typename SourceType> long int G2_constraints_ATu_spin_adapted(TargetType A_p,SourceType u_p);
+    template <typename TargetType, typename SourceType> long int T1_constraints_ATu(TargetType A_p,SourceType u_p);
+    template <typename TargetType, typename SourceType> long int T2_constraints_ATu(TargetType A_p,SourceType u_p);
+    template <typename TargetType, typename SourceType> long int T2_constraints_ATu_slow(TargetType A_p,SourceType u_p);
+    template <typename TargetType, typename SourceType> long int D3_constraints_ATu(TargetType A_p,SourceType u_p);
+
+    /// bpsdp_Au / bpsdp_ATu with the constraint families evaluated as OpenMP tasks
+    void bpsdp_Au_tasks(SharedVector A, SharedVector u);
+    void bpsdp_ATu_tasks(SharedVector A, SharedVector u);
+
+    /// number of private A^T.u accumulators needed by bpsdp_ATu_tasks
+    int NumberOfConstraintTaskBuffers();
+
+    /// record all constraints in the order used by bpsdp_ATu
+    void RecordConstraints(SparseRecorder * recorder);
+
+    /// build explicit sparse representations of A and A^T
+    void BuildSparseConstraintMatrix();
+
+    /// use explicit sparse A and A^T in bpsdp_Au / bpsdp_ATu?
+    bool sparse_constraint_matrix_;
+
+    /// explicit constraint matrix, A, and its transpose
+    std::shared_ptr<SparseMatrix> A_sparse_;
+    std::shared_ptr<SparseMatrix> AT_sparse_;
+
+    /// build explicit sparse A.A^T for the conjugate gradient solver
+    void BuildSparseGramMatrix();
+
+    /// use explicit sparse A.A^T in cg_Ax?
+    bool sparse_gram_matrix_;
+
+    /// explicit A.A^T
+    std::shared_ptr<SparseMatrix> AAT_sparse_;
+
+    /// build diagonal (Jacobi) preconditioner for the conjugate gradient solver
+    void BuildCGPreconditioner();
+
+    /// use preconditioned conjugate gradient solver?
+    bool cg_preconditioner_;
+
+    /// inverse of the diagonal of A.A^T
+    SharedVector cg_precon_;
+
+    /// factorize A.A^T once for the dual update
+    void BuildCholeskyFactor();
+
+    /// sparse Cholesky factor of A.A^T (NULL if not used)
+    std::shared_ptr<SparseCholesky> AAT_cholesky_;
+
     /// SCF energy
     double escf_;
 
@@ -331,12 +452,162 @@ class v2RDMSolver: public Wavefunction{
     SharedVector z;      // second dual solution
     SharedVector rx;       // square root of x (for diis)
     SharedVector rz;       // square root of z (for diis)
-    SharedVector rx_error; // error vector for x (for diis)
-    SharedVector rz_error; // error vector for z (for diis)
 
     void Update_xz();
     void Update_xz_nonsymmetric();
 
+    /// offset of each block of x/z (see dimensions_) in the primal vector
+    std::vector<long int> dimensions_offset_;
+
+    /// store the blocks of x, z, c, ATy, rx, and rz as packed lower triangles?
+    bool packed_storage_;
+
+    /// is x currently packed? (only during the iterations; z, c, ATy, rx, 
+    /// and rz stay packed throughout if packed_storage_ is set)
+    bool primal_packed_;
+
+    /// offset of each block in the packed vectors, and their length
+    std::vector<long int> dimensions_packed_offset_;
+    long int dimx_packed_;
+
+    /// length of z, c, ATy, rx, and rz (dimx_, dimx_packed_, or smaller 
+    /// with spin_adapt_d2_)
+    long int primal_dim_;
+
+    /// full-square primal vector for the constraint kernels when the 
+    /// others are packed.  otherwise, the same vector as ATy
+    SharedVector unpacked_;
+
+    /// symmetric dim x dim block <-> packed lower triangle, with the 
+    /// off-diagonal elements scaled by sqrt(2) so that dot products and 
+    /// norms are unchanged.  PackBlock is also the adjoint of UnpackBlock, 
+    /// i.e., it symmetrizes a square block that is not symmetric
+    void PackBlock(long int dim, double * full, double * packed);
+    void UnpackBlock(long int dim, double * packed, double * full);
+
+    /// PackBlock / UnpackBlock for every block of a primal vector
+    void PackPrimal(double * full, double * packed);
+    void UnpackPrimal(double * packed, double * full);
+
+    /// offset in z (packed or spin-adapted) of the block at "offset" in x 
+    /// (e.g., d1aoff[h]).  not valid for the D2 blocks with spin_adapt_d2_
+    long int PrimalOffset(long int offset);
+
+    /// store D2 as singlet and triplet blocks during the iterations?
+    bool spin_adapt_d2_;
+
+    /// z, c, ATy, rx, and rz (and x, during the iterations) are not 
+    /// laid out like x: packed_storage_ || spin_adapt_d2_
+    bool reduced_primal_;
+
+    /// length of the D2ab, D2aa, and D2bb blocks at the start of x
+    long int d2_full_dim_;
+
+    /// full squares of the D2s and D2t blocks (workspace for spin_adapt_d2_)
+    double * spin_adapted_d2_scratch_;
+
+    /// singlet (s) and triplet (t) blocks of symmetry h <-> D2ab, D2aa, 
+    /// and D2bb in x.  Contract is the adjoint of Expand, and Expand is an 
+    /// isometry, so Contract(Expand(s,t)) = (s,t)
+    void SpinAdaptedD2Expand(int h, double * s, double * t, double * full);
+    void SpinAdaptedD2Contract(int h, double * full, double * s, double * t);
+
+    /// Expand / Contract, for all irreps.  the D2s and D2t blocks are at 
+    /// the start of a z-like vector
+    void SpinAdaptedD2ExpandBlocks(double * in, double * full);
+    void SpinAdaptedD2ContractBlocks(double * full, double * out);
+
+    /// replace the D2 blocks of x by Expand(Contract(x)), for all irreps
+    void SpinAdaptedD2Project(double * full);
+
+    /// z-like (packed and/or spin-adapted) <-> x-like vectors
+    void ExpandPrimal(double * in, double * out);
+    void ContractPrimal(double * in, double * out);
+
+    /// A.u and A^T.u for u (or A) stored like z: packed if packed_storage_ 
+    /// is set, spin adapted if spin_adapt_d2_ is set.  the constraint 
+    /// kernels work on full squares in unpacked_
+    void bpsdp_Au_packed(SharedVector A, SharedVector u);
+    void bpsdp_ATu_packed(SharedVector A, SharedVector u);
+
+    /// switch x between packed storage (for the iterations) and full 
+    /// squares (for everything else)
+    void PackX();
+    void UnpackX();
+
+    /// set up offsets, block schedule, and workspace requirements for Update_xz
+    void BuildUpdateXZSchedule();
+
+    /// allocate per-thread workspace for Update_xz
+    void AllocateUpdateXZWorkspace();
+
+    /// project one block of M(mu*x + ATy - c) onto x and z
+    void UpdateBlock(int block, double * work, long int lwork, int * iwork, long int liwork);
+
+    /// project one block, given as full squares A_p = ATy (not yet 
+    /// symmetrized), x_p, z_p, and rx_p, rz_p (NULL unless update_xz_sqrt_)
+    void ProjectBlock(int block, double * A_p, double * x_p, double * z_p, double * rx_p, double * rz_p,
+                      double * work, long int lwork, int * iwork, long int liwork);
+
+    /// project one block, computing only the smaller of U+ and U- (dsyevr)
+    void UpdateBlockPartial(int block, double * A_p, double * x_p, double * z_p,
+                            double * work, long int lwork, int * iwork, long int liwork);
+
+    /// project one block, refining the eigenvectors of the last iteration
+    bool UpdateBlockWarm(int block, double * A_p, double * x_p, double * z_p, double * rx_p, double * rz_p, double * work);
+
+    /// project one block with the matrix sign function (Newton-Schulz)
+    bool UpdateBlockNewtonSchulz(int block, double * A_p, double * x_p, double * z_p, double * work);
+
+    /// sign function of a (not necessarily symmetric) matrix with real eigenvalues, using only DGEMM
+    bool MatrixSign(long int dim, double * mat, double * X, double * X2, double * tmp);
+
+    /// algorithm for the projection in Update_xz (FULL, PARTIAL, WARM_START, or NEWTON_SCHULZ)
+    std::string psd_projection_;
+
+    /// smallest block for which the Newton-Schulz projection is used
+    int newton_schulz_min_dim_;
+
+    /// eigenvectors of each block from the last Update_xz (WARM_START)
+    double * update_xz_evec_;
+
+    /// warm starts since the eigenvectors of a block were last computed from scratch, plus one (0 = none)
+    std::vector<int> update_xz_warm_;
+
+    /// also build rx and rz (square roots of x and z) in Update_xz?
+    bool update_xz_sqrt_;
+
+    /// number of positive eigenvalues of each block in the last Update_xz (-1 if unknown)
+    std::vector<long int> update_xz_npos_;
+
+    /// blocks diagonalized one at a time, with threaded BLAS/LAPACK
+    std::vector<int> update_xz_serial_blocks_;
+
+    /// groups of blocks distributed over threads, largest first
+    std::vector< std::vector<int> > update_xz_tasks_;
+
+    /// workspace for serial blocks and for each thread
+    double * update_xz_serial_work_;
+    std::vector<double*> update_xz_thread_work_;
+    long int update_xz_serial_lwork_;
+    long int update_xz_thread_lwork_;
+    int * update_xz_serial_iwork_;
+    std::vector<int*> update_xz_thread_iwork_;
+    long int update_xz_serial_liwork_;
+    long int update_xz_thread_liwork_;
+
+    /// total Update_xz workspace (in doubles)
+    double update_xz_memory_;
+
+    /// per-phase wall time and peak memory
+    Timers timers_;
+
+    /// index of the Update_xz timer for block 0 (one timer per block follows)
+    int update_xz_block_timers_;
+
+    /// print timers and write them to disk (TIMERS_WRITE, TIMERS_FORMAT)
+    void WriteTimers();
+
     /// compute natural orbitals and transform OPDM and TPDM to natural orbital basis
     void ComputeNaturalOrbitals();
 
@@ -351,6 +622,15 @@ class v2RDMSolver: public Wavefunction{
 
     /// full space of integrals for MO gradient / Hessian, blocked by symmetry
     double * tei_full_sym_;
+
+    /// with TEI_STORAGE = ACTIVE, tei_full_sym_ only holds pairs of core and 
+    /// active orbitals.  those are the first gems_plus_core[h] pairs of each 
+    /// block, so each block of tei_full_sym_ is a prefix of the full block
+    bool active_space_tei_;
+
+    /// number of pairs per irrep stored in tei_full_sym_ (gems_full or gems_plus_core)
+    int * TEIPairs() { return active_space_tei_ ? gems_plus_core : gems_full; }
+
     double * oei_full_sym_;
     // gidofalvi -- modified the type of tei_full_dim_ so that it is correct for large bases
     long int tei_full_dim_;
@@ -376,11 +656,19 @@ class v2RDMSolver: public Wavefunction{
 
     /// repack rotated full-space integrals into active-space integrals
     void RepackIntegrals();
-    void RepackIntegralsDF();
+
+    /// number of auxiliary functions per batch that fits in available_memory_
+    long int ThreeIndexBatchSize(long int per_Q);
+
+    /// build active-space (tu|vw) from the 3-index integrals, batched over Q
+    void ActiveTEIDF(double * tei_act);
 
     /// compute frozen core energy and adjust oeis
     void FrozenCoreEnergy();
 
+    /// core coulomb/exchange terms from the 3-index integrals
+    double FrozenCoreDF(double * fock_act);
+
     /// function to rotate orbitals
     void RotateOrbitals();
 
@@ -535,7 +535,7 @@ void v2RDMSolver::ReadTPDM(){
             for (int k = 0; k < nmo_; k++) {
                 for (int l = 0; l < nmo_; l++) {
 
-                    double eri = C_DDOT(nQ_,Qmo_ + INDEX(i,k),(nmo_-nfrzv_)*(nmo_-nfrzv_+1)/2,Qmo_+INDEX(j,l),(nmo_-nfrzv_)*(nmo_-nfrzv_+1)/2);
+                    double eri = C_DDOT(nQ_,Qmo_ + INDEX(i,k)*qmo_pqstride_,qmo_qstride_,Qmo_ + INDEX(j,l)*qmo_pqstride_,qmo_qstride_);
                     
                     en2 +=       eri * D2ab[i*nmo_*nmo_*nmo_+j*nmo_*nmo_+k*nmo_+l];
                     en2 += 0.5 * eri * D2aa[i*nmo_*nmo_*nmo_+j*nmo_*nmo_+k*nmo_+l];